@@ -0,0 +1,115 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class IOStatus {
+  Completed,
+  Failed,
+  Cancelled,
+};
+
+struct IOResult {
+  uint64_t id = 0;
+  IOStatus status = IOStatus::Failed;
+  std::string path;
+  std::vector<uint8_t> data;  // Empty unless Completed, shorter than asked when the file ends first
+  int error = 0;              // errno of the call that failed
+};
+
+// Runs on the thread that calls AsyncIO::poll(), the data can be moved out
+using IOCallback = std::function<void(IOResult& result)>;
+
+struct IOStats {
+  int pending = 0;
+  int inFlight = 0;
+  int completed = 0;
+  int failed = 0;
+  int cancelled = 0;
+  int batches = 0;  // Submissions to the kernel, each one carrying every read that was ready
+  size_t bytesRead = 0;
+};
+
+// Reads files off the calling thread. With io_uring (Linux 5.1+) one thread batches every queued
+// read into a single submission and reaps the completions; elsewhere, or when the kernel refuses
+// io_uring, a few threads read with pread. Queued reads are started highest priority first and
+// their callbacks are delivered by poll(), which the engine calls on the main thread every frame.
+class AsyncIO {
+private:
+  struct Request {
+    uint64_t id = 0;
+    std::string path;
+    uint64_t offset = 0;
+    size_t size = 0;  // 0 = to the end of the file
+    float priority = 1.0f;
+    IOCallback callback;
+
+    int fd = -1;
+    std::vector<uint8_t> data;
+    size_t done = 0;
+    bool cancelled = false;
+  };
+
+  struct Completion {
+    IOResult result;
+    IOCallback callback;
+  };
+
+  struct Ring;  // io_uring state, only defined where it is available
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::vector<std::unique_ptr<Request>> m_pending;
+  std::unordered_map<uint64_t, std::unique_ptr<Request>> m_inFlight;
+  std::deque<Completion> m_completed;
+  std::vector<std::thread> m_threads;
+  std::unique_ptr<Ring> m_ring;
+  uint64_t m_nextId;
+  bool m_stopping;
+  IOStats m_stats;
+
+  // Called with m_mutex held
+  std::unique_ptr<Request> takeNext();
+  void complete(Request* request, IOStatus status, int error);
+
+  bool openFile(Request& request, int& error) const;
+  void closeFile(Request& request) const;
+
+  void readerLoop();
+  void ringLoop();
+
+public:
+  // readerThreads is only used without io_uring, queueDepth bounds the reads in flight with it
+  explicit AsyncIO(unsigned int readerThreads = 2, unsigned int queueDepth = 64);
+  // Waits for the reads in flight, queued reads are dropped without calling back
+  ~AsyncIO();
+
+  AsyncIO(const AsyncIO&) = delete;
+  AsyncIO& operator=(const AsyncIO&) = delete;
+
+  // Returns a request id (never 0). Reads the whole file, or size bytes from offset.
+  uint64_t read(const std::string& path, IOCallback callback, float priority = 1.0f);
+  uint64_t read(const std::string& path, uint64_t offset, size_t size, IOCallback callback, float priority = 1.0f);
+
+  // Only affects reads that haven't started yet
+  void setPriority(uint64_t id, float priority);
+  // The callback still runs, with IOStatus::Cancelled. False when the result was already delivered.
+  bool cancel(uint64_t id);
+
+  // Delivers the finished reads, returns how many callbacks ran
+  int poll();
+
+  bool usesIoUring() const {
+    return m_ring != nullptr;
+  }
+  IOStats getStats();
+};
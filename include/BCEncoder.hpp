@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include "CompressedImage.hpp"
+
+// CPU encoders for the BCn formats the engine loads. Block functions take one 4x4 block as 16
+// RGBA8 texels in row-major order and write 8 (BC1/BC4) or 16 bytes.
+namespace BCEncoder {
+// Four color mode, or three colors + transparent when the block has alpha below 128
+void encodeBC1(const uint8_t* rgba, uint8_t* out);
+// BC4 alpha + four color BC1
+void encodeBC3(const uint8_t* rgba, uint8_t* out);
+void encodeBC4(const uint8_t* rgba, uint8_t* out, int channel = 0);
+// Red and green as two BC4 blocks
+void encodeBC5(const uint8_t* rgba, uint8_t* out);
+// Mode 6 only: one subset, RGBA 7.7.7.7 endpoints with a p-bit each and 4-bit indices
+void encodeBC7(const uint8_t* rgba, uint8_t* out);
+
+BlockFormat chooseFormat(TextureUsage usage);
+
+// Box filtered half size image. Color maps are filtered in linear space, normals renormalized.
+std::vector<uint8_t> downsample(const uint8_t* rgba, int width, int height, TextureUsage usage);
+
+// Compresses an RGBA8 image (and its mip chain), spreading the block rows over all cores
+CompressedImage compress(const uint8_t* rgba,
+                         int width,
+                         int height,
+                         BlockFormat format,
+                         TextureUsage usage,
+                         bool generateMips = true);
+}  // namespace BCEncoder
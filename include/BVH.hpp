@@ -0,0 +1,109 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "Bounds.hpp"
+
+// Node of the flat BVH array. Children are indices into the same array so the whole tree is one
+// contiguous allocation; the SAH builder lays nodes out depth-first (left child == parent + 1).
+struct alignas(16) BVHNode {
+  AABB bounds;
+  int parent = -1;
+  int left = -1;   // -1 for leaves (also the free list link for unused nodes)
+  int right = -1;
+  int height = 0;  // 0 for leaves, -1 for nodes on the free list
+  int userData = -1;
+
+  bool isLeaf() const {
+    return right == -1;
+  }
+};
+
+struct BVHBuildItem {
+  AABB bounds;
+  int userData;
+};
+
+struct RaycastHit {
+  int userData = -1;
+  float distance = 0.0f;
+};
+
+struct BVHStats {
+  int nodeCount = 0;
+  int leafCount = 0;
+  int height = 0;
+  float sahCost = 0.0f;  // Sum of internal node areas relative to the root area
+};
+
+// Optional narrow phase for ray casts: return true and write the exact hit distance if the object is hit
+using RaycastCallback = std::function<bool(int userData, const Ray& ray, float& distance)>;
+
+// Dynamic bounding volume hierarchy. Static content is bulk built with a binned SAH split, moving
+// objects are inserted incrementally (branch and bound sibling search) and refit in place with
+// tree rotations when they leave their fattened bounds.
+class BVH {
+private:
+  std::vector<BVHNode> m_nodes;
+  int m_root;
+  int m_freeList;
+  int m_leafCount;
+  float m_margin;
+
+  int allocateNode();
+  void freeNode(int node);
+
+  int buildRecursive(const std::vector<BVHBuildItem>& items,
+                     std::vector<int>& order,
+                     std::vector<int>& proxies,
+                     int begin,
+                     int end,
+                     int parent);
+
+  void insertLeaf(int leaf);
+  void removeLeaf(int leaf);
+  void refitAncestors(int node);
+  void rotate(int node);
+  void replaceChild(int parent, int oldChild, int newChild);
+
+public:
+  static constexpr int NullNode = -1;
+
+  explicit BVH(float margin = 0.1f);
+  ~BVH() = default;
+
+  // Rebuilds the whole tree from scratch. Returns the proxy of every item (same order as items).
+  std::vector<int> build(const std::vector<BVHBuildItem>& items);
+  void clear();
+
+  // Dynamic proxies - the stored bounds are inflated by the margin so small motion costs nothing
+  int insert(const AABB& bounds, int userData);
+  void remove(int proxy);
+
+  // Returns true if the tree had to be refit (the object left its fattened bounds)
+  bool move(int proxy, const AABB& bounds);
+
+  // Full bottom-up refit, for when many proxies were moved through setBounds
+  void setBounds(int proxy, const AABB& bounds);
+  void refit();
+
+  // Queries - results are the userData of the leaves
+  void queryFrustum(const Frustum& frustum, std::vector<int>& results) const;
+  void queryOverlap(const AABB& bounds, std::vector<int>& results) const;
+  bool raycast(const Ray& ray, float maxDistance, RaycastHit& hit, const RaycastCallback& narrowPhase = nullptr) const;
+
+  const AABB& getBounds(int proxy) const {
+    return m_nodes[proxy].bounds;
+  }
+  int getUserData(int proxy) const {
+    return m_nodes[proxy].userData;
+  }
+  int getRoot() const {
+    return m_root;
+  }
+  const std::vector<BVHNode>& getNodes() const {
+    return m_nodes;
+  }
+
+  BVHStats computeStats() const;
+};
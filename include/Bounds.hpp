@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <glm/glm.hpp>
+
+// Axis aligned bounding box used by the spatial structures (BVH, culling, picking)
+struct AABB {
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+
+  AABB() = default;
+  AABB(const glm::vec3& minCorner, const glm::vec3& maxCorner) : min(minCorner), max(maxCorner) {}
+
+  // An inverted box that any merge will overwrite
+  static AABB empty();
+
+  glm::vec3 center() const {
+    return (min + max) * 0.5f;
+  }
+  glm::vec3 extent() const {
+    return max - min;
+  }
+
+  bool isValid() const;
+  float surfaceArea() const;
+  float volume() const;
+
+  void expand(const glm::vec3& point);
+  void expand(const AABB& other);
+  AABB inflated(float margin) const;
+
+  bool contains(const AABB& other) const;
+  bool overlaps(const AABB& other) const;
+
+  // Bounds of this box after an affine transform (Arvo's method)
+  AABB transformed(const glm::mat4& transform) const;
+
+  static AABB merge(const AABB& a, const AABB& b);
+};
+
+struct Ray {
+  glm::vec3 origin;
+  glm::vec3 direction;
+  glm::vec3 invDirection;
+
+  Ray(const glm::vec3& o, const glm::vec3& d);
+
+  glm::vec3 at(float t) const {
+    return origin + direction * t;
+  }
+
+  // Slab test - writes the entry distance when the ray hits the box within [0, maxT]
+  bool intersects(const AABB& box, float maxT, float& tEntry) const;
+
+  // Builds a world space picking ray from window coordinates (origin top-left)
+  static Ray fromScreen(double x, double y, int width, int height, const glm::mat4& inverseViewProjection);
+};
+
+enum class Containment { Outside, Intersect, Inside };
+
+// Six clip planes extracted from a view-projection matrix (Gribb/Hartmann), normals pointing inward
+struct Frustum {
+  enum Plane { Left = 0, Right, Bottom, Top, Near, Far };
+
+  std::array<glm::vec4, 6> planes;
+
+  static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+  Containment classify(const AABB& box) const;
+
+  // Hierarchical variant: only tests the planes set in planeMask and clears the bits of
+  // planes the box is fully inside of, so children of the box can skip them
+  Containment classify(const AABB& box, unsigned& planeMask) const;
+
+  bool intersects(const AABB& box) const;
+  bool intersectsSphere(const glm::vec3& center, float radius) const;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include "JobSystem.hpp"
+#include "ResidencyManager.hpp"
+#include "Shader.hpp"
+
+struct PointLight {
+  glm::vec3 position = glm::vec3(0.0f);  // World space
+  float radius = 5.0f;                   // Light is faded out to nothing at this distance
+  glm::vec3 color = glm::vec3(1.0f);
+  float intensity = 1.0f;
+};
+
+struct LightingStats {
+  int lights = 0;
+  int visibleLights = 0;     // Lights touching at least one cluster
+  int lightIndices = 0;      // Entries of all the clusters' light lists
+  int maxClusterLights = 0;  // Longest light list
+  int overflows = 0;         // Clusters that had more than MaxClusterLights lights, the rest is dropped
+  float binMs = 0.0f;
+};
+
+// Clustered forward lighting. The view frustum is split into a grid of clusters, screen tiles in
+// x and y and exponentially spaced depth slices in z. Every frame the lights are tested against the
+// clusters on the CPU (a depth slice per job, 4 lights per test with SSE) and each cluster gets a
+// compact list of the lights reaching it. The lights, the lists and the per-cluster ranges are
+// uploaded as buffer textures, so a fragment only loops over the lights of its own cluster.
+// Shaders get the lookup from resources/shaders/lighting.glsl.
+class ClusteredLighting {
+public:
+  static constexpr int ClustersX = 16;
+  static constexpr int ClustersY = 9;
+  static constexpr int ClustersZ = 24;
+  static constexpr int ClusterCount = ClustersX * ClustersY * ClustersZ;
+  static constexpr int MaxClusterLights = 256;
+  static constexpr int MaxLights = 65535;  // Indices are 16 bit
+  static constexpr int FirstUnit = 8;      // Texture units FirstUnit..FirstUnit+2, after the material arrays
+
+private:
+  struct ClusterBounds {
+    glm::vec3 min;
+    glm::vec3 max;
+  };
+
+  // What one depth slice found, merged into the frame's lists afterwards
+  struct SliceResult {
+    std::vector<uint16_t> indices;
+    std::vector<uint32_t> counts;  // Per cluster of the slice
+    int overflows = 0;
+
+    // The lights reaching into the slice, kept to reuse the allocations
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+    std::vector<uint16_t> ids;
+  };
+
+  JobSystem* m_jobs;
+  ResidencyManager* m_residency;
+  std::vector<PointLight> m_lights;
+  bool m_lightsDirty;
+
+  // The grid, rebuilt when the projection changes
+  std::vector<ClusterBounds> m_clusters;
+  float m_fovY;
+  float m_aspect;
+  float m_near;
+  float m_far;
+
+  // Per frame, view space lights laid out for 4-wide tests
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<float> m_z;
+  std::vector<float> m_radius;
+  std::vector<SliceResult> m_slices;
+  std::vector<uint32_t> m_ranges;  // Offset and count per cluster
+  std::vector<uint16_t> m_indices;
+  std::vector<uint8_t> m_visible;
+
+  GLuint m_buffers[3];   // Lights, ranges, indices
+  GLuint m_textures[3];
+  size_t m_capacity[3];  // Bytes allocated for each buffer
+  int m_residencyId;
+  LightingStats m_stats;
+
+  void buildClusters(float fovY, float aspect, float nearPlane, float farPlane);
+  void binSlice(int slice);
+  void upload(int buffer, const void* data, size_t bytes);
+
+public:
+  explicit ClusteredLighting(JobSystem* jobs = nullptr, ResidencyManager* residency = nullptr);
+  ~ClusteredLighting();
+
+  ClusteredLighting(const ClusteredLighting&) = delete;
+  ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+  // Returns the light's index, -1 past MaxLights
+  int addLight(const PointLight& light);
+  void setLight(int index, const PointLight& light);
+  void clearLights();
+  const std::vector<PointLight>& getLights() const {
+    return m_lights;
+  }
+
+  // Bins the lights for this camera and uploads the result. The projection is a symmetric
+  // perspective one with these parameters.
+  void update(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane);
+  // Sets the lighting.glsl uniforms of the shader, which must be in use
+  void bind(const Shader& shader, int viewportWidth, int viewportHeight) const;
+
+  const LightingStats& getStats() const {
+    return m_stats;
+  }
+};
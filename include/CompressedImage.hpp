@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GPU block compression formats (4x4 texel blocks). BC1/BC3/BC7 hold color and come in sRGB and
+// linear variants, BC4 holds one linear channel and BC5 two (normal map XY).
+enum class BlockFormat {
+  BC1,
+  BC3,
+  BC4,
+  BC5,
+  BC7,
+};
+
+// What a texture map holds decides its color space and which block format suits it
+enum class TextureUsage {
+  Color,   // Albedo, emissive - sRGB
+  Normal,  // Tangent space normal map - linear, XY only
+  Mask,    // Roughness, metallic, AO, height - linear, one channel
+  Data,    // Anything else linear
+};
+
+struct CompressedMip {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> data;
+};
+
+// Pre-compressed texture with its whole mip chain, as stored in a KTX2 or DDS container. Rows are
+// kept in the same bottom-up order the uncompressed image path uploads; KTX2 files marked top-down
+// (KTXorientation "rd", the default) are flipped on load.
+struct CompressedImage {
+  BlockFormat format = BlockFormat::BC1;
+  bool srgb = false;
+  int width = 0;
+  int height = 0;
+  std::vector<CompressedMip> mips;
+
+  bool isValid() const {
+    return width > 0 && height > 0 && !mips.empty();
+  }
+
+  // Picks the container from the extension (.ktx2 or .dds)
+  static bool load(const std::string& filepath, CompressedImage& image);
+  // Picks the container from the data's magic bytes
+  static bool load(const uint8_t* data, size_t size, CompressedImage& image);
+  static bool loadKTX2(const uint8_t* data, size_t size, CompressedImage& image);
+  static bool loadDDS(const uint8_t* data, size_t size, CompressedImage& image);
+
+  bool save(const std::string& filepath) const;
+  bool saveKTX2(const std::string& filepath) const;
+  bool saveDDS(const std::string& filepath) const;
+  // The KTX2 file as it would be written, for packing
+  std::vector<uint8_t> encodeKTX2() const;
+};
+
+unsigned int blockBytes(BlockFormat format);
+size_t compressedSize(BlockFormat format, int width, int height);
+const char* blockFormatName(BlockFormat format);
+bool isColorFormat(BlockFormat format);
+
+bool isCompressedTexturePath(const std::string& filepath);
+// Guesses the map type from the last token of the file name (_Normal, _Roughness, _AO ...), ignoring a
+// trailing resolution (_4K). Defaults to Color.
+TextureUsage usageFromPath(const std::string& filepath);
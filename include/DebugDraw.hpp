@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+#include "ResidencyManager.hpp"
+#include "Shader.hpp"
+
+// Debug drawing is compiled out of builds that define NDEBUG, unless MACHI_DEBUG_DRAW is set to 1
+#ifndef MACHI_DEBUG_DRAW
+#ifdef NDEBUG
+#define MACHI_DEBUG_DRAW 0
+#else
+#define MACHI_DEBUG_DRAW 1
+#endif
+#endif
+
+enum class DebugDepth {
+  Tested,   // Hidden behind the scene
+  Overlay,  // Always on top
+};
+
+struct DebugDrawStats {
+  size_t lines = 0;
+  size_t triangles = 0;
+  int drawCalls = 0;
+  int threads = 0;  // That have drawn anything since startup
+  size_t streamBytes = 0;
+};
+
+// Immediate mode lines and triangles in world space, for debugging culling, BVHs, physics and the
+// like from anywhere in the code, on any thread. Every thread appends to a buffer of its own
+// without taking a lock; once per frame DebugRenderer merges them into one streaming vertex buffer
+// and draws it with one call per primitive type and depth mode. Primitives last a single frame,
+// so draw them again every frame for as long as they should stay. Without MACHI_DEBUG_DRAW every
+// function here is empty and inline, calls to them compile to nothing.
+namespace DebugDraw {
+#if MACHI_DEBUG_DRAW
+void line(const glm::vec3& a, const glm::vec3& b, const glm::vec4& color, DebugDepth depth = DebugDepth::Tested);
+// Blended, color alpha applies
+void triangle(const glm::vec3& a,
+              const glm::vec3& b,
+              const glm::vec3& c,
+              const glm::vec4& color,
+              DebugDepth depth = DebugDepth::Tested);
+void box(const AABB& box, const glm::vec4& color, DebugDepth depth = DebugDepth::Tested);
+// A local box under a transform, oriented with it
+void box(const glm::mat4& transform, const AABB& box, const glm::vec4& color, DebugDepth depth = DebugDepth::Tested);
+// Three great circles
+void sphere(const glm::vec3& center, float radius, const glm::vec4& color, DebugDepth depth = DebugDepth::Tested);
+// The volume a view-projection matrix sees, near plane to far plane
+void frustum(const glm::mat4& viewProjection, const glm::vec4& color, DebugDepth depth = DebugDepth::Tested);
+// X red, Y green, Z blue, size long
+void axes(const glm::mat4& transform, float size, DebugDepth depth = DebugDepth::Overlay);
+void cross(const glm::vec3& center, float size, const glm::vec4& color, DebugDepth depth = DebugDepth::Overlay);
+#else
+inline void line(const glm::vec3&, const glm::vec3&, const glm::vec4&, DebugDepth = DebugDepth::Tested) {}
+inline void triangle(const glm::vec3&,
+                     const glm::vec3&,
+                     const glm::vec3&,
+                     const glm::vec4&,
+                     DebugDepth = DebugDepth::Tested) {}
+inline void box(const AABB&, const glm::vec4&, DebugDepth = DebugDepth::Tested) {}
+inline void box(const glm::mat4&, const AABB&, const glm::vec4&, DebugDepth = DebugDepth::Tested) {}
+inline void sphere(const glm::vec3&, float, const glm::vec4&, DebugDepth = DebugDepth::Tested) {}
+inline void frustum(const glm::mat4&, const glm::vec4&, DebugDepth = DebugDepth::Tested) {}
+inline void axes(const glm::mat4&, float, DebugDepth = DebugDepth::Overlay) {}
+inline void cross(const glm::vec3&, float, const glm::vec4&, DebugDepth = DebugDepth::Overlay) {}
+#endif
+}  // namespace DebugDraw
+
+// Draws what the DebugDraw functions collected. Shaders are resources/shaders/debug.vert/frag.glsl.
+class DebugRenderer {
+public:
+  static constexpr size_t VertexBytes = 16;  // Position, RGBA8 color
+
+private:
+#if MACHI_DEBUG_DRAW
+  GLuint m_vao;
+  GLuint m_buffer;
+  size_t m_capacity;  // Bytes allocated for the buffer
+  ResidencyManager* m_residency;
+  int m_residencyId;
+#endif
+  DebugDrawStats m_stats;
+
+public:
+#if MACHI_DEBUG_DRAW
+  explicit DebugRenderer(ResidencyManager* residency = nullptr);
+  ~DebugRenderer();
+
+  // Takes everything drawn on any thread since the last call and draws it over the bound
+  // framebuffer, without writing depth. Main thread, once per frame; the debug shader must be in use.
+  void render(const Shader& shader, glm::mat4 viewProjection);
+#else
+  explicit DebugRenderer(ResidencyManager* = nullptr) {}
+
+  void render(const Shader&, glm::mat4) {}
+#endif
+
+  DebugRenderer(const DebugRenderer&) = delete;
+  DebugRenderer& operator=(const DebugRenderer&) = delete;
+
+  const DebugDrawStats& getStats() const {
+    return m_stats;
+  }
+};
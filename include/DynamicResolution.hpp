@@ -0,0 +1,57 @@
+#pragma once
+
+struct DynamicResolutionStats {
+  float scale = 1.0f;
+  float gpuMs = 0.0f;     // Smoothed GPU frame time
+  float budgetMs = 0.0f;  // What the frame may take on the GPU
+  int changes = 0;        // Scale changes so far
+};
+
+// Picks the resolution the scene is rendered at from the measured GPU frame time. Going over budget
+// for a few frames drops the scale right away, by as much as the pixel count has to shrink; it only
+// creeps back up one step at a time after staying well under budget for a while. The gap between
+// the two thresholds and the waiting keep the scale from oscillating. Scales are quantized so render
+// targets of the same few sizes keep being reused.
+class DynamicResolution {
+public:
+  static constexpr float Step = 0.05f;
+  static constexpr float Headroom = 0.9f;         // Fraction of the frame time the GPU is budgeted
+  static constexpr float LowerThreshold = 0.75f;  // Under budget * this the scale may go up
+  static constexpr int OverFrames = 3;            // Frames over budget before scaling down
+  static constexpr int UnderFrames = 60;          // Frames under the lower threshold before scaling up
+
+private:
+  float m_minScale;
+  float m_maxScale;
+  float m_budgetMs;
+  float m_smoothedMs;
+  int m_overFrames;
+  int m_underFrames;
+  int m_cooldown;  // Frames to ignore after a change, until samples at the new scale come in
+  int m_latency;
+  bool m_enabled;
+  DynamicResolutionStats m_stats;
+
+  void setScale(float scale);
+
+public:
+  // latency = frames between rendering and its GPU time being measured
+  DynamicResolution(float minScale, float maxScale, float targetFPS, int latency);
+
+  void setEnabled(bool enabled);
+  bool isEnabled() const {
+    return m_enabled;
+  }
+
+  // Once per frame with the newest GPU frame time
+  void update(float gpuMs);
+
+  float getScale() const {
+    return m_stats.scale;
+  }
+  // Size to render at for a window of this size, at least 1x1
+  int scaled(int size) const;
+  const DynamicResolutionStats& getStats() const {
+    return m_stats;
+  }
+};
@@ -0,0 +1,480 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include "JobSystem.hpp"
+
+// Index into the world's entity table plus the generation of the slot, the same scheme as
+// ResourceHandle: a destroyed entity's slot is reused with a new generation, stale ids resolve to
+// nothing.
+struct Entity {
+  static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+  uint32_t index = InvalidIndex;
+  uint32_t generation = 0;
+
+  bool isValid() const {
+    return index != InvalidIndex;
+  }
+  bool operator==(const Entity& other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const Entity& other) const {
+    return !(*this == other);
+  }
+};
+
+using ComponentId = uint32_t;
+using ComponentMask = uint64_t;  // One bit per component type
+
+namespace ECS {
+constexpr ComponentId MaxComponents = 64;
+
+// Ids are handed out the first time a type is used, in whatever order that happens
+ComponentId registerComponent(size_t size, size_t alignment, const char* name);
+size_t componentSize(ComponentId id);
+const char* componentName(ComponentId id);
+
+template <typename T>
+ComponentId componentId() {
+  if constexpr (std::is_const_v<T>) {
+    // One id per type however it's qualified
+    return componentId<std::remove_const_t<T>>();
+  } else {
+    // Components are moved between chunks with memcpy and never constructed or destroyed in place
+    static_assert(std::is_trivially_copyable_v<T>, "Components must be trivially copyable");
+    static_assert(alignof(T) <= 64, "Components can be aligned to 64 bytes at most");
+    static const ComponentId id = registerComponent(sizeof(T), alignof(T), typeid(T).name());
+    return id;
+  }
+}
+
+template <typename... Ts>
+ComponentMask maskOf() {
+  return (ComponentMask(0) | ... | (ComponentMask(1) << componentId<Ts>()));
+}
+}  // namespace ECS
+
+struct WorldStats {
+  size_t entities = 0;
+  size_t archetypes = 0;
+  size_t chunks = 0;
+  size_t chunkBytes = 0;  // Allocated for the chunks
+};
+
+class World;
+
+// Structural changes recorded while the world is being iterated, applied in order by
+// World::apply() at a sync point. Entities created here get a placeholder id that the later
+// commands of the same buffer can use; components added right after a create are placed in the
+// entity's final archetype at once instead of moving it once per component.
+class CommandBuffer {
+public:
+  static constexpr uint32_t PendingGeneration = 0xFFFFFFFFu;  // Marks placeholder ids
+
+private:
+  enum class Op : uint8_t { Create, Destroy, Add, Remove };
+
+  struct Command {
+    Op op;
+    Entity entity;
+    ComponentId component;
+    size_t offset;  // Of the value in m_data, for Add
+  };
+
+  std::vector<Command> m_commands;
+  std::vector<uint8_t> m_data;
+  uint32_t m_pending = 0;
+
+  friend class World;
+
+public:
+  Entity create() {
+    const Entity entity{m_pending++, PendingGeneration};
+    m_commands.push_back({Op::Create, entity, 0, 0});
+    return entity;
+  }
+  template <typename... Ts>
+  Entity create(const Ts&... components) {
+    const Entity entity = create();
+    (add(entity, components), ...);
+    return entity;
+  }
+  void destroy(Entity entity) {
+    m_commands.push_back({Op::Destroy, entity, 0, 0});
+  }
+  template <typename T>
+  void add(Entity entity, const T& component) {
+    const size_t offset = m_data.size();
+    m_data.resize(offset + sizeof(T));
+    std::memcpy(&m_data[offset], &component, sizeof(T));
+    m_commands.push_back({Op::Add, entity, ECS::componentId<T>(), offset});
+  }
+  template <typename T>
+  void remove(Entity entity) {
+    m_commands.push_back({Op::Remove, entity, ECS::componentId<T>(), 0});
+  }
+
+  bool empty() const {
+    return m_commands.empty();
+  }
+  size_t size() const {
+    return m_commands.size();
+  }
+  void clear() {
+    m_commands.clear();
+    m_data.clear();
+    m_pending = 0;
+  }
+};
+
+template <typename... Ts>
+class Query;
+
+// Entities and their components, stored by archetype: every entity with exactly the same set of
+// component types lives in the same archetype, in fixed size chunks that hold an array per
+// component (structure of arrays), so a query walks contiguous memory per component. Adding or
+// removing a component moves the entity to another archetype; removal swaps the archetype's last
+// entity into the hole so chunks stay dense. Components must be trivially copyable.
+//
+// Structural changes (create, destroy, add, remove) must not happen while anything iterates the
+// world, record them in a CommandBuffer instead. Reading and writing components is fine from any
+// number of threads as long as no two touch the same component type at once, see SystemScheduler.
+class World {
+public:
+  static constexpr size_t ChunkBytes = 64 * 1024;
+
+private:
+  struct Archetype {
+    ComponentMask mask = 0;
+    std::vector<ComponentId> components;  // Ascending
+    std::vector<int> columns;             // Per component id, index into components or -1
+    std::vector<size_t> offsets;          // Of each component's array within a chunk
+    std::vector<size_t> sizes;            // Of each component
+    size_t capacity = 0;                  // Entities per chunk
+    size_t count = 0;
+    std::vector<uint8_t*> chunks;  // Entity ids first, then the component arrays
+    std::vector<int> addEdges;     // Archetype reached by adding a component id, -1 until known
+    std::vector<int> removeEdges;
+
+    Archetype() = default;
+    ~Archetype();
+    Archetype(const Archetype&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
+    Entity* entities(size_t chunk) const {
+      return reinterpret_cast<Entity*>(chunks[chunk]);
+    }
+    uint8_t* component(size_t row, int column) const {
+      return chunks[row / capacity] + offsets[column] + (row % capacity) * sizes[column];
+    }
+    // Chunks holding entities. There can be a spare empty one after them.
+    size_t usedChunks() const {
+      return (count + capacity - 1) / capacity;
+    }
+    // Entities in a used chunk, only the last one can be partly filled
+    size_t chunkCount(size_t chunk) const {
+      return std::min(capacity, count - chunk * capacity);
+    }
+  };
+
+  struct Record {
+    uint32_t archetype = 0;
+    uint32_t row = 0;
+    uint32_t generation = 1;
+    bool alive = false;
+  };
+
+  std::vector<std::unique_ptr<Archetype>> m_archetypes;  // Only ever added to, queries keep indices
+  std::unordered_map<ComponentMask, uint32_t> m_archetypeLookup;
+  std::vector<Record> m_records;
+  std::vector<uint32_t> m_freeRecords;
+  size_t m_entityCount;
+  bool m_locked;
+
+  template <typename... Ts>
+  friend class Query;
+  friend class SystemScheduler;
+
+  uint32_t findArchetype(ComponentMask mask);
+  uint32_t neighbour(uint32_t archetype, ComponentId component, bool adding);
+  // Appends an entity to the archetype, components are left uninitialized
+  uint32_t allocateRow(uint32_t archetype, Entity entity);
+  // Swaps the last entity into row and shrinks the archetype
+  void freeRow(uint32_t archetype, uint32_t row);
+  // Moves the entity and its shared components to another archetype
+  void move(Entity entity, uint32_t target);
+  bool checkUnlocked(const char* operation) const;
+  const Record* find(Entity entity) const;
+
+public:
+  World();
+  ~World() = default;
+
+  World(const World&) = delete;
+  World& operator=(const World&) = delete;
+
+  // Components are zeroed
+  Entity create(ComponentMask mask = 0);
+  template <typename... Ts>
+  Entity create(const Ts&... components) {
+    const Entity entity = create(ECS::maskOf<Ts...>());
+    if (entity.isValid()) {
+      (set(entity, components), ...);
+    }
+    return entity;
+  }
+  void destroy(Entity entity);
+  bool isAlive(Entity entity) const {
+    return find(entity) != nullptr;
+  }
+
+  // Returns the component's storage, zeroed when it was just added
+  void* add(Entity entity, ComponentId component);
+  void remove(Entity entity, ComponentId component);
+  void* get(Entity entity, ComponentId component) const;
+
+  template <typename T>
+  void add(Entity entity, const T& component) {
+    if (void* storage = add(entity, ECS::componentId<T>())) {
+      std::memcpy(storage, &component, sizeof(T));
+    }
+  }
+  template <typename T>
+  void remove(Entity entity) {
+    remove(entity, ECS::componentId<T>());
+  }
+  // nullptr when the entity is gone or doesn't have the component
+  template <typename T>
+  T* get(Entity entity) const {
+    return static_cast<T*>(get(entity, ECS::componentId<T>()));
+  }
+  template <typename T>
+  bool has(Entity entity) const {
+    return get<T>(entity) != nullptr;
+  }
+  // Overwrites a component the entity already has
+  template <typename T>
+  void set(Entity entity, const T& component) {
+    if (T* storage = get<T>(entity)) {
+      *storage = component;
+    }
+  }
+
+  // Runs the buffer's commands in the order they were recorded and clears it
+  void apply(CommandBuffer& commands);
+
+  // A cached query over the entities that have all of Ts, const components are only read
+  template <typename... Ts>
+  Query<Ts...> query() {
+    return Query<Ts...>(*this);
+  }
+
+  size_t getEntityCount() const {
+    return m_entityCount;
+  }
+  WorldStats getStats() const;
+};
+
+// The archetypes holding all of Ts. Matching archetypes are cached and only archetypes created
+// since the last use are checked, so keep a query around instead of making one per frame. Iteration
+// goes chunk by chunk, forEachChunk hands out the component arrays directly for loops the compiler
+// can vectorize.
+template <typename... Ts>
+class Query {
+private:
+  World* m_world;
+  ComponentMask m_mask;
+  std::vector<uint32_t> m_archetypes;
+  size_t m_checked = 0;  // Archetypes of the world already matched
+
+  struct ChunkRef {
+    uint32_t archetype;
+    uint32_t chunk;
+  };
+
+  void refresh() {
+    for (; m_checked < m_world->m_archetypes.size(); m_checked++) {
+      if ((m_world->m_archetypes[m_checked]->mask & m_mask) == m_mask) {
+        m_archetypes.push_back(static_cast<uint32_t>(m_checked));
+      }
+    }
+  }
+
+  template <typename F>
+  void runChunk(const World::Archetype& archetype, size_t chunk, F& function) const {
+    const size_t count = archetype.chunkCount(chunk);
+    uint8_t* data = archetype.chunks[chunk];
+    function(count,
+             const_cast<const Entity*>(archetype.entities(chunk)),
+             reinterpret_cast<Ts*>(data + archetype.offsets[archetype.columns[ECS::componentId<Ts>()]])...);
+  }
+
+public:
+  explicit Query(World& world) : m_world(&world), m_mask(ECS::maskOf<Ts...>()) {}
+
+  // Components the query can write, the non-const ones, and the ones it only reads
+  static ComponentMask writes() {
+    return (ComponentMask(0) | ... | (std::is_const_v<Ts> ? 0 : ComponentMask(1) << ECS::componentId<Ts>()));
+  }
+  static ComponentMask reads() {
+    return (ComponentMask(0) | ... | (std::is_const_v<Ts> ? ComponentMask(1) << ECS::componentId<Ts>() : 0));
+  }
+
+  // function(size_t count, const Entity* entities, Ts* components...)
+  template <typename F>
+  void forEachChunk(F&& function) {
+    refresh();
+    for (uint32_t index : m_archetypes) {
+      const World::Archetype& archetype = *m_world->m_archetypes[index];
+      const size_t used = archetype.usedChunks();
+      for (size_t chunk = 0; chunk < used; chunk++) {
+        runChunk(archetype, chunk, function);
+      }
+    }
+  }
+
+  // function(Entity entity, Ts& components...)
+  template <typename F>
+  void forEach(F&& function) {
+    forEachChunk([&function](size_t count, const Entity* entities, Ts*... components) {
+      for (size_t i = 0; i < count; i++) {
+        function(entities[i], components[i]...);
+      }
+    });
+  }
+
+  // forEachChunk spread over the job system, chunks run concurrently so function must only touch
+  // its own chunk. Runs on the calling thread without jobs.
+  template <typename F>
+  void parallelForEachChunk(JobSystem* jobs, F&& function) {
+    refresh();
+    std::vector<ChunkRef> chunks;
+    for (uint32_t index : m_archetypes) {
+      const size_t count = m_world->m_archetypes[index]->usedChunks();
+      for (size_t chunk = 0; chunk < count; chunk++) {
+        chunks.push_back({index, static_cast<uint32_t>(chunk)});
+      }
+    }
+    auto body = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        runChunk(*m_world->m_archetypes[chunks[i].archetype], chunks[i].chunk, function);
+      }
+    };
+    if (jobs) {
+      jobs->parallelFor(chunks.size(), 4, body);
+    } else {
+      body(0, chunks.size());
+    }
+  }
+
+  template <typename F>
+  void parallelForEach(JobSystem* jobs, F&& function) {
+    parallelForEachChunk(jobs, [&function](size_t count, const Entity* entities, Ts*... components) {
+      for (size_t i = 0; i < count; i++) {
+        function(entities[i], components[i]...);
+      }
+    });
+  }
+
+  size_t count() {
+    refresh();
+    size_t total = 0;
+    for (uint32_t index : m_archetypes) {
+      total += m_world->m_archetypes[index]->count;
+    }
+    return total;
+  }
+};
+
+// The component types a system reads and writes. Two systems conflict when one writes what the
+// other reads or writes; exclusive systems conflict with everything.
+class Access {
+private:
+  ComponentMask m_reads = 0;
+  ComponentMask m_writes = 0;
+  bool m_exclusive = false;
+
+public:
+  template <typename... Ts>
+  Access& read() {
+    m_reads |= ECS::maskOf<Ts...>();
+    return *this;
+  }
+  template <typename... Ts>
+  Access& write() {
+    m_writes |= ECS::maskOf<Ts...>();
+    return *this;
+  }
+  // For systems that touch state outside the world (the scene, GL), they run alone on the
+  // calling thread
+  Access& exclusive() {
+    m_exclusive = true;
+    return *this;
+  }
+
+  bool isExclusive() const {
+    return m_exclusive;
+  }
+  bool conflicts(const Access& other) const {
+    return m_exclusive || other.m_exclusive || (m_writes & (other.m_reads | other.m_writes)) != 0 ||
+           (other.m_writes & m_reads) != 0;
+  }
+};
+
+struct SystemContext {
+  World& world;
+  CommandBuffer& commands;  // Applied once the system's stage is done
+  JobSystem* jobs;          // Set when the system runs alone in its stage and may spread its own work
+  float deltaTime;
+};
+
+struct SystemTiming {
+  std::string name;
+  int stage = 0;
+  float ms = 0.0f;
+};
+
+// Runs systems once per frame in stages. A system goes into the first stage after every earlier
+// system it conflicts with, so conflicting systems keep the order they were added in while the
+// systems of one stage run in parallel on the job system. Each stage ends with a sync point that
+// applies the structural changes its systems recorded, in system order.
+class SystemScheduler {
+public:
+  using Function = std::function<void(SystemContext&)>;
+
+private:
+  struct System {
+    std::string name;
+    Access access;
+    Function function;
+    CommandBuffer commands;
+    int stage = 0;
+    float ms = 0.0f;
+  };
+
+  std::vector<System> m_systems;
+  std::vector<std::vector<size_t>> m_stages;
+
+  void runSystem(System& system, World& world, JobSystem* jobs, float deltaTime);
+
+public:
+  void add(const std::string& name, const Access& access, Function function);
+
+  void run(World& world, JobSystem* jobs, float deltaTime);
+
+  size_t getStageCount() const {
+    return m_stages.size();
+  }
+  std::vector<SystemTiming> getTimings() const;
+};
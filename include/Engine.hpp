@@ -1,10 +1,33 @@
 #pragma once
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include "AsyncIO.hpp"
 #include "Camera.hpp"
+#include "DebugDraw.hpp"
+#include "DynamicResolution.hpp"
+#include "ClusteredLighting.hpp"
 #include "EventManager.hpp"
+#include "FontAtlas.hpp"
+#include "FrameCapture.hpp"
 #include "InputManager.hpp"
+#include "JobSystem.hpp"
+#include "LODSelector.hpp"
+#include "MaterialTable.hpp"
+#include "MeshManager.hpp"
+#include "PackFile.hpp"
+#include "ParticleSystem.hpp"
+#include "Profiler.hpp"
+#include "RenderGraph.hpp"
+#include "ResidencyManager.hpp"
+#include "ResourceManager.hpp"
+#include "Scene.hpp"
+#include "ShaderCache.hpp"
+#include "ShadowMaps.hpp"
+#include "SpriteBatch.hpp"
+#include "TexturePool.hpp"
+#include "TextureStreamer.hpp"
 #include "WindowManager.hpp"
 
 // Forward declarations for systems we'll integrate later
@@ -33,6 +56,78 @@ struct EngineConfig {
   bool enableDepthTest = true;
   bool enableBlending = false;
   int msaaSamples = 4;
+
+  // Dynamic resolution settings, the scene is rendered between these fractions of the window size
+  // to keep the GPU within the targetFPS budget (F3 toggles it)
+  bool dynamicResolution = true;
+  float minResolutionScale = 0.5f;
+  float maxResolutionScale = 1.0f;
+
+  // Culling settings
+  bool enableOcclusionCulling = true;
+  int occlusionBufferWidth = 256;
+  int occlusionBufferHeight = 128;
+
+  // Level of detail settings
+  float lodPixelError = 1.0f;   // Allowed simplification error on screen, in pixels
+  float lodHysteresis = 0.2f;   // Fraction of the budget an object must cross before switching back
+
+  // Streaming settings
+  size_t textureUploadBudget = 4 * 1024 * 1024;  // Bytes of texture data sent to the GPU per frame
+  unsigned int workerThreads = 0;                // 0 = one per hardware thread, minus the main thread
+  unsigned int ioThreads = 2;                    // File readers, only used where io_uring is not available
+
+  // GPU memory settings
+  size_t gpuMemoryBudget = 512 * 1024 * 1024;  // Least recently used textures are reduced past this
+
+  // Texture pool settings
+  int textureArrayLayers = 16;   // Layers allocated per texture array
+  bool bindlessTextures = true;  // Used when the driver has ARB_bindless_texture
+
+  // Asset settings
+  std::string assetPack = "../resources/assets.mpak";  // Written by machi_cook, loose files are used without it
+  std::string assetRoot = "../resources";              // The directory the pack was cooked from
+  std::string shaderCacheDirectory = "shader_cache";   // Linked program binaries, empty = always compile
+
+  // Shader variants compiled at startup, see ResourceManager::warmUpShaders()
+  std::string shaderWarmUpList = "../resources/shaders/warmup.txt";
+
+  // Lighting settings
+  int demoLights = 256;                                     // Point lights scattered around the demo scene
+  glm::vec3 ambientLight = glm::vec3(0.08f);                // Added to every lit surface
+  glm::vec3 sunDirection = glm::vec3(-0.4f, -1.0f, -0.3f);  // Direction the sunlight travels in
+  glm::vec3 sunColor = glm::vec3(1.0f, 0.95f, 0.85f);
+
+  // Particle settings
+  int demoParticles = 100000;  // Live particles the demo fountains keep up, a million to stress the system
+
+  // Entity settings
+  int demoEntities = 10000;  // Moved by the demo swarm's systems every frame, a million to stress the scheduler
+
+  // HUD settings, frame statistics drawn over the frame (F4 toggles it)
+  bool showHud = true;
+  std::string hudFont = "../resources/fonts/DejaVuSansMono.ttf";  // TrueType, the HUD is left out without it
+  float hudTextSize = 16.0f;                                      // Pixels per em
+
+  // Shadow settings
+  int shadowMapSize = 2048;
+  int shadowCascades = 4;
+  int shadowCachedCascades = 2;   // The farthest cascades, only re-rendered when something changed
+  float shadowDistance = 60.0f;   // View depth the cascades cover
+  int shadowRefreshInterval = 0;  // Frames between forced re-renders of cached cascades, 0 = only on changes
+
+  // Capture settings, F12 saves a screenshot and F11 starts or stops a recording
+  std::string captureDirectory = "captures";
+  CaptureFormat recordingFormat = CaptureFormat::PNG;  // Raw appends every frame to one file
+
+  // Reference image test: once goldenFrame frames were drawn and no texture is streaming any more,
+  // the frame is compared to goldenImage and the engine stops, see getExitCode(). Dynamic resolution
+  // is turned off so the frame doesn't depend on timing.
+  bool hiddenWindow = false;
+  std::string goldenImage = "";  // Empty = no test
+  int goldenFrame = 10;
+  int goldenTolerance = 2;            // Channel difference a pixel may have without counting as differing
+  float goldenMaxDiffering = 0.001f;  // Fraction of the pixels that may differ
 };
 
 class Engine {
@@ -47,6 +142,40 @@ private:
   std::unique_ptr<EventManager> m_eventManager;
   std::unique_ptr<InputManager> m_inputManager;
   std::unique_ptr<Camera> m_camera;
+  std::unique_ptr<Scene> m_scene;
+  std::unique_ptr<OcclusionCuller> m_occlusionCuller;
+  std::unique_ptr<LODSelector> m_lodSelector;
+  std::unique_ptr<ResidencyManager> m_residency;  // Outlives everything that reports to it
+  std::unique_ptr<PackFile> m_assetPack;          // Outlives the workers reading from it
+  std::unique_ptr<ShaderCache> m_shaderCache;     // Needs the GL context, created with the renderer
+  std::unique_ptr<MeshManager> m_meshManager;    // Holds GL objects, must go before the window
+  std::unique_ptr<ResourceManager> m_resourceManager;  // Same
+  std::unique_ptr<JobSystem> m_jobSystem;
+  std::unique_ptr<AsyncIO> m_asyncIO;  // Callbacks are delivered on the main thread, once per frame
+  std::unique_ptr<TextureStreamer> m_textureStreamer;  // Needs the GL context, created with the renderer
+  std::unique_ptr<TexturePool> m_texturePool;          // Same
+  std::unique_ptr<MaterialTable> m_materials;          // Same, samples the pool's arrays
+  std::unique_ptr<ClusteredLighting> m_lighting;       // Same, bins on the job system
+  std::unique_ptr<ShadowMaps> m_shadows;               // Same
+  std::unique_ptr<ParticleSystem> m_particles;         // Same, simulates on the job system
+  std::unique_ptr<Profiler> m_profiler;                // Same, owns timer queries
+  std::unique_ptr<RenderGraph> m_renderGraph;          // Same, owns the render target pool
+  std::unique_ptr<DynamicResolution> m_dynamicResolution;
+  std::unique_ptr<FrameCapture> m_capture;  // Needs the GL context, created with the renderer
+  std::unique_ptr<FontAtlas> m_font;        // Same
+  std::unique_ptr<SpriteBatch> m_sprites;   // Same
+  std::unique_ptr<DebugRenderer> m_debugRenderer;  // Same
+  bool m_showHud;
+  SystemScheduler m_systems;  // Runs over the scene's world every frame
+  AABB m_swarmBounds;         // Of the demo entities, updated by their systems
+
+  // What F5 draws over the scene with DebugDraw
+  enum class DebugView { None, Bounds, BVH };
+  DebugView m_debugView;
+
+  // Per-frame culling results and the matrix they were computed with (reused for picking)
+  std::vector<int> m_visibleObjects;
+  glm::mat4 m_viewProjection;
 
   // Timing sustem for smooth frame rates and delta time calculation
   std::chrono::high_resolution_clock::time_point m_lastFrameTime;
@@ -55,12 +184,15 @@ private:
   float m_totalTime;
   float m_currentFrame;
   float m_lastFrame;
-  int m_frameCount;
+  int m_frameCount;       // Since the last FPS update
+  uint64_t m_frameIndex;  // Since start, never reset
   float m_fps;
   float m_fpsUpdateTimer;
+  int m_exitCode;
 
   // Engine subsystem initialization methods
   bool initializeWindowSystem();
+  void mountAssetPack();  // Falls back to the loose files, with a warning if the pack is unreadable
   bool initializeRenderingSystem();
   bool initializeInputSystem();
   bool initializeEventSystem();
@@ -80,11 +212,23 @@ private:
   void onScroll(double xOffset, double yOffset);
 
   void keyTest(GLFWwindow* window);
+  void pickObject(double x, double y);
+  void captureScreenshot();
+  void toggleRecording();
+  void cycleDebugView();
+  void drawDebugView();
+  // The swarm of entities and the systems that move and replace them
+  void createDemoEntities();
+  // Queues the HUD text into the sprite batch, drawn by the HUD pass
+  void drawHud(int width, int height, int renderWidth, int renderHeight);
+  // Asks for this frame to be compared to the golden image once it has settled, true if it was
+  bool captureGoldenFrame();
 
   // Scene management helpers
   void performSceneTransition();
 
   // Cleanup methods
+  // Tears the subsystems down before the window, from the destructor or a failed initialize()
   void shutdownSystems();
 
 public:
@@ -132,6 +276,13 @@ public:
   int getFrameCount() const {
     return m_frameCount;
   }
+  uint64_t getFrameIndex() const {
+    return m_frameIndex;
+  }
+  // 0 unless the golden image test failed
+  int getExitCode() const {
+    return m_exitCode;
+  }
 
   // Window interface - provides controlled access to window functionality
   WindowManager& getWindowManager() {
@@ -141,6 +292,26 @@ public:
     return *m_windowManager;
   }
 
+  // Resource interface - valid once the engine is initialized
+  MeshManager& getMeshManager() {
+    return *m_meshManager;
+  }
+  ResourceManager& getResourceManager() {
+    return *m_resourceManager;
+  }
+  ResidencyManager& getResidencyManager() {
+    return *m_residency;
+  }
+  AsyncIO& getAsyncIO() {
+    return *m_asyncIO;
+  }
+  TextureStreamer& getTextureStreamer() {
+    return *m_textureStreamer;
+  }
+  TexturePool& getTexturePool() {
+    return *m_texturePool;
+  }
+
   std::array<int, 2> getWindowSize() const;
   void setWindowSize(int width, int height);
   void setWindowTitle(const std::string&);
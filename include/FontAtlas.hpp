@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "JobSystem.hpp"
+#include "ResidencyManager.hpp"
+
+// The glyphs of a TrueType font as signed distance fields packed into one single channel texture.
+// Outlines are read straight from the font's glyf table and flattened to line segments, then every
+// texel stores its distance to the nearest edge: 0.5 on the outline, more inside, less outside. The
+// text shader turns that into an edge about a pixel wide at any size, so one atlas generated at
+// load time serves every text size. Generating the fields is spread over the job system. Fonts with
+// CFF outlines (most .otf files) are not read.
+class FontAtlas {
+public:
+  static constexpr int GlyphSize = 48;  // Pixels per em the fields are generated at
+  static constexpr int Spread = 6;      // Pixels of distance stored on either side of an outline
+  static constexpr int AtlasWidth = 512;
+
+  // In pixels at GlyphSize, y down
+  struct Glyph {
+    glm::vec2 offset = glm::vec2(0.0f);  // From the pen position on the baseline to the quad's top left
+    glm::vec2 size = glm::vec2(0.0f);    // Of the quad, zero for glyphs without an outline
+    glm::vec4 uv = glm::vec4(0.0f);      // The quad's top left and bottom right in the atlas
+    float advance = 0.0f;
+  };
+
+private:
+  GLuint m_texture;
+  int m_width;
+  int m_height;
+  uint32_t m_first;
+  std::vector<Glyph> m_glyphs;  // From m_first on
+  float m_ascent;               // Above the baseline
+  float m_descent;              // Below it, negative
+  float m_lineGap;
+  ResidencyManager* m_residency;
+  int m_residencyId;
+
+  void release();
+
+public:
+  explicit FontAtlas(ResidencyManager* residency = nullptr);
+  ~FontAtlas();
+
+  FontAtlas(const FontAtlas&) = delete;
+  FontAtlas& operator=(const FontAtlas&) = delete;
+
+  // Generates the fields of the characters first to last. Returns false (and logs) when the font
+  // can't be read, the atlas loaded before stays.
+  bool load(const std::string& filepath, JobSystem* jobs = nullptr, uint32_t first = 32, uint32_t last = 126);
+
+  bool isLoaded() const {
+    return m_texture != 0;
+  }
+  GLuint getTexture() const {
+    return m_texture;
+  }
+  int getWidth() const {
+    return m_width;
+  }
+  int getHeight() const {
+    return m_height;
+  }
+
+  // Characters outside the loaded range come back as '?'. The atlas must be loaded.
+  const Glyph& getGlyph(uint32_t codepoint) const;
+  float getAscent() const {
+    return m_ascent;
+  }
+  float getLineHeight() const {
+    return m_ascent - m_descent + m_lineGap;
+  }
+
+  // Width of the longest line at pixelSize pixels per em. Text is taken byte by byte (Latin-1).
+  float measure(std::string_view text, float pixelSize) const;
+};
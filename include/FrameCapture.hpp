@@ -0,0 +1,149 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "JobSystem.hpp"
+#include "ResidencyManager.hpp"
+
+enum class CaptureFormat {
+  PNG,
+  Raw,  // RGBA8 rows, top row first, no header
+};
+
+// A frame read back from the GPU, RGBA8 rows, top row first
+struct CapturedFrame {
+  int width = 0;
+  int height = 0;
+  uint64_t frame = 0;  // Counted in readBack() calls
+  std::vector<uint8_t> pixels;
+};
+
+struct CaptureStats {
+  int inFlight = 0;       // Readbacks the GPU hasn't finished yet
+  int encoding = 0;       // Frames with the workers
+  uint64_t captured = 0;  // Frames read back
+  uint64_t written = 0;   // Files written, raw recordings count every frame
+  uint64_t dropped = 0;   // Recorded frames skipped because every buffer was still in flight
+  uint64_t failed = 0;    // Readbacks or writes that failed
+  int latencyFrames = 0;  // Frames between issuing the last completed readback and collecting it
+  float copyMs = 0.0f;    // Main thread time spent copying the last completed frame out of its buffer
+};
+
+// Reads the finished backbuffer back without stalling the frame. glReadPixels goes into one of a
+// ring of pixel pack buffers and is followed by a fence, the buffer is only mapped once the fence
+// has signaled a few frames later, so neither the CPU nor the GPU waits for the other. The pixels
+// are then handed to the job system to be encoded and written, or to a callback on a worker thread.
+// Recordings read back every frame while they run; when the ring is full the frame is dropped
+// rather than waited for.
+class FrameCapture {
+public:
+  static constexpr int RingSize = 3;
+  using Callback = std::function<void(const CapturedFrame&)>;  // Called on a worker thread
+
+private:
+  // A running recording's raw stream. The workers may finish frames in any order, each is held
+  // back until every earlier frame has been appended.
+  struct RawStream {
+    std::mutex mutex;
+    std::ofstream file;
+    uint64_t nextSequence = 0;
+    std::map<uint64_t, std::shared_ptr<const CapturedFrame>> waiting;
+
+    // Returns the number of frames written, a frame without pixels (its readback failed) only
+    // moves the stream on
+    int append(uint64_t sequence, std::shared_ptr<const CapturedFrame> frame);
+  };
+
+  // One consumer of a readback
+  struct Target {
+    std::string path;
+    CaptureFormat format = CaptureFormat::PNG;
+    Callback callback;                  // Instead of writing a file when set
+    std::shared_ptr<RawStream> stream;  // Or appending to a raw recording
+    uint64_t sequence = 0;              // Position in it
+  };
+
+  // Shared with the encoding jobs so they can finish after the capture is gone
+  struct Encoding {
+    std::mutex mutex;
+    std::condition_variable done;
+    int pending = 0;
+    uint64_t written = 0;
+    uint64_t failed = 0;
+  };
+
+  struct ReadbackBuffer {
+    GLuint pbo = 0;
+    GLsync fence = nullptr;  // Set while the GPU is writing into it
+    size_t capacity = 0;
+    int width = 0;
+    int height = 0;
+    uint64_t frame = 0;
+    std::vector<Target> targets;
+    int residencyId = -1;
+  };
+
+  std::array<ReadbackBuffer, RingSize> m_buffers;
+  std::deque<int> m_inFlight;      // Buffer indices, oldest readback first
+  std::vector<Target> m_requests;  // For the next readback
+  uint64_t m_frame;
+
+  // Current recording
+  bool m_recording;
+  std::string m_recordPath;
+  CaptureFormat m_recordFormat;
+  std::shared_ptr<RawStream> m_stream;
+  uint64_t m_recordSequence;
+  int m_recordWidth;
+  int m_recordHeight;
+
+  JobSystem& m_jobs;
+  std::shared_ptr<Encoding> m_encoding;
+  ResidencyManager* m_residency;
+  CaptureStats m_stats;
+
+  void issue(int width, int height);
+  // Hands the oldest readbacks whose fences signaled on, waiting for them if wait is set
+  void collect(bool wait);
+  void submit(std::shared_ptr<const CapturedFrame> frame, std::vector<Target> targets);
+
+public:
+  explicit FrameCapture(JobSystem& jobs, ResidencyManager* residency = nullptr);
+  // Waits for the readbacks in flight and the frames being written
+  ~FrameCapture();
+
+  FrameCapture(const FrameCapture&) = delete;
+  FrameCapture& operator=(const FrameCapture&) = delete;
+
+  // The next frame read back is written to path
+  void capture(const std::string& path, CaptureFormat format = CaptureFormat::PNG);
+  // Or passed to the callback
+  void capture(Callback callback);
+
+  // PNG recordings write path_000000.png, path_000001.png and so on, raw ones append every frame to
+  // path. A raw recording stops when the window size changes.
+  void startRecording(const std::string& path, CaptureFormat format);
+  void stopRecording();
+  bool isRecording() const {
+    return m_recording;
+  }
+
+  // Once per frame once the backbuffer holds the finished frame, before it is swapped. Issues this
+  // frame's readback if anything asked for it and passes on the ones that completed.
+  void readBack(int width, int height);
+  // Blocks until everything issued so far is read back and written. For shutdown and headless runs,
+  // where stalling doesn't matter.
+  void flush();
+
+  CaptureStats getStats() const;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ImageDifference {
+  bool sizeMatches = false;
+  int maxDifference = 0;       // Largest difference of any channel, 0-255
+  size_t differingPixels = 0;  // Pixels with a channel off by more than the tolerance
+  size_t pixels = 0;
+  double meanError = 0.0;  // Mean absolute channel difference
+
+  double differingFraction() const {
+    return pixels ? static_cast<double>(differingPixels) / pixels : 0.0;
+  }
+};
+
+// Writing and comparing 8 bit images. Pixels are tightly packed rows, top row first, with 1 (gray),
+// 2 (gray + alpha), 3 (RGB) or 4 (RGBA) channels. PNGs are encoded without an external library:
+// every row gets the filter that leaves the smallest residuals and the result is deflated with
+// LZ77 and the fixed Huffman codes, which is far from the smallest file but quick enough to run for
+// every frame of a recording.
+namespace ImageIO {
+std::vector<uint8_t> encodePNG(const uint8_t* pixels, int width, int height, int channels);
+bool writePNG(const std::string& filepath, const uint8_t* pixels, int width, int height, int channels);
+// The pixels as they are, no header
+bool writeRaw(const std::string& filepath, const uint8_t* pixels, size_t size);
+
+// Per channel comparison of two images of the same layout, tolerance is the difference a channel
+// may have without counting the pixel as differing
+ImageDifference compare(const uint8_t* a, const uint8_t* b, int width, int height, int channels, int tolerance);
+// Loads the reference (any format stb_image reads) with the given channel count and compares to it.
+// A missing reference or one of another size is reported through sizeMatches.
+ImageDifference compareToFile(const std::string& reference,
+                              const uint8_t* pixels,
+                              int width,
+                              int height,
+                              int channels,
+                              int tolerance);
+}  // namespace ImageIO
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads pulling jobs from one FIFO queue. Jobs must not touch GL, results
+// that need the context are handed back to the main thread by whoever submitted them.
+class JobSystem {
+private:
+  std::vector<std::thread> m_workers;
+  std::deque<std::function<void()>> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_jobAvailable;
+  std::condition_variable m_idle;
+  size_t m_activeJobs;
+  bool m_stopping;
+
+  void workerLoop();
+
+public:
+  // 0 workers = one per hardware thread, minus the main thread
+  explicit JobSystem(unsigned int workerCount = 0);
+  // Finishes the queued jobs before joining
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  void submit(std::function<void()> job);
+  void waitIdle();
+
+  // Runs body(begin, end) over [0, count) in chunks of up to grain items and returns once all of
+  // them are done. The calling thread works on chunks too, the helpers it queues go ahead of the
+  // other jobs so a frame never waits behind background work. body must not call parallelFor.
+  void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+
+  size_t getWorkerCount() const {
+    return m_workers.size();
+  }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+#include "MeshData.hpp"
+
+struct LODStats {
+  int objects = 0;
+  int triangles = 0;
+  int switches = 0;
+  std::vector<int> objectsPerLevel;
+};
+
+// Picks the coarsest LOD whose simplification error stays below a pixel budget at the object's
+// projected size. A hysteresis band around the budget stops objects sitting right at a threshold
+// from flickering between two levels.
+class LODSelector {
+private:
+  float m_pixelError;
+  float m_hysteresis;
+  LODStats m_stats;
+
+public:
+  LODSelector(float pixelError = 1.0f, float hysteresis = 0.2f);
+  ~LODSelector() = default;
+
+  // Radius of the bounding sphere in pixels when seen from eye
+  static float projectedRadius(const AABB& worldBounds, const glm::vec3& eye, float fovY, int viewportHeight);
+
+  void beginFrame();
+  // Level to draw, 0 for an empty chain
+  int select(const std::vector<MeshLOD>& lods, float projectedRadius, int currentLOD);
+
+  void setPixelError(float pixelError) {
+    m_pixelError = pixelError;
+  }
+  void setHysteresis(float hysteresis) {
+    m_hysteresis = hysteresis;
+  }
+  const LODStats& getStats() const {
+    return m_stats;
+  }
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How a file is going to be read, passed on to the OS as a readahead hint
+enum class FileAccess {
+  Sequential,  // Front to back once (shaders, images): read ahead aggressively, drop pages behind
+  Random,      // Jumping around (asset packs): only read the pages that are touched
+};
+
+// Read-only view of a whole file mapped into the address space. Pages are only read from disk when
+// they are first touched, and the OS can drop them again under memory pressure. Files that can't
+// be mapped (empty files, pipes, some network filesystems) are read into memory instead, the view
+// works the same either way.
+class MappedFile {
+private:
+  const uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_open = false;
+  bool m_mapped = false;
+  std::vector<uint8_t> m_buffer;  // Fallback when mapping fails
+#ifdef _WIN32
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#else
+  int m_fd = -1;
+#endif
+
+  bool map(const std::string& filepath, FileAccess access);
+  bool read(const std::string& filepath);
+
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  // Closes whatever was open first. Returns false (and logs) when the file can't be opened at all.
+  bool open(const std::string& filepath, FileAccess access = FileAccess::Sequential);
+  void close();
+
+  bool isOpen() const {
+    return m_open;
+  }
+  // False when the contents were read into memory instead
+  bool isMapped() const {
+    return m_mapped;
+  }
+  const uint8_t* data() const {
+    return m_data;
+  }
+  size_t size() const {
+    return m_size;
+  }
+  std::string_view text() const {
+    return {reinterpret_cast<const char*>(m_data), m_size};
+  }
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The standard_surface inputs the renderer uses. Factors are linear, a map replaces (colors:
+// multiplies) its factor. Map paths are resolved against the document, empty when there is none.
+struct Material {
+  std::string name;
+
+  glm::vec3 baseColor = glm::vec3(0.8f);
+  float base = 1.0f;
+  float metalness = 0.0f;
+  float roughness = 0.2f;  // specular_roughness
+  float specular = 1.0f;
+  float specularIOR = 1.5f;
+  float coat = 0.0f;
+  glm::vec3 coatColor = glm::vec3(1.0f);
+  float coatRoughness = 0.1f;
+  float emission = 0.0f;
+  glm::vec3 emissionColor = glm::vec3(1.0f);
+  float opacity = 1.0f;
+  float normalScale = 1.0f;
+  glm::vec2 uvTiling = glm::vec2(1.0f);
+
+  std::string baseColorMap;
+  std::string normalMap;
+  std::string roughnessMap;
+  std::string metalnessMap;
+};
+
+namespace MaterialX {
+// Every surfacematerial of the document (or every standard_surface when it has none). Inputs are
+// followed through nodenames, nodegraph outputs and interface names down to the image they read;
+// nodes that combine images (mix, multiply ...) are reduced to the first image they lead to.
+// Read from the mounted asset pack when it has the file. Throws std::runtime_error when the file
+// can't be read or isn't a MaterialX document.
+std::vector<Material> load(const std::string& filepath);
+// directory is what relative file names are resolved against
+std::vector<Material> parse(std::string_view document, const std::string& directory);
+}  // namespace MaterialX
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Material.hpp"
+#include "ResidencyManager.hpp"
+#include "Shader.hpp"
+#include "TexturePool.hpp"
+
+// Every material's parameters in one uniform buffer, their maps in the TexturePool's arrays. A draw
+// selects its material by index (the materialIndex uniform), so switching materials re-uploads no
+// parameters and binds no textures. Entry 0 is a plain default material. Shaders get the layout
+// from resources/shaders/materials.glsl.
+class MaterialTable {
+public:
+  static constexpr int Capacity = 64;  // MAX_MATERIALS in materials.glsl
+  static constexpr int MaxArrays = 8;  // Texture arrays materials can sample, bound to units 0..7
+  static constexpr GLuint BindingPoint = 0;
+
+private:
+  // std140 mirror of the Material struct in materials.glsl
+  struct GPUMaterial {
+    glm::vec4 baseColor;  // base_color * base, opacity
+    glm::vec4 surface;    // metalness, roughness, specular, normal scale
+    glm::vec4 coat;       // coat_color, coat
+    glm::vec4 emission;   // emission_color * emission, coat_roughness
+    glm::vec4 uv;         // uv tiling, specular_IOR
+    glm::ivec4 arrays;    // Texture array of the base color, normal, roughness and metalness maps, -1 = none
+    glm::ivec4 layers;
+    glm::vec4 rects[4];   // TextureRegion::uvRect of each map
+  };
+  static_assert(sizeof(GPUMaterial) == 176, "GPUMaterial has to match the std140 layout");
+
+  TexturePool& m_pool;
+  ResidencyManager* m_residency;
+  std::vector<Material> m_materials;
+  std::vector<GPUMaterial> m_entries;
+  std::unordered_map<std::string, int> m_lookup;
+  GLuint m_buffer;
+  int m_residencyId;
+  int m_dirtyBegin;  // Range of entries to upload, empty when begin >= end
+  int m_dirtyEnd;
+
+  // map is the slot, MAP_* in materials.glsl. A file that doesn't exist gets defaultMap(map).
+  TextureRegion loadMap(const std::string& path, int map);
+  TextureRegion defaultMap(int map);
+  GPUMaterial pack(const Material& material);
+
+public:
+  explicit MaterialTable(TexturePool& pool, ResidencyManager* residency = nullptr);
+  ~MaterialTable();
+
+  MaterialTable(const MaterialTable&) = delete;
+  MaterialTable& operator=(const MaterialTable&) = delete;
+
+  // Loads the material's maps into the pool. Returns its index, the existing one when a material
+  // with the same name was added before, -1 when the table is full.
+  int add(const Material& material);
+  // Adds every material of a .mtlx document under "<path>:<name>". Returns the index of the first
+  // one, -1 when the document couldn't be loaded or has no material.
+  int load(const std::string& path);
+  void set(int index, const Material& material);
+
+  int find(const std::string& name) const;
+  const Material& get(int index) const {
+    return m_materials[index];
+  }
+  int getCount() const {
+    return static_cast<int>(m_materials.size());
+  }
+
+  // Sends the entries changed since the last call, once per frame before drawing
+  void upload();
+  // Binds the table and the pool's arrays for the shader, which must be in use
+  void bind(const Shader& shader) const;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include "MeshData.hpp"
+#include "VertexLayout.hpp"
+
+// GPU copy of a MeshData: one vertex buffer, one index buffer holding every LOD and the VAO tying
+// them together. Owns the GL objects, so it can be moved but not copied.
+class Mesh {
+private:
+  GLuint m_vao;
+  GLuint m_vbo;
+  GLuint m_ebo;
+  size_t m_vertexCount;
+  size_t m_bytes;  // Vertex + index buffer
+  std::vector<MeshLOD> m_lods;
+  AABB m_bounds;
+
+  // Vertex format and what the shader needs to decode it
+  VertexLayout m_layout;
+  glm::vec3 m_positionScale;
+  glm::vec3 m_positionOffset;
+  bool m_octahedralNormals;
+
+  void release();
+
+public:
+  Mesh(const MeshData& data, const VertexEncoding& encoding);
+  ~Mesh();
+
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
+  Mesh(Mesh&& other) noexcept;
+  Mesh& operator=(Mesh&& other) noexcept;
+
+  void bind() const;
+  // Draws one LOD range of the index buffer, the mesh must be bound
+  void draw(int lod = 0) const;
+
+  GLuint getVAO() const {
+    return m_vao;
+  }
+  size_t getVertexCount() const {
+    return m_vertexCount;
+  }
+  size_t getMemoryUsage() const {
+    return m_bytes;
+  }
+  const std::vector<MeshLOD>& getLODs() const {
+    return m_lods;
+  }
+  const AABB& getBounds() const {
+    return m_bounds;
+  }
+  const VertexLayout& getLayout() const {
+    return m_layout;
+  }
+  const glm::vec3& getPositionScale() const {
+    return m_positionScale;
+  }
+  const glm::vec3& getPositionOffset() const {
+    return m_positionOffset;
+  }
+  bool hasOctahedralNormals() const {
+    return m_octahedralNormals;
+  }
+};
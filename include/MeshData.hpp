@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+
+struct Vertex {
+  glm::vec3 position;
+  glm::vec3 normal = glm::vec3(0.0f);
+  glm::vec2 texCoord;
+};
+
+// A range of the shared index buffer holding one level of detail
+struct MeshLOD {
+  unsigned int indexOffset = 0;
+  unsigned int indexCount = 0;
+  float error = 0.0f;  // Simplification error relative to the mesh radius
+};
+
+// CPU side geometry. All LODs reference the same vertex array and live back to back in one index
+// buffer, so switching LOD is only a different draw range.
+struct MeshData {
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+  std::vector<MeshLOD> lods;
+  AABB bounds;
+
+  void computeBounds();
+  // Area weighted face normals, accumulated per vertex (so unwelded input gets flat normals)
+  void computeNormals();
+
+  // Builds an indexed triangle list from interleaved position (3 floats) + uv (2 floats) data
+  static MeshData fromInterleaved(const float* data, size_t vertexCount);
+
+  // Flat little endian copy of the vertices, indices, LODs and bounds, as stored by machi_cook
+  std::vector<uint8_t> serialize() const;
+  static bool deserialize(const uint8_t* data, size_t size, MeshData& mesh);
+};
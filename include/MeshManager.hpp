@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
+#include "ResidencyManager.hpp"
+
+// Owns every mesh on the GPU by name. Geometry handed to load() goes through the optimization
+// pipeline first: weld -> LOD chain -> vertex cache/overdraw per LOD -> vertex fetch -> upload.
+class MeshManager {
+private:
+  std::unordered_map<std::string, std::unique_ptr<Mesh>> m_meshes;
+  std::unordered_map<std::string, int> m_residencyIds;
+  ResidencyManager* m_residency;
+  MeshOptimizer::LODSettings m_lodSettings;
+  bool m_compressVertices = true;
+
+  Mesh* upload(const std::string& name, const MeshData& data, const VertexEncoding& encoding);
+
+public:
+  // Buffers are reported to the residency manager for accounting, meshes are never evicted
+  explicit MeshManager(ResidencyManager* residency = nullptr);
+  ~MeshManager();
+
+  MeshManager(const MeshManager&) = delete;
+  MeshManager& operator=(const MeshManager&) = delete;
+
+  // Optimizes and uploads the mesh, replacing any mesh already loaded under that name. Without an
+  // explicit encoding the most compact one that fits the mesh is picked.
+  Mesh* load(const std::string& name, MeshData data);
+  Mesh* load(const std::string& name, MeshData data, const VertexEncoding& encoding);
+  // Geometry machi_cook already ran through the pipeline (MeshData::serialize), uploaded as is
+  Mesh* loadCooked(const std::string& name, const uint8_t* data, size_t size);
+  Mesh* get(const std::string& name) const;
+  void unload(const std::string& name);
+  void clear();
+
+  void setLODSettings(const MeshOptimizer::LODSettings& settings) {
+    m_lodSettings = settings;
+  }
+  void setCompressVertices(bool compress) {
+    m_compressVertices = compress;
+  }
+  size_t getMeshCount() const {
+    return m_meshes.size();
+  }
+};
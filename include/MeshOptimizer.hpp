@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include "MeshData.hpp"
+
+namespace MeshOptimizer {
+struct SimplifyOptions {
+  // How much a uv change costs compared to moving a vertex across the whole mesh
+  float attributeWeight = 0.5f;
+  // Vertices on open borders and uv seams stay where they are so silhouettes and seams survive
+  bool lockBorders = true;
+};
+
+struct LODSettings {
+  int maxLevels = 4;
+  float reduction = 0.5f;   // Triangle ratio between consecutive levels
+  float maxError = 0.05f;   // Stop once a level would exceed this error (relative to the mesh radius)
+  SimplifyOptions simplify;
+};
+
+// Quadric error metric simplification (Garland-Heckbert, extended with uv attributes). Collapses
+// edges onto existing vertices, so the result indexes the same vertex array as the input.
+std::vector<unsigned int> simplify(const std::vector<Vertex>& vertices,
+                                   const std::vector<unsigned int>& indices,
+                                   size_t targetIndexCount,
+                                   float targetError,
+                                   float* resultError = nullptr,
+                                   const SimplifyOptions& options = {});
+
+// Appends progressively simplified levels to mesh.indices/mesh.lods (level 0 must already exist)
+void generateLODChain(MeshData& mesh, const LODSettings& settings = {});
+
+// Welds identical vertices and rewrites the index buffer. Returns the new vertex count.
+size_t generateIndexBuffer(MeshData& mesh);
+
+// Reorders triangles for the post-transform vertex cache (Forsyth's linear-speed algorithm)
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+// Splits a cache optimized triangle list into clusters and sorts them front to back (outward
+// facing first) so early depth test rejects more. threshold bounds the allowed ACMR increase.
+void optimizeOverdraw(unsigned int* indices,
+                      size_t indexCount,
+                      const std::vector<Vertex>& vertices,
+                      float threshold = 1.05f);
+
+// Reorders vertices in first-use order of the index buffer and drops unused ones
+void optimizeVertexFetch(MeshData& mesh);
+
+// The whole pipeline MeshManager and the asset cooker run: weld -> LOD chain -> vertex cache and
+// overdraw per LOD -> vertex fetch. Replaces any LODs the mesh already has.
+void optimize(MeshData& mesh, const LODSettings& settings = {});
+
+// Average cache miss ratio: transformed vertices per triangle with a FIFO cache (lower is better)
+float computeACMR(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize = 16);
+}  // namespace MeshOptimizer
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+
+// Low polygon stand-in geometry for an occluder. It must lie inside the real mesh so it never
+// hides something the real mesh would not.
+struct OccluderMesh {
+  std::vector<glm::vec3> vertices;
+  std::vector<unsigned int> indices;  // Counter-clockwise front faces
+
+  static OccluderMesh fromBox(const AABB& bounds);
+};
+
+struct OcclusionStats {
+  int occluderTriangles = 0;
+  int tested = 0;
+  int culled = 0;
+  float rasterMs = 0.0f;  // Time spent rasterizing occluders and building the hierarchy
+  float testMs = 0.0f;    // Time spent testing bounds against the buffer
+
+  float culledPercent() const {
+    return tested > 0 ? 100.0f * culled / tested : 0.0f;
+  }
+};
+
+// CPU software occlusion culling. A handful of occluder meshes are rasterized (4 pixels at a time
+// with SSE) into a small depth buffer, which is then reduced into a tile hierarchy holding the
+// farthest depth of every 8x8 tile. Object bounds are rejected against the tiles first and only
+// fall back to a per-pixel test where a tile is inconclusive. Needs no GPU at all.
+class OcclusionCuller {
+private:
+  static constexpr int TileSize = 8;
+
+  int m_width;
+  int m_height;
+  int m_tilesX;
+  int m_tilesY;
+
+  std::vector<float> m_depth;    // Nearest occluder depth per pixel, [0, 1] window depth
+  std::vector<float> m_tileMax;  // Farthest depth inside each tile
+
+  glm::mat4 m_viewProjection;
+  OcclusionStats m_stats;
+
+  struct ScreenVertex {
+    float x, y, z;
+  };
+
+  void rasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2);
+  void clipAndRasterize(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2);
+  ScreenVertex toScreen(const glm::vec4& clip) const;
+  bool isRegionOccluded(int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+
+public:
+  OcclusionCuller(int width = 256, int height = 128);
+  ~OcclusionCuller() = default;
+
+  // Clears the buffer, call once per frame before rendering occluders
+  void beginFrame(const glm::mat4& viewProjection);
+
+  void renderOccluder(const OccluderMesh& mesh, const glm::mat4& model);
+
+  // Builds the tile hierarchy, call after all occluders and before testing
+  void finalize();
+
+  // World space bounds test. Conservative: anything that cannot be proven hidden is visible.
+  bool isVisible(const AABB& worldBounds);
+
+  const OcclusionStats& getStats() const {
+    return m_stats;
+  }
+  int getWidth() const {
+    return m_width;
+  }
+  int getHeight() const {
+    return m_height;
+  }
+  const std::vector<float>& getDepthBuffer() const {
+    return m_depth;
+  }
+};
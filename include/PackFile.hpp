@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MappedFile.hpp"
+
+// What a packed blob holds, decided by the cooker
+enum class AssetType : uint32_t {
+  Raw = 0,      // Copied as is
+  Texture = 1,  // KTX2 with the full BCn mip chain
+  Shader = 2,   // GLSL source
+  Mesh = 3,     // Optimized MeshData (see MeshData::serialize)
+};
+
+// On-disk layout, little endian. Blobs start 16 byte aligned after the header, followed by the TOC
+// (sorted by name hash) and a string table with the entry names.
+namespace PackFormat {
+constexpr char Magic[4] = {'M', 'P', 'A', 'K'};
+constexpr uint32_t Version = 1;
+constexpr size_t Alignment = 16;
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t stringTableSize;
+  uint64_t tocOffset;
+  uint64_t stringTableOffset;
+};
+
+struct Entry {
+  uint64_t nameHash;
+  uint64_t contentHash;  // Of the source and cook settings, lets the cooker skip unchanged assets
+  uint64_t offset;
+  uint64_t size;
+  uint32_t nameOffset;
+  uint32_t nameLength;
+  uint32_t type;
+  uint32_t flags;
+};
+
+static_assert(sizeof(Header) == 32, "pack header layout changed");
+static_assert(sizeof(Entry) == 48, "pack entry layout changed");
+
+// FNV-1a, chained through seed
+uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+}  // namespace PackFormat
+
+// Points straight into the mapped pack, valid for as long as the pack stays open
+struct AssetView {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  AssetType type = AssetType::Raw;
+  uint64_t contentHash = 0;
+
+  explicit operator bool() const {
+    return data != nullptr;
+  }
+  std::string_view text() const {
+    return {reinterpret_cast<const char*>(data), size};
+  }
+};
+
+// Memory-mapped archive written by machi_cook. Assets are looked up by the path of their source
+// file relative to the directory that was cooked, which is mounted at a directory on disk so that
+// loaders can keep asking for the loose paths ("../resources/shaders/main.vert.glsl"). Loose files
+// under the mount point that were modified after the pack was written win over their packed copy.
+class PackFile {
+private:
+  MappedFile m_file;
+  const PackFormat::Entry* m_entries = nullptr;
+  uint32_t m_entryCount = 0;
+  const char* m_strings = nullptr;
+  std::string m_mountPoint;
+  std::vector<bool> m_stale;  // Per entry, the loose file is newer and find() skips it
+  uint32_t m_staleCount = 0;
+
+  bool validate(const std::string& filepath);
+  // Compares the loose files under the mount point with the pack's write time
+  void findStaleEntries(const std::string& filepath);
+
+public:
+  PackFile() = default;
+  ~PackFile();
+
+  PackFile(const PackFile&) = delete;
+  PackFile& operator=(const PackFile&) = delete;
+
+  // Logs and returns false when the file is missing or malformed
+  bool open(const std::string& filepath, const std::string& mountPoint = "");
+  void close();
+
+  // Accepts names as stored ("shaders/main.vert.glsl") or paths under the mount point. Entries whose
+  // loose file is newer than the pack are not found, so loaders read the edited file instead.
+  AssetView find(const std::string& path) const;
+  AssetView find(const std::string& path, AssetType type) const;
+
+  // Entries in TOC order, for listing the contents
+  AssetView getEntry(uint32_t index) const;
+  std::string_view getEntryName(uint32_t index) const;
+
+  bool isOpen() const {
+    return m_file.isOpen();
+  }
+  uint32_t getEntryCount() const {
+    return m_entryCount;
+  }
+  // Entries outdated by their loose file
+  uint32_t getStaleCount() const {
+    return m_staleCount;
+  }
+  const std::string& getMountPoint() const {
+    return m_mountPoint;
+  }
+
+  // The pack the loaders (textures, shaders) look in before going to the loose files. Only set it
+  // while nothing is loading, lookups from worker threads are not synchronized with it.
+  static void mount(const PackFile* pack);
+  static const PackFile* mounted();
+};
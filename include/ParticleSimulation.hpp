@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include "JobSystem.hpp"
+
+struct ParticleEmitter {
+  glm::vec3 position = glm::vec3(0.0f);                    // World space
+  glm::vec3 velocity = glm::vec3(0.0f, 3.0f, 0.0f);        // Mean start velocity
+  float velocitySpread = 1.0f;                             // Random velocity added, up to this fast
+  glm::vec3 acceleration = glm::vec3(0.0f, -9.81f, 0.0f);  // Gravity, wind
+  float drag = 0.0f;                                       // Fraction of the velocity lost per second
+  float rate = 100.0f;                                     // Particles spawned per second
+  float minLifetime = 1.0f;                                // Seconds
+  float maxLifetime = 2.0f;
+  glm::vec4 startColor = glm::vec4(1.0f);  // Linear, alpha scales how much a particle adds
+  glm::vec4 endColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+  float startSize = 0.05f;  // World space half size
+  float endSize = 0.02f;
+  int capacity = 1000;  // Live particles at most, spawning waits for room
+  bool active = true;   // Inactive emitters stop spawning, their particles live on
+};
+
+// The CPU half of ParticleSystem, without any GL, so it can be run and timed on its own. Particles
+// are stored as a structure of arrays per emitter, so every update step is a loop over contiguous
+// floats that runs four particles per instruction with SSE. Emitters are simulated in parallel on
+// the job system: integration, then removal of the dead ones by compacting the arrays, then
+// spawning. pack() writes the survivors as instances, with their color and size over life.
+class ParticleSimulation {
+public:
+  static constexpr size_t InstanceBytes = 20;  // Position, size, RGBA8 color
+  static constexpr float MaxStep = 0.1f;       // Longer steps are simulated as this long
+
+private:
+  // One emitter's particles. The arrays are padded to a multiple of 4 so the kernels never need
+  // a scalar tail.
+  struct Pool {
+    ParticleEmitter emitter;
+    size_t count = 0;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> vx;
+    std::vector<float> vy;
+    std::vector<float> vz;
+    std::vector<float> life;      // Age as a fraction of the lifetime, dead at 1
+    std::vector<float> lifeRate;  // 1 / lifetime
+    float spawnDebt = 0.0f;       // Fraction of a particle carried over to the next frame
+    uint32_t random = 1;          // xorshift state, seeded per emitter so runs repeat
+    size_t spawned = 0;
+    size_t died = 0;
+  };
+
+  JobSystem* m_jobs;
+  std::vector<Pool> m_pools;
+  std::vector<size_t> m_offsets;  // First instance of each pool in pack()'s output
+  size_t m_alive;
+  size_t m_spawned;
+  size_t m_died;
+  bool m_simd;
+
+  static void reserve(Pool& pool);
+  static void simulate(Pool& pool, float deltaTime, bool simd);
+  static void spawn(Pool& pool, float deltaTime);
+  static void pack(const Pool& pool, size_t begin, size_t end, uint8_t* out, bool simd);
+
+public:
+  explicit ParticleSimulation(JobSystem* jobs = nullptr);
+
+  int addEmitter(const ParticleEmitter& emitter);
+  // Position, velocity and lifetimes apply to the particles spawned from now on, the rest to all
+  void setEmitter(int index, const ParticleEmitter& emitter);
+  const ParticleEmitter& getEmitter(int index) const {
+    return m_pools[index].emitter;
+  }
+  size_t getEmitterCount() const {
+    return m_pools.size();
+  }
+  void clear();
+
+  // Advances every particle by deltaTime seconds, at most MaxStep, so a stall doesn't spawn a burst
+  void simulate(float deltaTime);
+  // Writes getAliveCount() instances of InstanceBytes each to out, on the job system
+  void pack(uint8_t* out) const;
+
+  // Whether this build has the SSE kernels. Turning them off runs the scalar ones, for comparing.
+  static bool hasSimd();
+  void setSimd(bool enabled) {
+    m_simd = enabled && hasSimd();
+  }
+
+  size_t getAliveCount() const {
+    return m_alive;
+  }
+  size_t getSpawnedCount() const {  // In the last simulate()
+    return m_spawned;
+  }
+  size_t getDiedCount() const {
+    return m_died;
+  }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "ParticleSimulation.hpp"
+#include "ResidencyManager.hpp"
+
+struct ParticleStats {
+  int emitters = 0;
+  size_t alive = 0;
+  size_t spawned = 0;  // This frame
+  size_t died = 0;     // This frame
+  float simulateMs = 0.0f;
+  float streamMs = 0.0f;  // Packing the particles into the instance buffer
+  size_t streamBytes = 0;
+};
+
+// Simulates particles with ParticleSimulation on the job system and streams the survivors straight
+// into an orphaned vertex buffer, drawn as instanced camera facing quads with additive blending so
+// they need no sorting. Shaders are resources/shaders/particle.vert/frag.glsl.
+class ParticleSystem {
+public:
+  static constexpr size_t InstanceBytes = ParticleSimulation::InstanceBytes;
+  static constexpr float MaxStep = ParticleSimulation::MaxStep;  // Longer frames are simulated as this long
+
+private:
+  ParticleSimulation m_simulation;
+  ResidencyManager* m_residency;
+
+  GLuint m_vao;
+  GLuint m_buffer;
+  size_t m_capacity;  // Bytes allocated for the buffer
+  GLsizei m_drawCount;
+  int m_residencyId;
+  ParticleStats m_stats;
+
+public:
+  explicit ParticleSystem(JobSystem* jobs = nullptr, ResidencyManager* residency = nullptr);
+  ~ParticleSystem();
+
+  ParticleSystem(const ParticleSystem&) = delete;
+  ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+  int addEmitter(const ParticleEmitter& emitter) {
+    return m_simulation.addEmitter(emitter);
+  }
+  // Position, velocity and lifetimes apply to the particles spawned from now on, the rest to all
+  void setEmitter(int index, const ParticleEmitter& emitter) {
+    m_simulation.setEmitter(index, emitter);
+  }
+  const ParticleEmitter& getEmitter(int index) const {
+    return m_simulation.getEmitter(index);
+  }
+  void clear();
+
+  // Advances every particle and streams the survivors into the instance buffer
+  void update(float deltaTime);
+  // Additive, without depth writes. The particle shader must be in use with its view and projection.
+  void draw() const;
+
+  size_t getAliveCount() const {
+    return m_stats.alive;
+  }
+  const ParticleStats& getStats() const {
+    return m_stats;
+  }
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ProfileTiming {
+  std::string name;
+  int depth = 0;          // Nesting level the scope was first opened at
+  float cpuMs = 0.0f;     // Smoothed over the frames the scope ran in
+  float gpuMs = 0.0f;     // Same, measured with timestamp queries
+  float lastCpuMs = 0.0f;
+  float lastGpuMs = 0.0f;
+  int calls = 0;          // Times the scope ran in the last measured frame
+  int frames = 0;         // Measured frames the scope ran in
+  int skippedFrames = 0;  // Measured frames in a row the scope didn't run in
+};
+
+// CPU and GPU times of named, nestable scopes. GPU times come from GL_TIMESTAMP queries that are
+// read back Latency frames later, so measuring never stalls the pipeline. Scopes that run several
+// times a frame are summed. Results keep the order the scopes were first seen in.
+class Profiler {
+public:
+  static constexpr int Latency = 4;  // Frames of queries in flight
+
+  // Times the enclosing block
+  class Scope {
+  private:
+    Profiler* m_profiler;
+
+  public:
+    Scope(Profiler* profiler, const char* name) : m_profiler(profiler) {
+      if (m_profiler) {
+        m_profiler->push(name);
+      }
+    }
+    ~Scope() {
+      if (m_profiler) {
+        m_profiler->pop();
+      }
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+
+private:
+  using Clock = std::chrono::high_resolution_clock;
+
+  struct Event {
+    int timing;
+    GLuint queries[2];  // Timestamps at push and pop
+    Clock::time_point start;
+    float cpuMs;
+  };
+
+  std::vector<ProfileTiming> m_timings;
+  std::unordered_map<std::string, int> m_lookup;
+  std::vector<Event> m_frames[Latency];
+  std::vector<int> m_open;  // Events of the current frame still waiting for pop()
+  std::vector<GLuint> m_freeQueries;
+  int m_frame;
+
+  GLuint takeQuery();
+  void collect(std::vector<Event>& events);
+
+public:
+  Profiler();
+  ~Profiler();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  // Start of frame, reads back the frame recorded Latency frames ago
+  void beginFrame();
+  void push(const char* name);
+  void pop();
+
+  const std::vector<ProfileTiming>& getTimings() const {
+    return m_timings;
+  }
+  // nullptr until the scope has been measured once
+  const ProfileTiming* find(const std::string& name) const;
+};
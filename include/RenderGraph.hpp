@@ -0,0 +1,151 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "Profiler.hpp"
+#include "ResidencyManager.hpp"
+
+struct RenderGraphStats {
+  int passes = 0;             // Declared this frame
+  int culledPasses = 0;       // Whose results nothing used
+  int transientTextures = 0;  // Created by the passes that ran
+  int physicalTextures = 0;   // Backing them after aliasing
+  size_t transientBytes = 0;  // What the transient textures would take without aliasing
+  size_t physicalBytes = 0;   // What they took
+  size_t poolBytes = 0;       // Everything the pool holds, including textures kept from earlier frames
+};
+
+// Per-frame graph of render passes. Every frame the passes are declared again with the resources
+// they read and write, then execute() culls the passes nothing depends on, orders the rest by their
+// dependencies and runs them. Transient render targets are created by the passes and backed by a
+// pool of textures: two transients whose lifetimes don't overlap in the frame share one texture, and
+// the textures are kept across frames, so adding a pass only costs memory for what is alive at the
+// same time. A pass is culled unless it writes an imported resource (the backbuffer, a shadow map)
+// or is marked as having side effects.
+class RenderGraph {
+public:
+  using Handle = int;
+  static constexpr Handle InvalidHandle = -1;
+  static constexpr int KeepFrames = 60;  // Pool textures unused this long are deleted
+
+  struct TextureDesc {
+    int width = 0;
+    int height = 0;
+    GLenum format = GL_RGBA8;  // Internal format
+    int samples = 1;
+
+    bool operator==(const TextureDesc& other) const {
+      return width == other.width && height == other.height && format == other.format && samples == other.samples;
+    }
+  };
+
+  // Declares what a pass uses, handed to the setup function
+  class Builder {
+  private:
+    RenderGraph& m_graph;
+    int m_pass;
+
+  public:
+    Builder(RenderGraph& graph, int pass) : m_graph(graph), m_pass(pass) {}
+
+    // A transient texture, its contents are undefined until this pass writes (clears) it
+    Handle create(const std::string& name, const TextureDesc& desc);
+    void read(Handle resource);
+    // Written without the graph's help, the pass binds its own framebuffer
+    void write(Handle resource);
+    // Written as attachment index, bound with the pass's framebuffer
+    void colorTarget(Handle resource, int index = 0);
+    void depthTarget(Handle resource);
+    // Never culled
+    void sideEffect();
+  };
+
+  // What a pass sees while executing
+  class Context {
+  private:
+    RenderGraph& m_graph;
+
+  public:
+    explicit Context(RenderGraph& graph) : m_graph(graph) {}
+
+    GLuint texture(Handle resource) const;
+    const TextureDesc& desc(Handle resource) const;
+    // Full size copy or resolve, mask is GL_COLOR_BUFFER_BIT or GL_DEPTH_BUFFER_BIT
+    void blit(Handle source, Handle destination, GLbitfield mask) const;
+    // Three vertices covering the target, positions and UVs are derived from gl_VertexID
+    void drawFullscreenTriangle() const;
+  };
+
+  using SetupFunction = std::function<void(Builder&)>;
+  using ExecuteFunction = std::function<void(const Context&)>;
+
+private:
+  struct Resource {
+    std::string name;
+    TextureDesc desc;
+    GLuint texture = 0;  // Imported, or the pool texture backing it while the graph executes
+    bool imported = false;
+    bool backbuffer = false;
+    std::vector<int> writers;
+    int firstUse = -1;  // Positions in the execution order
+    int lastUse = -1;
+  };
+
+  struct Pass {
+    std::string name;
+    ExecuteFunction execute;
+    std::vector<Handle> reads;
+    std::vector<Handle> writes;
+    std::vector<Handle> colorTargets;  // By attachment index, InvalidHandle for gaps
+    Handle depthTarget = InvalidHandle;
+    bool sideEffect = false;
+    bool culled = false;
+  };
+
+  struct PoolTexture {
+    GLuint texture = 0;
+    TextureDesc desc;
+    int busyUntil = -1;  // Last position in this frame's execution order it is used at
+    int unusedFrames = 0;
+    int residencyId = -1;
+  };
+
+  std::vector<Resource> m_resources;
+  std::vector<Pass> m_passes;
+  std::vector<int> m_order;
+  std::vector<PoolTexture> m_pool;
+  std::map<std::vector<GLuint>, GLuint> m_framebuffers;  // By attachments, colors then depth
+  GLuint m_emptyVAO;
+  ResidencyManager* m_residency;
+  RenderGraphStats m_stats;
+
+  void cull();
+  bool sort();
+  void allocate();
+  void release(size_t poolIndex);
+  GLuint framebuffer(const std::vector<Handle>& colors, Handle depth);
+
+public:
+  explicit RenderGraph(ResidencyManager* residency = nullptr);
+  ~RenderGraph();
+
+  RenderGraph(const RenderGraph&) = delete;
+  RenderGraph& operator=(const RenderGraph&) = delete;
+
+  // Forgets the passes and resources of the last frame, the pool is kept
+  void reset();
+  Handle importTexture(const std::string& name, GLuint texture, const TextureDesc& desc);
+  // The default framebuffer, only usable as a color target or blit destination
+  Handle importBackbuffer(const std::string& name, int width, int height);
+  void addPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute);
+
+  // Culls, orders, allocates and runs the passes, each in its own profiler scope
+  void execute(Profiler* profiler = nullptr);
+
+  const RenderGraphStats& getStats() const {
+    return m_stats;
+  }
+};
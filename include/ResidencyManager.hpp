@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class ResidencyKind { Texture, Buffer };
+
+struct ResidencyStats {
+  size_t budget = 0;
+  size_t used = 0;
+  size_t peak = 0;
+  size_t textureBytes = 0;
+  size_t bufferBytes = 0;
+  int resources = 0;
+  // Reset every frame
+  int touchedThisFrame = 0;
+  int mipsDroppedThisFrame = 0;
+  int evictedThisFrame = 0;
+  size_t bytesFreedThisFrame = 0;
+
+  bool overBudget() const {
+    return used > budget;
+  }
+};
+
+// Accounts for every GPU allocation the engine makes and keeps the total under a budget. Owners
+// report sizes (mip chains included) and touch() what they use each frame. When the total is over
+// budget, the least recently used resources that were not touched this frame are degraded first:
+// one mip level at a time while they can drop one, then evicted entirely. Resources registered
+// without callbacks are only accounted.
+class ResidencyManager {
+public:
+  // Frees the top mip and returns the bytes still resident (unchanged when it can't drop a level)
+  using DropMipFunction = std::function<size_t()>;
+  // Frees everything, the owner brings it back (and reports the new size) when it is needed again
+  using EvictFunction = std::function<void()>;
+
+private:
+  struct Entry {
+    ResidencyKind kind = ResidencyKind::Texture;
+    std::string name;
+    size_t bytes = 0;
+    uint64_t lastUsedFrame = 0;
+    DropMipFunction dropMip;
+    EvictFunction evict;
+    bool active = false;
+    bool exhausted = false;  // On its last mip and not evictable, skipped until it grows or is used
+  };
+
+  std::vector<Entry> m_entries;
+  std::vector<int> m_freeEntries;
+  uint64_t m_frame;
+  ResidencyStats m_stats;
+
+  void account(const Entry& entry, bool add);
+
+public:
+  explicit ResidencyManager(size_t budget);
+
+  ResidencyManager(const ResidencyManager&) = delete;
+  ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+  // Callbacks must not call back into the manager, their results are applied by it
+  int add(ResidencyKind kind,
+          const std::string& name,
+          size_t bytes,
+          DropMipFunction dropMip = nullptr,
+          EvictFunction evict = nullptr);
+  void resize(int id, size_t bytes);
+  void remove(int id);
+  void touch(int id);
+
+  void beginFrame();
+  // End of frame, after everything used has been touched
+  void enforceBudget();
+
+  // Bytes that can still be allocated without going over budget
+  size_t getHeadroom() const {
+    return m_stats.used < m_stats.budget ? m_stats.budget - m_stats.used : 0;
+  }
+  uint64_t getFrame() const {
+    return m_frame;
+  }
+  void setBudget(size_t bytes) {
+    m_stats.budget = bytes;
+  }
+  const ResidencyStats& getStats() const {
+    return m_stats;
+  }
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Logger.hpp"
+
+// Index into a cache's slot table plus the generation of the slot when the handle was made. A slot
+// is reused once its resource is freed, bumping the generation, so stale handles resolve to nothing.
+struct ResourceHandle {
+  static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+  uint32_t index = InvalidIndex;
+  uint32_t generation = 0;
+
+  bool isValid() const {
+    return index != InvalidIndex;
+  }
+  bool operator==(const ResourceHandle& other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const ResourceHandle& other) const {
+    return !(*this == other);
+  }
+};
+
+struct ResourceStats {
+  int hits = 0;      // Requests answered by an already loaded resource
+  int misses = 0;    // Requests that had to load
+  int failures = 0;  // Loads that failed (not cached, retried on the next request)
+  int live = 0;
+  size_t bytes = 0;  // Memory of the live resources, as reported by T::getMemoryUsage()
+
+  float hitRate() const {
+    int requests = hits + misses;
+    return requests > 0 ? 100.0f * hits / requests : 0.0f;
+  }
+};
+
+// Loaded resources of one type, keyed by a string built from the canonical path and the load
+// options. References are counted: the resource is destroyed as soon as the last Ref to it goes
+// away. Refs must not outlive the cache.
+template <typename T>
+class ResourceCache {
+private:
+  struct Slot {
+    std::unique_ptr<T> resource;
+    std::string key;
+    uint32_t generation = 1;
+    uint32_t refCount = 0;
+    size_t bytes = 0;
+  };
+
+  std::string m_typeName;
+  std::vector<Slot> m_slots;
+  std::vector<uint32_t> m_freeSlots;
+  std::unordered_map<std::string, uint32_t> m_lookup;
+  std::function<void(T&)> m_onRelease;
+  ResourceStats m_stats;
+
+  void addRef(ResourceHandle handle) {
+    if (Slot* slot = resolve(handle)) {
+      slot->refCount++;
+    }
+  }
+
+  void release(ResourceHandle handle) {
+    Slot* slot = resolve(handle);
+    if (!slot || --slot->refCount > 0) {
+      return;
+    }
+
+    LOG_INFO_F("[ResourceCache] Freeing {} {}", m_typeName, slot->key);
+    if (m_onRelease) {
+      m_onRelease(*slot->resource);
+    }
+    m_lookup.erase(slot->key);
+    slot->resource.reset();
+    slot->key.clear();
+    slot->generation++;
+    m_stats.live--;
+    m_stats.bytes -= slot->bytes;
+    slot->bytes = 0;
+    m_freeSlots.push_back(handle.index);
+  }
+
+  Slot* resolve(ResourceHandle handle) {
+    if (handle.index >= m_slots.size() || m_slots[handle.index].generation != handle.generation) {
+      return nullptr;
+    }
+    return &m_slots[handle.index];
+  }
+
+public:
+  // Shared ownership of a cached resource, copying adds a reference
+  class Ref {
+  private:
+    ResourceCache* m_cache = nullptr;
+    ResourceHandle m_handle;
+
+    friend class ResourceCache;
+    Ref(ResourceCache* cache, ResourceHandle handle) : m_cache(cache), m_handle(handle) {
+      m_cache->addRef(m_handle);
+    }
+
+  public:
+    Ref() = default;
+    ~Ref() {
+      reset();
+    }
+
+    Ref(const Ref& other) : m_cache(other.m_cache), m_handle(other.m_handle) {
+      if (m_cache) {
+        m_cache->addRef(m_handle);
+      }
+    }
+    Ref& operator=(const Ref& other) {
+      if (this != &other) {
+        Ref copy(other);
+        std::swap(m_cache, copy.m_cache);
+        std::swap(m_handle, copy.m_handle);
+      }
+      return *this;
+    }
+    Ref(Ref&& other) noexcept : m_cache(other.m_cache), m_handle(other.m_handle) {
+      other.m_cache = nullptr;
+      other.m_handle = {};
+    }
+    Ref& operator=(Ref&& other) noexcept {
+      if (this != &other) {
+        reset();
+        std::swap(m_cache, other.m_cache);
+        std::swap(m_handle, other.m_handle);
+      }
+      return *this;
+    }
+
+    void reset() {
+      if (m_cache) {
+        m_cache->release(m_handle);
+        m_cache = nullptr;
+        m_handle = {};
+      }
+    }
+
+    T* get() const {
+      return m_cache ? m_cache->get(m_handle) : nullptr;
+    }
+    T* operator->() const {
+      return get();
+    }
+    T& operator*() const {
+      return *get();
+    }
+    explicit operator bool() const {
+      return get() != nullptr;
+    }
+    ResourceHandle getHandle() const {
+      return m_handle;
+    }
+  };
+
+  explicit ResourceCache(std::string typeName) : m_typeName(std::move(typeName)) {}
+  ~ResourceCache() {
+    if (m_stats.live > 0) {
+      LOG_WARNING_F("[ResourceCache] {} {} resource(s) still referenced at shutdown", m_stats.live, m_typeName);
+    }
+  }
+
+  ResourceCache(const ResourceCache&) = delete;
+  ResourceCache& operator=(const ResourceCache&) = delete;
+
+  // Returns the cached resource for key, or calls load() (returning a std::unique_ptr<T>, null on
+  // failure) to create it. A failed load returns an empty Ref.
+  template <typename Loader>
+  Ref acquire(const std::string& key, Loader&& load) {
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end()) {
+      m_stats.hits++;
+      return Ref(this, {it->second, m_slots[it->second].generation});
+    }
+
+    m_stats.misses++;
+    std::unique_ptr<T> resource = load();
+    if (!resource) {
+      m_stats.failures++;
+      LOG_ERROR_F("[ResourceCache] Failed to load {} {}", m_typeName, key);
+      return Ref();
+    }
+
+    uint32_t index;
+    if (!m_freeSlots.empty()) {
+      index = m_freeSlots.back();
+      m_freeSlots.pop_back();
+    } else {
+      index = static_cast<uint32_t>(m_slots.size());
+      m_slots.emplace_back();
+    }
+
+    Slot& slot = m_slots[index];
+    slot.bytes = resource->getMemoryUsage();
+    slot.resource = std::move(resource);
+    slot.key = key;
+    slot.refCount = 0;
+    m_lookup[key] = index;
+    m_stats.live++;
+    m_stats.bytes += slot.bytes;
+
+    return Ref(this, {index, slot.generation});
+  }
+
+  // Called right before a resource is destroyed
+  void setReleaseCallback(std::function<void(T&)> callback) {
+    m_onRelease = std::move(callback);
+  }
+
+  // Null when the handle is stale
+  T* get(ResourceHandle handle) {
+    Slot* slot = resolve(handle);
+    return slot ? slot->resource.get() : nullptr;
+  }
+
+  const std::string& getTypeName() const {
+    return m_typeName;
+  }
+  const ResourceStats& getStats() const {
+    return m_stats;
+  }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ResidencyManager.hpp"
+#include "ResourceCache.hpp"
+#include "Shader.hpp"
+#include "ShaderCache.hpp"
+#include "Texture.hpp"
+
+// Single entry point for file-backed GPU resources. The same file with the same options is only
+// ever loaded once; everyone asking for it shares the GL object until the last reference drops.
+class ResourceManager {
+private:
+  ResourceCache<Texture> m_textures;
+  ResourceCache<Shader> m_shaders;
+  ResidencyManager* m_residency;
+  ShaderCache* m_shaderCache = nullptr;
+  std::vector<ResourceCache<Shader>::Ref> m_compilingShaders;  // Held until the driver is done with them
+  std::vector<ResourceCache<Shader>::Ref> m_warmShaders;       // Kept alive for the whole run
+  std::unordered_map<const Texture*, int> m_residencyIds;
+
+public:
+  using TextureRef = ResourceCache<Texture>::Ref;
+  using ShaderRef = ResourceCache<Shader>::Ref;
+
+  // Loaded textures are reported to the residency manager for accounting
+  explicit ResourceManager(ResidencyManager* residency = nullptr);
+
+  // The texture unit is chosen at bind time (Texture::bindTexture(unit)), so it is not part of
+  // the key. Usage is: it decides between sRGB and linear storage.
+  TextureRef loadTexture(const std::string& path);
+  TextureRef loadTexture(const std::string& path, TextureUsage usage);
+  ShaderRef loadShader(const std::string& vertexPath, const std::string& fragmentPath);
+  // One variant of the shader pair, compiled on first use. Without wait the compile runs in the
+  // background: the returned shader is usable once isReady() and isLinked(), see updateShaders().
+  ShaderRef loadShader(const std::string& vertexPath,
+                       const std::string& fragmentPath,
+                       const ShaderDefines& defines,
+                       bool wait = true);
+  // Finishes the background compiles the driver is done with, returns how many. Once per frame.
+  int updateShaders();
+  // Starts compiling every variant in the list, one "vertex fragment [NAME[=value] ...]" per line
+  // with paths relative to the list. Returns how many were started.
+  int warmUpShaders(const std::string& listPath);
+  int getCompilingShaderCount() const {
+    return static_cast<int>(m_compilingShaders.size());
+  }
+
+  // Shaders loaded from then on go through the program binary cache, null turns it off
+  void setShaderCache(ShaderCache* cache) {
+    m_shaderCache = cache;
+  }
+
+  const ResourceStats& getTextureStats() const {
+    return m_textures.getStats();
+  }
+  const ResourceStats& getShaderStats() const {
+    return m_shaders.getStats();
+  }
+  void logStats() const;
+
+  // "../resources/a.png" and "../resources/./a.png" name the same file
+  static std::string canonicalPath(const std::string& path);
+};
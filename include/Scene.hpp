@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "BVH.hpp"
+#include "ECS.hpp"
+#include "OcclusionCuller.hpp"
+
+class Mesh;
+
+struct SceneObject {
+  glm::mat4 transform = glm::mat4(1.0f);
+  AABB localBounds;
+  AABB worldBounds;
+  bool isStatic = true;
+  int proxy = BVH::NullNode;
+  int lod = 0;
+  const Mesh* mesh = nullptr;  // Owned by the MeshManager
+  int material = 0;            // Index into the MaterialTable
+
+  // Set for the few large objects worth rasterizing into the occlusion buffer
+  std::shared_ptr<const OccluderMesh> occluder;
+};
+
+// Components that put an entity of the scene's world into the scene, Scene::addEntities() turns
+// entities with all three into objects
+struct Transform {
+  glm::mat4 matrix = glm::mat4(1.0f);
+};
+
+struct MeshRenderer {
+  const Mesh* mesh = nullptr;  // Owned by the MeshManager
+  int material = 0;
+  bool isStatic = true;
+};
+
+struct SceneLink {
+  int objectId = -1;  // -1 until the entity has an object
+};
+
+// Objects are what the renderer draws, culled and picked through the BVH. The entities of the
+// world are everything the game simulates, the ones with a Transform, a MeshRenderer and a SceneLink
+// are also objects.
+class Scene {
+private:
+  std::vector<SceneObject> m_objects;
+  BVH m_bvh;
+  World m_world;
+
+  bool m_needsRebuild;       // Static objects were added - rerun the SAH build
+  bool m_needsRefit;         // Static objects were moved - refit the tree bottom-up
+  uint64_t m_staticVersion;  // Bumped whenever static geometry changes, caches of it compare it
+
+public:
+  Scene();
+  ~Scene() = default;
+
+  // Static objects go through the SAH builder, dynamic ones are inserted incrementally
+  int addObject(const glm::mat4& transform, const AABB& localBounds, bool isStatic = true);
+  void setTransform(int objectId, const glm::mat4& transform);
+  void setOccluder(int objectId, std::shared_ptr<const OccluderMesh> occluder);
+  void setMesh(int objectId, const Mesh* mesh) {
+    m_objects[objectId].mesh = mesh;
+    if (m_objects[objectId].isStatic) {
+      m_staticVersion++;
+    }
+  }
+  void setMaterial(int objectId, int material) {
+    m_objects[objectId].material = material;
+  }
+  void setLOD(int objectId, int lod) {
+    m_objects[objectId].lod = lod;
+  }
+
+  // Creates an object, bounded by its mesh, for every linked entity that doesn't have one yet.
+  // Returns how many were added.
+  int addEntities();
+
+  // Applies pending rebuilds/refits, call once per frame before any query
+  void update();
+  void buildHierarchy();
+
+  // Spatial queries - results are object ids
+  void cull(const Frustum& frustum, std::vector<int>& visible) const;
+  void queryOverlap(const AABB& bounds, std::vector<int>& results) const;
+  bool pick(const Ray& ray, float maxDistance, RaycastHit& hit) const;
+
+  // Rasterizes the visible occluders and removes the objects they hide from the list
+  void cullOccluded(OcclusionCuller& culler, const glm::mat4& viewProjection, std::vector<int>& visible) const;
+
+  const SceneObject& getObject(int objectId) const {
+    return m_objects[objectId];
+  }
+  size_t getObjectCount() const {
+    return m_objects.size();
+  }
+  World& getWorld() {
+    return m_world;
+  }
+  const World& getWorld() const {
+    return m_world;
+  }
+  const BVH& getBVH() const {
+    return m_bvh;
+  }
+  uint64_t getStaticVersion() const {
+    return m_staticVersion;
+  }
+};
@@ -1,16 +1,71 @@
 #pragma once
 #include <glad/glad.h>
+#include <memory>
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "ShaderPreprocessor.hpp"
+
+class ShaderCache;
 
 class Shader {
 private:
+  // Compile and link issued to the driver but not checked yet
+  struct Pending {
+    unsigned int vertex = 0;
+    unsigned int fragment = 0;
+    ShaderCache* cache = nullptr;
+    uint64_t cacheKey = 0;
+    std::string name;
+    std::vector<std::string> vertexFiles;
+    std::vector<std::string> fragmentFiles;
+  };
+
+  bool m_linked = false;
+  size_t m_bytes = 0;
+  std::unique_ptr<Pending> m_pending;
+
+  void build(const ShaderSource& vertex, const ShaderSource& fragment, ShaderCache* cache);
+  void readBinaryLength();
+
 public:
   unsigned int m_id;
 
-  // constructor reads and builds the shader
-  Shader(const char* vPath, const char* fPath);
+  // constructor reads and builds the shader, from the cached program binary when there is one
+  Shader(const char* vPath, const char* fPath, ShaderCache* cache = nullptr);
+  // Preprocessed with the defines. Without wait the compile is only started: poll isReady() and
+  // call finish() once it is, so the driver can compile in the background.
+  Shader(const std::string& vPath,
+         const std::string& fPath,
+         const ShaderDefines& defines,
+         ShaderCache* cache = nullptr,
+         bool wait = true);
+  ~Shader();
+
+  // Owns the GL program, so it can be moved but not copied
+  Shader(const Shader&) = delete;
+  Shader& operator=(const Shader&) = delete;
+  Shader(Shader&& other) noexcept;
+  Shader& operator=(Shader&& other) noexcept;
+
+  bool isLinked() const {
+    return m_linked;
+  }
+  // False while the driver is still compiling in the background, never blocks
+  bool isReady() const;
+  // Checks the compile and link results, logging any errors. Blocks when the driver isn't done yet.
+  bool finish();
+
+  // Lets the driver compile on threads of its own (KHR/ARB_parallel_shader_compile), so shaders
+  // built without waiting don't stall the frame. False when the driver can't.
+  static bool enableParallelCompile();
+  static bool hasParallelCompile();
+
+  // Size of the linked program binary, 0 where the driver can't report it (before GL 4.1)
+  size_t getMemoryUsage() const {
+    return m_bytes;
+  }
 
   // use/activate the shader
   void use();
@@ -19,6 +74,7 @@ public:
   void setBool(const std::string& name, bool value) const;
   void setInt(const std::string& name, int value) const;
   void setFloat(const std::string& name, float value) const;
+  void setVec3(const std::string& name, const glm::vec3& value) const;
   void setMat4(const std::string& name, glm::mat4& mat) const;
   // void unbind() const;
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct ShaderCacheStats {
+  int hits = 0;      // Programs created from a cached binary
+  int misses = 0;    // Programs that had to be compiled from source
+  int rejected = 0;  // Cached binaries the driver refused (driver update, different GPU), counted as misses too
+  int stored = 0;
+};
+
+// Linked program binaries on disk (GL 4.1 / ARB_get_program_binary), one file per program. Files
+// are named after a hash of the exact source text handed to the compiler and of the driver's
+// vendor, renderer and version strings, so a driver update or a different GPU simply misses. A
+// binary the driver still refuses is deleted and the caller compiles from source as usual.
+// Needs the GL context.
+class ShaderCache {
+private:
+  typedef void(APIENTRYP GetProgramBinaryProc)(
+    GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+  typedef void(APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+  typedef void(APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+  std::string m_directory;
+  uint64_t m_driverHash;
+  bool m_supported;
+  ShaderCacheStats m_stats;
+
+  GetProgramBinaryProc m_getProgramBinary;
+  ProgramBinaryProc m_programBinary;
+  ProgramParameteriProc m_programParameteri;
+
+  std::string entryPath(uint64_t key) const;
+
+public:
+  explicit ShaderCache(const std::string& directory);
+
+  ShaderCache(const ShaderCache&) = delete;
+  ShaderCache& operator=(const ShaderCache&) = delete;
+
+  // Key of the program built from these sources, by this driver
+  uint64_t key(std::string_view vertexSource, std::string_view fragmentSource) const;
+
+  // A linked program made from the cached binary, 0 when there is none or the driver rejected it
+  GLuint load(uint64_t key);
+  // Call between creating the program and linking it, asks the driver to keep the binary around
+  void prepare(GLuint program) const;
+  // Writes the binary of a linked program, false when it could not be retrieved or written
+  bool store(uint64_t key, GLuint program);
+
+  bool isSupported() const {
+    return m_supported;
+  }
+  const std::string& getDirectory() const {
+    return m_directory;
+  }
+  const ShaderCacheStats& getStats() const {
+    return m_stats;
+  }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Name and value pairs, a define with an empty value is defined as 1
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+struct ShaderSource {
+  std::string text;
+  // Source string numbers used by the #line directives (and so by the compiler's log), 0 is the
+  // file that was loaded
+  std::vector<std::string> files;
+};
+
+namespace ShaderPreprocessor {
+// Expands #include "file" (relative to the including file, each file at most once, like a
+// #pragma once on every file) and puts the defines right after the #version line. Files come from
+// the mounted asset pack when it has them. Throws std::runtime_error on a missing file.
+ShaderSource load(const std::string& filepath, const ShaderDefines& defines = {});
+
+// The same set of defines in any order gives the same key
+std::string definesKey(const ShaderDefines& defines);
+}  // namespace ShaderPreprocessor
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include "Profiler.hpp"
+#include "ResidencyManager.hpp"
+#include "Scene.hpp"
+#include "Shader.hpp"
+
+struct ShadowStats {
+  int rendered = 0;      // Cascades whose casters were drawn from scratch this frame
+  int cached = 0;        // Cached cascades reused as they were
+  int copied = 0;        // Cached cascades restored from their static layer to add moving casters
+  int casters = 0;       // Shadow draws
+  float savedMs = 0.0f;  // GPU time the reused cascades took the last time they were rendered
+};
+
+// Cascaded shadow maps for one directional light. The view frustum up to the shadow distance is
+// split into cascades, each covered by a texel-snapped orthographic projection of a bounding sphere
+// so the shadow edges don't crawl when the camera moves or turns. Casters are culled per cascade.
+// Cascades from firstCached on keep their static casters in a separate layer that is only
+// re-rendered when static geometry or the light changes, when the camera leaves the (padded) area
+// they cover, or every refresh interval, staggered across cascades. Moving casters are drawn over a
+// copy of it. Shaders get the lookup from resources/shaders/shadows.glsl.
+class ShadowMaps {
+public:
+  static constexpr int MaxCascades = 4;  // MAX_CASCADES in shadows.glsl
+  static constexpr int Unit = 11;        // After the light clusters
+
+private:
+  struct Cascade {
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 center = glm::vec3(0.0f);  // World space sphere the projection covers
+    float radius = 0.0f;
+    float splitFar = 0.0f;  // View depth where the cascade ends
+
+    // Cached cascades only
+    bool valid = false;
+    bool hasMovingCasters = false;  // The live layer holds moving casters drawn over the static ones
+    uint64_t staticVersion = 0;
+    glm::vec3 lightDirection = glm::vec3(0.0f);
+  };
+
+  int m_size;
+  int m_cascadeCount;
+  int m_firstCached;
+  float m_distance;
+  int m_refreshInterval;
+  glm::vec3 m_lightDirection;
+  std::array<Cascade, MaxCascades> m_cascades;
+  std::array<glm::mat4, MaxCascades> m_matrices;  // Copies of the view projections, uploaded as one array
+  std::vector<int> m_casters;
+  int m_frame;
+
+  GLuint m_depth;            // One layer per cascade, sampled with depth comparison
+  GLuint m_static;           // The static casters of every cached cascade
+  GLuint m_framebuffers[2];  // Drawn to, read from when restoring a static layer
+  int m_residencyId;
+  ResidencyManager* m_residency;
+  ShadowStats m_stats;
+
+  void fitCascade(int index, const glm::mat4& inverseView, float splitNear, float splitFar, float tanX, float tanY);
+  void drawCasters(const Scene& scene, const Shader& depthShader, bool staticCasters);
+
+public:
+  // Cascades from firstCached on are cached, cascades itself to cache none
+  ShadowMaps(int size, int cascades, int firstCached, float distance, ResidencyManager* residency = nullptr);
+  ~ShadowMaps();
+
+  ShadowMaps(const ShadowMaps&) = delete;
+  ShadowMaps& operator=(const ShadowMaps&) = delete;
+
+  // Direction the light travels in, world space
+  void setLightDirection(const glm::vec3& direction);
+  // Re-renders cached cascades every this many frames even without changes, 0 = only on changes
+  void setRefreshInterval(int frames) {
+    m_refreshInterval = frames;
+  }
+  // Forces every cached cascade to re-render
+  void invalidate();
+
+  // Renders what changed for this camera. The projection is a symmetric perspective one with these
+  // parameters, the scene has to be updated already. Leaves the default framebuffer bound.
+  void render(const Scene& scene,
+              Shader& depthShader,
+              const glm::mat4& view,
+              float fovY,
+              float aspect,
+              float nearPlane,
+              Profiler* profiler = nullptr);
+  // Sets the shadows.glsl uniforms of the shader, which must be in use
+  void bind(const Shader& shader) const;
+
+  // The cascades' depth array, for declaring it to the render graph
+  GLuint getTexture() const {
+    return m_depth;
+  }
+  int getSize() const {
+    return m_size;
+  }
+  const ShadowStats& getStats() const {
+    return m_stats;
+  }
+};
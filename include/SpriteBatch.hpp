@@ -0,0 +1,89 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string_view>
+#include <vector>
+#include "FontAtlas.hpp"
+#include "ResidencyManager.hpp"
+#include "Shader.hpp"
+
+struct SpriteStats {
+  size_t quads = 0;
+  int drawCalls = 0;
+  size_t streamBytes = 0;
+};
+
+// Screen space quads, sprites and text, collected over the frame and drawn in as few calls as
+// possible. Every quad goes into one array; consecutive quads with the same texture share a batch.
+// end() streams the whole array into an orphaned vertex buffer at once and draws each batch with a
+// slice of a static index buffer, so a HUD of thousands of glyphs from one font atlas is one draw
+// call. Quads are drawn in the order they were added, interleaving textures costs a call per switch.
+// Shaders are resources/shaders/sprite.vert/frag.glsl.
+class SpriteBatch {
+public:
+  static constexpr size_t VertexBytes = 20;  // Position, texture coordinate, RGBA8 color
+
+private:
+  struct Vertex {
+    float x;
+    float y;
+    float u;
+    float v;
+    uint32_t color;
+  };
+
+  struct Batch {
+    GLuint texture;
+    bool distanceField;  // A FontAtlas, the shader draws the outline
+    size_t first;        // Quads
+    size_t count;
+  };
+
+  std::vector<Vertex> m_vertices;
+  std::vector<Batch> m_batches;
+  glm::vec2 m_screenSize;
+
+  GLuint m_vao;
+  GLuint m_vertexBuffer;
+  GLuint m_indexBuffer;
+  GLuint m_whiteTexture;  // For untextured rectangles
+  size_t m_capacity;      // Quads the buffers hold
+  ResidencyManager* m_residency;
+  int m_residencyId;
+  SpriteStats m_stats;
+
+  void reserve(size_t quads);
+  void addQuad(GLuint texture, bool distanceField, glm::vec2 position, glm::vec2 size, glm::vec4 uv, uint32_t color);
+
+public:
+  explicit SpriteBatch(ResidencyManager* residency = nullptr);
+  ~SpriteBatch();
+
+  SpriteBatch(const SpriteBatch&) = delete;
+  SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+  // Drops anything not drawn and starts over for a target of this size. Positions are in pixels
+  // with the origin at the top left.
+  void begin(int width, int height);
+
+  // uv holds the top left and bottom right texture coordinates, color tints the texture
+  void draw(GLuint texture,
+            glm::vec2 position,
+            glm::vec2 size,
+            glm::vec4 uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+            glm::vec4 color = glm::vec4(1.0f));
+  void drawRect(glm::vec2 position, glm::vec2 size, glm::vec4 color);
+  // position is the top left of the first line, '\n' starts a new one. Text is taken byte by byte
+  // (Latin-1). Returns the width of the longest line.
+  float drawText(const FontAtlas& font, std::string_view text, glm::vec2 position, float pixelSize, glm::vec4 color);
+
+  // Streams everything since begin() to the GPU and draws it over the bound framebuffer, blended,
+  // without depth testing. The sprite shader must be in use.
+  void end(const Shader& shader);
+
+  const SpriteStats& getStats() const {
+    return m_stats;
+  }
+};
@@ -1,23 +1,63 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <string>
+#include "../include/CompressedImage.hpp"
 #include "../include/Utils.hpp"
 
+// Looks through the context's extension list (GLAD only loads core 4.6 entry points)
+bool hasExtension(const char* name);
+// GL side of the block formats, shared by Texture, the streaming loader and the texture pool
+bool isBlockFormatSupported(BlockFormat format, bool srgb);
+GLenum compressedInternalFormat(BlockFormat format, bool srgb);
+// The cooked version of an image lives next to it as .ktx2 or .dds, empty if there is none
+std::string findCompressedSibling(const std::string& filepath);
+// The cooked version of an image from the mounted asset pack (PackFile::mount), false if it has none
+bool loadPackedTexture(const std::string& filepath, CompressedImage& image);
+
 class Texture {
 private:
   unsigned m_texture;
   int m_texture_num = 0;
+  TextureUsage m_usage;
+  bool m_loaded = false;
+  size_t m_bytes = 0;
   Utils::Image m_texture_img;
 
   void setParams() const;
   void loadTexture(const char* filepath);
+  bool loadCompressed(const std::string& filepath);
+  bool uploadCompressed(const std::string& filepath, const CompressedImage& image);
 
 public:
   // enum class Format { PNG, JPEG, JPG };
   // enum class Filter { PNG, JPEG, JPG };
   // enum class Wrap { PNG, JPEG, JPG };
 
+  // A .ktx2/.dds file, or an image whose cooked .ktx2/.dds sibling is used when it exists. The
+  // usage decides between sRGB and linear and is guessed from the file name when not given.
   Texture(int texture_slot, const char* filepath);
+  Texture(int texture_slot, const char* filepath, TextureUsage usage);
+  ~Texture();
+
+  // Owns the GL texture, so it can be moved but not copied
+  Texture(const Texture&) = delete;
+  Texture& operator=(const Texture&) = delete;
+  Texture(Texture&& other) noexcept;
+  Texture& operator=(Texture&& other) noexcept;
+
   void bindTexture();
+  void bindTexture(int unit);
   unsigned const getTexture() const;
+  TextureUsage getUsage() const {
+    return m_usage;
+  }
+  // False when neither the file nor a cooked sibling could be loaded
+  bool isLoaded() const {
+    return m_loaded;
+  }
+  // Estimated GPU memory, mips included
+  size_t getMemoryUsage() const {
+    return m_bytes;
+  }
 };
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CompressedImage.hpp"
+#include "ResidencyManager.hpp"
+#include "Shader.hpp"
+
+// Where a pooled texture lives: a layer of one of the pool's GL_TEXTURE_2D_ARRAYs, and for atlased
+// textures the sub-rectangle of that layer (offset in xy, size in zw). Shaders sample it with
+//   texture(textures, vec3(uvRect.xy + fract(uv) * uvRect.zw, layer))
+// which also keeps tiling working inside an atlas.
+struct TextureRegion {
+  int array = -1;
+  int layer = 0;
+  glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+  bool isValid() const {
+    return array >= 0;
+  }
+};
+
+struct TexturePoolStats {
+  int arrays = 0;
+  int layers = 0;        // Used layers across all arrays
+  int atlasPages = 0;
+  int atlasRegions = 0;
+  size_t bytes = 0;      // GPU memory of every array, including unused layers and mips
+  int grows = 0;         // Arrays reallocated with more layers
+};
+
+// Packs textures into a few texture arrays so that materials differ by a layer index instead of a
+// texture bind. Textures with the same size, format and mip count share an array; small RGBA
+// textures are packed into atlas pages (layers of an atlas array) with replicated edges so the
+// first mips do not bleed. Where ARB_bindless_texture exists the arrays are also made resident
+// and set on samplers by handle, so not even the array has to be bound.
+class TexturePool {
+private:
+  struct TextureArray {
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+    int levels = 0;
+    int capacity = 0;     // Layers allocated
+    int maxCapacity = 0;  // Layers it may grow to
+    int layers = 0;
+    std::vector<size_t> levelBytes;  // Of one layer
+    GLenum internalFormat = 0;
+    bool compressed = false;
+    bool atlas = false;
+    bool mipsDirty = false;  // Atlas pages regenerate their mips in finalize()
+    GLuint64 handle = 0;
+    int residencyId = -1;
+  };
+
+  struct Shelf {
+    int y = 0;
+    int height = 0;
+    int x = 0;  // Next free column
+  };
+
+  struct AtlasPage {
+    int array = -1;
+    int layer = 0;
+    std::vector<Shelf> shelves;
+  };
+
+  std::vector<TextureArray> m_arrays;
+  std::vector<AtlasPage> m_atlasPages;
+  std::unordered_map<std::string, TextureRegion> m_regions;
+  int m_layersPerArray;
+  int m_atlasSize;
+  int m_maxAtlasTexture;
+  bool m_bindless;
+  bool m_canGrow;  // Layers can be copied into a larger array (GL 4.3)
+  ResidencyManager* m_residency;
+  TexturePoolStats m_stats;
+
+  // An array with a free layer matching the description. Arrays start with a single layer and
+  // double when full, up to layersPerArray layers or ArrayBytes; past that a new array is created.
+  int acquireLayer(int width,
+                   int height,
+                   GLenum internalFormat,
+                   bool compressed,
+                   bool atlas,
+                   const std::vector<size_t>& levelBytes,
+                   int& layer);
+  // (Re)allocates the array's storage with room for capacity layers, keeping the layers in use
+  void allocate(TextureArray& array, int capacity);
+  bool placeInAtlas(GLenum internalFormat, int width, int height, int& page, int& x, int& y);
+  TextureRegion addToAtlas(const uint8_t* rgba, int width, int height, GLenum internalFormat);
+
+public:
+  static constexpr size_t ArrayBytes = 64 * 1024 * 1024;  // An array stops growing past this size
+
+  // Atlas pages are atlasSize squared, textures up to maxAtlasTexture on both sides go into them.
+  // Arrays are reported to the residency manager for accounting only.
+  TexturePool(int layersPerArray = 16,
+              int atlasSize = 1024,
+              int maxAtlasTexture = 128,
+              bool allowBindless = true,
+              ResidencyManager* residency = nullptr);
+  ~TexturePool();
+
+  TexturePool(const TexturePool&) = delete;
+  TexturePool& operator=(const TexturePool&) = delete;
+
+  // Same rules as Texture: a cooked .ktx2/.dds sibling is preferred over decoding the image.
+  // Loading the same path again returns the region it already has.
+  TextureRegion load(const std::string& path);
+  TextureRegion load(const std::string& path, TextureUsage usage);
+  TextureRegion add(const std::string& name, const uint8_t* rgba, int width, int height, TextureUsage usage);
+  TextureRegion add(const std::string& name, const CompressedImage& image, TextureUsage usage);
+  const TextureRegion* find(const std::string& name) const;
+
+  // Call after a batch of loads: rebuilds atlas mips and makes new arrays bindless-resident
+  void finalize();
+
+  void bind(int array, int unit) const;
+  // Points a sampler2DArray uniform of the bound shader at an array. By handle when bindless, which
+  // needs "#extension GL_ARB_bindless_texture" in the shader, otherwise by binding it to unit.
+  void setSampler(const Shader& shader, const std::string& name, int array, int unit) const;
+
+  bool isBindless() const {
+    return m_bindless;
+  }
+  GLuint64 getHandle(int array) const {
+    return m_arrays[array].handle;
+  }
+  GLuint getTexture(int array) const {
+    return m_arrays[array].texture;
+  }
+  size_t getArrayCount() const {
+    return m_arrays.size();
+  }
+  const TexturePoolStats& getStats() const {
+    return m_stats;
+  }
+};
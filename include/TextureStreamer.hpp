@@ -0,0 +1,183 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "AsyncIO.hpp"
+#include "CompressedImage.hpp"
+#include "JobSystem.hpp"
+#include "ResidencyManager.hpp"
+
+enum class StreamState {
+  Queued,     // Waiting for a decode slot
+  Decoding,   // On a worker thread
+  Uploading,  // Decoded, mips going up coarse to fine
+  Resident,   // Every mip is on the GPU (or every mip the residency manager left it)
+  Evicted,    // Freed for the memory budget, streams back in when bound again
+  Failed,
+};
+
+struct StreamingStats {
+  int queued = 0;
+  int decoding = 0;
+  int uploading = 0;
+  int resident = 0;
+  int reduced = 0;  // Resident with top mips dropped for the memory budget
+  int evicted = 0;
+  int failed = 0;
+  int uploadsThisFrame = 0;
+  size_t bytesThisFrame = 0;
+  size_t totalBytes = 0;
+};
+
+// Loads textures without stalling the main thread. Files are decoded (or read pre-compressed) on
+// the job system, highest priority first, and the mips are uploaded through a ring of pixel buffer
+// objects under a per-frame byte budget, smallest first. Until its first mip arrives a texture
+// samples a placeholder, after that GL_TEXTURE_BASE_LEVEL follows the finest resident mip.
+class TextureStreamer {
+private:
+  struct MipLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> data;
+  };
+
+  struct DecodedImage {
+    int id = -1;
+    bool success = false;
+    bool compressed = false;
+    bool fromSibling = false;  // Came from a cooked .ktx2/.dds next to the requested image
+    BlockFormat format = BlockFormat::BC1;
+    std::vector<MipLevel> mips;
+  };
+
+  // Shared with in-flight jobs so they can finish safely after the streamer is gone
+  struct DecodeQueue {
+    std::mutex mutex;
+    std::vector<DecodedImage> done;
+  };
+
+  struct StreamedTexture {
+    std::string path;
+    TextureUsage usage = TextureUsage::Color;
+    float priority = 1.0f;
+    StreamState state = StreamState::Queued;
+    bool allowCompressed = true;
+    uint64_t readRequest = 0;  // While the file is being read by AsyncIO
+
+    GLuint texture = 0;
+    bool compressed = false;
+    GLenum internalFormat = 0;
+    std::vector<MipLevel> mips;  // CPU copies, released once uploaded
+    int nextLevel = -1;          // Next mip to upload, counts down to 0
+    int residentLevel = -1;      // Finest uploaded mip, -1 while the placeholder stands in
+    size_t bytes = 0;            // Allocated GPU memory
+
+    // Full chain, kept to copy and restore levels. GL level i of the texture is level firstLevel + i.
+    int width = 0;
+    int height = 0;
+    std::vector<size_t> levelBytes;
+    int firstLevel = 0;
+
+    // Reduced copy that stays bound while the full texture streams back in
+    GLuint fallback = 0;
+    int fallbackLevel = 0;
+    size_t fallbackBytes = 0;
+
+    int residencyId = -1;
+    uint64_t lastBoundFrame = 0;
+    bool canRestore = true;
+  };
+
+  struct UploadBuffer {
+    GLuint pbo = 0;
+    size_t capacity = 0;
+    GLsync fence = nullptr;
+    int residencyId = -1;
+  };
+
+  JobSystem& m_jobs;
+  AsyncIO* m_io;
+  ResidencyManager* m_residency;
+  std::shared_ptr<DecodeQueue> m_decoded;
+  std::vector<StreamedTexture> m_textures;
+  std::vector<UploadBuffer> m_uploadBuffers;
+  size_t m_nextUploadBuffer;
+  size_t m_uploadBudget;
+  int m_maxDecodesInFlight;
+  int m_decodesInFlight;
+  uint64_t m_frame;
+
+  GLuint m_placeholderColor;
+  GLuint m_placeholderLinear;
+  GLuint m_placeholderNormal;
+  StreamingStats m_stats;
+
+  void startDecodes();
+  void receiveDecoded();
+  void allocateStorage(int id, DecodedImage& image);
+  GLuint createStorage(const StreamedTexture& texture, int firstLevel) const;
+  bool uploadLevel(StreamedTexture& texture);
+  UploadBuffer* acquireUploadBuffer(size_t size);
+
+  // Residency callbacks and the way back
+  size_t dropTopMip(int id);
+  void evict(int id);
+  void restoreUsedTextures();
+  void reportResidency(StreamedTexture& texture);
+
+  // The file a texture is read from: its cooked sibling when there is one and it's allowed
+  static std::string sourcePath(const std::string& path, bool allowCompressed);
+  static DecodedImage decode(int id, const std::string& path, TextureUsage usage, bool allowCompressed);
+  static DecodedImage decodeData(int id,
+                                 const std::string& source,
+                                 const uint8_t* data,
+                                 size_t size,
+                                 TextureUsage usage,
+                                 bool fromSibling);
+  static void takeCompressed(DecodedImage& result, CompressedImage& image);
+  static GLuint createPlaceholder(const uint8_t* rgba, bool srgb);
+
+public:
+  // With AsyncIO files are read by it and only decoded on the job system. With a residency manager,
+  // textures not bound recently give up mips (or their memory) when it runs over budget and stream
+  // back in once they are bound again.
+  TextureStreamer(JobSystem& jobs,
+                  AsyncIO* io = nullptr,
+                  ResidencyManager* residency = nullptr,
+                  size_t uploadBudget = 4 * 1024 * 1024,
+                  int uploadBuffers = 4);
+  ~TextureStreamer();
+
+  TextureStreamer(const TextureStreamer&) = delete;
+  TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+  // Returns a texture id, usable right away (it samples a placeholder until data arrives)
+  int request(const std::string& path, float priority = 1.0f);
+  int request(const std::string& path, TextureUsage usage, float priority = 1.0f);
+  void setPriority(int id, float priority);
+
+  // Main thread, once per frame: collects decoded images and spends the upload budget
+  void update();
+
+  // Also marks the texture as used this frame
+  void bind(int id, int unit);
+  // The placeholder until the first mip is on the GPU
+  GLuint getTexture(int id) const;
+  StreamState getState(int id) const {
+    return m_textures[id].state;
+  }
+  bool isResident(int id) const {
+    return m_textures[id].state == StreamState::Resident;
+  }
+
+  void setUploadBudget(size_t bytes) {
+    m_uploadBudget = bytes;
+  }
+  const StreamingStats& getStats() const {
+    return m_stats;
+  }
+};
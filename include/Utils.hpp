@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
+#include "MappedFile.hpp"
 
 namespace Utils {
 // Structs
@@ -12,11 +15,18 @@ struct Image {
   int channels;
 };
 
+// Maps the file instead of copying it, use this over loadFile/loadBinaryFile when the contents are
+// only read. Throws like they do when the file can't be opened.
+MappedFile mapFile(const std::string& filepath, FileAccess access = FileAccess::Sequential, bool debug = true);
 std::string loadFile(const std::string& filepath, bool debug = true);
+std::vector<uint8_t> loadBinaryFile(const std::string& filepath, bool debug = true);
 
 // unsigned char* loadImage(const std::string& filepath, bool debug = true);
 
-Image loadImage(const std::string& filepath, bool debug = true);
+// desiredChannels forces the channel count of the returned data (0 keeps the file's own)
+Image loadImage(const std::string& filepath, bool debug = true, int desiredChannels = 0);
+// The same from an encoded file already in memory (PNG, JPEG ...), without logging
+Image loadImage(const uint8_t* data, size_t size, int desiredChannels = 0);
 
 void freeImage(Image& img);
 
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MeshData.hpp"
+
+// The value is the shader attribute location
+enum class VertexAttribute : uint8_t {
+  Position = 0,
+  TexCoord = 1,
+  Normal = 2,
+};
+
+enum class VertexFormat : uint8_t {
+  Float2,
+  Float3,
+  Half2,
+  Half4,
+  UNorm16x2,
+  UNorm16x4,
+  SNorm16x2,
+};
+
+struct VertexElement {
+  VertexAttribute attribute;
+  VertexFormat format;
+  unsigned int offset;
+};
+
+// Declarative description of one interleaved vertex buffer
+class VertexLayout {
+private:
+  std::vector<VertexElement> m_elements;
+  unsigned int m_stride = 0;
+
+public:
+  // Elements are packed in the order they are added, each one 4-byte aligned
+  VertexLayout& add(VertexAttribute attribute, VertexFormat format);
+
+  // Sets up the attribute pointers for the buffer bound to GL_ARRAY_BUFFER (VAO must be bound)
+  void apply() const;
+
+  const VertexElement* find(VertexAttribute attribute) const;
+  const std::vector<VertexElement>& getElements() const {
+    return m_elements;
+  }
+  unsigned int getStride() const {
+    return m_stride;
+  }
+
+  static unsigned int formatSize(VertexFormat format);
+};
+
+enum class PositionEncoding { Float, UNorm16 };
+enum class NormalEncoding { Float, Octahedral16 };
+enum class TexCoordEncoding { Float, Half, UNorm16 };
+
+// How a mesh stores its vertices on the GPU. Quantized positions are relative to the mesh bounds
+// and expanded again in the vertex shader with the scale/offset of the encoded mesh.
+struct VertexEncoding {
+  PositionEncoding position = PositionEncoding::UNorm16;
+  NormalEncoding normal = NormalEncoding::Octahedral16;
+  TexCoordEncoding texCoord = TexCoordEncoding::UNorm16;
+
+  VertexLayout layout() const;
+
+  static VertexEncoding uncompressed();
+  // Smallest encoding that keeps positions within maxPositionError (in mesh units) and can
+  // represent the mesh's uv range
+  static VertexEncoding select(const MeshData& mesh, float maxPositionError = 0.001f);
+};
+
+struct EncodedVertices {
+  VertexLayout layout;
+  std::vector<uint8_t> data;
+
+  // position = decoded * positionScale + positionOffset
+  glm::vec3 positionScale = glm::vec3(1.0f);
+  glm::vec3 positionOffset = glm::vec3(0.0f);
+  bool octahedralNormals = false;
+};
+
+EncodedVertices encodeVertices(const std::vector<Vertex>& vertices, const AABB& bounds, const VertexEncoding& encoding);
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2
+glm::vec2 encodeOctahedral(const glm::vec3& normal);
+glm::vec3 decodeOctahedral(const glm::vec2& encoded);
@@ -20,6 +20,8 @@ struct WindowConfig {
   bool vsync = true;
   bool decorated = true;  // Window border/title bar
   int samples = 4;        // MSAA samples (0 = disabled)
+  bool srgb = true;       // sRGB capable default framebuffer
+  bool visible = true;    // Hidden windows still render, for headless runs
 
   // OpenGL version
   int glMajorVersion = 3;
@@ -0,0 +1,11 @@
+#version 330 core
+// Flat colored debug primitives (DebugRenderer)
+
+in vec4 vertexColor;
+
+out vec4 FragColor;
+
+void main()
+{
+  FragColor = vertexColor;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+// World space lines and triangles from DebugDraw
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec4 color;
+
+out vec4 vertexColor;
+
+uniform mat4 viewProjection;
+
+void main()
+{
+  vertexColor = color;
+  gl_Position = viewProjection * vec4(position, 1.0);
+}
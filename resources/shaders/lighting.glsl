@@ -0,0 +1,81 @@
+#pragma once
+// Clustered point lights (ClusteredLighting), each fragment loops over its cluster's light list only
+
+uniform samplerBuffer lightData;       // Two texels per light: position, radius / color * intensity
+uniform usamplerBuffer clusterRanges;  // Offset and count into lightIndices per cluster
+uniform usamplerBuffer lightIndices;
+
+uniform ivec3 clusterCounts;
+uniform vec2 clusterTileSize;  // Pixels per cluster in x and y
+uniform float clusterSliceScale;
+uniform float clusterSliceBias;
+
+int clusterIndex(vec2 fragCoord, float viewDepth)
+{
+  ivec2 tile = min(ivec2(fragCoord / clusterTileSize), clusterCounts.xy - 1);
+  int slice = clamp(int(log(viewDepth) * clusterSliceScale + clusterSliceBias), 0, clusterCounts.z - 1);
+  return tile.x + clusterCounts.x * (tile.y + clusterCounts.y * slice);
+}
+
+// Inverse square falloff, windowed to reach zero at the light's radius
+float lightAttenuation(float distance, float radius)
+{
+  float ratio = distance / radius;
+  float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+  return window * window / (distance * distance + 1.0);
+}
+
+// What the lights need to know about the shaded point
+struct Surface
+{
+  vec3 position;
+  vec3 normal;
+  vec3 viewDir;  // Towards the camera
+  vec3 diffuseColor;
+  vec3 specularColor;
+  float shininess;
+};
+
+Surface makeSurface(vec3 position, vec3 normal, vec3 viewDir, vec3 albedo, float roughness, float metalness)
+{
+  Surface surface;
+  surface.position = position;
+  surface.normal = normal;
+  surface.viewDir = viewDir;
+  surface.diffuseColor = albedo * (1.0 - metalness);
+  surface.specularColor = mix(vec3(0.04), albedo, metalness);
+  surface.shininess = 2.0 / max(roughness * roughness * roughness * roughness, 1e-4) - 2.0;
+  return surface;
+}
+
+// Lambert and normalized Blinn-Phong for light arriving from direction l
+vec3 shadeLight(Surface surface, vec3 l, vec3 radiance)
+{
+  float nDotL = max(dot(surface.normal, l), 0.0);
+  if (nDotL <= 0.0) {
+    return vec3(0.0);
+  }
+  vec3 h = normalize(l + surface.viewDir);
+  float specular = (surface.shininess + 8.0) / 25.1327 * pow(max(dot(surface.normal, h), 0.0), surface.shininess);
+  return radiance * nDotL * (surface.diffuseColor + surface.specularColor * specular);
+}
+
+vec3 shadePointLights(Surface surface, vec2 fragCoord, float viewDepth)
+{
+  uvec2 range = texelFetch(clusterRanges, clusterIndex(fragCoord, viewDepth)).xy;
+  vec3 result = vec3(0.0);
+  for (uint i = 0u; i < range.y; i++) {
+    int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+    vec4 positionRadius = texelFetch(lightData, light * 2);
+    vec3 color = texelFetch(lightData, light * 2 + 1).rgb;
+
+    vec3 toLight = positionRadius.xyz - surface.position;
+    float distance = length(toLight);
+    if (distance >= positionRadius.w) {
+      continue;
+    }
+    vec3 l = toLight / max(distance, 1e-4);
+    result += shadeLight(surface, l, color * lightAttenuation(distance, positionRadius.w));
+  }
+  return result;
+}
@@ -1,13 +1,31 @@
 #version 330 core
+#include "materials.glsl"
+#include "lighting.glsl"
+#include "shadows.glsl"
 
 out vec4 FragColor;
 
 in vec2 texCoord;
+in vec3 normal;
+in vec3 worldPosition;
+in float viewDepth;
 
-uniform sampler2D texture0;
-uniform sampler2D texture1;
+uniform vec3 cameraPosition;
+uniform vec3 ambientLight;
+uniform vec3 sunDirection;  // Direction the light travels in
+uniform vec3 sunColor;
 
 void main()
 {
-  FragColor = mix(texture(texture0, texCoord), texture(texture1, texCoord), 0.5);
+  Material material = materials[materialIndex];
+  vec4 baseColor = sampleMaterialMap(material, MAP_BASE_COLOR, texCoord, vec4(1.0)) * material.baseColor;
+  float roughness = sampleMaterialMap(material, MAP_ROUGHNESS, texCoord, vec4(1.0)).r * material.surface.y;
+  float metalness = sampleMaterialMap(material, MAP_METALNESS, texCoord, vec4(1.0)).r * material.surface.x;
+
+  vec3 n = normalize(gl_FrontFacing ? normal : -normal);
+  vec3 viewDir = normalize(cameraPosition - worldPosition);
+  Surface surface = makeSurface(worldPosition, n, viewDir, baseColor.rgb, roughness, metalness);
+  vec3 lit = shadePointLights(surface, gl_FragCoord.xy, viewDepth);
+  lit += shadeLight(surface, -sunDirection, sunColor * shadowFactor(worldPosition, n, viewDepth));
+  FragColor = vec4(ambientLight * baseColor.rgb + lit + material.emission.rgb, baseColor.a);
 }
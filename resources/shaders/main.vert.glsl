@@ -2,18 +2,44 @@
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
 
 out vec2 texCoord; 
+out vec3 normal;
+out vec3 worldPosition;
+out float viewDepth;  // Distance in front of the camera, for the light clusters
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Quantized meshes store positions relative to their bounds and normals octahedral encoded
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+uniform bool octahedralNormals;
+
 // uniform mat4 transform;
 
+vec3 decodeOctahedral(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
 void main()
 {
-  gl_Position = projection * view * model * vec4(aPos, 1.0);
+  vec3 position = aPos * positionScale + positionOffset;
+  vec4 world = model * vec4(position, 1.0);
+  vec4 viewPosition = view * world;
+  gl_Position = projection * viewPosition;
+  worldPosition = world.xyz;
+  viewDepth = -viewPosition.z;
+
+  vec3 objectNormal = octahedralNormals ? decodeOctahedral(aNormal.xy) : aNormal;
+  normal = mat3(model) * objectNormal;
 
   texCoord = vec2(aTexCoord.x, aTexCoord.y);
 }
@@ -0,0 +1,59 @@
+#pragma once
+// The engine's material table (MaterialTable), indexed by materialIndex per draw
+
+#ifndef MAX_MATERIALS
+#define MAX_MATERIALS 64
+#endif
+
+#define MAP_BASE_COLOR 0
+#define MAP_NORMAL 1
+#define MAP_ROUGHNESS 2
+#define MAP_METALNESS 3
+
+struct Material
+{
+  vec4 baseColor;  // rgb = base_color * base, a = opacity
+  vec4 surface;    // metalness, roughness, specular, normal scale
+  vec4 coat;       // rgb = coat_color, a = coat
+  vec4 emission;   // rgb = emission_color * emission, a = coat_roughness
+  vec4 uv;         // xy = tiling, z = specular_IOR
+  ivec4 arrays;    // Texture array of each map, -1 without one
+  ivec4 layers;
+  vec4 rects[4];   // Atlas rectangle of each map in its layer
+};
+
+layout (std140) uniform MaterialTable
+{
+  Material materials[MAX_MATERIALS];
+};
+
+uniform sampler2DArray materialArrays[8];
+uniform int materialIndex;
+
+// Sampler arrays can only be indexed by constants here, the branch is uniform across the draw
+vec4 sampleMaterialArray(int array, vec3 uvw)
+{
+  switch (array) {
+    case 0: return texture(materialArrays[0], uvw);
+    case 1: return texture(materialArrays[1], uvw);
+    case 2: return texture(materialArrays[2], uvw);
+    case 3: return texture(materialArrays[3], uvw);
+    case 4: return texture(materialArrays[4], uvw);
+    case 5: return texture(materialArrays[5], uvw);
+    case 6: return texture(materialArrays[6], uvw);
+    default: return texture(materialArrays[7], uvw);
+  }
+}
+
+vec4 sampleMaterialMap(Material material, int map, vec2 uv, vec4 fallback)
+{
+  int array = material.arrays[map];
+  if (array < 0) {
+    return fallback;
+  }
+  vec4 rect = material.rects[map];
+  vec2 tiled = uv * material.uv.xy;
+  // Whole layers wrap by themselves, atlas entries have to wrap inside their rectangle
+  vec2 st = rect.zw == vec2(1.0) ? tiled : rect.xy + fract(tiled) * rect.zw;
+  return sampleMaterialArray(array, vec3(st, float(material.layers[map])));
+}
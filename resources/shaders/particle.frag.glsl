@@ -0,0 +1,16 @@
+#version 330 core
+// Soft round particles, blended additively (ParticleSystem)
+
+in vec2 corner;
+in vec4 particleColor;
+
+out vec4 FragColor;
+
+void main()
+{
+  float falloff = 1.0 - dot(corner, corner);
+  if (falloff <= 0.0) {
+    discard;
+  }
+  FragColor = vec4(particleColor.rgb, particleColor.a * falloff * falloff);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+// Camera facing quads, one instance per particle (ParticleSystem)
+
+layout (location = 0) in vec4 positionSize;  // World position, half size
+layout (location = 1) in vec4 color;
+
+out vec2 corner;
+out vec4 particleColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+  // Triangle strip over the corners (-1,-1) (1,-1) (-1,1) (1,1)
+  corner = vec2((gl_VertexID & 1) * 2 - 1, (gl_VertexID & 2) - 1);
+  particleColor = color;
+  // Offset in view space, so the quad always faces the camera
+  vec4 center = view * vec4(positionSize.xyz, 1.0);
+  gl_Position = projection * (center + vec4(corner * positionSize.w, 0.0, 0.0));
+}
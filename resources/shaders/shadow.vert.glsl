@@ -0,0 +1,17 @@
+#version 330 core
+// Depth only pass of ShadowMaps
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 lightViewProjection;
+
+// Quantized meshes store positions relative to their bounds
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+void main()
+{
+  vec3 position = aPos * positionScale + positionOffset;
+  gl_Position = lightViewProjection * model * vec4(position, 1.0);
+}
@@ -0,0 +1,41 @@
+#pragma once
+// Cascaded shadow maps of the directional light (ShadowMaps)
+
+#define MAX_CASCADES 4
+
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 shadowMatrices[MAX_CASCADES];
+uniform vec4 cascadeSplits;      // View depth where each cascade ends
+uniform vec4 cascadeTexelSizes;  // World space size of a shadow texel in each cascade
+uniform int cascadeCount;
+uniform float shadowTexelSize;   // 1 / shadow map size
+
+// 1 = lit, 0 = in shadow
+float shadowFactor(vec3 worldPosition, vec3 normal, float viewDepth)
+{
+  if (cascadeCount == 0 || viewDepth > cascadeSplits[cascadeCount - 1]) {
+    return 1.0;
+  }
+  int cascade = 0;
+  while (cascade < cascadeCount - 1 && viewDepth > cascadeSplits[cascade]) {
+    cascade++;
+  }
+
+  // Pushed out along the normal by about a texel, against acne on surfaces facing away from the light
+  vec3 offsetPosition = worldPosition + normal * cascadeTexelSizes[cascade] * 1.5;
+  vec4 projected = shadowMatrices[cascade] * vec4(offsetPosition, 1.0);
+  vec3 coords = projected.xyz * 0.5 + 0.5;
+  if (coords.z > 1.0) {
+    return 1.0;
+  }
+
+  // 3x3 taps of hardware 2x2 PCF
+  float lit = 0.0;
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      vec2 uv = coords.xy + vec2(x, y) * shadowTexelSize;
+      lit += texture(shadowMap, vec4(uv, float(cascade), coords.z));
+    }
+  }
+  return lit / 9.0;
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// Tinted sprites, or text from a FontAtlas signed distance field (SpriteBatch)
+
+in vec2 uv;
+in vec4 spriteColor;
+
+out vec4 FragColor;
+
+uniform sampler2D spriteTexture;
+uniform bool distanceField;
+
+void main()
+{
+  if (distanceField) {
+    // The outline is at 0.5. fwidth is how much the distance changes over a screen pixel, so the
+    // edge stays about a pixel wide however large the text is drawn.
+    float distance = texture(spriteTexture, uv).r;
+    float width = max(fwidth(distance) * 0.75, 0.001);
+    float coverage = smoothstep(0.5 - width, 0.5 + width, distance);
+    FragColor = vec4(spriteColor.rgb, spriteColor.a * coverage);
+  } else {
+    FragColor = spriteColor * texture(spriteTexture, uv);
+  }
+}
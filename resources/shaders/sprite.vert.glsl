@@ -0,0 +1,18 @@
+#version 330 core
+// Screen space quads from the SpriteBatch, positions in pixels from the top left
+
+layout (location = 0) in vec4 positionUV;  // Position, texture coordinate
+layout (location = 1) in vec4 color;
+
+out vec2 uv;
+out vec4 spriteColor;
+
+uniform vec2 screenSize;  // Pixels
+
+void main()
+{
+  uv = positionUV.zw;
+  spriteColor = color;
+  vec2 ndc = positionUV.xy / screenSize * 2.0 - 1.0;
+  gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
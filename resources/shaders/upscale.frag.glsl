@@ -0,0 +1,46 @@
+#version 330 core
+// Scales the scene color rendered at the dynamic resolution up to the window
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D sceneColor;
+uniform vec2 sourceSize;  // Pixels of sceneColor
+
+// Catmull-Rom, sharper than bilinear and exact at a scale of 1. The 4x4 footprint is folded into
+// 9 bilinear taps by merging the two middle weights of each axis.
+vec3 sampleCatmullRom(vec2 position)
+{
+  vec2 texel = position * sourceSize;
+  vec2 center = floor(texel - 0.5) + 0.5;
+  vec2 f = texel - center;
+
+  vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+  vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+  vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+  vec2 w3 = f * f * (-0.5 + 0.5 * f);
+  vec2 w12 = w1 + w2;
+
+  vec2 uv0 = (center - 1.0) / sourceSize;
+  vec2 uv12 = (center + w2 / w12) / sourceSize;
+  vec2 uv3 = (center + 2.0) / sourceSize;
+
+  vec3 result = vec3(0.0);
+  result += textureLod(sceneColor, vec2(uv0.x, uv0.y), 0.0).rgb * w0.x * w0.y;
+  result += textureLod(sceneColor, vec2(uv12.x, uv0.y), 0.0).rgb * w12.x * w0.y;
+  result += textureLod(sceneColor, vec2(uv3.x, uv0.y), 0.0).rgb * w3.x * w0.y;
+  result += textureLod(sceneColor, vec2(uv0.x, uv12.y), 0.0).rgb * w0.x * w12.y;
+  result += textureLod(sceneColor, vec2(uv12.x, uv12.y), 0.0).rgb * w12.x * w12.y;
+  result += textureLod(sceneColor, vec2(uv3.x, uv12.y), 0.0).rgb * w3.x * w12.y;
+  result += textureLod(sceneColor, vec2(uv0.x, uv3.y), 0.0).rgb * w0.x * w3.y;
+  result += textureLod(sceneColor, vec2(uv12.x, uv3.y), 0.0).rgb * w12.x * w3.y;
+  result += textureLod(sceneColor, vec2(uv3.x, uv3.y), 0.0).rgb * w3.x * w3.y;
+  // The negative lobes can overshoot below zero next to bright edges
+  return max(result, vec3(0.0));
+}
+
+void main()
+{
+  FragColor = vec4(sampleCatmullRom(uv), 1.0);
+}
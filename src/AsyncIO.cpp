@@ -0,0 +1,545 @@
+#include "../include/AsyncIO.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+// IORING_OP_READ and IORING_FEAT_RW_CUR_POS arrived together in 5.6, older headers use the threads
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#ifdef IORING_FEAT_RW_CUR_POS
+#define MACHI_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace {
+// One read per request and submission, large files take a few
+constexpr size_t MaxReadChunk = size_t(1) << 30;
+
+#ifdef _WIN32
+int openReadOnly(const char* path) {
+  return _open(path, _O_RDONLY | _O_BINARY);
+}
+
+bool fileSize(int fd, uint64_t& size) {
+  struct _stat64 info;
+  if (_fstat64(fd, &info) != 0) {
+    return false;
+  }
+  size = static_cast<uint64_t>(info.st_size);
+  return true;
+}
+
+long long readAt(int fd, uint8_t* buffer, size_t size, uint64_t offset) {
+  // The descriptor belongs to one request on one thread, so seeking is safe
+  if (_lseeki64(fd, static_cast<long long>(offset), SEEK_SET) < 0) {
+    return -1;
+  }
+  return _read(fd, buffer, static_cast<unsigned int>(std::min<size_t>(size, MaxReadChunk)));
+}
+
+void closeDescriptor(int fd) {
+  _close(fd);
+}
+#else
+int openReadOnly(const char* path) {
+  return ::open(path, O_RDONLY | O_CLOEXEC);
+}
+
+bool fileSize(int fd, uint64_t& size) {
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    return false;
+  }
+  size = static_cast<uint64_t>(info.st_size);
+  return true;
+}
+
+long long readAt(int fd, uint8_t* buffer, size_t size, uint64_t offset) {
+  return pread(fd, buffer, std::min(size, MaxReadChunk), static_cast<off_t>(offset));
+}
+
+void closeDescriptor(int fd) {
+  ::close(fd);
+}
+#endif
+}  // namespace
+
+#ifdef MACHI_IO_URING
+// Submission and completion rings shared with the kernel, set up with the raw syscalls so there is
+// no liburing dependency. Only the ring thread touches it.
+struct AsyncIO::Ring {
+  int fd = -1;
+  unsigned entries = 0;
+  unsigned queued = 0;  // Prepared, not yet taken by the kernel
+
+  unsigned* sqHead = nullptr;
+  unsigned* sqTail = nullptr;
+  unsigned sqMask = 0;
+  unsigned* sqArray = nullptr;
+  io_uring_sqe* sqes = nullptr;
+  unsigned* cqHead = nullptr;
+  unsigned* cqTail = nullptr;
+  unsigned cqMask = 0;
+  io_uring_cqe* cqes = nullptr;
+
+  void* sqMap = MAP_FAILED;
+  size_t sqMapSize = 0;
+  void* cqMap = MAP_FAILED;
+  size_t cqMapSize = 0;
+  void* sqeMap = MAP_FAILED;
+  size_t sqeMapSize = 0;
+
+  ~Ring() {
+    if (sqeMap != MAP_FAILED) {
+      munmap(sqeMap, sqeMapSize);
+    }
+    if (cqMap != MAP_FAILED && cqMap != sqMap) {
+      munmap(cqMap, cqMapSize);
+    }
+    if (sqMap != MAP_FAILED) {
+      munmap(sqMap, sqMapSize);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+  bool init(unsigned depth) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+    if (fd < 0) {
+      return false;
+    }
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+      return false;  // Pre-5.6 kernel, no IORING_OP_READ
+    }
+
+    entries = params.sq_entries;
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap) {
+      sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+    }
+
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED) {
+      return false;
+    }
+    cqMap = sqMap;
+    if (!singleMap) {
+      cqMap = mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+      if (cqMap == MAP_FAILED) {
+        return false;
+      }
+    }
+    sqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqeMap = mmap(nullptr, sqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqeMap == MAP_FAILED) {
+      return false;
+    }
+
+    auto* sq = static_cast<uint8_t*>(sqMap);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqes = static_cast<io_uring_sqe*>(sqeMap);
+
+    auto* cq = static_cast<uint8_t*>(cqMap);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  // False when the submission queue is full
+  bool prepareRead(int file, uint8_t* buffer, size_t size, uint64_t offset, uint64_t userData) {
+    const unsigned tail = *sqTail;
+    if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= entries) {
+      return false;
+    }
+
+    const unsigned index = tail & sqMask;
+    io_uring_sqe& sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = file;
+    sqe.addr = reinterpret_cast<uint64_t>(buffer);
+    sqe.len = static_cast<unsigned>(std::min(size, MaxReadChunk));
+    sqe.off = offset;
+    sqe.user_data = userData;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    queued++;
+    return true;
+  }
+
+  // Hands the prepared reads to the kernel in one call, optionally waiting for a completion
+  int submit(bool wait) {
+    int result = static_cast<int>(
+      syscall(__NR_io_uring_enter, fd, queued, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+    if (result > 0) {
+      queued -= static_cast<unsigned>(result);
+    }
+    return result;
+  }
+
+  template <typename Function>
+  void reap(Function&& function) {
+    unsigned head = *cqHead;
+    const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      const io_uring_cqe& cqe = cqes[head & cqMask];
+      function(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+  }
+};
+#else
+struct AsyncIO::Ring {};
+#endif
+
+AsyncIO::AsyncIO(unsigned int readerThreads, unsigned int queueDepth) : m_nextId(1), m_stopping(false) {
+#ifdef MACHI_IO_URING
+  m_ring = std::make_unique<Ring>();
+  if (m_ring->init(std::max(queueDepth, 1u))) {
+    m_threads.emplace_back(&AsyncIO::ringLoop, this);
+    LOG_INFO_F("[AsyncIO] Using io_uring, {} read(s) in flight at most", m_ring->entries);
+    return;
+  }
+  // Old kernels, and sandboxes that filter the syscalls
+  LOG_WARNING_F("[AsyncIO] io_uring is not available ({}), reading on threads", std::strerror(errno));
+  m_ring.reset();
+#endif
+
+  readerThreads = std::max(readerThreads, 1u);
+  for (unsigned int i = 0; i < readerThreads; i++) {
+    m_threads.emplace_back(&AsyncIO::readerLoop, this);
+  }
+  LOG_INFO_F("[AsyncIO] Using {} pread thread(s)", readerThreads);
+}
+
+AsyncIO::~AsyncIO() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_pending.clear();
+  }
+  m_wake.notify_all();
+
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+uint64_t AsyncIO::read(const std::string& path, IOCallback callback, float priority) {
+  return read(path, 0, 0, std::move(callback), priority);
+}
+
+uint64_t AsyncIO::read(const std::string& path, uint64_t offset, size_t size, IOCallback callback, float priority) {
+  auto request = std::make_unique<Request>();
+  request->path = path;
+  request->offset = offset;
+  request->size = size;
+  request->priority = priority;
+  request->callback = std::move(callback);
+
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    id = m_nextId++;
+    request->id = id;
+    m_pending.push_back(std::move(request));
+  }
+  m_wake.notify_one();
+  return id;
+}
+
+void AsyncIO::setPriority(uint64_t id, float priority) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& request : m_pending) {
+    if (request->id == id) {
+      request->priority = priority;
+      return;
+    }
+  }
+}
+
+bool AsyncIO::cancel(uint64_t id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto pending = std::find_if(
+    m_pending.begin(), m_pending.end(), [id](const std::unique_ptr<Request>& request) { return request->id == id; });
+  if (pending != m_pending.end()) {
+    Completion completion;
+    completion.result.id = id;
+    completion.result.status = IOStatus::Cancelled;
+    completion.result.path = std::move((*pending)->path);
+    completion.callback = std::move((*pending)->callback);
+    m_completed.push_back(std::move(completion));
+    m_pending.erase(pending);
+    m_stats.cancelled++;
+    return true;
+  }
+
+  // Can't be taken back from the kernel or a reader, the result is dropped when it arrives
+  auto inFlight = m_inFlight.find(id);
+  if (inFlight != m_inFlight.end()) {
+    inFlight->second->cancelled = true;
+    return true;
+  }
+
+  for (auto& completion : m_completed) {
+    IOResult& result = completion.result;
+    if (result.id == id && result.status != IOStatus::Cancelled) {
+      (result.status == IOStatus::Completed ? m_stats.completed : m_stats.failed)--;
+      m_stats.cancelled++;
+      result.status = IOStatus::Cancelled;
+      result.data = {};
+      return true;
+    }
+  }
+  return false;
+}
+
+int AsyncIO::poll() {
+  std::deque<Completion> completed;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    completed.swap(m_completed);
+  }
+
+  for (auto& completion : completed) {
+    if (completion.callback) {
+      completion.callback(completion.result);
+    }
+  }
+  return static_cast<int>(completed.size());
+}
+
+IOStats AsyncIO::getStats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  IOStats stats = m_stats;
+  stats.pending = static_cast<int>(m_pending.size());
+  stats.inFlight = static_cast<int>(m_inFlight.size());
+  return stats;
+}
+
+std::unique_ptr<AsyncIO::Request> AsyncIO::takeNext() {
+  // Highest priority, oldest first among equals. The queue is short, a scan is fine.
+  auto best = m_pending.begin();
+  for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+    if ((*it)->priority > (*best)->priority || ((*it)->priority == (*best)->priority && (*it)->id < (*best)->id)) {
+      best = it;
+    }
+  }
+
+  std::unique_ptr<Request> request = std::move(*best);
+  *best = std::move(m_pending.back());
+  m_pending.pop_back();
+  return request;
+}
+
+void AsyncIO::complete(Request* request, IOStatus status, int error) {
+  auto it = m_inFlight.find(request->id);
+  std::unique_ptr<Request> owned = std::move(it->second);
+  m_inFlight.erase(it);
+  closeFile(*owned);
+
+  Completion completion;
+  completion.result.id = owned->id;
+  completion.result.status = owned->cancelled ? IOStatus::Cancelled : status;
+  completion.result.path = std::move(owned->path);
+  completion.result.error = error;
+  completion.callback = std::move(owned->callback);
+
+  switch (completion.result.status) {
+    case IOStatus::Completed:
+      owned->data.resize(owned->done);
+      m_stats.bytesRead += owned->done;
+      m_stats.completed++;
+      completion.result.data = std::move(owned->data);
+      break;
+    case IOStatus::Failed:
+      m_stats.failed++;
+      LOG_ERROR_F("[AsyncIO] Failed to read {}: {}", completion.result.path, std::strerror(error));
+      break;
+    case IOStatus::Cancelled:
+      m_stats.cancelled++;
+      break;
+  }
+  m_completed.push_back(std::move(completion));
+}
+
+bool AsyncIO::openFile(Request& request, int& error) const {
+  int fd = openReadOnly(request.path.c_str());
+  if (fd < 0) {
+    error = errno;
+    return false;
+  }
+
+  uint64_t size;
+  if (!fileSize(fd, size)) {
+    error = errno;
+    closeDescriptor(fd);
+    return false;
+  }
+
+  const uint64_t available = request.offset < size ? size - request.offset : 0;
+  request.fd = fd;
+  request.data.resize(static_cast<size_t>(request.size == 0 ? available : std::min<uint64_t>(request.size, available)));
+  request.done = 0;
+  return true;
+}
+
+void AsyncIO::closeFile(Request& request) const {
+  if (request.fd >= 0) {
+    closeDescriptor(request.fd);
+    request.fd = -1;
+  }
+}
+
+void AsyncIO::readerLoop() {
+  while (true) {
+    Request* request;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+      if (m_pending.empty()) {
+        return;  // Stopping
+      }
+      std::unique_ptr<Request> next = takeNext();
+      request = next.get();
+      m_inFlight[request->id] = std::move(next);
+    }
+
+    int error = 0;
+    IOStatus status = IOStatus::Completed;
+    if (!openFile(*request, error)) {
+      status = IOStatus::Failed;
+    }
+    while (status == IOStatus::Completed && request->done < request->data.size()) {
+      long long count = readAt(request->fd,
+                               request->data.data() + request->done,
+                               request->data.size() - request->done,
+                               request->offset + request->done);
+      if (count < 0 && errno == EINTR) {
+        continue;
+      }
+      if (count < 0) {
+        error = errno;
+        status = IOStatus::Failed;
+      } else if (count == 0) {
+        break;  // The file got shorter since it was opened
+      }
+      request->done += static_cast<size_t>(std::max(count, 0ll));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    complete(request, status, error);
+  }
+}
+
+void AsyncIO::ringLoop() {
+#ifdef MACHI_IO_URING
+  std::vector<Request*> opening;  // Taken from the queue, opened outside the lock
+  std::vector<Request*> ready;    // Open (or partly read) and waiting for a submission slot
+  size_t submitted = 0;           // Reads the kernel is working on
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (submitted == 0 && ready.empty()) {
+        m_wake.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+        if (m_pending.empty()) {
+          return;  // Stopping, and nothing left in flight
+        }
+      }
+      // New reads only join between completions, so a busy ring delays them by one read at most
+      while (submitted + ready.size() + opening.size() < m_ring->entries && !m_pending.empty()) {
+        std::unique_ptr<Request> next = takeNext();
+        opening.push_back(next.get());
+        m_inFlight[next->id] = std::move(next);
+      }
+    }
+
+    for (Request* request : opening) {
+      int error = 0;
+      if (!openFile(*request, error)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        complete(request, IOStatus::Failed, error);
+      } else if (request->data.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        complete(request, IOStatus::Completed, 0);
+      } else {
+        ready.push_back(request);
+      }
+    }
+    opening.clear();
+
+    // Everything that is ready goes to the kernel in one batch
+    size_t prepared = 0;
+    while (prepared < ready.size()) {
+      Request* request = ready[prepared];
+      if (!m_ring->prepareRead(request->fd,
+                               request->data.data() + request->done,
+                               request->data.size() - request->done,
+                               request->offset + request->done,
+                               reinterpret_cast<uint64_t>(request))) {
+        break;
+      }
+      prepared++;
+    }
+    ready.erase(ready.begin(), ready.begin() + static_cast<std::ptrdiff_t>(prepared));
+    submitted += prepared;
+    if (prepared > 0) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stats.batches++;
+    }
+
+    if (m_ring->submit(submitted > 0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      LOG_ERROR_F("[AsyncIO] io_uring_enter failed: {}", std::strerror(errno));
+    }
+
+    m_ring->reap([&](uint64_t userData, int result) {
+      Request* request = reinterpret_cast<Request*>(userData);
+      submitted--;
+      if (result == -EINTR || result == -EAGAIN) {
+        ready.push_back(request);
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (result < 0) {
+        complete(request, IOStatus::Failed, -result);
+        return;
+      }
+      request->done += static_cast<size_t>(result);
+      if (result == 0 || request->done == request->data.size() || request->cancelled) {
+        complete(request, IOStatus::Completed, 0);
+      } else {
+        ready.push_back(request);
+      }
+    });
+  }
+#endif
+}
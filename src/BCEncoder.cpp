@@ -0,0 +1,682 @@
+#include "../include/BCEncoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace {
+// Principal axis of a set of points through power iteration on the covariance matrix
+template <int N>
+void principalAxis(const float (*points)[N], int count, float* mean, float* axis) {
+  for (int c = 0; c < N; c++) {
+    mean[c] = 0.0f;
+    for (int i = 0; i < count; i++) {
+      mean[c] += points[i][c];
+    }
+    mean[c] /= std::max(count, 1);
+  }
+
+  float covariance[N][N] = {};
+  for (int i = 0; i < count; i++) {
+    for (int a = 0; a < N; a++) {
+      for (int b = 0; b < N; b++) {
+        covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+      }
+    }
+  }
+
+  for (int c = 0; c < N; c++) {
+    axis[c] = 1.0f;
+  }
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[N] = {};
+    float length = 0.0f;
+    for (int a = 0; a < N; a++) {
+      for (int b = 0; b < N; b++) {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      length = std::max(length, std::abs(next[a]));
+    }
+    if (length < 1e-6f) {
+      break;
+    }
+    for (int c = 0; c < N; c++) {
+      axis[c] = next[c] / length;
+    }
+  }
+}
+
+uint16_t packRGB565(const float* color) {
+  int r = std::clamp(static_cast<int>(std::lround(color[0] * 31.0f / 255.0f)), 0, 31);
+  int g = std::clamp(static_cast<int>(std::lround(color[1] * 63.0f / 255.0f)), 0, 63);
+  int b = std::clamp(static_cast<int>(std::lround(color[2] * 31.0f / 255.0f)), 0, 31);
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackRGB565(uint16_t packed, float* color) {
+  int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+  color[0] = static_cast<float>((r << 3) | (r >> 2));
+  color[1] = static_cast<float>((g << 2) | (g >> 4));
+  color[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+float distanceSquared3(const float* a, const float* b) {
+  float dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+  return dr * dr + dg * dg + db * db;
+}
+
+// Builds the BC1 palette of two packed endpoints and returns the number of opaque entries
+int colorPalette(uint16_t c0, uint16_t c1, bool threeColor, float (*palette)[3]) {
+  unpackRGB565(c0, palette[0]);
+  unpackRGB565(c1, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    if (threeColor) {
+      palette[2][c] = (palette[0][c] + palette[1][c]) * 0.5f;
+      palette[3][c] = 0.0f;
+    } else {
+      palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+      palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+  }
+  return threeColor ? 3 : 4;
+}
+
+float assignColorIndices(const float (*pixels)[3],
+                         const bool* transparent,
+                         uint16_t c0,
+                         uint16_t c1,
+                         bool threeColor,
+                         uint8_t* indices) {
+  float palette[4][3];
+  int entries = colorPalette(c0, c1, threeColor, palette);
+
+  float error = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    if (transparent[i]) {
+      indices[i] = 3;
+      continue;
+    }
+    float best = distanceSquared3(pixels[i], palette[0]);
+    indices[i] = 0;
+    for (int e = 1; e < entries; e++) {
+      float d = distanceSquared3(pixels[i], palette[e]);
+      if (d < best) {
+        best = d;
+        indices[i] = static_cast<uint8_t>(e);
+      }
+    }
+    error += best;
+  }
+  return error;
+}
+
+// Least squares endpoints for fixed indices
+bool solveColorEndpoints(const float (*pixels)[3],
+                         const bool* transparent,
+                         const uint8_t* indices,
+                         bool threeColor,
+                         float* e0,
+                         float* e1) {
+  const float fourWeights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  const float threeWeights[3] = {1.0f, 0.0f, 0.5f};
+
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[3] = {}, bx[3] = {};
+  for (int i = 0; i < 16; i++) {
+    if (transparent[i]) {
+      continue;
+    }
+    float a = threeColor ? threeWeights[indices[i]] : fourWeights[indices[i]];
+    float b = 1.0f - a;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < 3; c++) {
+      ax[c] += a * pixels[i][c];
+      bx[c] += b * pixels[i][c];
+    }
+  }
+
+  float determinant = aa * bb - ab * ab;
+  if (std::abs(determinant) < 1e-6f) {
+    return false;
+  }
+  for (int c = 0; c < 3; c++) {
+    e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+    e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+  }
+  return true;
+}
+
+void encodeColorBlock(const uint8_t* rgba, uint8_t* out, bool allowTransparency) {
+  float pixels[16][3];
+  bool transparent[16];
+  float opaque[16][3];
+  int opaqueCount = 0;
+
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 3; c++) {
+      pixels[i][c] = rgba[i * 4 + c];
+    }
+    transparent[i] = allowTransparency && rgba[i * 4 + 3] < 128;
+    if (!transparent[i]) {
+      std::memcpy(opaque[opaqueCount++], pixels[i], sizeof(pixels[i]));
+    }
+  }
+  const bool threeColor = opaqueCount < 16;
+
+  uint16_t c0 = 0, c1 = 0;
+  uint8_t indices[16] = {};
+
+  if (opaqueCount > 0) {
+    float mean[3], axis[3];
+    principalAxis<3>(opaque, opaqueCount, mean, axis);
+
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int i = 0; i < opaqueCount; i++) {
+      float t = (opaque[i][0] - mean[0]) * axis[0] + (opaque[i][1] - mean[1]) * axis[1] +
+                (opaque[i][2] - mean[2]) * axis[2];
+      tMin = std::min(tMin, t);
+      tMax = std::max(tMax, t);
+    }
+
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++) {
+      float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+      float scale = axisLength > 0.0f ? 1.0f / axisLength : 0.0f;
+      e0[c] = std::clamp(mean[c] + axis[c] * tMax * scale, 0.0f, 255.0f);
+      e1[c] = std::clamp(mean[c] + axis[c] * tMin * scale, 0.0f, 255.0f);
+    }
+
+    c0 = packRGB565(e0);
+    c1 = packRGB565(e1);
+    float bestError = assignColorIndices(pixels, transparent, c0, c1, threeColor, indices);
+
+    // A couple of least squares refinements on the index assignment
+    for (int iteration = 0; iteration < 2; iteration++) {
+      if (!solveColorEndpoints(pixels, transparent, indices, threeColor, e0, e1)) {
+        break;
+      }
+      uint16_t r0 = packRGB565(e0), r1 = packRGB565(e1);
+      uint8_t refined[16];
+      float error = assignColorIndices(pixels, transparent, r0, r1, threeColor, refined);
+      if (error >= bestError) {
+        break;
+      }
+      bestError = error;
+      c0 = r0;
+      c1 = r1;
+      std::memcpy(indices, refined, sizeof(indices));
+    }
+  } else {
+    std::fill(indices, indices + 16, 3);
+  }
+
+  // The endpoint order selects the mode: c0 > c1 is four colors, c0 <= c1 three + transparent
+  if (threeColor) {
+    if (c0 > c1) {
+      std::swap(c0, c1);
+      for (auto& index : indices) {
+        index = index == 0 ? 1 : index == 1 ? 0 : index;
+      }
+    }
+  } else if (c0 < c1) {
+    std::swap(c0, c1);
+    for (auto& index : indices) {
+      index ^= 1;
+    }
+  } else if (c0 == c1) {
+    std::fill(indices, indices + 16, 0);
+  }
+
+  uint32_t packedIndices = 0;
+  for (int i = 0; i < 16; i++) {
+    packedIndices |= static_cast<uint32_t>(indices[i]) << (i * 2);
+  }
+  std::memcpy(out, &c0, 2);
+  std::memcpy(out + 2, &c1, 2);
+  std::memcpy(out + 4, &packedIndices, 4);
+}
+
+// Tries a palette for a BC4 block and returns the squared error
+int assignAlphaIndices(const uint8_t* values, int a0, int a1, uint8_t* indices) {
+  int palette[8];
+  palette[0] = a0;
+  palette[1] = a1;
+  if (a0 > a1) {
+    for (int k = 1; k <= 6; k++) {
+      palette[k + 1] = ((7 - k) * a0 + k * a1 + 3) / 7;
+    }
+  } else {
+    for (int k = 1; k <= 4; k++) {
+      palette[k + 1] = ((5 - k) * a0 + k * a1 + 2) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+
+  int error = 0;
+  for (int i = 0; i < 16; i++) {
+    int best = 1 << 30;
+    for (int e = 0; e < 8; e++) {
+      int d = values[i] - palette[e];
+      if (d * d < best) {
+        best = d * d;
+        indices[i] = static_cast<uint8_t>(e);
+      }
+    }
+    error += best;
+  }
+  return error;
+}
+
+void encodeAlphaBlock(const uint8_t* values, uint8_t* out) {
+  uint8_t minValue = 255, maxValue = 0;
+  uint8_t innerMin = 255, innerMax = 0;
+  for (int i = 0; i < 16; i++) {
+    minValue = std::min(minValue, values[i]);
+    maxValue = std::max(maxValue, values[i]);
+    if (values[i] != 0 && values[i] != 255) {
+      innerMin = std::min(innerMin, values[i]);
+      innerMax = std::max(innerMax, values[i]);
+    }
+  }
+
+  uint8_t a0 = maxValue, a1 = minValue;
+  uint8_t indices[16] = {};
+  if (a0 != a1) {
+    // Eight interpolated values over the full range
+    int error = assignAlphaIndices(values, a0, a1, indices);
+
+    // Six values over the inner range with exact 0 and 255 - better for blocks with saturated texels
+    if (innerMin <= innerMax) {
+      uint8_t alternative[16];
+      int alternativeError = assignAlphaIndices(values, innerMin, innerMax, alternative);
+      if (alternativeError < error) {
+        a0 = innerMin;
+        a1 = innerMax;
+        std::memcpy(indices, alternative, sizeof(indices));
+      }
+    }
+  }
+
+  uint64_t packedIndices = 0;
+  for (int i = 0; i < 16; i++) {
+    packedIndices |= static_cast<uint64_t>(indices[i]) << (i * 3);
+  }
+  out[0] = a0;
+  out[1] = a1;
+  for (int i = 0; i < 6; i++) {
+    out[2 + i] = static_cast<uint8_t>(packedIndices >> (i * 8));
+  }
+}
+
+// BC7 mode 6
+const int BC7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BC7Endpoints {
+  int q0[4];  // 7-bit endpoint values
+  int q1[4];
+  int p0;
+  int p1;
+};
+
+float evaluateBC7(const float (*pixels)[4], const BC7Endpoints& endpoints, uint8_t* indices) {
+  int palette[16][4];
+  for (int c = 0; c < 4; c++) {
+    int e0 = (endpoints.q0[c] << 1) | endpoints.p0;
+    int e1 = (endpoints.q1[c] << 1) | endpoints.p1;
+    for (int i = 0; i < 16; i++) {
+      palette[i][c] = ((64 - BC7Weights[i]) * e0 + BC7Weights[i] * e1 + 32) >> 6;
+    }
+  }
+
+  float error = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    float best = 1e30f;
+    for (int e = 0; e < 16; e++) {
+      float d = 0.0f;
+      for (int c = 0; c < 4; c++) {
+        float diff = pixels[i][c] - palette[e][c];
+        d += diff * diff;
+      }
+      if (d < best) {
+        best = d;
+        indices[i] = static_cast<uint8_t>(e);
+      }
+    }
+    error += best;
+  }
+  return error;
+}
+
+// Best p-bit combination for a pair of 8-bit endpoints
+float quantizeBC7(const float (*pixels)[4], const float* e0, const float* e1, BC7Endpoints& best, uint8_t* indices) {
+  float bestError = 1e30f;
+  for (int p0 = 0; p0 < 2; p0++) {
+    for (int p1 = 0; p1 < 2; p1++) {
+      BC7Endpoints candidate;
+      candidate.p0 = p0;
+      candidate.p1 = p1;
+      for (int c = 0; c < 4; c++) {
+        candidate.q0[c] = std::clamp(static_cast<int>(std::lround((e0[c] - p0) * 0.5f)), 0, 127);
+        candidate.q1[c] = std::clamp(static_cast<int>(std::lround((e1[c] - p1) * 0.5f)), 0, 127);
+      }
+      uint8_t candidateIndices[16];
+      float error = evaluateBC7(pixels, candidate, candidateIndices);
+      if (error < bestError) {
+        bestError = error;
+        best = candidate;
+        std::memcpy(indices, candidateIndices, 16);
+      }
+    }
+  }
+  return bestError;
+}
+
+class BitWriter {
+private:
+  uint8_t* m_data;
+  int m_position = 0;
+
+public:
+  explicit BitWriter(uint8_t* data) : m_data(data) {
+    std::memset(m_data, 0, 16);
+  }
+
+  void write(uint32_t value, int bits) {
+    for (int i = 0; i < bits; i++, m_position++) {
+      if (value & (1u << i)) {
+        m_data[m_position >> 3] |= static_cast<uint8_t>(1u << (m_position & 7));
+      }
+    }
+  }
+};
+
+// sRGB <-> linear for filtering color mips
+float srgbToLinear(float value) {
+  return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSRGB(float value) {
+  return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+void extractBlock(const uint8_t* rgba, int width, int height, int blockX, int blockY, uint8_t* block) {
+  for (int y = 0; y < 4; y++) {
+    // Edge texels are repeated for images that are not a multiple of four
+    int sy = std::min(blockY * 4 + y, height - 1);
+    for (int x = 0; x < 4; x++) {
+      int sx = std::min(blockX * 4 + x, width - 1);
+      std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+    }
+  }
+}
+
+void encodeBlock(BlockFormat format, const uint8_t* block, uint8_t* out) {
+  switch (format) {
+    case BlockFormat::BC1:
+      BCEncoder::encodeBC1(block, out);
+      break;
+    case BlockFormat::BC3:
+      BCEncoder::encodeBC3(block, out);
+      break;
+    case BlockFormat::BC4:
+      BCEncoder::encodeBC4(block, out);
+      break;
+    case BlockFormat::BC5:
+      BCEncoder::encodeBC5(block, out);
+      break;
+    case BlockFormat::BC7:
+      BCEncoder::encodeBC7(block, out);
+      break;
+  }
+}
+
+CompressedMip compressLevel(const uint8_t* rgba, int width, int height, BlockFormat format) {
+  CompressedMip mip;
+  mip.width = width;
+  mip.height = height;
+  mip.data.resize(compressedSize(format, width, height));
+
+  const int blocksX = (width + 3) / 4;
+  const int blocksY = (height + 3) / 4;
+  const unsigned int bytes = blockBytes(format);
+
+  auto encodeRows = [&](int firstRow, int rowStep) {
+    uint8_t block[64];
+    for (int by = firstRow; by < blocksY; by += rowStep) {
+      for (int bx = 0; bx < blocksX; bx++) {
+        extractBlock(rgba, width, height, bx, by, block);
+        encodeBlock(format, block, mip.data.data() + (static_cast<size_t>(by) * blocksX + bx) * bytes);
+      }
+    }
+  };
+
+  int threadCount = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, blocksY);
+  std::vector<std::thread> threads;
+  for (int t = 1; t < threadCount; t++) {
+    threads.emplace_back(encodeRows, t, threadCount);
+  }
+  encodeRows(0, threadCount);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  return mip;
+}
+}  // namespace
+
+namespace BCEncoder {
+void encodeBC1(const uint8_t* rgba, uint8_t* out) {
+  encodeColorBlock(rgba, out, true);
+}
+
+void encodeBC3(const uint8_t* rgba, uint8_t* out) {
+  encodeBC4(rgba, out, 3);
+  encodeColorBlock(rgba, out + 8, false);
+}
+
+void encodeBC4(const uint8_t* rgba, uint8_t* out, int channel) {
+  uint8_t values[16];
+  for (int i = 0; i < 16; i++) {
+    values[i] = rgba[i * 4 + channel];
+  }
+  encodeAlphaBlock(values, out);
+}
+
+void encodeBC5(const uint8_t* rgba, uint8_t* out) {
+  encodeBC4(rgba, out, 0);
+  encodeBC4(rgba, out + 8, 1);
+}
+
+void encodeBC7(const uint8_t* rgba, uint8_t* out) {
+  float pixels[16][4];
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 4; c++) {
+      pixels[i][c] = rgba[i * 4 + c];
+    }
+  }
+
+  float mean[4], axis[4];
+  principalAxis<4>(pixels, 16, mean, axis);
+
+  float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+  float scale = axisLength > 0.0f ? 1.0f / axisLength : 0.0f;
+  float tMin = 0.0f, tMax = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    float t = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      t += (pixels[i][c] - mean[c]) * axis[c];
+    }
+    tMin = std::min(tMin, t);
+    tMax = std::max(tMax, t);
+  }
+
+  float e0[4], e1[4];
+  for (int c = 0; c < 4; c++) {
+    e0[c] = std::clamp(mean[c] + axis[c] * tMin * scale, 0.0f, 255.0f);
+    e1[c] = std::clamp(mean[c] + axis[c] * tMax * scale, 0.0f, 255.0f);
+  }
+
+  BC7Endpoints endpoints;
+  uint8_t indices[16];
+  float error = quantizeBC7(pixels, e0, e1, endpoints, indices);
+
+  // Least squares refinement of the endpoints for the chosen indices
+  for (int iteration = 0; iteration < 2; iteration++) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; i++) {
+      float b = BC7Weights[indices[i]] / 64.0f;
+      float a = 1.0f - b;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for (int c = 0; c < 4; c++) {
+        ax[c] += a * pixels[i][c];
+        bx[c] += b * pixels[i][c];
+      }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f) {
+      break;
+    }
+    for (int c = 0; c < 4; c++) {
+      e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+      e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+
+    BC7Endpoints refined;
+    uint8_t refinedIndices[16];
+    float refinedError = quantizeBC7(pixels, e0, e1, refined, refinedIndices);
+    if (refinedError >= error) {
+      break;
+    }
+    error = refinedError;
+    endpoints = refined;
+    std::memcpy(indices, refinedIndices, sizeof(indices));
+  }
+
+  // The anchor index has an implicit zero top bit, flip the endpoints if texel 0 needs it set
+  if (indices[0] >= 8) {
+    std::swap(endpoints.q0, endpoints.q1);
+    std::swap(endpoints.p0, endpoints.p1);
+    for (auto& index : indices) {
+      index = static_cast<uint8_t>(15 - index);
+    }
+  }
+
+  BitWriter writer(out);
+  writer.write(1u << 6, 7);
+  for (int c = 0; c < 4; c++) {
+    writer.write(endpoints.q0[c], 7);
+    writer.write(endpoints.q1[c], 7);
+  }
+  writer.write(endpoints.p0, 1);
+  writer.write(endpoints.p1, 1);
+  writer.write(indices[0], 3);
+  for (int i = 1; i < 16; i++) {
+    writer.write(indices[i], 4);
+  }
+}
+
+BlockFormat chooseFormat(TextureUsage usage) {
+  switch (usage) {
+    case TextureUsage::Normal:
+      return BlockFormat::BC5;
+    case TextureUsage::Mask:
+      return BlockFormat::BC4;
+    case TextureUsage::Color:
+    case TextureUsage::Data:
+      return BlockFormat::BC7;
+  }
+  return BlockFormat::BC7;
+}
+
+std::vector<uint8_t> downsample(const uint8_t* rgba, int width, int height, TextureUsage usage) {
+  const int newWidth = std::max(width / 2, 1);
+  const int newHeight = std::max(height / 2, 1);
+  std::vector<uint8_t> result(static_cast<size_t>(newWidth) * newHeight * 4);
+
+  static const std::array<float, 256> toLinear = [] {
+    std::array<float, 256> table;
+    for (int i = 0; i < 256; i++) {
+      table[i] = srgbToLinear(i / 255.0f);
+    }
+    return table;
+  }();
+
+  for (int y = 0; y < newHeight; y++) {
+    for (int x = 0; x < newWidth; x++) {
+      float sum[4] = {};
+      for (int dy = 0; dy < 2; dy++) {
+        for (int dx = 0; dx < 2; dx++) {
+          int sx = std::min(x * 2 + dx, width - 1);
+          int sy = std::min(y * 2 + dy, height - 1);
+          const uint8_t* texel = rgba + (static_cast<size_t>(sy) * width + sx) * 4;
+          for (int c = 0; c < 4; c++) {
+            if (usage == TextureUsage::Color && c < 3) {
+              sum[c] += toLinear[texel[c]];
+            } else if (usage == TextureUsage::Normal && c < 3) {
+              sum[c] += texel[c] / 127.5f - 1.0f;
+            } else {
+              sum[c] += texel[c] / 255.0f;
+            }
+          }
+        }
+      }
+
+      uint8_t* texel = result.data() + (static_cast<size_t>(y) * newWidth + x) * 4;
+      if (usage == TextureUsage::Normal) {
+        float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+        for (int c = 0; c < 3; c++) {
+          float n = length > 0.0f ? sum[c] / length : (c == 2 ? 1.0f : 0.0f);
+          texel[c] = static_cast<uint8_t>(std::lround((n * 0.5f + 0.5f) * 255.0f));
+        }
+      }
+      for (int c = 0; c < 4; c++) {
+        if (usage == TextureUsage::Normal && c < 3) {
+          continue;
+        }
+        float value = sum[c] * 0.25f;
+        if (usage == TextureUsage::Color && c < 3) {
+          value = linearToSRGB(value);
+        }
+        texel[c] = static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+      }
+    }
+  }
+
+  return result;
+}
+
+CompressedImage compress(const uint8_t* rgba,
+                         int width,
+                         int height,
+                         BlockFormat format,
+                         TextureUsage usage,
+                         bool generateMips) {
+  CompressedImage image;
+  image.format = format;
+  image.srgb = usage == TextureUsage::Color && isColorFormat(format);
+  image.width = width;
+  image.height = height;
+
+  image.mips.push_back(compressLevel(rgba, width, height, format));
+
+  std::vector<uint8_t> level;
+  const uint8_t* source = rgba;
+  while (generateMips && (width > 1 || height > 1)) {
+    level = downsample(source, width, height, usage);
+    width = std::max(width / 2, 1);
+    height = std::max(height / 2, 1);
+    source = level.data();
+    image.mips.push_back(compressLevel(source, width, height, format));
+  }
+
+  return image;
+}
+}  // namespace BCEncoder
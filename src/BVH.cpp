@@ -0,0 +1,559 @@
+#include "../include/BVH.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+// Traversal stack that lives on the C++ stack for normal tree depths and spills to the heap otherwise
+template <typename T>
+class TraversalStack {
+private:
+  static constexpr int FixedSize = 64;
+  T m_fixed[FixedSize];
+  std::vector<T> m_overflow;
+  int m_size = 0;
+
+public:
+  void push(const T& value) {
+    if (m_size < FixedSize) {
+      m_fixed[m_size] = value;
+    } else {
+      m_overflow.push_back(value);
+    }
+    m_size++;
+  }
+
+  T pop() {
+    m_size--;
+    if (m_size < FixedSize) {
+      return m_fixed[m_size];
+    }
+    T value = m_overflow.back();
+    m_overflow.pop_back();
+    return value;
+  }
+
+  bool empty() const {
+    return m_size == 0;
+  }
+};
+
+struct FrustumEntry {
+  int node;
+  unsigned planeMask;
+};
+
+constexpr int SAH_BIN_COUNT = 16;
+}  // namespace
+
+BVH::BVH(float margin) : m_root(NullNode), m_freeList(NullNode), m_leafCount(0), m_margin(margin) {}
+
+int BVH::allocateNode() {
+  if (m_freeList == NullNode) {
+    m_nodes.emplace_back();
+    return static_cast<int>(m_nodes.size()) - 1;
+  }
+
+  int node = m_freeList;
+  m_freeList = m_nodes[node].left;
+  m_nodes[node] = BVHNode();
+  return node;
+}
+
+void BVH::freeNode(int node) {
+  m_nodes[node].left = m_freeList;
+  m_nodes[node].right = NullNode;
+  m_nodes[node].height = -1;
+  m_freeList = node;
+}
+
+void BVH::clear() {
+  m_nodes.clear();
+  m_root = NullNode;
+  m_freeList = NullNode;
+  m_leafCount = 0;
+}
+
+std::vector<int> BVH::build(const std::vector<BVHBuildItem>& items) {
+  clear();
+
+  std::vector<int> proxies(items.size(), NullNode);
+  if (items.empty()) {
+    return proxies;
+  }
+
+  // A binary tree with n leaves has exactly 2n - 1 nodes
+  m_nodes.reserve(items.size() * 2 - 1);
+
+  std::vector<int> order(items.size());
+  for (size_t i = 0; i < items.size(); i++) {
+    order[i] = static_cast<int>(i);
+  }
+
+  m_root = buildRecursive(items, order, proxies, 0, static_cast<int>(items.size()), NullNode);
+  m_leafCount = static_cast<int>(items.size());
+  return proxies;
+}
+
+int BVH::buildRecursive(const std::vector<BVHBuildItem>& items,
+                        std::vector<int>& order,
+                        std::vector<int>& proxies,
+                        int begin,
+                        int end,
+                        int parent) {
+  int node = allocateNode();
+  m_nodes[node].parent = parent;
+
+  if (end - begin == 1) {
+    const BVHBuildItem& item = items[order[begin]];
+    m_nodes[node].bounds = item.bounds;
+    m_nodes[node].userData = item.userData;
+    proxies[order[begin]] = node;
+    return node;
+  }
+
+  AABB bounds = AABB::empty();
+  AABB centroidBounds = AABB::empty();
+  for (int i = begin; i < end; i++) {
+    bounds.expand(items[order[i]].bounds);
+    centroidBounds.expand(items[order[i]].bounds.center());
+  }
+
+  glm::vec3 centroidExtent = centroidBounds.extent();
+  int axis = 0;
+  if (centroidExtent.y > centroidExtent[axis])
+    axis = 1;
+  if (centroidExtent.z > centroidExtent[axis])
+    axis = 2;
+
+  int mid = (begin + end) / 2;
+
+  if (centroidExtent[axis] > 0.0f) {
+    // Binned SAH: bucket centroids along the widest axis and sweep for the cheapest split plane
+    AABB binBounds[SAH_BIN_COUNT];
+    int binCounts[SAH_BIN_COUNT] = {};
+    std::fill(binBounds, binBounds + SAH_BIN_COUNT, AABB::empty());
+
+    float binScale = SAH_BIN_COUNT / centroidExtent[axis];
+    auto binOf = [&](int item) {
+      float offset = items[item].bounds.center()[axis] - centroidBounds.min[axis];
+      return std::min(SAH_BIN_COUNT - 1, static_cast<int>(offset * binScale));
+    };
+
+    for (int i = begin; i < end; i++) {
+      int bin = binOf(order[i]);
+      binCounts[bin]++;
+      binBounds[bin].expand(items[order[i]].bounds);
+    }
+
+    // Right-to-left sweep stores the cost contribution of everything right of each plane
+    float rightCost[SAH_BIN_COUNT];
+    AABB accumulated = AABB::empty();
+    int accumulatedCount = 0;
+    for (int i = SAH_BIN_COUNT - 1; i > 0; i--) {
+      accumulated.expand(binBounds[i]);
+      accumulatedCount += binCounts[i];
+      rightCost[i] = accumulatedCount ? accumulated.surfaceArea() * accumulatedCount : 0.0f;
+    }
+
+    float bestCost = std::numeric_limits<float>::max();
+    int bestPlane = -1;
+    accumulated = AABB::empty();
+    accumulatedCount = 0;
+    for (int i = 0; i < SAH_BIN_COUNT - 1; i++) {
+      accumulated.expand(binBounds[i]);
+      accumulatedCount += binCounts[i];
+      if (accumulatedCount == 0 || accumulatedCount == end - begin) {
+        continue;
+      }
+      float cost = accumulated.surfaceArea() * accumulatedCount + rightCost[i + 1];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestPlane = i;
+      }
+    }
+
+    if (bestPlane >= 0) {
+      auto split = std::partition(
+        order.begin() + begin, order.begin() + end, [&](int item) { return binOf(item) <= bestPlane; });
+      mid = static_cast<int>(split - order.begin());
+    }
+  }
+
+  // Degenerate centroids (or no useful plane) fall back to a median split
+  if (mid == begin || mid == end) {
+    mid = (begin + end) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](int a, int b) {
+      return items[a].bounds.center()[axis] < items[b].bounds.center()[axis];
+    });
+  }
+
+  // Children are allocated after the parent, so the left subtree directly follows it in memory
+  int left = buildRecursive(items, order, proxies, begin, mid, node);
+  int right = buildRecursive(items, order, proxies, mid, end, node);
+
+  BVHNode& current = m_nodes[node];
+  current.left = left;
+  current.right = right;
+  current.bounds = bounds;
+  current.height = 1 + std::max(m_nodes[left].height, m_nodes[right].height);
+  return node;
+}
+
+int BVH::insert(const AABB& bounds, int userData) {
+  int leaf = allocateNode();
+  m_nodes[leaf].bounds = bounds.inflated(m_margin);
+  m_nodes[leaf].userData = userData;
+  m_nodes[leaf].height = 0;
+
+  insertLeaf(leaf);
+  m_leafCount++;
+  return leaf;
+}
+
+void BVH::remove(int proxy) {
+  removeLeaf(proxy);
+  freeNode(proxy);
+  m_leafCount--;
+}
+
+bool BVH::move(int proxy, const AABB& bounds) {
+  if (m_nodes[proxy].bounds.contains(bounds)) {
+    return false;
+  }
+
+  m_nodes[proxy].bounds = bounds.inflated(m_margin);
+  refitAncestors(m_nodes[proxy].parent);
+  return true;
+}
+
+void BVH::setBounds(int proxy, const AABB& bounds) {
+  m_nodes[proxy].bounds = bounds;
+}
+
+void BVH::refit() {
+  // Children always have a larger index than parents in a freshly built tree, but incremental
+  // inserts break that ordering, so refit through an explicit post-order traversal
+  if (m_root == NullNode) {
+    return;
+  }
+
+  std::vector<int> postOrder;
+  postOrder.reserve(m_nodes.size());
+  TraversalStack<int> stack;
+  stack.push(m_root);
+  while (!stack.empty()) {
+    int node = stack.pop();
+    postOrder.push_back(node);
+    if (!m_nodes[node].isLeaf()) {
+      stack.push(m_nodes[node].left);
+      stack.push(m_nodes[node].right);
+    }
+  }
+
+  for (auto it = postOrder.rbegin(); it != postOrder.rend(); ++it) {
+    BVHNode& node = m_nodes[*it];
+    if (!node.isLeaf()) {
+      node.bounds = AABB::merge(m_nodes[node.left].bounds, m_nodes[node.right].bounds);
+      node.height = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
+    }
+  }
+}
+
+void BVH::insertLeaf(int leaf) {
+  if (m_root == NullNode) {
+    m_root = leaf;
+    m_nodes[leaf].parent = NullNode;
+    return;
+  }
+
+  // Descend towards the sibling that minimises the surface area added to the tree
+  const AABB leafBounds = m_nodes[leaf].bounds;
+  int index = m_root;
+  while (!m_nodes[index].isLeaf()) {
+    const BVHNode& node = m_nodes[index];
+    float area = node.bounds.surfaceArea();
+    float combinedArea = AABB::merge(node.bounds, leafBounds).surfaceArea();
+
+    // Cost of making a new parent for this node and the leaf
+    float cost = 2.0f * combinedArea;
+    // Minimum cost of pushing the leaf further down the tree
+    float inheritanceCost = 2.0f * (combinedArea - area);
+
+    auto descendCost = [&](int child) {
+      const AABB& childBounds = m_nodes[child].bounds;
+      float mergedArea = AABB::merge(childBounds, leafBounds).surfaceArea();
+      if (m_nodes[child].isLeaf()) {
+        return mergedArea + inheritanceCost;
+      }
+      return mergedArea - childBounds.surfaceArea() + inheritanceCost;
+    };
+
+    float costLeft = descendCost(node.left);
+    float costRight = descendCost(node.right);
+
+    if (cost < costLeft && cost < costRight) {
+      break;
+    }
+
+    index = costLeft < costRight ? node.left : node.right;
+  }
+
+  int sibling = index;
+  int oldParent = m_nodes[sibling].parent;
+  int newParent = allocateNode();
+
+  m_nodes[newParent].parent = oldParent;
+  m_nodes[newParent].bounds = AABB::merge(leafBounds, m_nodes[sibling].bounds);
+  m_nodes[newParent].height = m_nodes[sibling].height + 1;
+  m_nodes[newParent].left = sibling;
+  m_nodes[newParent].right = leaf;
+  m_nodes[sibling].parent = newParent;
+  m_nodes[leaf].parent = newParent;
+
+  if (oldParent == NullNode) {
+    m_root = newParent;
+  } else {
+    replaceChild(oldParent, sibling, newParent);
+  }
+
+  refitAncestors(newParent);
+}
+
+void BVH::removeLeaf(int leaf) {
+  if (leaf == m_root) {
+    m_root = NullNode;
+    return;
+  }
+
+  int parent = m_nodes[leaf].parent;
+  int grandParent = m_nodes[parent].parent;
+  int sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+  if (grandParent == NullNode) {
+    m_root = sibling;
+    m_nodes[sibling].parent = NullNode;
+    freeNode(parent);
+    return;
+  }
+
+  // The sibling takes the place of the parent
+  replaceChild(grandParent, parent, sibling);
+  m_nodes[sibling].parent = grandParent;
+  freeNode(parent);
+
+  refitAncestors(grandParent);
+}
+
+void BVH::replaceChild(int parent, int oldChild, int newChild) {
+  if (m_nodes[parent].left == oldChild) {
+    m_nodes[parent].left = newChild;
+  } else {
+    m_nodes[parent].right = newChild;
+  }
+}
+
+void BVH::refitAncestors(int node) {
+  while (node != NullNode) {
+    BVHNode& current = m_nodes[node];
+    current.bounds = AABB::merge(m_nodes[current.left].bounds, m_nodes[current.right].bounds);
+    current.height = 1 + std::max(m_nodes[current.left].height, m_nodes[current.right].height);
+
+    rotate(node);
+    node = m_nodes[node].parent;
+  }
+}
+
+void BVH::rotate(int node) {
+  // Kopta et al. tree rotations: try swapping one child with a grandchild on the other side and keep
+  // the swap that shrinks the surface area of the rebuilt child the most. The node's own bounds
+  // never change because it still contains the same leaves.
+  const int left = m_nodes[node].left;
+  const int right = m_nodes[node].right;
+
+  float bestDelta = 0.0f;
+  int swapChild = NullNode;
+  int swapGrandChild = NullNode;
+
+  auto consider = [&](int child, int other) {
+    if (m_nodes[other].isLeaf()) {
+      return;
+    }
+    const BVHNode& otherNode = m_nodes[other];
+    float otherArea = otherNode.bounds.surfaceArea();
+
+    // Swapping child with other.left leaves other = {child, other.right} and vice versa
+    float deltaLeft = AABB::merge(m_nodes[child].bounds, m_nodes[otherNode.right].bounds).surfaceArea() - otherArea;
+    float deltaRight = AABB::merge(m_nodes[child].bounds, m_nodes[otherNode.left].bounds).surfaceArea() - otherArea;
+
+    if (deltaLeft < bestDelta) {
+      bestDelta = deltaLeft;
+      swapChild = child;
+      swapGrandChild = otherNode.left;
+    }
+    if (deltaRight < bestDelta) {
+      bestDelta = deltaRight;
+      swapChild = child;
+      swapGrandChild = otherNode.right;
+    }
+  };
+
+  consider(left, right);
+  consider(right, left);
+
+  if (swapChild == NullNode) {
+    return;
+  }
+
+  int other = m_nodes[swapGrandChild].parent;
+  replaceChild(node, swapChild, swapGrandChild);
+  replaceChild(other, swapGrandChild, swapChild);
+  m_nodes[swapGrandChild].parent = node;
+  m_nodes[swapChild].parent = other;
+
+  BVHNode& otherNode = m_nodes[other];
+  otherNode.bounds = AABB::merge(m_nodes[otherNode.left].bounds, m_nodes[otherNode.right].bounds);
+  otherNode.height = 1 + std::max(m_nodes[otherNode.left].height, m_nodes[otherNode.right].height);
+
+  BVHNode& current = m_nodes[node];
+  current.height = 1 + std::max(m_nodes[current.left].height, m_nodes[current.right].height);
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<int>& results) const {
+  if (m_root == NullNode) {
+    return;
+  }
+
+  TraversalStack<FrustumEntry> stack;
+  stack.push({m_root, 0x3Fu});
+
+  while (!stack.empty()) {
+    FrustumEntry entry = stack.pop();
+    const BVHNode& node = m_nodes[entry.node];
+
+    // Planes the parent was fully inside of are skipped for the whole subtree
+    unsigned planeMask = entry.planeMask;
+    if (planeMask != 0 && frustum.classify(node.bounds, planeMask) == Containment::Outside) {
+      continue;
+    }
+
+    if (node.isLeaf()) {
+      results.push_back(node.userData);
+    } else {
+      stack.push({node.right, planeMask});
+      stack.push({node.left, planeMask});
+    }
+  }
+}
+
+void BVH::queryOverlap(const AABB& bounds, std::vector<int>& results) const {
+  if (m_root == NullNode) {
+    return;
+  }
+
+  TraversalStack<int> stack;
+  stack.push(m_root);
+
+  while (!stack.empty()) {
+    const BVHNode& node = m_nodes[stack.pop()];
+    if (!node.bounds.overlaps(bounds)) {
+      continue;
+    }
+
+    if (node.isLeaf()) {
+      results.push_back(node.userData);
+    } else {
+      stack.push(node.right);
+      stack.push(node.left);
+    }
+  }
+}
+
+bool BVH::raycast(const Ray& ray, float maxDistance, RaycastHit& hit, const RaycastCallback& narrowPhase) const {
+  if (m_root == NullNode) {
+    return false;
+  }
+
+  float closest = maxDistance;
+  bool found = false;
+
+  float rootEntry;
+  if (!ray.intersects(m_nodes[m_root].bounds, closest, rootEntry)) {
+    return false;
+  }
+
+  TraversalStack<int> stack;
+  stack.push(m_root);
+
+  while (!stack.empty()) {
+    const BVHNode& node = m_nodes[stack.pop()];
+
+    float entry;
+    if (!ray.intersects(node.bounds, closest, entry)) {
+      continue;
+    }
+
+    if (node.isLeaf()) {
+      float distance = entry;
+      if (narrowPhase && !narrowPhase(node.userData, ray, distance)) {
+        continue;
+      }
+      if (distance <= closest) {
+        closest = distance;
+        hit.userData = node.userData;
+        hit.distance = distance;
+        found = true;
+      }
+      continue;
+    }
+
+    // Visit the nearer child first so the closest hit shrinks the search early
+    float leftEntry, rightEntry;
+    bool hitLeft = ray.intersects(m_nodes[node.left].bounds, closest, leftEntry);
+    bool hitRight = ray.intersects(m_nodes[node.right].bounds, closest, rightEntry);
+
+    if (hitLeft && hitRight) {
+      if (leftEntry < rightEntry) {
+        stack.push(node.right);
+        stack.push(node.left);
+      } else {
+        stack.push(node.left);
+        stack.push(node.right);
+      }
+    } else if (hitLeft) {
+      stack.push(node.left);
+    } else if (hitRight) {
+      stack.push(node.right);
+    }
+  }
+
+  return found;
+}
+
+BVHStats BVH::computeStats() const {
+  BVHStats stats;
+  if (m_root == NullNode) {
+    return stats;
+  }
+
+  stats.leafCount = m_leafCount;
+  stats.height = m_nodes[m_root].height;
+
+  float rootArea = m_nodes[m_root].bounds.surfaceArea();
+  TraversalStack<int> stack;
+  stack.push(m_root);
+
+  while (!stack.empty()) {
+    const BVHNode& node = m_nodes[stack.pop()];
+    stats.nodeCount++;
+    if (!node.isLeaf()) {
+      if (rootArea > 0.0f) {
+        stats.sahCost += node.bounds.surfaceArea() / rootArea;
+      }
+      stack.push(node.left);
+      stack.push(node.right);
+    }
+  }
+
+  return stats;
+}
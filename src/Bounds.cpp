@@ -0,0 +1,169 @@
+#include "../include/Bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+AABB AABB::empty() {
+  const float inf = std::numeric_limits<float>::max();
+  return AABB(glm::vec3(inf), glm::vec3(-inf));
+}
+
+bool AABB::isValid() const {
+  return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+}
+
+float AABB::surfaceArea() const {
+  glm::vec3 e = extent();
+  return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+float AABB::volume() const {
+  glm::vec3 e = extent();
+  return e.x * e.y * e.z;
+}
+
+void AABB::expand(const glm::vec3& point) {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void AABB::expand(const AABB& other) {
+  min = glm::min(min, other.min);
+  max = glm::max(max, other.max);
+}
+
+AABB AABB::inflated(float margin) const {
+  return AABB(min - glm::vec3(margin), max + glm::vec3(margin));
+}
+
+bool AABB::contains(const AABB& other) const {
+  return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z && other.max.x <= max.x &&
+         other.max.y <= max.y && other.max.z <= max.z;
+}
+
+bool AABB::overlaps(const AABB& other) const {
+  return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y &&
+         min.z <= other.max.z && other.min.z <= max.z;
+}
+
+AABB AABB::transformed(const glm::mat4& transform) const {
+  // Start from the translation and accumulate the min/max contribution of every matrix element
+  glm::vec3 translation(transform[3]);
+  AABB result(translation, translation);
+
+  for (int col = 0; col < 3; col++) {
+    for (int row = 0; row < 3; row++) {
+      float a = transform[col][row] * min[col];
+      float b = transform[col][row] * max[col];
+      result.min[row] += std::min(a, b);
+      result.max[row] += std::max(a, b);
+    }
+  }
+
+  return result;
+}
+
+AABB AABB::merge(const AABB& a, const AABB& b) {
+  return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+Ray::Ray(const glm::vec3& o, const glm::vec3& d) : origin(o), direction(d) {
+  // Division by zero gives +/-inf which the slab test handles correctly
+  invDirection = glm::vec3(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+}
+
+bool Ray::intersects(const AABB& box, float maxT, float& tEntry) const {
+  glm::vec3 t0 = (box.min - origin) * invDirection;
+  glm::vec3 t1 = (box.max - origin) * invDirection;
+  glm::vec3 tSmall = glm::min(t0, t1);
+  glm::vec3 tBig = glm::max(t0, t1);
+
+  float tMin = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, 0.0f));
+  float tMax = std::min(std::min(tBig.x, tBig.y), std::min(tBig.z, maxT));
+
+  if (tMin > tMax) {
+    return false;
+  }
+
+  tEntry = tMin;
+  return true;
+}
+
+Ray Ray::fromScreen(double x, double y, int width, int height, const glm::mat4& inverseViewProjection) {
+  float ndcX = static_cast<float>(2.0 * x / width - 1.0);
+  float ndcY = static_cast<float>(1.0 - 2.0 * y / height);
+
+  glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+  glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+  glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+  glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+
+  return Ray(origin, glm::normalize(target - origin));
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+  Frustum frustum;
+
+  // Rows of the (column-major) matrix
+  glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+  glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+  glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+  glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  frustum.planes[Left] = row3 + row0;
+  frustum.planes[Right] = row3 - row0;
+  frustum.planes[Bottom] = row3 + row1;
+  frustum.planes[Top] = row3 - row1;
+  frustum.planes[Near] = row3 + row2;
+  frustum.planes[Far] = row3 - row2;
+
+  for (auto& plane : frustum.planes) {
+    float length = glm::length(glm::vec3(plane));
+    plane = plane / length;
+  }
+
+  return frustum;
+}
+
+Containment Frustum::classify(const AABB& box) const {
+  unsigned planeMask = 0x3F;
+  return classify(box, planeMask);
+}
+
+Containment Frustum::classify(const AABB& box, unsigned& planeMask) const {
+  glm::vec3 center = box.center();
+  glm::vec3 halfExtent = box.extent() * 0.5f;
+
+  for (int i = 0; i < 6; i++) {
+    if (!(planeMask & (1u << i))) {
+      continue;
+    }
+
+    glm::vec3 normal(planes[i]);
+    float distance = glm::dot(normal, center) + planes[i].w;
+    float radius = glm::dot(halfExtent, glm::abs(normal));
+
+    if (distance < -radius) {
+      return Containment::Outside;
+    }
+    if (distance >= radius) {
+      planeMask &= ~(1u << i);
+    }
+  }
+
+  return planeMask == 0 ? Containment::Inside : Containment::Intersect;
+}
+
+bool Frustum::intersects(const AABB& box) const {
+  return classify(box) != Containment::Outside;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+  for (const auto& plane : planes) {
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
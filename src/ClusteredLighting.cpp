@@ -0,0 +1,308 @@
+#include "../include/ClusteredLighting.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MACHI_LIGHTING_SSE 1
+#endif
+
+namespace {
+enum Buffer { LightBuffer, RangeBuffer, IndexBuffer };
+
+// Padding lights, too far away to reach any cluster
+constexpr float FarAway = 1e18f;
+
+// Depth (distance in front of the camera) where a slice starts, exponential so clusters stay
+// roughly cubic from near to far
+float sliceDepth(int slice, float nearPlane, float farPlane) {
+  return nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / ClusteredLighting::ClustersZ);
+}
+}  // namespace
+
+ClusteredLighting::ClusteredLighting(JobSystem* jobs, ResidencyManager* residency) :
+ m_jobs(jobs),
+ m_residency(residency),
+ m_lightsDirty(true),
+ m_fovY(0.0f),
+ m_aspect(0.0f),
+ m_near(0.0f),
+ m_far(0.0f),
+ m_buffers{0, 0, 0},
+ m_textures{0, 0, 0},
+ m_capacity{0, 0, 0},
+ m_residencyId(-1) {
+  const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R16UI};
+  glGenBuffers(3, m_buffers);
+  glGenTextures(3, m_textures);
+  for (int i = 0; i < 3; i++) {
+    // A buffer texture needs storage to be complete, the first update grows it
+    m_capacity[i] = 64;
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[i]);
+    glBufferData(GL_TEXTURE_BUFFER, m_capacity[i], nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+    glTexBuffer(GL_TEXTURE_BUFFER, formats[i], m_buffers[i]);
+  }
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  m_slices.resize(ClustersZ);
+  m_ranges.resize(ClusterCount * 2);
+  if (m_residency) {
+    m_residencyId = m_residency->add(ResidencyKind::Buffer, "clustered lights", m_capacity[0] * 3);
+  }
+}
+
+ClusteredLighting::~ClusteredLighting() {
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->remove(m_residencyId);
+  }
+  glDeleteTextures(3, m_textures);
+  glDeleteBuffers(3, m_buffers);
+}
+
+int ClusteredLighting::addLight(const PointLight& light) {
+  if (static_cast<int>(m_lights.size()) >= MaxLights) {
+    LOG_WARNING_F("[ClusteredLighting] {} lights at most, light not added", MaxLights);
+    return -1;
+  }
+  m_lights.push_back(light);
+  m_lightsDirty = true;
+  return static_cast<int>(m_lights.size()) - 1;
+}
+
+void ClusteredLighting::setLight(int index, const PointLight& light) {
+  m_lights[index] = light;
+  m_lightsDirty = true;
+}
+
+void ClusteredLighting::clearLights() {
+  m_lights.clear();
+  m_lightsDirty = true;
+}
+
+void ClusteredLighting::buildClusters(float fovY, float aspect, float nearPlane, float farPlane) {
+  m_fovY = fovY;
+  m_aspect = aspect;
+  m_near = nearPlane;
+  m_far = farPlane;
+
+  // Each cluster is the frustum piece between two slices, its box spans both ends of it
+  const float tanY = std::tan(fovY * 0.5f);
+  const float tanX = tanY * aspect;
+  m_clusters.resize(ClusterCount);
+  for (int z = 0; z < ClustersZ; z++) {
+    const float d0 = sliceDepth(z, nearPlane, farPlane);
+    const float d1 = sliceDepth(z + 1, nearPlane, farPlane);
+    for (int y = 0; y < ClustersY; y++) {
+      const float y0 = -1.0f + 2.0f * y / ClustersY;
+      const float y1 = -1.0f + 2.0f * (y + 1) / ClustersY;
+      for (int x = 0; x < ClustersX; x++) {
+        const float x0 = -1.0f + 2.0f * x / ClustersX;
+        const float x1 = -1.0f + 2.0f * (x + 1) / ClustersX;
+        ClusterBounds& bounds = m_clusters[x + ClustersX * (y + ClustersY * z)];
+        bounds.min = glm::vec3(std::min(x0 * tanX * d0, x0 * tanX * d1), std::min(y0 * tanY * d0, y0 * tanY * d1), -d1);
+        bounds.max = glm::vec3(std::max(x1 * tanX * d0, x1 * tanX * d1), std::max(y1 * tanY * d0, y1 * tanY * d1), -d0);
+      }
+    }
+  }
+}
+
+void ClusteredLighting::binSlice(int slice) {
+  SliceResult& result = m_slices[slice];
+  result.indices.clear();
+  result.counts.assign(ClustersX * ClustersY, 0);
+  result.overflows = 0;
+
+  // Lights overlapping the slice's depth range, padded to a multiple of 4
+  const float sliceNear = -sliceDepth(slice, m_near, m_far);
+  const float sliceFar = -sliceDepth(slice + 1, m_near, m_far);
+  std::vector<float>& x = result.x;
+  std::vector<float>& y = result.y;
+  std::vector<float>& z = result.z;
+  std::vector<float>& radius = result.radius;
+  std::vector<uint16_t>& ids = result.ids;
+  x.clear();
+  y.clear();
+  z.clear();
+  radius.clear();
+  ids.clear();
+  const size_t lightCount = m_x.size();
+  for (size_t i = 0; i < lightCount; i++) {
+    if (m_z[i] - m_radius[i] <= sliceNear && m_z[i] + m_radius[i] >= sliceFar) {
+      x.push_back(m_x[i]);
+      y.push_back(m_y[i]);
+      z.push_back(m_z[i]);
+      radius.push_back(m_radius[i]);
+      ids.push_back(static_cast<uint16_t>(i));
+    }
+  }
+  if (ids.empty()) {
+    return;
+  }
+  while (x.size() % 4 != 0) {
+    x.push_back(FarAway);
+    y.push_back(FarAway);
+    z.push_back(FarAway);
+    radius.push_back(0.0f);
+  }
+
+  const size_t candidates = ids.size();
+  for (int tile = 0; tile < ClustersX * ClustersY; tile++) {
+    const ClusterBounds& bounds = m_clusters[tile + ClustersX * ClustersY * slice];
+    uint32_t count = 0;
+    auto append = [&](size_t candidate) {
+      if (count < MaxClusterLights) {
+        result.indices.push_back(ids[candidate]);
+        count++;
+      } else if (count == MaxClusterLights) {
+        result.overflows++;
+        count++;
+      }
+    };
+
+    // Sphere against box: squared distance from the center to the nearest point of the box
+#ifdef MACHI_LIGHTING_SSE
+    const __m128 minX = _mm_set1_ps(bounds.min.x), maxX = _mm_set1_ps(bounds.max.x);
+    const __m128 minY = _mm_set1_ps(bounds.min.y), maxY = _mm_set1_ps(bounds.max.y);
+    const __m128 minZ = _mm_set1_ps(bounds.min.z), maxZ = _mm_set1_ps(bounds.max.z);
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = 0; i < x.size(); i += 4) {
+      const __m128 px = _mm_loadu_ps(&x[i]), py = _mm_loadu_ps(&y[i]), pz = _mm_loadu_ps(&z[i]);
+      const __m128 r = _mm_loadu_ps(&radius[i]);
+      const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, px), _mm_sub_ps(px, maxX)), zero);
+      const __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, py), _mm_sub_ps(py, maxY)), zero);
+      const __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, pz), _mm_sub_ps(pz, maxZ)), zero);
+      const __m128 distance2 =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+      const int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, _mm_mul_ps(r, r)));
+      for (int lane = 0; mask && lane < 4; lane++) {
+        if ((mask & (1 << lane)) && i + lane < candidates) {
+          append(i + lane);
+        }
+      }
+    }
+#else
+    for (size_t i = 0; i < candidates; i++) {
+      const float dx = std::max(std::max(bounds.min.x - x[i], x[i] - bounds.max.x), 0.0f);
+      const float dy = std::max(std::max(bounds.min.y - y[i], y[i] - bounds.max.y), 0.0f);
+      const float dz = std::max(std::max(bounds.min.z - z[i], z[i] - bounds.max.z), 0.0f);
+      if (dx * dx + dy * dy + dz * dz <= radius[i] * radius[i]) {
+        append(i);
+      }
+    }
+#endif
+    result.counts[tile] = std::min<uint32_t>(count, MaxClusterLights);
+  }
+}
+
+void ClusteredLighting::upload(int buffer, const void* data, size_t bytes) {
+  if (bytes > m_capacity[buffer]) {
+    // Grown with headroom so a slowly rising light count doesn't reallocate every frame
+    m_capacity[buffer] = std::max(bytes, m_capacity[buffer] * 2);
+    if (m_residency && m_residencyId >= 0) {
+      m_residency->resize(m_residencyId, m_capacity[0] + m_capacity[1] + m_capacity[2]);
+    }
+  }
+  // Orphaned, the driver hands out fresh storage instead of waiting for last frame's draws
+  glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[buffer]);
+  glBufferData(GL_TEXTURE_BUFFER, m_capacity[buffer], nullptr, GL_STREAM_DRAW);
+  if (bytes > 0) {
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+  }
+}
+
+void ClusteredLighting::update(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane) {
+  auto start = std::chrono::high_resolution_clock::now();
+  if (m_clusters.empty() || fovY != m_fovY || aspect != m_aspect || nearPlane != m_near || farPlane != m_far) {
+    buildClusters(fovY, aspect, nearPlane, farPlane);
+  }
+
+  const size_t lightCount = m_lights.size();
+  m_x.resize(lightCount);
+  m_y.resize(lightCount);
+  m_z.resize(lightCount);
+  m_radius.resize(lightCount);
+  for (size_t i = 0; i < lightCount; i++) {
+    const glm::vec4 position = view * glm::vec4(m_lights[i].position, 1.0f);
+    m_x[i] = position.x;
+    m_y[i] = position.y;
+    m_z[i] = position.z;
+    m_radius[i] = m_lights[i].radius;
+  }
+
+  if (m_jobs) {
+    m_jobs->parallelFor(ClustersZ, 1, [this](size_t begin, size_t end) {
+      for (size_t slice = begin; slice < end; slice++) {
+        binSlice(static_cast<int>(slice));
+      }
+    });
+  } else {
+    for (int slice = 0; slice < ClustersZ; slice++) {
+      binSlice(slice);
+    }
+  }
+
+  // Slices into one list, the ranges point into it
+  m_indices.clear();
+  m_visible.assign(lightCount, 0);
+  m_stats = LightingStats();
+  m_stats.lights = static_cast<int>(lightCount);
+  for (int slice = 0; slice < ClustersZ; slice++) {
+    const SliceResult& result = m_slices[slice];
+    uint32_t offset = static_cast<uint32_t>(m_indices.size());
+    for (int tile = 0; tile < ClustersX * ClustersY; tile++) {
+      const int cluster = tile + ClustersX * ClustersY * slice;
+      const uint32_t count = result.counts[tile];
+      m_ranges[cluster * 2] = offset;
+      m_ranges[cluster * 2 + 1] = count;
+      offset += count;
+      m_stats.maxClusterLights = std::max(m_stats.maxClusterLights, static_cast<int>(count));
+    }
+    m_indices.insert(m_indices.end(), result.indices.begin(), result.indices.end());
+    m_stats.overflows += result.overflows;
+  }
+  for (uint16_t index : m_indices) {
+    m_visible[index] = 1;
+  }
+  m_stats.visibleLights = static_cast<int>(std::count(m_visible.begin(), m_visible.end(), 1));
+  m_stats.lightIndices = static_cast<int>(m_indices.size());
+
+  if (m_lightsDirty) {
+    std::vector<glm::vec4> texels(lightCount * 2);
+    for (size_t i = 0; i < lightCount; i++) {
+      texels[i * 2] = glm::vec4(m_lights[i].position, m_lights[i].radius);
+      texels[i * 2 + 1] = glm::vec4(m_lights[i].color * m_lights[i].intensity, 0.0f);
+    }
+    upload(LightBuffer, texels.data(), texels.size() * sizeof(glm::vec4));
+    m_lightsDirty = false;
+  }
+  upload(RangeBuffer, m_ranges.data(), m_ranges.size() * sizeof(uint32_t));
+  upload(IndexBuffer, m_indices.data(), m_indices.size() * sizeof(uint16_t));
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  auto end = std::chrono::high_resolution_clock::now();
+  m_stats.binMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void ClusteredLighting::bind(const Shader& shader, int viewportWidth, int viewportHeight) const {
+  const char* samplers[3] = {"lightData", "clusterRanges", "lightIndices"};
+  for (int i = 0; i < 3; i++) {
+    glActiveTexture(GL_TEXTURE0 + FirstUnit + i);
+    glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+    shader.setInt(samplers[i], FirstUnit + i);
+  }
+  glActiveTexture(GL_TEXTURE0);
+
+  // slice = log(depth) * scale + bias inverts sliceDepth()
+  const float logRatio = std::log(m_far / m_near);
+  glUniform3i(glGetUniformLocation(shader.m_id, "clusterCounts"), ClustersX, ClustersY, ClustersZ);
+  glUniform2f(glGetUniformLocation(shader.m_id, "clusterTileSize"),
+              static_cast<float>(viewportWidth) / ClustersX,
+              static_cast<float>(viewportHeight) / ClustersY);
+  shader.setFloat("clusterSliceScale", ClustersZ / logRatio);
+  shader.setFloat("clusterSliceBias", -ClustersZ * std::log(m_near) / logRatio);
+}
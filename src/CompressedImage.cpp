@@ -0,0 +1,687 @@
+#include "../include/CompressedImage.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Utils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <exception>
+#include <fstream>
+
+namespace {
+const uint8_t KTX2Identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// VkFormat values used by KTX2
+enum VkFormat : uint32_t {
+  VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131,
+  VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132,
+  VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133,
+  VK_FORMAT_BC1_RGBA_SRGB_BLOCK = 134,
+  VK_FORMAT_BC3_UNORM_BLOCK = 137,
+  VK_FORMAT_BC3_SRGB_BLOCK = 138,
+  VK_FORMAT_BC4_UNORM_BLOCK = 139,
+  VK_FORMAT_BC5_UNORM_BLOCK = 141,
+  VK_FORMAT_BC7_UNORM_BLOCK = 145,
+  VK_FORMAT_BC7_SRGB_BLOCK = 146,
+};
+
+// DXGI_FORMAT values used by the DDS DX10 header
+enum DXGIFormat : uint32_t {
+  DXGI_FORMAT_BC1_UNORM = 71,
+  DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+  DXGI_FORMAT_BC3_UNORM = 77,
+  DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+  DXGI_FORMAT_BC4_UNORM = 80,
+  DXGI_FORMAT_BC5_UNORM = 83,
+  DXGI_FORMAT_BC7_UNORM = 98,
+  DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+};
+
+constexpr uint32_t fourCC(char a, char b, char c, char d) {
+  return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) |
+         (static_cast<uint32_t>(d) << 24);
+}
+
+template <typename T>
+T readValue(const uint8_t* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+template <typename T>
+void writeValue(std::vector<uint8_t>& out, T value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void pad(std::vector<uint8_t>& out, size_t alignment) {
+  while (out.size() % alignment != 0) {
+    out.push_back(0);
+  }
+}
+
+// Index bits of one texel row in a BC4 style block (BC4, BC5 and BC3 alpha): 4 rows of 12 bits
+// after the two endpoint bytes
+uint64_t alphaRow(const uint8_t* block, int row) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, block + 2, 6);
+  return (bits >> (row * 12)) & 0xFFF;
+}
+
+void setAlphaRow(uint8_t* block, int row, uint64_t value) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, block + 2, 6);
+  bits = (bits & ~(uint64_t(0xFFF) << (row * 12))) | (value << (row * 12));
+  std::memcpy(block + 2, &bits, 6);
+}
+
+// Texel row sourceRow of source becomes row targetRow of target, endpoints stay those of target
+void copyBlockRow(BlockFormat format, const uint8_t* source, int sourceRow, uint8_t* target, int targetRow) {
+  switch (format) {
+    case BlockFormat::BC1:  // A byte of 2 bit indices per row after the two colors
+      target[4 + targetRow] = source[4 + sourceRow];
+      break;
+    case BlockFormat::BC3:
+      setAlphaRow(target, targetRow, alphaRow(source, sourceRow));
+      target[12 + targetRow] = source[12 + sourceRow];
+      break;
+    case BlockFormat::BC4:
+      setAlphaRow(target, targetRow, alphaRow(source, sourceRow));
+      break;
+    case BlockFormat::BC5:
+      setAlphaRow(target, targetRow, alphaRow(source, sourceRow));
+      setAlphaRow(target + 8, targetRow, alphaRow(source + 8, sourceRow));
+      break;
+    case BlockFormat::BC7:  // Row layout depends on the block's mode and partition
+      break;
+  }
+}
+
+// Turns a top-down level into a bottom-up one without decoding it: block rows are reversed and so
+// are the texel rows inside each block. That needs every block to come from a single block, so
+// levels whose height isn't a multiple of 4 only work when they are one block high. BC7 blocks
+// can't be flipped this way.
+bool flipVertically(BlockFormat format, CompressedMip& mip) {
+  if (format == BlockFormat::BC7 || (mip.height > 4 && mip.height % 4 != 0)) {
+    return false;
+  }
+  const size_t bytes = blockBytes(format);
+  const int blocksWide = (mip.width + 3) / 4;
+  const int blocksHigh = (mip.height + 3) / 4;
+  const size_t rowBytes = blocksWide * bytes;
+  std::vector<uint8_t> flipped(mip.data.size());
+  for (int blockRow = 0; blockRow < blocksHigh; blockRow++) {
+    const uint8_t* source = mip.data.data() + (blocksHigh - 1 - blockRow) * rowBytes;
+    uint8_t* target = flipped.data() + blockRow * rowBytes;
+    std::memcpy(target, source, rowBytes);
+    const int rows = std::min(mip.height, 4);
+    for (size_t block = 0; block < static_cast<size_t>(blocksWide); block++) {
+      for (int row = 0; row < rows; row++) {
+        copyBlockRow(format, source + block * bytes, rows - 1 - row, target + block * bytes, row);
+      }
+    }
+  }
+  mip.data = std::move(flipped);
+  return true;
+}
+
+// The KTXorientation value, "rd" (rows top-down, the default) when the file has none
+std::string ktx2Orientation(const uint8_t* data, size_t size) {
+  const uint64_t offset = readValue<uint32_t>(data + 56);
+  const uint64_t length = readValue<uint32_t>(data + 60);
+  if (offset + length > size) {
+    return "rd";
+  }
+  const uint8_t* entry = data + offset;
+  const uint8_t* end = entry + length;
+  const char key[] = "KTXorientation";
+  while (end - entry >= 4) {
+    const uint32_t entryLength = readValue<uint32_t>(entry);
+    const uint8_t* text = entry + 4;
+    if (entryLength > static_cast<size_t>(end - text)) {
+      break;
+    }
+    if (entryLength > sizeof(key) && std::memcmp(text, key, sizeof(key)) == 0) {
+      const char* value = reinterpret_cast<const char*>(text + sizeof(key));
+      return std::string(value, strnlen(value, entryLength - sizeof(key)));
+    }
+    entry = text + (entryLength + 3) / 4 * 4;
+  }
+  return "rd";
+}
+
+bool fromVkFormat(uint32_t vkFormat, BlockFormat& format, bool& srgb) {
+  switch (vkFormat) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+      format = BlockFormat::BC1;
+      srgb = false;
+      return true;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+      format = BlockFormat::BC1;
+      srgb = true;
+      return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+      format = BlockFormat::BC3;
+      srgb = vkFormat == VK_FORMAT_BC3_SRGB_BLOCK;
+      return true;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+      format = BlockFormat::BC4;
+      srgb = false;
+      return true;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+      format = BlockFormat::BC5;
+      srgb = false;
+      return true;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+      format = BlockFormat::BC7;
+      srgb = vkFormat == VK_FORMAT_BC7_SRGB_BLOCK;
+      return true;
+  }
+  return false;
+}
+
+uint32_t toVkFormat(BlockFormat format, bool srgb) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case BlockFormat::BC3:
+      return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case BlockFormat::BC4:
+      return VK_FORMAT_BC4_UNORM_BLOCK;
+    case BlockFormat::BC5:
+      return VK_FORMAT_BC5_UNORM_BLOCK;
+    case BlockFormat::BC7:
+      return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+  }
+  return 0;
+}
+
+bool fromDXGIFormat(uint32_t dxgiFormat, BlockFormat& format, bool& srgb) {
+  switch (dxgiFormat) {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+      format = BlockFormat::BC1;
+      srgb = dxgiFormat == DXGI_FORMAT_BC1_UNORM_SRGB;
+      return true;
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+      format = BlockFormat::BC3;
+      srgb = dxgiFormat == DXGI_FORMAT_BC3_UNORM_SRGB;
+      return true;
+    case DXGI_FORMAT_BC4_UNORM:
+      format = BlockFormat::BC4;
+      srgb = false;
+      return true;
+    case DXGI_FORMAT_BC5_UNORM:
+      format = BlockFormat::BC5;
+      srgb = false;
+      return true;
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+      format = BlockFormat::BC7;
+      srgb = dxgiFormat == DXGI_FORMAT_BC7_UNORM_SRGB;
+      return true;
+  }
+  return false;
+}
+
+uint32_t toDXGIFormat(BlockFormat format, bool srgb) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+    case BlockFormat::BC3:
+      return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+    case BlockFormat::BC4:
+      return DXGI_FORMAT_BC4_UNORM;
+    case BlockFormat::BC5:
+      return DXGI_FORMAT_BC5_UNORM;
+    case BlockFormat::BC7:
+      return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+  }
+  return 0;
+}
+
+// Khronos data format descriptor for a block compressed format, required by KTX2 readers
+std::vector<uint8_t> buildDFD(BlockFormat format, bool srgb) {
+  enum : uint32_t { ModelBC1A = 128, ModelBC3 = 130, ModelBC4 = 131, ModelBC5 = 132, ModelBC7 = 134 };
+  enum : uint32_t { ChannelColor = 0, ChannelRed = 0, ChannelGreen = 1, ChannelAlpha = 15 };
+
+  struct Sample {
+    uint32_t channel;
+    uint32_t bitOffset;
+    uint32_t bitLength;
+  };
+  std::vector<Sample> samples;
+  uint32_t model = 0;
+
+  switch (format) {
+    case BlockFormat::BC1:
+      model = ModelBC1A;
+      samples = {{ChannelColor, 0, 64}};
+      break;
+    case BlockFormat::BC3:
+      model = ModelBC3;
+      samples = {{ChannelAlpha, 0, 64}, {ChannelColor, 64, 64}};
+      break;
+    case BlockFormat::BC4:
+      model = ModelBC4;
+      samples = {{ChannelRed, 0, 64}};
+      break;
+    case BlockFormat::BC5:
+      model = ModelBC5;
+      samples = {{ChannelRed, 0, 64}, {ChannelGreen, 64, 64}};
+      break;
+    case BlockFormat::BC7:
+      model = ModelBC7;
+      samples = {{ChannelColor, 0, 128}};
+      break;
+  }
+
+  const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+  const uint32_t primariesBT709 = 1;
+  const uint32_t transfer = srgb ? 2 : 1;
+
+  std::vector<uint8_t> dfd;
+  writeValue<uint32_t>(dfd, 4 + blockSize);  // dfdTotalSize
+  writeValue<uint32_t>(dfd, 0);  // vendorId, descriptorType
+  writeValue<uint32_t>(dfd, 2 | (blockSize << 16));  // versionNumber, descriptorBlockSize
+  writeValue<uint32_t>(dfd, model | (primariesBT709 << 8) | (transfer << 16));
+  writeValue<uint32_t>(dfd, 3 | (3 << 8));  // texelBlockDimension - 1
+  writeValue<uint32_t>(dfd, blockBytes(format));  // bytesPlane0
+  writeValue<uint32_t>(dfd, 0);  // bytesPlane4-7
+  for (const auto& sample : samples) {
+    writeValue<uint32_t>(dfd, sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+    writeValue<uint32_t>(dfd, 0);  // samplePosition
+    writeValue<uint32_t>(dfd, 0);  // sampleLower
+    writeValue<uint32_t>(dfd, 0xFFFFFFFFu);  // sampleUpper
+  }
+  return dfd;
+}
+
+bool writeFile(const std::string& filepath, const std::vector<uint8_t>& data) {
+  std::ofstream file(filepath, std::ios::binary);
+  if (!file.is_open()) {
+    LOG_ERROR_F("[CompressedImage] Unable to write {}", filepath);
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+  return file.good();
+}
+
+std::string lowercaseExtension(const std::string& filepath) {
+  size_t dot = filepath.find_last_of('.');
+  if (dot == std::string::npos) {
+    return "";
+  }
+  std::string extension = filepath.substr(dot);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return extension;
+}
+}  // namespace
+
+unsigned int blockBytes(BlockFormat format) {
+  return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+size_t compressedSize(BlockFormat format, int width, int height) {
+  size_t blocksX = (std::max(width, 1) + 3) / 4;
+  size_t blocksY = (std::max(height, 1) + 3) / 4;
+  return blocksX * blocksY * blockBytes(format);
+}
+
+const char* blockFormatName(BlockFormat format) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return "BC1";
+    case BlockFormat::BC3:
+      return "BC3";
+    case BlockFormat::BC4:
+      return "BC4";
+    case BlockFormat::BC5:
+      return "BC5";
+    case BlockFormat::BC7:
+      return "BC7";
+  }
+  return "unknown";
+}
+
+bool isColorFormat(BlockFormat format) {
+  return format == BlockFormat::BC1 || format == BlockFormat::BC3 || format == BlockFormat::BC7;
+}
+
+bool isCompressedTexturePath(const std::string& filepath) {
+  std::string extension = lowercaseExtension(filepath);
+  return extension == ".ktx2" || extension == ".dds";
+}
+
+TextureUsage usageFromPath(const std::string& filepath) {
+  std::string name = filepath.substr(filepath.find_last_of("/\\") + 1);
+  name = name.substr(0, name.find_last_of('.'));
+  std::transform(
+    name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+  // The map type is the last token of the name, before a resolution such as _4k
+  size_t end = name.size();
+  std::string token;
+  for (int i = 0; i < 2 && end > 0; i++) {
+    const size_t start = name.find_last_of("_- ", end - 1);
+    const size_t first = start == std::string::npos ? 0 : start + 1;
+    token = name.substr(first, end - first);
+    const bool resolution = token.size() >= 2 && token.back() == 'k' &&
+                            std::all_of(token.begin(), token.end() - 1, [](unsigned char c) {
+                              return std::isdigit(c) != 0;
+                            });
+    if (!resolution || start == std::string::npos) {
+      break;
+    }
+    end = start;
+  }
+
+  for (const char* suffix : {"normal", "nrm", "nor", "normalgl", "normaldx"}) {
+    if (token == suffix) {
+      return TextureUsage::Normal;
+    }
+  }
+  for (const char* suffix :
+       {"roughness", "metallic", "metalness", "ambientocclusion", "ao", "displacement", "height", "gloss"}) {
+    if (token == suffix) {
+      return TextureUsage::Mask;
+    }
+  }
+  return TextureUsage::Color;
+}
+
+bool CompressedImage::load(const std::string& filepath, CompressedImage& image) {
+  MappedFile file;
+  if (!file.open(filepath, FileAccess::Sequential)) {
+    return false;
+  }
+
+  std::string extension = lowercaseExtension(filepath);
+  bool loaded = extension == ".dds" ? loadDDS(file.data(), file.size(), image)
+                                    : loadKTX2(file.data(), file.size(), image);
+  if (!loaded) {
+    LOG_ERROR_F("[CompressedImage] Failed to parse {}", filepath);
+    return false;
+  }
+
+  LOG_INFO_F("[CompressedImage] Loaded {}: {}x{} {}{}, {} mip(s)",
+             filepath,
+             image.width,
+             image.height,
+             blockFormatName(image.format),
+             image.srgb ? " sRGB" : "",
+             image.mips.size());
+  return true;
+}
+
+bool CompressedImage::load(const uint8_t* data, size_t size, CompressedImage& image) {
+  if (size >= 4 && readValue<uint32_t>(data) == fourCC('D', 'D', 'S', ' ')) {
+    return loadDDS(data, size, image);
+  }
+  return loadKTX2(data, size, image);
+}
+
+bool CompressedImage::loadKTX2(const uint8_t* data, size_t size, CompressedImage& image) {
+  const size_t headerSize = 80;
+  if (size < headerSize || std::memcmp(data, KTX2Identifier, sizeof(KTX2Identifier)) != 0) {
+    LOG_ERROR("[CompressedImage] Not a KTX2 file");
+    return false;
+  }
+
+  uint32_t vkFormat = readValue<uint32_t>(data + 12);
+  uint32_t pixelWidth = readValue<uint32_t>(data + 20);
+  uint32_t pixelHeight = readValue<uint32_t>(data + 24);
+  uint32_t pixelDepth = readValue<uint32_t>(data + 28);
+  uint32_t layerCount = readValue<uint32_t>(data + 32);
+  uint32_t faceCount = readValue<uint32_t>(data + 36);
+  uint32_t levelCount = std::max(readValue<uint32_t>(data + 40), 1u);
+  uint32_t supercompression = readValue<uint32_t>(data + 44);
+
+  if (!fromVkFormat(vkFormat, image.format, image.srgb)) {
+    LOG_ERROR_F("[CompressedImage] Unsupported KTX2 vkFormat {}", vkFormat);
+    return false;
+  }
+  if (supercompression != 0) {
+    LOG_ERROR_F("[CompressedImage] KTX2 supercompression scheme {} is not supported", supercompression);
+    return false;
+  }
+  if (pixelDepth > 1 || layerCount > 1 || faceCount != 1) {
+    LOG_ERROR("[CompressedImage] Only single 2D KTX2 textures are supported");
+    return false;
+  }
+  if (size < headerSize + levelCount * 24) {
+    LOG_ERROR("[CompressedImage] Truncated KTX2 level index");
+    return false;
+  }
+
+  image.width = static_cast<int>(pixelWidth);
+  image.height = static_cast<int>(pixelHeight);
+  image.mips.clear();
+
+  for (uint32_t level = 0; level < levelCount; level++) {
+    const uint8_t* entry = data + headerSize + level * 24;
+    uint64_t offset = readValue<uint64_t>(entry);
+    uint64_t length = readValue<uint64_t>(entry + 8);
+
+    CompressedMip mip;
+    mip.width = std::max(image.width >> level, 1);
+    mip.height = std::max(image.height >> level, 1);
+    if (offset + length > size || length < compressedSize(image.format, mip.width, mip.height)) {
+      LOG_ERROR_F("[CompressedImage] KTX2 level {} is out of bounds", level);
+      return false;
+    }
+    mip.data.assign(data + offset, data + offset + compressedSize(image.format, mip.width, mip.height));
+    image.mips.push_back(std::move(mip));
+  }
+
+  // Rows are kept bottom-up, files written top-down by other tools are flipped to match
+  const std::string orientation = ktx2Orientation(data, size);
+  if (orientation.size() >= 2 && orientation[1] == 'd') {
+    for (CompressedMip& mip : image.mips) {
+      if (!flipVertically(image.format, mip)) {
+        LOG_ERROR_F("[CompressedImage] Top-down {} KTX2 levels of {}x{} can't be flipped, re-encode it bottom-up",
+                    blockFormatName(image.format),
+                    mip.width,
+                    mip.height);
+        return false;
+      }
+    }
+  }
+
+  return image.isValid();
+}
+
+bool CompressedImage::loadDDS(const uint8_t* data, size_t size, CompressedImage& image) {
+  const size_t headerSize = 4 + 124;
+  if (size < headerSize || readValue<uint32_t>(data) != fourCC('D', 'D', 'S', ' ')) {
+    LOG_ERROR("[CompressedImage] Not a DDS file");
+    return false;
+  }
+
+  const uint8_t* header = data + 4;
+  uint32_t height = readValue<uint32_t>(header + 8);
+  uint32_t width = readValue<uint32_t>(header + 12);
+  uint32_t mipCount = std::max(readValue<uint32_t>(header + 24), 1u);
+  uint32_t pixelFormatFlags = readValue<uint32_t>(header + 76);
+  uint32_t pixelFourCC = readValue<uint32_t>(header + 80);
+  size_t dataOffset = headerSize;
+
+  const uint32_t FlagFourCC = 0x4;
+  if (!(pixelFormatFlags & FlagFourCC)) {
+    LOG_ERROR("[CompressedImage] Uncompressed DDS files are not supported");
+    return false;
+  }
+
+  bool known = true;
+  image.srgb = false;
+  switch (pixelFourCC) {
+    case fourCC('D', 'X', 'T', '1'):
+      image.format = BlockFormat::BC1;
+      break;
+    case fourCC('D', 'X', 'T', '5'):
+      image.format = BlockFormat::BC3;
+      break;
+    case fourCC('A', 'T', 'I', '1'):
+    case fourCC('B', 'C', '4', 'U'):
+      image.format = BlockFormat::BC4;
+      break;
+    case fourCC('A', 'T', 'I', '2'):
+    case fourCC('B', 'C', '5', 'U'):
+      image.format = BlockFormat::BC5;
+      break;
+    case fourCC('D', 'X', '1', '0'): {
+      if (size < headerSize + 20) {
+        return false;
+      }
+      uint32_t dxgiFormat = readValue<uint32_t>(data + headerSize);
+      uint32_t arraySize = readValue<uint32_t>(data + headerSize + 12);
+      known = fromDXGIFormat(dxgiFormat, image.format, image.srgb) && arraySize <= 1;
+      dataOffset += 20;
+      break;
+    }
+    default:
+      known = false;
+      break;
+  }
+  if (!known) {
+    LOG_ERROR("[CompressedImage] Unsupported DDS pixel format");
+    return false;
+  }
+
+  image.width = static_cast<int>(width);
+  image.height = static_cast<int>(height);
+  image.mips.clear();  // DDS stores the levels back to back, largest first
+  for (uint32_t level = 0; level < mipCount; level++) {
+    CompressedMip mip;
+    mip.width = std::max(image.width >> level, 1);
+    mip.height = std::max(image.height >> level, 1);
+    size_t length = compressedSize(image.format, mip.width, mip.height);
+    if (dataOffset + length > size) {
+      LOG_ERROR_F("[CompressedImage] DDS level {} is out of bounds", level);
+      return false;
+    }
+    mip.data.assign(data + dataOffset, data + dataOffset + length);
+    dataOffset += length;
+    image.mips.push_back(std::move(mip));
+  }
+
+  return image.isValid();
+}
+
+bool CompressedImage::save(const std::string& filepath) const {
+  return lowercaseExtension(filepath) == ".dds" ? saveDDS(filepath) : saveKTX2(filepath);
+}
+
+bool CompressedImage::saveKTX2(const std::string& filepath) const {
+  return writeFile(filepath, encodeKTX2());
+}
+
+std::vector<uint8_t> CompressedImage::encodeKTX2() const {
+  const uint32_t levelCount = static_cast<uint32_t>(mips.size());
+  std::vector<uint8_t> dfd = buildDFD(format, srgb);
+
+  // Rows are bottom-up, the same order the engine uploads uncompressed images in
+  std::vector<uint8_t> kvd;
+  const char key[] = "KTXorientation";
+  const char value[] = "ru";
+  writeValue<uint32_t>(kvd, sizeof(key) + sizeof(value));
+  kvd.insert(kvd.end(), key, key + sizeof(key));
+  kvd.insert(kvd.end(), value, value + sizeof(value));
+  pad(kvd, 4);
+
+  const size_t levelIndexOffset = 80;
+  const size_t dfdOffset = levelIndexOffset + levelCount * 24;
+  const size_t kvdOffset = dfdOffset + dfd.size();
+
+  std::vector<uint8_t> out(KTX2Identifier, KTX2Identifier + sizeof(KTX2Identifier));
+  writeValue<uint32_t>(out, toVkFormat(format, srgb));
+  writeValue<uint32_t>(out, 1);  // typeSize
+  writeValue<uint32_t>(out, static_cast<uint32_t>(width));
+  writeValue<uint32_t>(out, static_cast<uint32_t>(height));
+  writeValue<uint32_t>(out, 0);  // pixelDepth
+  writeValue<uint32_t>(out, 0);  // layerCount
+  writeValue<uint32_t>(out, 1);  // faceCount
+  writeValue<uint32_t>(out, levelCount);
+  writeValue<uint32_t>(out, 0);  // supercompressionScheme
+  writeValue<uint32_t>(out, static_cast<uint32_t>(dfdOffset));
+  writeValue<uint32_t>(out, static_cast<uint32_t>(dfd.size()));
+  writeValue<uint32_t>(out, static_cast<uint32_t>(kvdOffset));
+  writeValue<uint32_t>(out, static_cast<uint32_t>(kvd.size()));
+  writeValue<uint64_t>(out, 0);  // sgdByteOffset
+  writeValue<uint64_t>(out, 0);  // sgdByteLength
+
+  // Level index is patched once the data offsets are known
+  out.resize(dfdOffset, 0);
+  out.insert(out.end(), dfd.begin(), dfd.end());
+  out.insert(out.end(), kvd.begin(), kvd.end());
+
+  // Level data goes smallest first, each level aligned to the block size
+  std::vector<uint64_t> offsets(levelCount);
+  for (uint32_t level = levelCount; level-- > 0;) {
+    pad(out, 16);
+    offsets[level] = out.size();
+    out.insert(out.end(), mips[level].data.begin(), mips[level].data.end());
+  }
+
+  for (uint32_t level = 0; level < levelCount; level++) {
+    uint64_t entry[3] = {offsets[level], mips[level].data.size(), mips[level].data.size()};
+    std::memcpy(out.data() + levelIndexOffset + level * 24, entry, sizeof(entry));
+  }
+
+  return out;
+}
+
+bool CompressedImage::saveDDS(const std::string& filepath) const {
+  const uint32_t FlagCaps = 0x1, FlagHeight = 0x2, FlagWidth = 0x4, FlagPixelFormat = 0x1000;
+  const uint32_t FlagMipCount = 0x20000, FlagLinearSize = 0x80000;
+  const uint32_t CapsTexture = 0x1000, CapsMipmap = 0x400000, CapsComplex = 0x8;
+
+  std::vector<uint8_t> out;
+  writeValue<uint32_t>(out, fourCC('D', 'D', 'S', ' '));
+
+  bool hasMips = mips.size() > 1;
+  writeValue<uint32_t>(out, 124);
+  writeValue<uint32_t>(
+    out, FlagCaps | FlagHeight | FlagWidth | FlagPixelFormat | FlagLinearSize | (hasMips ? FlagMipCount : 0));
+  writeValue<uint32_t>(out, static_cast<uint32_t>(height));
+  writeValue<uint32_t>(out, static_cast<uint32_t>(width));
+  writeValue<uint32_t>(out, static_cast<uint32_t>(mips.empty() ? 0 : mips[0].data.size()));
+  writeValue<uint32_t>(out, 0);  // depth
+  writeValue<uint32_t>(out, static_cast<uint32_t>(mips.size()));
+  for (int i = 0; i < 11; i++) {
+    writeValue<uint32_t>(out, 0);
+  }
+
+  // Pixel format: always the DX10 extension so sRGB and BC7 survive
+  writeValue<uint32_t>(out, 32);
+  writeValue<uint32_t>(out, 0x4);
+  writeValue<uint32_t>(out, fourCC('D', 'X', '1', '0'));
+  for (int i = 0; i < 5; i++) {
+    writeValue<uint32_t>(out, 0);
+  }
+
+  writeValue<uint32_t>(out, CapsTexture | (hasMips ? CapsMipmap | CapsComplex : 0));
+  for (int i = 0; i < 4; i++) {
+    writeValue<uint32_t>(out, 0);
+  }
+
+  writeValue<uint32_t>(out, toDXGIFormat(format, srgb));
+  writeValue<uint32_t>(out, 3);  // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+  writeValue<uint32_t>(out, 0);
+  writeValue<uint32_t>(out, 1);  // arraySize
+  writeValue<uint32_t>(out, 0);
+
+  for (const auto& mip : mips) {
+    out.insert(out.end(), mip.data.begin(), mip.data.end());
+  }
+
+  return writeFile(filepath, out);
+}
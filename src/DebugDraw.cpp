@@ -0,0 +1,343 @@
+#include "../include/DebugDraw.hpp"
+#include "../include/Logger.hpp"
+
+#if MACHI_DEBUG_DRAW
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int CircleSegments = 32;
+
+struct Vertex {
+  glm::vec3 position;
+  uint32_t color;
+};
+static_assert(sizeof(Vertex) == DebugRenderer::VertexBytes, "Vertex layout mismatch");
+
+// What a vertex list holds and how it is drawn, one draw call each
+enum Stream { LinesTested, LinesOverlay, TrianglesTested, TrianglesOverlay, StreamCount };
+
+// What a thread's writer is doing, the renderer waits while it might still be in the half being read
+enum WriterState : unsigned { Idle = 0, ReadingParity = 1, WritingHalf = 2 };  // WritingHalf + parity
+
+// One thread's primitives. The renderer flips the frame parity before it reads, writers append to
+// the other half from then on.
+struct ThreadBuffer {
+  std::atomic<unsigned> state{Idle};
+  std::array<std::array<std::vector<Vertex>, StreamCount>, 2> frames;
+};
+
+struct Registry {
+  std::mutex mutex;  // Only taken when a thread draws for the first time, and by the renderer
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::atomic<unsigned> parity{0};
+};
+
+Registry& registry() {
+  static Registry instance;
+  return instance;
+}
+
+ThreadBuffer& threadBuffer() {
+  thread_local ThreadBuffer* buffer = nullptr;
+  if (!buffer) {
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.buffers.push_back(std::make_unique<ThreadBuffer>());
+    buffer = shared.buffers.back().get();
+  }
+  return *buffer;
+}
+
+// The calling thread's list for this frame, for as long as the writer lives
+class Writer {
+private:
+  ThreadBuffer& m_buffer;
+  std::vector<Vertex>* m_vertices;
+
+public:
+  explicit Writer(Stream stream) : m_buffer(threadBuffer()) {
+    // Announced before the parity is read, both sequentially consistent, so the renderer either
+    // sees this writer busy or the writer sees the new parity
+    m_buffer.state.store(ReadingParity);
+    const unsigned parity = registry().parity.load();
+    m_buffer.state.store(WritingHalf + parity);
+    m_vertices = &m_buffer.frames[parity][stream];
+  }
+  ~Writer() {
+    m_buffer.state.store(Idle, std::memory_order_release);
+  }
+
+  void add(const glm::vec3& position, uint32_t color) {
+    m_vertices->push_back({position, color});
+  }
+};
+
+Stream lineStream(DebugDepth depth) {
+  return depth == DebugDepth::Tested ? LinesTested : LinesOverlay;
+}
+
+uint32_t packColor(const glm::vec4& color) {
+  uint32_t packed = 0;
+  for (int c = 0; c < 4; c++) {
+    const auto channel = static_cast<uint32_t>(std::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    packed |= channel << (c * 8);
+  }
+  return packed;
+}
+
+// Corners numbered by bits, x in bit 0, y in bit 1, z in bit 2
+void addBoxEdges(const std::array<glm::vec3, 8>& corners, const glm::vec4& color, DebugDepth depth) {
+  static const int edges[12][2] = {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+  const uint32_t packed = packColor(color);
+  Writer writer(lineStream(depth));
+  for (const auto& edge : edges) {
+    writer.add(corners[edge[0]], packed);
+    writer.add(corners[edge[1]], packed);
+  }
+}
+}  // namespace
+
+namespace DebugDraw {
+void line(const glm::vec3& a, const glm::vec3& b, const glm::vec4& color, DebugDepth depth) {
+  const uint32_t packed = packColor(color);
+  Writer writer(lineStream(depth));
+  writer.add(a, packed);
+  writer.add(b, packed);
+}
+
+void triangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec4& color, DebugDepth depth) {
+  const uint32_t packed = packColor(color);
+  Writer writer(depth == DebugDepth::Tested ? TrianglesTested : TrianglesOverlay);
+  writer.add(a, packed);
+  writer.add(b, packed);
+  writer.add(c, packed);
+}
+
+void box(const AABB& box, const glm::vec4& color, DebugDepth depth) {
+  std::array<glm::vec3, 8> corners;
+  for (int i = 0; i < 8; i++) {
+    corners[i] = glm::vec3((i & 1) ? box.max.x : box.min.x,
+                           (i & 2) ? box.max.y : box.min.y,
+                           (i & 4) ? box.max.z : box.min.z);
+  }
+  addBoxEdges(corners, color, depth);
+}
+
+void box(const glm::mat4& transform, const AABB& box, const glm::vec4& color, DebugDepth depth) {
+  std::array<glm::vec3, 8> corners;
+  for (int i = 0; i < 8; i++) {
+    const glm::vec4 local((i & 1) ? box.max.x : box.min.x,
+                          (i & 2) ? box.max.y : box.min.y,
+                          (i & 4) ? box.max.z : box.min.z,
+                          1.0f);
+    corners[i] = glm::vec3(transform * local);
+  }
+  addBoxEdges(corners, color, depth);
+}
+
+void sphere(const glm::vec3& center, float radius, const glm::vec4& color, DebugDepth depth) {
+  const uint32_t packed = packColor(color);
+  Writer writer(lineStream(depth));
+  for (int axis = 0; axis < 3; axis++) {
+    glm::vec3 previous;
+    for (int i = 0; i <= CircleSegments; i++) {
+      const float angle = i * 6.2831853f / CircleSegments;
+      const float u = std::cos(angle) * radius;
+      const float v = std::sin(angle) * radius;
+      glm::vec3 point = center;
+      point[(axis + 1) % 3] += u;
+      point[(axis + 2) % 3] += v;
+      if (i > 0) {
+        writer.add(previous, packed);
+        writer.add(point, packed);
+      }
+      previous = point;
+    }
+  }
+}
+
+void frustum(const glm::mat4& viewProjection, const glm::vec4& color, DebugDepth depth) {
+  const glm::mat4 inverse = glm::inverse(viewProjection);
+  std::array<glm::vec3, 8> corners;
+  for (int i = 0; i < 8; i++) {
+    const glm::vec4 clip((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+    const glm::vec4 world = inverse * clip;
+    corners[i] = glm::vec3(world) / world.w;
+  }
+  addBoxEdges(corners, color, depth);
+}
+
+void axes(const glm::mat4& transform, float size, DebugDepth depth) {
+  const glm::vec3 origin(transform[3]);
+  for (int axis = 0; axis < 3; axis++) {
+    glm::vec4 color(0.0f, 0.0f, 0.0f, 1.0f);
+    color[axis] = 1.0f;
+    line(origin, origin + glm::normalize(glm::vec3(transform[axis])) * size, color, depth);
+  }
+}
+
+void cross(const glm::vec3& center, float size, const glm::vec4& color, DebugDepth depth) {
+  const uint32_t packed = packColor(color);
+  const float half = size * 0.5f;
+  Writer writer(lineStream(depth));
+  for (int axis = 0; axis < 3; axis++) {
+    glm::vec3 offset(0.0f);
+    offset[axis] = half;
+    writer.add(center - offset, packed);
+    writer.add(center + offset, packed);
+  }
+}
+}  // namespace DebugDraw
+
+DebugRenderer::DebugRenderer(ResidencyManager* residency) :
+ m_vao(0),
+ m_buffer(0),
+ m_capacity(VertexBytes * 4096),
+ m_residency(residency),
+ m_residencyId(-1) {
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_buffer);
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_capacity), nullptr, GL_STREAM_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VertexBytes, reinterpret_cast<void*>(0));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, VertexBytes, reinterpret_cast<void*>(12));
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  if (m_residency) {
+    m_residencyId = m_residency->add(ResidencyKind::Buffer, "debug draw vertices", m_capacity);
+  }
+}
+
+DebugRenderer::~DebugRenderer() {
+  glDeleteBuffers(1, &m_buffer);
+  glDeleteVertexArrays(1, &m_vao);
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->remove(m_residencyId);
+  }
+}
+
+void DebugRenderer::render(const Shader& shader, glm::mat4 viewProjection) {
+  // New primitives go to the other half from here on. A thread registers before it reads the
+  // parity, so every thread that could still have the old one is in the list taken after the flip.
+  Registry& shared = registry();
+  const unsigned parity = shared.parity.fetch_xor(1);
+  std::vector<ThreadBuffer*> buffers;
+  {
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (const auto& buffer : shared.buffers) {
+      buffers.push_back(buffer.get());
+    }
+  }
+  // Wait out appends that started before the flip, the ones writing the new half don't matter
+  for (ThreadBuffer* buffer : buffers) {
+    unsigned state = buffer->state.load();
+    while (state == ReadingParity || state == WritingHalf + parity) {
+      std::this_thread::yield();
+      state = buffer->state.load();
+    }
+  }
+
+  std::array<size_t, StreamCount> counts{};
+  for (ThreadBuffer* buffer : buffers) {
+    for (int stream = 0; stream < StreamCount; stream++) {
+      counts[stream] += buffer->frames[parity][stream].size();
+    }
+  }
+  size_t total = 0;
+  for (size_t count : counts) {
+    total += count;
+  }
+  m_stats.lines = (counts[LinesTested] + counts[LinesOverlay]) / 2;
+  m_stats.triangles = (counts[TrianglesTested] + counts[TrianglesOverlay]) / 3;
+  m_stats.drawCalls = 0;
+  m_stats.threads = static_cast<int>(buffers.size());
+  m_stats.streamBytes = total * VertexBytes;
+  if (total == 0) {
+    return;
+  }
+
+  // Every thread's lists, stream by stream, into one buffer
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  if (m_stats.streamBytes > m_capacity) {
+    while (m_capacity < m_stats.streamBytes) {
+      m_capacity *= 2;
+    }
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_capacity), nullptr, GL_STREAM_DRAW);
+    if (m_residency && m_residencyId >= 0) {
+      m_residency->resize(m_residencyId, m_capacity);
+    }
+  }
+  auto* mapped = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER,
+                                                        0,
+                                                        static_cast<GLsizeiptr>(m_stats.streamBytes),
+                                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  if (!mapped) {
+    LOG_ERROR("[DebugDraw] Failed to map the vertex buffer");
+  }
+  std::array<GLint, StreamCount> firsts{};
+  size_t offset = 0;
+  for (int stream = 0; stream < StreamCount; stream++) {
+    firsts[stream] = static_cast<GLint>(offset);
+    for (ThreadBuffer* buffer : buffers) {
+      std::vector<Vertex>& vertices = buffer->frames[parity][stream];
+      if (mapped && !vertices.empty()) {
+        std::memcpy(mapped + offset * VertexBytes, vertices.data(), vertices.size() * VertexBytes);
+      }
+      offset += vertices.size();
+      vertices.clear();
+    }
+  }
+  if (mapped) {
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  if (!mapped) {
+    return;
+  }
+
+  const GLboolean blending = glIsEnabled(GL_BLEND);
+  const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDepthMask(GL_FALSE);
+  shader.setMat4("viewProjection", viewProjection);
+  glBindVertexArray(m_vao);
+  for (int stream = 0; stream < StreamCount; stream++) {
+    if (counts[stream] == 0) {
+      continue;
+    }
+    if (stream == LinesTested || stream == TrianglesTested) {
+      glEnable(GL_DEPTH_TEST);
+    } else {
+      glDisable(GL_DEPTH_TEST);
+    }
+    const GLenum mode = stream == LinesTested || stream == LinesOverlay ? GL_LINES : GL_TRIANGLES;
+    glDrawArrays(mode, firsts[stream], static_cast<GLsizei>(counts[stream]));
+    m_stats.drawCalls++;
+  }
+  glBindVertexArray(0);
+  glDepthMask(GL_TRUE);
+  if (depthTest) {
+    glEnable(GL_DEPTH_TEST);
+  } else {
+    glDisable(GL_DEPTH_TEST);
+  }
+  if (!blending) {
+    glDisable(GL_BLEND);
+  }
+}
+
+#endif
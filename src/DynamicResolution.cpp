@@ -0,0 +1,78 @@
+#include "../include/DynamicResolution.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Weight of a new sample in the smoothed frame time
+constexpr float Smoothing = 0.2f;
+}  // namespace
+
+DynamicResolution::DynamicResolution(float minScale, float maxScale, float targetFPS, int latency) :
+ m_minScale(std::clamp(minScale, Step, 1.0f)),
+ m_maxScale(std::clamp(maxScale, m_minScale, 1.0f)),
+ m_budgetMs(1000.0f / std::max(targetFPS, 1.0f) * Headroom),
+ m_smoothedMs(0.0f),
+ m_overFrames(0),
+ m_underFrames(0),
+ m_cooldown(0),
+ m_latency(latency),
+ m_enabled(true) {
+  m_stats.scale = m_maxScale;
+  m_stats.budgetMs = m_budgetMs;
+}
+
+void DynamicResolution::setEnabled(bool enabled) {
+  m_enabled = enabled;
+  if (!enabled) {
+    setScale(m_maxScale);
+  }
+}
+
+void DynamicResolution::setScale(float scale) {
+  scale = std::clamp(std::round(scale / Step) * Step, m_minScale, m_maxScale);
+  if (scale == m_stats.scale) {
+    return;
+  }
+  LOG_INFO_F("[DynamicResolution] Scale {:.2f} -> {:.2f} ({:.2f}ms GPU, {:.2f}ms budget)",
+             m_stats.scale,
+             scale,
+             m_smoothedMs,
+             m_budgetMs);
+  m_stats.scale = scale;
+  m_stats.changes++;
+  m_overFrames = 0;
+  m_underFrames = 0;
+  // Times measured before the change reflect the old resolution
+  m_cooldown = m_latency + 2;
+}
+
+void DynamicResolution::update(float gpuMs) {
+  m_smoothedMs = m_smoothedMs == 0.0f ? gpuMs : m_smoothedMs + (gpuMs - m_smoothedMs) * Smoothing;
+  m_stats.gpuMs = m_smoothedMs;
+  if (!m_enabled) {
+    return;
+  }
+  if (m_cooldown > 0) {
+    m_cooldown--;
+    m_smoothedMs = gpuMs;
+    return;
+  }
+
+  m_overFrames = m_smoothedMs > m_budgetMs ? m_overFrames + 1 : 0;
+  m_underFrames = m_smoothedMs < m_budgetMs * LowerThreshold ? m_underFrames + 1 : 0;
+  if (m_overFrames >= OverFrames) {
+    // The cost of a fill-bound frame follows the pixel count, the scale applies to both axes. Rounded
+    // down so a small overshoot still takes a whole step.
+    const float target = m_stats.scale * std::sqrt(m_budgetMs / m_smoothedMs);
+    setScale(std::min(std::floor(target / Step) * Step, m_stats.scale - Step));
+  } else if (m_underFrames >= UnderFrames) {
+    setScale(m_stats.scale + Step);
+    m_underFrames = 0;
+  }
+}
+
+int DynamicResolution::scaled(int size) const {
+  return std::max(1, static_cast<int>(std::lround(size * m_stats.scale)));
+}
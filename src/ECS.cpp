@@ -0,0 +1,381 @@
+#include "../include/ECS.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+namespace {
+constexpr size_t ChunkAlignment = 64;  // Every component array starts on a cache line
+
+struct ComponentInfo {
+  size_t size;
+  size_t alignment;
+  const char* name;
+};
+
+// Fixed storage so readers never race a registration that grows it
+std::array<ComponentInfo, ECS::MaxComponents> componentInfos;
+std::atomic<ComponentId> componentCount{0};
+std::mutex componentMutex;
+
+size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+uint8_t* allocateChunk() {
+  return static_cast<uint8_t*>(::operator new(World::ChunkBytes, std::align_val_t(ChunkAlignment)));
+}
+}  // namespace
+
+namespace ECS {
+ComponentId registerComponent(size_t size, size_t alignment, const char* name) {
+  std::lock_guard<std::mutex> lock(componentMutex);
+  const ComponentId id = componentCount.load(std::memory_order_relaxed);
+  if (id >= MaxComponents) {
+    LOG_ERROR_F("[ECS] Too many component types, {} does not fit", name);
+    throw std::length_error("ECS component limit reached");
+  }
+  componentInfos[id] = {size, alignment, name};
+  componentCount.store(id + 1, std::memory_order_release);
+  return id;
+}
+
+size_t componentSize(ComponentId id) {
+  return componentInfos[id].size;
+}
+
+const char* componentName(ComponentId id) {
+  return componentInfos[id].name;
+}
+}  // namespace ECS
+
+World::Archetype::~Archetype() {
+  for (uint8_t* chunk : chunks) {
+    ::operator delete(chunk, std::align_val_t(ChunkAlignment));
+  }
+}
+
+World::World() : m_entityCount(0), m_locked(false) {
+  findArchetype(0);  // Entities without components
+}
+
+uint32_t World::findArchetype(ComponentMask mask) {
+  const auto found = m_archetypeLookup.find(mask);
+  if (found != m_archetypeLookup.end()) {
+    return found->second;
+  }
+
+  auto archetype = std::make_unique<Archetype>();
+  archetype->mask = mask;
+  archetype->columns.assign(ECS::MaxComponents, -1);
+  archetype->addEdges.assign(ECS::MaxComponents, -1);
+  archetype->removeEdges.assign(ECS::MaxComponents, -1);
+  size_t rowBytes = sizeof(Entity);
+  for (ComponentId id = 0; id < ECS::MaxComponents; id++) {
+    if (mask & (ComponentMask(1) << id)) {
+      archetype->columns[id] = static_cast<int>(archetype->components.size());
+      archetype->components.push_back(id);
+      archetype->sizes.push_back(ECS::componentSize(id));
+      rowBytes += ECS::componentSize(id);
+    }
+  }
+
+  // As many rows as fit once every array is padded to the next cache line
+  const size_t padding = ChunkAlignment * (archetype->components.size() + 1);
+  archetype->capacity = ChunkBytes > padding + rowBytes ? (ChunkBytes - padding) / rowBytes : 0;
+  if (archetype->capacity == 0) {
+    LOG_ERROR_F("[ECS] Components of {} bytes per entity do not fit in a chunk", rowBytes);
+    throw std::length_error("ECS archetype too large for a chunk");
+  }
+  size_t offset = alignUp(archetype->capacity * sizeof(Entity), ChunkAlignment);
+  for (size_t size : archetype->sizes) {
+    archetype->offsets.push_back(offset);
+    offset = alignUp(offset + archetype->capacity * size, ChunkAlignment);
+  }
+
+  const auto index = static_cast<uint32_t>(m_archetypes.size());
+  m_archetypes.push_back(std::move(archetype));
+  m_archetypeLookup[mask] = index;
+  return index;
+}
+
+uint32_t World::neighbour(uint32_t archetype, ComponentId component, bool adding) {
+  std::vector<int>& edges = adding ? m_archetypes[archetype]->addEdges : m_archetypes[archetype]->removeEdges;
+  if (edges[component] < 0) {
+    const ComponentMask bit = ComponentMask(1) << component;
+    const ComponentMask mask = m_archetypes[archetype]->mask;
+    // findArchetype can grow m_archetypes, don't hold on to the edge reference across it
+    const uint32_t target = findArchetype(adding ? mask | bit : mask & ~bit);
+    std::vector<int>& current = adding ? m_archetypes[archetype]->addEdges : m_archetypes[archetype]->removeEdges;
+    current[component] = static_cast<int>(target);
+    return target;
+  }
+  return static_cast<uint32_t>(edges[component]);
+}
+
+uint32_t World::allocateRow(uint32_t index, Entity entity) {
+  Archetype& archetype = *m_archetypes[index];
+  const size_t row = archetype.count;
+  if (row == archetype.chunks.size() * archetype.capacity) {
+    archetype.chunks.push_back(allocateChunk());
+  }
+  archetype.entities(row / archetype.capacity)[row % archetype.capacity] = entity;
+  archetype.count++;
+  return static_cast<uint32_t>(row);
+}
+
+void World::freeRow(uint32_t index, uint32_t row) {
+  Archetype& archetype = *m_archetypes[index];
+  const size_t last = archetype.count - 1;
+  if (row != last) {
+    const Entity moved = archetype.entities(last / archetype.capacity)[last % archetype.capacity];
+    archetype.entities(row / archetype.capacity)[row % archetype.capacity] = moved;
+    for (size_t column = 0; column < archetype.components.size(); column++) {
+      std::memcpy(archetype.component(row, static_cast<int>(column)),
+                  archetype.component(last, static_cast<int>(column)),
+                  archetype.sizes[column]);
+    }
+    m_records[moved.index].row = row;
+  }
+  archetype.count--;
+
+  // Keep a spare chunk so an entity moving back and forth doesn't allocate every time
+  while (archetype.chunks.size() > archetype.usedChunks() + 1) {
+    ::operator delete(archetype.chunks.back(), std::align_val_t(ChunkAlignment));
+    archetype.chunks.pop_back();
+  }
+}
+
+void World::move(Entity entity, uint32_t target) {
+  Record& record = m_records[entity.index];
+  const uint32_t source = record.archetype;
+  const uint32_t sourceRow = record.row;
+  const uint32_t targetRow = allocateRow(target, entity);
+
+  const Archetype& from = *m_archetypes[source];
+  const Archetype& to = *m_archetypes[target];
+  for (size_t column = 0; column < to.components.size(); column++) {
+    const int shared = from.columns[to.components[column]];
+    uint8_t* destination = to.component(targetRow, static_cast<int>(column));
+    if (shared >= 0) {
+      std::memcpy(destination, from.component(sourceRow, shared), to.sizes[column]);
+    } else {
+      std::memset(destination, 0, to.sizes[column]);
+    }
+  }
+
+  freeRow(source, sourceRow);
+  record.archetype = target;
+  record.row = targetRow;
+}
+
+bool World::checkUnlocked(const char* operation) const {
+  if (m_locked) {
+    LOG_ERROR_F("[ECS] {} while systems are running, record it in the system's command buffer", operation);
+    return false;
+  }
+  return true;
+}
+
+const World::Record* World::find(Entity entity) const {
+  if (entity.index >= m_records.size()) {
+    return nullptr;
+  }
+  const Record& record = m_records[entity.index];
+  return record.alive && record.generation == entity.generation ? &record : nullptr;
+}
+
+Entity World::create(ComponentMask mask) {
+  if (!checkUnlocked("Creating an entity")) {
+    return {};
+  }
+  uint32_t index;
+  if (!m_freeRecords.empty()) {
+    index = m_freeRecords.back();
+    m_freeRecords.pop_back();
+  } else {
+    index = static_cast<uint32_t>(m_records.size());
+    m_records.emplace_back();
+  }
+
+  Record& record = m_records[index];
+  const Entity entity{index, record.generation};
+  record.archetype = findArchetype(mask);
+  record.row = allocateRow(record.archetype, entity);
+  record.alive = true;
+
+  const Archetype& archetype = *m_archetypes[record.archetype];
+  for (size_t column = 0; column < archetype.components.size(); column++) {
+    std::memset(archetype.component(record.row, static_cast<int>(column)), 0, archetype.sizes[column]);
+  }
+  m_entityCount++;
+  return entity;
+}
+
+void World::destroy(Entity entity) {
+  if (!checkUnlocked("Destroying an entity") || !find(entity)) {
+    return;
+  }
+  Record& record = m_records[entity.index];
+  freeRow(record.archetype, record.row);
+  record.alive = false;
+  // Generations skip the placeholder value command buffers use
+  record.generation = record.generation + 1 == CommandBuffer::PendingGeneration ? 1 : record.generation + 1;
+  m_freeRecords.push_back(entity.index);
+  m_entityCount--;
+}
+
+void* World::add(Entity entity, ComponentId component) {
+  if (!checkUnlocked("Adding a component") || !find(entity)) {
+    return nullptr;
+  }
+  const Record& record = m_records[entity.index];
+  if (!(m_archetypes[record.archetype]->mask & (ComponentMask(1) << component))) {
+    move(entity, neighbour(record.archetype, component, true));
+  }
+  const Archetype& archetype = *m_archetypes[record.archetype];
+  return archetype.component(record.row, archetype.columns[component]);
+}
+
+void World::remove(Entity entity, ComponentId component) {
+  if (!checkUnlocked("Removing a component") || !find(entity)) {
+    return;
+  }
+  const Record& record = m_records[entity.index];
+  if (m_archetypes[record.archetype]->mask & (ComponentMask(1) << component)) {
+    move(entity, neighbour(record.archetype, component, false));
+  }
+}
+
+void* World::get(Entity entity, ComponentId component) const {
+  const Record* record = find(entity);
+  if (!record) {
+    return nullptr;
+  }
+  const Archetype& archetype = *m_archetypes[record->archetype];
+  const int column = archetype.columns[component];
+  return column >= 0 ? archetype.component(record->row, column) : nullptr;
+}
+
+void World::apply(CommandBuffer& commands) {
+  if (!checkUnlocked("Applying commands")) {
+    return;
+  }
+  std::vector<Entity> created(commands.m_pending);
+  auto resolve = [&created](Entity entity) {
+    return entity.generation == CommandBuffer::PendingGeneration ? created[entity.index] : entity;
+  };
+
+  const std::vector<CommandBuffer::Command>& list = commands.m_commands;
+  size_t i = 0;
+  while (i < list.size()) {
+    const CommandBuffer::Command& command = list[i];
+    switch (command.op) {
+      case CommandBuffer::Op::Create: {
+        // The adds that follow go straight into the final archetype
+        size_t end = i + 1;
+        ComponentMask mask = 0;
+        while (end < list.size() && list[end].op == CommandBuffer::Op::Add && list[end].entity == command.entity) {
+          mask |= ComponentMask(1) << list[end].component;
+          end++;
+        }
+        const Entity entity = create(mask);
+        created[command.entity.index] = entity;
+        for (size_t j = i + 1; j < end; j++) {
+          std::memcpy(get(entity, list[j].component),
+                      &commands.m_data[list[j].offset],
+                      ECS::componentSize(list[j].component));
+        }
+        i = end;
+        continue;
+      }
+      case CommandBuffer::Op::Destroy:
+        destroy(resolve(command.entity));
+        break;
+      case CommandBuffer::Op::Add:
+        if (void* storage = add(resolve(command.entity), command.component)) {
+          std::memcpy(storage, &commands.m_data[command.offset], ECS::componentSize(command.component));
+        }
+        break;
+      case CommandBuffer::Op::Remove:
+        remove(resolve(command.entity), command.component);
+        break;
+    }
+    i++;
+  }
+  commands.clear();
+}
+
+WorldStats World::getStats() const {
+  WorldStats stats;
+  stats.entities = m_entityCount;
+  stats.archetypes = m_archetypes.size();
+  for (const auto& archetype : m_archetypes) {
+    stats.chunks += archetype->chunks.size();
+  }
+  stats.chunkBytes = stats.chunks * ChunkBytes;
+  return stats;
+}
+
+void SystemScheduler::add(const std::string& name, const Access& access, Function function) {
+  System system;
+  system.name = name;
+  system.access = access;
+  system.function = std::move(function);
+  for (const System& earlier : m_systems) {
+    if (access.conflicts(earlier.access)) {
+      system.stage = std::max(system.stage, earlier.stage + 1);
+    }
+  }
+  if (system.stage >= static_cast<int>(m_stages.size())) {
+    m_stages.resize(system.stage + 1);
+  }
+  m_stages[system.stage].push_back(m_systems.size());
+  m_systems.push_back(std::move(system));
+}
+
+void SystemScheduler::runSystem(System& system, World& world, JobSystem* jobs, float deltaTime) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  SystemContext context{world, system.commands, jobs, deltaTime};
+  system.function(context);
+  const std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+  system.ms = elapsed.count();
+}
+
+void SystemScheduler::run(World& world, JobSystem* jobs, float deltaTime) {
+  for (const std::vector<size_t>& stage : m_stages) {
+    world.m_locked = true;
+    if (stage.size() == 1 || !jobs) {
+      // Alone in its stage a system gets the job system for its own parallel loops
+      for (size_t index : stage) {
+        runSystem(m_systems[index], world, stage.size() == 1 ? jobs : nullptr, deltaTime);
+      }
+    } else {
+      jobs->parallelFor(stage.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          runSystem(m_systems[stage[i]], world, nullptr, deltaTime);
+        }
+      });
+    }
+    world.m_locked = false;
+
+    // Sync point
+    for (size_t index : stage) {
+      world.apply(m_systems[index].commands);
+    }
+  }
+}
+
+std::vector<SystemTiming> SystemScheduler::getTimings() const {
+  std::vector<SystemTiming> timings;
+  timings.reserve(m_systems.size());
+  for (const System& system : m_systems) {
+    timings.push_back({system.name, system.stage, system.ms});
+  }
+  return timings;
+}
@@ -1,4 +1,5 @@
 #include "../include/Engine.hpp"
+#include "../include/ImageIO.hpp"
 #include "../include/Logger.hpp"
 #include "../include/Shader.hpp"
 // #include "../include/Utils.hpp"
@@ -6,13 +7,19 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/fwd.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iomanip>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -20,6 +27,36 @@ glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
+namespace {
+// Components of the demo swarm
+struct Position {
+  glm::vec3 value;
+};
+
+struct Velocity {
+  glm::vec3 value;
+};
+
+struct Lifetime {
+  float remaining;
+};
+
+// xorshift32, the swarm only needs cheap noise
+float randomUnit(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return static_cast<float>(state >> 8) / 16777216.0f;
+}
+
+glm::vec3 randomDirection(uint32_t& state) {
+  return glm::vec3(randomUnit(state), randomUnit(state), randomUnit(state)) * 2.0f - 1.0f;
+}
+
+// Longer frames (startup, a breakpoint, dragging the window) are simulated as this long
+constexpr float MaxFrameTime = 0.1f;
+}  // namespace
+
 Engine::Engine(const EngineConfig& config) :
  m_config(config),
  m_isInitialized(false),
@@ -29,11 +66,25 @@ Engine::Engine(const EngineConfig& config) :
  m_lastFrame(0.0f),
  m_currentFrame(0.0f),
  m_totalTime(0.0f),
- m_frameCount(0.0f),
+ m_frameCount(0),
+ m_frameIndex(0),
  m_fps(0.0f),
  m_fpsUpdateTimer(0.0f),
+ m_exitCode(0),
+ m_showHud(config.showHud && config.goldenImage.empty()),
+ m_swarmBounds(AABB::empty()),
+ m_debugView(DebugView::None),
  m_windowManager(nullptr),
- m_eventManager(nullptr)
+ m_eventManager(nullptr),
+ m_scene(std::make_unique<Scene>()),
+ m_occlusionCuller(std::make_unique<OcclusionCuller>(config.occlusionBufferWidth, config.occlusionBufferHeight)),
+ m_lodSelector(std::make_unique<LODSelector>(config.lodPixelError, config.lodHysteresis)),
+ m_residency(std::make_unique<ResidencyManager>(config.gpuMemoryBudget)),
+ m_meshManager(std::make_unique<MeshManager>(m_residency.get())),
+ m_resourceManager(std::make_unique<ResourceManager>(m_residency.get())),
+ m_jobSystem(std::make_unique<JobSystem>(config.workerThreads)),
+ m_asyncIO(std::make_unique<AsyncIO>(config.ioThreads)),
+ m_viewProjection(1.0f)
 // m_currentScene(nullptr),
 // m_nextScene(nullptr)
 {
@@ -59,6 +110,7 @@ Engine::Engine(const std::string& title, int width, int height) : Engine(EngineC
 Engine::~Engine() {
   LOG_INFO("[Engine] Engine shuttingdown");
   shutdown();
+  shutdownSystems();
 }
 
 bool Engine::initialize() {
@@ -77,11 +129,14 @@ bool Engine::initialize() {
       LOG_ERROR("[Engine] Failed to initialize window system!");
       return false;
     }
-    // TODO: did something here but I can't remember why so I will ahve to look at it later
-    // if (!initializeRenderingSystem()) {
-    //   LOG_ERROR("[Engine] Failed to initialize rendering system!");
-    //   return false;
-    // }
+    // Mounted before anything loads, the loaders check it before going to the loose files
+    mountAssetPack();
+
+    // Everything that owns GL objects is created here, right after the context
+    if (!initializeRenderingSystem()) {
+      LOG_ERROR("[Engine] Failed to initialize rendering system!");
+      return false;
+    }
 
     if (!initializeEventSystem()) {
       LOG_ERROR("[Engine] Failed to initialize input system!");
@@ -121,6 +176,7 @@ bool Engine::initializeWindowSystem() {
   windowConfig.fullscreen = m_config.fullscreen;
   windowConfig.vsync = m_config.vsync;
   windowConfig.samples = m_config.msaaSamples;
+  windowConfig.visible = !m_config.hiddenWindow;
 
   m_windowManager = std::make_unique<WindowManager>(windowConfig);
 
@@ -142,6 +198,21 @@ bool Engine::initializeWindowSystem() {
   return true;
 };
 
+void Engine::mountAssetPack() {
+  if (m_config.assetPack.empty() || !std::filesystem::exists(m_config.assetPack)) {
+    LOG_INFO_F("[Engine] No asset pack at '{}', loading loose files", m_config.assetPack);
+    return;
+  }
+  m_assetPack = std::make_unique<PackFile>();
+  if (!m_assetPack->open(m_config.assetPack, m_config.assetRoot)) {
+    // Still runs from the loose files, just slower, so this doesn't fail initialization
+    LOG_WARNING_F("[Engine] Failed to mount asset pack '{}', loading loose files", m_config.assetPack);
+    m_assetPack.reset();
+    return;
+  }
+  PackFile::mount(m_assetPack.get());
+}
+
 bool Engine::initializeRenderingSystem() {
   LOG_INFO("[Engine] Initializing rendering system...");
   // Set up basic OpenGL state based on our configuration
@@ -153,6 +224,43 @@ bool Engine::initializeRenderingSystem() {
   auto [width, height] = m_windowManager->getSize();
   glViewport(0, 0, width, height);
 
+  m_shaderCache = std::make_unique<ShaderCache>(m_config.shaderCacheDirectory);
+  m_resourceManager->setShaderCache(m_shaderCache.get());
+  if (Shader::enableParallelCompile()) {
+    LOG_INFO("[Engine] Shader variants compile in the background");
+  }
+  if (!m_config.shaderWarmUpList.empty() && std::filesystem::exists(m_config.shaderWarmUpList)) {
+    m_resourceManager->warmUpShaders(m_config.shaderWarmUpList);
+  }
+
+  m_textureStreamer =
+    std::make_unique<TextureStreamer>(*m_jobSystem, m_asyncIO.get(), m_residency.get(), m_config.textureUploadBudget);
+  m_texturePool = std::make_unique<TexturePool>(
+    m_config.textureArrayLayers, 1024, 128, m_config.bindlessTextures, m_residency.get());
+  m_materials = std::make_unique<MaterialTable>(*m_texturePool, m_residency.get());
+  m_lighting = std::make_unique<ClusteredLighting>(m_jobSystem.get(), m_residency.get());
+  m_shadows = std::make_unique<ShadowMaps>(m_config.shadowMapSize,
+                                           m_config.shadowCascades,
+                                           m_config.shadowCascades - m_config.shadowCachedCascades,
+                                           m_config.shadowDistance,
+                                           m_residency.get());
+  m_shadows->setLightDirection(m_config.sunDirection);
+  m_shadows->setRefreshInterval(m_config.shadowRefreshInterval);
+  m_particles = std::make_unique<ParticleSystem>(m_jobSystem.get(), m_residency.get());
+  m_profiler = std::make_unique<Profiler>();
+  m_renderGraph = std::make_unique<RenderGraph>(m_residency.get());
+  m_dynamicResolution = std::make_unique<DynamicResolution>(
+    m_config.minResolutionScale, m_config.maxResolutionScale, m_config.targetFPS, Profiler::Latency);
+  // A reference image test needs the same frame every run
+  m_dynamicResolution->setEnabled(m_config.dynamicResolution && m_config.goldenImage.empty());
+  m_capture = std::make_unique<FrameCapture>(*m_jobSystem, m_residency.get());
+  m_font = std::make_unique<FontAtlas>(m_residency.get());
+  m_sprites = std::make_unique<SpriteBatch>(m_residency.get());
+  m_debugRenderer = std::make_unique<DebugRenderer>(m_residency.get());
+  if (!m_config.hudFont.empty()) {
+    m_font->load(m_config.hudFont, m_jobSystem.get());
+  }
+
   LOG_INFO("[Engine] Rendering system initialized successfully");
   return true;
 }
@@ -176,8 +284,30 @@ bool Engine::initializeEventSystem() {
         case GLFW_KEY_F1:
           printFrameStats();
           break;
+        case GLFW_KEY_F3:
+          m_dynamicResolution->setEnabled(!m_dynamicResolution->isEnabled());
+          LOG_INFO_F("[Engine] F3 pressed - dynamic resolution {}", m_dynamicResolution->isEnabled() ? "on" : "off");
+          break;
+        case GLFW_KEY_F4:
+          m_showHud = !m_showHud;
+          LOG_INFO_F("[Engine] F4 pressed - HUD {}", m_showHud ? "on" : "off");
+          break;
+        case GLFW_KEY_F5:
+          cycleDebugView();
+          break;
+        case GLFW_KEY_F11:
+          toggleRecording();
+          break;
+        case GLFW_KEY_F12:
+          captureScreenshot();
+          break;
       }
     }
+
+    if (event.type == EventType::MousePress && event.data.mouse.button == GLFW_MOUSE_BUTTON_LEFT && m_isRunning) {
+      auto [mouseX, mouseY] = m_inputManager->getMousePosition();
+      pickObject(mouseX, mouseY);
+    }
   });
 
   LOG_INFO("[Engine] Input system intialized successfully");
@@ -197,9 +327,39 @@ void Engine::run() {
   }
 
   glEnable(GL_DEPTH_TEST);
+  // Color textures are sampled as sRGB (decoded to linear), so the output has to be encoded again
+  glEnable(GL_FRAMEBUFFER_SRGB);
 
   // INFO: --> Shader test starts here
-  Shader shader("../resources/shaders/main.vert.glsl", "../resources/shaders/main.frag.glsl");
+  ResourceManager::ShaderRef shaderRef =
+    m_resourceManager->loadShader("../resources/shaders/main.vert.glsl", "../resources/shaders/main.frag.glsl");
+  if (!shaderRef) {
+    LOG_ERROR("[Engine] Cannot run - main shader failed to build");
+    return;
+  }
+  Shader& shader = *shaderRef;
+  // Depth only, the scene is drawn without shadows if it doesn't build
+  ResourceManager::ShaderRef shadowShader =
+    m_resourceManager->loadShader("../resources/shaders/shadow.vert.glsl", "../resources/shaders/shadow.frag.glsl");
+  // Scales the offscreen scene color up to the window
+  ResourceManager::ShaderRef upscaleShader = m_resourceManager->loadShader(
+    "../resources/shaders/fullscreen.vert.glsl", "../resources/shaders/upscale.frag.glsl");
+  // The scene is drawn without particles if it doesn't build
+  ResourceManager::ShaderRef particleShader = m_resourceManager->loadShader(
+    "../resources/shaders/particle.vert.glsl", "../resources/shaders/particle.frag.glsl");
+  // Same for the HUD
+  ResourceManager::ShaderRef spriteShader =
+    m_resourceManager->loadShader("../resources/shaders/sprite.vert.glsl", "../resources/shaders/sprite.frag.glsl");
+#if MACHI_DEBUG_DRAW
+  // And for DebugDraw
+  ResourceManager::ShaderRef debugShader =
+    m_resourceManager->loadShader("../resources/shaders/debug.vert.glsl", "../resources/shaders/debug.frag.glsl");
+#endif
+  // A second launch with a warm cache should load every one of these from a binary
+  if (m_shaderCache->isSupported()) {
+    const ShaderCacheStats& cache = m_shaderCache->getStats();
+    LOG_INFO_F("[Engine] Startup shaders: {} loaded from the binary cache, {} compiled", cache.hits, cache.misses);
+  }
 
   // VAOs, VBOs, EBOs
   // clang-format off
@@ -259,45 +419,71 @@ void Engine::run() {
     glm::vec3(1.5f, 0.2f, -1.5f),
     glm::vec3(-1.3f, 1.0f, -1.5f)
   };
-
-  unsigned int indices[] = {  
-    0, 1, 3,
-    1, 2, 3
-  };
   // clang-format on
 
-  unsigned int vao, vbo, ebo;
-  glGenVertexArrays(1, &vao);
-  glGenBuffers(1, &vbo);
-  glGenBuffers(1, &ebo);
-
-  // vao
-  glBindVertexArray(vao);
-
-  // vbo
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  // ebo
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+  // Welded, simplified into LODs and reordered for the vertex cache on load
+  const Mesh* cubeMesh = m_meshManager->load("cube", MeshData::fromInterleaved(vertices, 36));
 
-  // position attribute
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), nullptr);
-  glEnableVertexAttribArray(0);
+  // Each material's parameters go into the material table and its maps into the texture pool
+  const int materials[] = {
+    m_materials->load("../resources/textures/wood_oak_texture/Poliigon_WoodVeneerOak_7760.mtlx"),
+    m_materials->load("../resources/textures/wood_texture/wood_texture.mtlx"),
+  };
 
-  // texture attribute
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
+  // The cubes are entities, the scene gives each of them an object so they can be culled and picked
+  // through the BVH
+  World& world = m_scene->getWorld();
+  Entity cubes[10];
+  for (unsigned int i = 0; i < 10; i++) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, cubePositions[i]);
+    float angle = 20.0f * i;
+    model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    cubes[i] = world.create(Transform{model}, MeshRenderer{cubeMesh, std::max(materials[i % 2], 0), true}, SceneLink{});
+  }
+  m_scene->addEntities();
+  auto cubeOccluder = std::make_shared<const OccluderMesh>(OccluderMesh::fromBox(cubeMesh->getBounds()));
+  for (Entity cube : cubes) {
+    m_scene->setOccluder(world.get<SceneLink>(cube)->objectId, cubeOccluder);
+  }
+  m_scene->buildHierarchy();
+
+  // Colored point lights spread through the cubes' volume, each only shades the clusters it reaches
+  for (int i = 0; i < m_config.demoLights; i++) {
+    const float t = (i + 0.5f) / m_config.demoLights;
+    const float angle = i * 2.39996f;  // Golden angle, spreads them without clumping
+    PointLight light;
+    light.position = glm::vec3(std::cos(angle) * (1.0f + 5.0f * t), 6.0f * std::sin(i * 0.7f), 2.0f - 16.0f * t);
+    light.radius = 2.5f;
+    light.color = glm::vec3(0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::cos(angle + 2.1f),
+                            0.5f + 0.5f * std::cos(angle + 4.2f));
+    light.intensity = 2.0f;
+    m_lighting->addLight(light);
+  }
 
-  // Load and create texture
-  Texture texture0(0, "../resources/textures/wood_texture/wood_texture.png");
-  Texture texture1(1, "../resources/textures/awesomeface.png");
+  // Fountains in a ring around the cubes, together keeping about demoParticles alive
+  const int fountains = 16;
+  for (int i = 0; i < fountains && m_config.demoParticles > 0; i++) {
+    const float angle = i * 6.28318f / fountains;
+    ParticleEmitter emitter;
+    emitter.position = glm::vec3(std::cos(angle) * 6.0f, -4.0f, -6.0f + std::sin(angle) * 6.0f);
+    emitter.velocity = glm::vec3(0.0f, 7.0f, 0.0f);
+    emitter.velocitySpread = 1.5f;
+    emitter.minLifetime = 1.0f;
+    emitter.maxLifetime = 2.0f;
+    emitter.rate = m_config.demoParticles / (fountains * 1.5f);  // Live = rate * mean lifetime
+    emitter.capacity = static_cast<int>(emitter.rate * emitter.maxLifetime) + 1;
+    const glm::vec3 color(0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::cos(angle + 2.1f),
+                          0.5f + 0.5f * std::cos(angle + 4.2f));
+    emitter.startColor = glm::vec4(color, 0.5f);
+    emitter.endColor = glm::vec4(color * 0.5f, 0.0f);
+    m_particles->addEmitter(emitter);
+  }
+  createDemoEntities();
 
   // Use Shader
   shader.use();
-  shader.setInt("texture0", 0);
-  shader.setInt("texture1", 1);
+  const GLint materialLocation = glGetUniformLocation(shader.m_id, "materialIndex");
 
   // INFO: --> Shader test ends here
   LOG_INFO("[ENGINE] starting main engine loop...");
@@ -310,8 +496,9 @@ void Engine::run() {
   LOG_INFO_F("checking the window config frame: {} x {}", m_config.windowWidth, m_config.windowHeight);
   auto start_time = std::chrono::high_resolution_clock::now();
 
-  glm::mat4 projection =
-    glm::perspective(glm::radians(45.0f), (float)m_config.windowWidth / (float)m_config.windowHeight, 0.1f, 100.0f);
+  const float fovY = glm::radians(45.0f);
+  const float aspect = (float)m_config.windowWidth / (float)m_config.windowHeight;
+  glm::mat4 projection = glm::perspective(fovY, aspect, 0.1f, 100.0f);
   shader.setMat4("projection", projection);
   float yaw = -90.0f;
   float pitch = -90.0f;
@@ -321,26 +508,38 @@ void Engine::run() {
   direction.y = sin(glm::radians(pitch));
   direction.z = sin(glm::radians(yaw) * cos(glm::radians(pitch)));
 
+  // The first frame measures from here rather than from 0, which would be the whole startup
+  m_lastFrame = static_cast<float>(glfwGetTime());
   while (m_isRunning && !m_windowManager->shouldClose()) {
-    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
-    m_currentFrame = std::chrono::duration<float>(now).count();
-    m_deltaTime = m_currentFrame - m_lastFrame;
+    m_currentFrame = static_cast<float>(glfwGetTime());
+    m_deltaTime = std::clamp(m_currentFrame - m_lastFrame, 0.0f, MaxFrameTime);
     m_lastFrame = m_currentFrame;
 
     processEvents();
     if (!m_isRunning)
       break;
+    m_profiler->beginFrame();
+    // The newest measured GPU frame decides the resolution of this one
+    if (const ProfileTiming* frameTiming = m_profiler->find("Frame")) {
+      m_dynamicResolution->update(frameTiming->lastGpuMs);
+    }
+    const int frameWidth = m_windowManager->getConfig().width;
+    const int frameHeight = m_windowManager->getConfig().height;
+    const int renderWidth = m_dynamicResolution->scaled(frameWidth);
+    const int renderHeight = m_dynamicResolution->scaled(frameHeight);
     // keyTest(m_windowManager->getWindow());
 
-    glClearColor(0.1, 0.0, 0.5, 1.0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // bind Texture
-    texture0.bindTexture();
-    texture1.bindTexture();
+    // Finished reads hand their data on, then whatever finished decoding is uploaded and the finest
+    // resident mips are bound
+    m_asyncIO->poll();
+    m_resourceManager->updateShaders();
+    m_residency->beginFrame();
+    m_textureStreamer->update();
 
     // Activate Shader & Create transformations
     shader.use();
+    m_materials->upload();
+    m_materials->bind(shader);
     //
     // glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
     // glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
@@ -357,19 +556,217 @@ void Engine::run() {
     view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
     shader.setMat4("view", view);
 
-    glBindVertexArray(vao);
-    for (unsigned int i = 0; i < 10; i++) {
-      glm::mat4 model = glm::mat4(1.0f);
-      model = glm::translate(model, cubePositions[i]);
-      float angle = 20.0f * i;
-      // model = glm::rotate(model, dt_seconds * glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      shader.setMat4("model", model);
+    // Lights are binned against this frame's clusters before anything is drawn
+    m_profiler->push("Light binning");
+    m_lighting->update(view, fovY, aspect, 0.1f, 100.0f);
+    m_profiler->pop();
+    m_lighting->bind(shader, renderWidth, renderHeight);
+    shader.setVec3("cameraPosition", cameraPos);
+    shader.setVec3("ambientLight", m_config.ambientLight);
+    shader.setVec3("sunDirection", glm::normalize(m_config.sunDirection));
+    shader.setVec3("sunColor", m_config.sunColor);
+
+    // Systems of the scene's world, the ones that don't conflict run side by side on the workers
+    m_profiler->push("ECS systems");
+    m_systems.run(m_scene->getWorld(),
+                  m_jobSystem.get(),
+                  m_config.goldenImage.empty() ? m_deltaTime : 1.0f / m_config.targetFPS);
+    m_profiler->pop();
+
+    // Only submit what survives hierarchical frustum culling
+    m_viewProjection = projection * view;
+    m_scene->update();
+
+    m_scene->cull(Frustum::fromMatrix(m_viewProjection), m_visibleObjects);
+    if (m_config.enableOcclusionCulling) {
+      m_scene->cullOccluded(*m_occlusionCuller, m_viewProjection, m_visibleObjects);
+    }
+    drawDebugView();
+
+    // Emitters are simulated on the workers and the survivors streamed to the GPU. A reference
+    // image test steps at a fixed rate so the particles end up in the same place every run.
+    m_profiler->push("Particle update");
+    m_particles->update(m_config.goldenImage.empty() ? m_deltaTime : 1.0f / m_config.targetFPS);
+    m_profiler->pop();
+
+    drawHud(frameWidth, frameHeight, renderWidth, renderHeight);
+
+    // The frame as passes: shadows, the scene into an offscreen HDR target at the dynamic
+    // resolution, particles over it, its MSAA resolve, the upscale to the window and the HUD on
+    // top. Targets come from the graph's pool and share memory where they can.
+    const int samples = std::max(m_config.msaaSamples, 1);
+    m_renderGraph->reset();
+    const RenderGraph::Handle backbuffer = m_renderGraph->importBackbuffer("Backbuffer", frameWidth, frameHeight);
+    RenderGraph::TextureDesc shadowDesc;
+    shadowDesc.width = shadowDesc.height = m_shadows->getSize();
+    shadowDesc.format = GL_DEPTH_COMPONENT32F;
+    const RenderGraph::Handle shadowMap =
+      m_renderGraph->importTexture("Shadow map", m_shadows->getTexture(), shadowDesc);
+
+    if (shadowShader) {
+      // Each cascade culls its own casters, the cached ones only redraw when something changed
+      m_renderGraph->addPass(
+        "Shadows",
+        [&](RenderGraph::Builder& builder) { builder.write(shadowMap); },
+        [&](const RenderGraph::Context&) {
+          m_shadows->render(*m_scene, *shadowShader, view, fovY, aspect, 0.1f, m_profiler.get());
+        });
+    }
+
+    RenderGraph::Handle sceneColor = RenderGraph::InvalidHandle;
+    RenderGraph::Handle sceneDepth = RenderGraph::InvalidHandle;
+    m_renderGraph->addPass(
+      "Opaque",
+      [&](RenderGraph::Builder& builder) {
+        RenderGraph::TextureDesc desc;
+        desc.width = renderWidth;
+        desc.height = renderHeight;
+        desc.format = GL_RGBA16F;
+        desc.samples = samples;
+        sceneColor = builder.create("Scene color", desc);
+        desc.format = GL_DEPTH_COMPONENT32F;
+        sceneDepth = builder.create("Scene depth", desc);
+        builder.colorTarget(sceneColor);
+        builder.depthTarget(sceneDepth);
+        builder.read(shadowMap);
+      },
+      [&](const RenderGraph::Context&) {
+        glClearColor(0.1, 0.0, 0.5, 1.0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        shader.use();
+        m_shadows->bind(shader);
+
+        const Mesh* boundMesh = nullptr;
+        int boundMaterial = -1;
+        m_lodSelector->beginFrame();
+        for (int objectId : m_visibleObjects) {
+          const SceneObject& object = m_scene->getObject(objectId);
+          if (!object.mesh) {
+            continue;
+          }
+
+          // Pick the level from the projected size so triangle count follows screen coverage
+          float radius = LODSelector::projectedRadius(object.worldBounds, cameraPos, fovY, renderHeight);
+          int lod = m_lodSelector->select(object.mesh->getLODs(), radius, object.lod);
+          m_scene->setLOD(objectId, lod);
+
+          glm::mat4 model = object.transform;
+          shader.setMat4("model", model);
+
+          if (object.mesh != boundMesh) {
+            object.mesh->bind();
+            shader.setVec3("positionScale", object.mesh->getPositionScale());
+            shader.setVec3("positionOffset", object.mesh->getPositionOffset());
+            shader.setBool("octahedralNormals", object.mesh->hasOctahedralNormals());
+            boundMesh = object.mesh;
+          }
+          // Everything about the material is already on the GPU, a draw only names it
+          if (object.material != boundMaterial) {
+            glUniform1i(materialLocation, object.material);
+            boundMaterial = object.material;
+          }
+          object.mesh->draw(lod);
+        }
+      });
+
+    if (particleShader) {
+      // Over the opaque scene, tested against its depth
+      m_renderGraph->addPass(
+        "Particles",
+        [&](RenderGraph::Builder& builder) {
+          builder.colorTarget(sceneColor);
+          builder.depthTarget(sceneDepth);
+        },
+        [&](const RenderGraph::Context&) {
+          particleShader->use();
+          particleShader->setMat4("view", view);
+          particleShader->setMat4("projection", projection);
+          m_particles->draw();
+        });
+    }
+
+#if MACHI_DEBUG_DRAW
+    if (debugShader) {
+      // Whatever was drawn with DebugDraw this frame, from any thread, tested against the scene depth
+      m_renderGraph->addPass(
+        "Debug draw",
+        [&](RenderGraph::Builder& builder) {
+          builder.colorTarget(sceneColor);
+          builder.depthTarget(sceneDepth);
+        },
+        [&](const RenderGraph::Context&) {
+          debugShader->use();
+          m_debugRenderer->render(*debugShader, m_viewProjection);
+        });
+    }
+#endif
+
+    RenderGraph::Handle multisampled = sceneColor;
+    if (samples > 1) {
+      m_renderGraph->addPass(
+        "Resolve",
+        [&](RenderGraph::Builder& builder) {
+          RenderGraph::TextureDesc desc;
+          desc.width = renderWidth;
+          desc.height = renderHeight;
+          desc.format = GL_RGBA16F;
+          builder.read(multisampled);
+          sceneColor = builder.create("Resolved color", desc);
+        },
+        [&](const RenderGraph::Context& context) {
+          context.blit(multisampled, sceneColor, GL_COLOR_BUFFER_BIT);
+        });
+    }
+
+    if (upscaleShader) {
+      m_renderGraph->addPass(
+        "Upscale",
+        [&](RenderGraph::Builder& builder) {
+          builder.read(sceneColor);
+          builder.colorTarget(backbuffer);
+        },
+        [&](const RenderGraph::Context& context) {
+          // Encoded to sRGB on the way out by GL_FRAMEBUFFER_SRGB
+          glDisable(GL_DEPTH_TEST);
+          upscaleShader->use();
+          glActiveTexture(GL_TEXTURE0);
+          glBindTexture(GL_TEXTURE_2D, context.texture(sceneColor));
+          upscaleShader->setInt("sceneColor", 0);
+          glUniform2f(glGetUniformLocation(upscaleShader->m_id, "sourceSize"),
+                      static_cast<float>(renderWidth),
+                      static_cast<float>(renderHeight));
+          context.drawFullscreenTriangle();
+          glEnable(GL_DEPTH_TEST);
+        });
+    }
+    if (spriteShader) {
+      m_renderGraph->addPass(
+        "HUD",
+        [&](RenderGraph::Builder& builder) { builder.colorTarget(backbuffer); },
+        [&](const RenderGraph::Context&) {
+          spriteShader->use();
+          m_sprites->end(*spriteShader);
+        });
+    }
+    // Timed as a whole, that time drives the dynamic resolution
+    m_profiler->push("Frame");
+    m_renderGraph->execute(m_profiler.get());
+    m_profiler->pop();
+
+    // Everything used this frame has been touched, reduce what wasn't if we are over budget
+    m_residency->enforceBudget();
 
-      glDrawArrays(GL_TRIANGLES, 0, 36);
-    };
+    // Screenshots and recordings copy the finished frame before it is swapped away, the pixels
+    // arrive a few frames later and are written on the workers
+    const bool goldenCaptured = !m_config.goldenImage.empty() && captureGoldenFrame();
+    m_capture->readBack(frameWidth, frameHeight);
 
     m_windowManager->swapBuffers();
+    if (goldenCaptured) {
+      // Nothing to keep smooth in a test run, wait for the comparison
+      m_capture->flush();
+      requestShutdown();
+    }
 
     // Update frame statistics for performance monitoring
     calculateFrameStats();
@@ -379,9 +776,6 @@ void Engine::run() {
     // performSceneTransition();
   }
 
-  glDeleteVertexArrays(1, &vao);
-  glDeleteBuffers(1, &vbo);
-
   LOG_INFO("[Engine] Main engine loop ended");
 }
 
@@ -398,7 +792,6 @@ void Engine::updateSystems(float deltaTime) {
   // - Physics system
   // - Audio system
   // - Animation system
-  // - Particle systems
   // - UI system
   m_camera->update(*m_inputManager, deltaTime);
 };
@@ -418,8 +811,142 @@ void Engine::renderFrame() {
   m_windowManager->swapBuffers();
 }
 
+void Engine::cycleDebugView() {
+  if (!MACHI_DEBUG_DRAW) {
+    LOG_WARNING("[Engine] F5 pressed - debug drawing is compiled out of this build");
+    return;
+  }
+  static const char* const names[] = {"off", "object bounds", "BVH"};
+  m_debugView = static_cast<DebugView>((static_cast<int>(m_debugView) + 1) % 3);
+  LOG_INFO_F("[Engine] F5 pressed - debug view {}", names[static_cast<int>(m_debugView)]);
+}
+
+void Engine::drawDebugView() {
+  if (m_debugView == DebugView::Bounds) {
+    // Green for what survived culling this frame
+    for (int objectId : m_visibleObjects) {
+      DebugDraw::box(m_scene->getObject(objectId).worldBounds, glm::vec4(0.2f, 1.0f, 0.2f, 1.0f));
+    }
+    // Orange around the demo swarm
+    if (m_swarmBounds.isValid()) {
+      DebugDraw::box(m_swarmBounds, glm::vec4(1.0f, 0.6f, 0.1f, 1.0f));
+    }
+  } else if (m_debugView == DebugView::BVH) {
+    // Leaves yellow, fading to blue towards the root
+    const BVH& bvh = m_scene->getBVH();
+    const std::vector<BVHNode>& nodes = bvh.getNodes();
+    const int rootHeight = bvh.getRoot() >= 0 ? std::max(nodes[bvh.getRoot()].height, 1) : 1;
+    for (const BVHNode& node : nodes) {
+      if (node.height < 0) {
+        continue;  // On the free list
+      }
+      const float t = static_cast<float>(node.height) / rootHeight;
+      DebugDraw::box(node.bounds, glm::vec4(1.0f - t, 1.0f - 0.5f * t, t, 0.4f + 0.6f * t), DebugDepth::Overlay);
+    }
+  }
+}
+
+void Engine::createDemoEntities() {
+  World& world = m_scene->getWorld();
+  uint32_t seed = 0x9E3779B9u;
+  for (int i = 0; i < m_config.demoEntities; i++) {
+    world.create(Position{randomDirection(seed) * 4.0f + glm::vec3(0.0f, 0.0f, -6.0f)},
+                 Velocity{randomDirection(seed)},
+                 Lifetime{1.0f + 4.0f * randomUnit(seed)});
+  }
+
+  // Movement and lifetime don't share components and run side by side, the bounds wait for the
+  // movement. Queries are kept in the systems so matching archetypes are only looked up once.
+  auto moving = std::make_shared<Query<Position, const Velocity>>(world.query<Position, const Velocity>());
+  m_systems.add("Swarm movement", Access().read<Velocity>().write<Position>(), [moving](SystemContext& context) {
+    const float deltaTime = context.deltaTime;
+    moving->parallelForEachChunk(
+        context.jobs, [deltaTime](size_t count, const Entity*, Position* positions, const Velocity* velocities) {
+          for (size_t i = 0; i < count; i++) {
+            positions[i].value += velocities[i].value * deltaTime;
+          }
+        });
+  });
+
+  // Expired entities are replaced, through the command buffer since nothing may change the world's
+  // structure while systems run
+  auto aging = std::make_shared<Query<Lifetime>>(world.query<Lifetime>());
+  m_systems.add("Swarm lifetime", Access().write<Lifetime>(), [aging, seed](SystemContext& context) mutable {
+    aging->forEach([&](Entity entity, Lifetime& lifetime) {
+      lifetime.remaining -= context.deltaTime;
+      if (lifetime.remaining <= 0.0f) {
+        context.commands.destroy(entity);
+        context.commands.create(Position{randomDirection(seed) + glm::vec3(0.0f, 0.0f, -6.0f)},
+                                Velocity{randomDirection(seed)},
+                                Lifetime{1.0f + 4.0f * randomUnit(seed)});
+      }
+    });
+  });
+
+  auto placed = std::make_shared<Query<const Position>>(world.query<const Position>());
+  m_systems.add("Swarm bounds", Access().read<Position>(), [this, placed](SystemContext& context) {
+    AABB bounds = AABB::empty();
+    std::mutex mutex;
+    placed->parallelForEachChunk(context.jobs, [&](size_t count, const Entity*, const Position* positions) {
+      AABB chunk = AABB::empty();
+      for (size_t i = 0; i < count; i++) {
+        chunk.expand(positions[i].value);
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      bounds.expand(chunk);
+    });
+    m_swarmBounds = bounds;
+  });
+
+  const WorldStats stats = world.getStats();
+  LOG_INFO_F("[Engine] {} entities in {} archetype(s), {} system(s) in {} stage(s)",
+             stats.entities,
+             stats.archetypes,
+             m_systems.getTimings().size(),
+             m_systems.getStageCount());
+}
+
+void Engine::drawHud(int width, int height, int renderWidth, int renderHeight) {
+  m_sprites->begin(width, height);
+  if (!m_showHud || !m_font->isLoaded()) {
+    return;
+  }
+
+  // Formatted into a fixed buffer, nothing is allocated for the HUD per frame
+  const SpriteStats& sprites = m_sprites->getStats();
+  char text[512];
+  std::snprintf(text,
+                sizeof(text),
+                "%.1f FPS  %.2f ms\n"
+                "Scene %dx%d of %dx%d\n"
+                "%zu visible objects\n"
+                "%zu particles, %zu entities\n"
+                "HUD %zu quads, %d draw calls",
+                m_fps,
+                m_deltaTime * 1000.0f,
+                renderWidth,
+                renderHeight,
+                width,
+                height,
+                m_visibleObjects.size(),
+                m_particles->getAliveCount(),
+                m_scene->getWorld().getEntityCount(),
+                sprites.quads,
+                sprites.drawCalls);
+
+  const float size = m_config.hudTextSize;
+  const float lineHeight = m_font->getLineHeight() * size / FontAtlas::GlyphSize;
+  const float lines = static_cast<float>(std::count(text, text + std::strlen(text), '\n') + 1);
+  const glm::vec2 margin(8.0f);
+  const glm::vec2 padding(size * 0.5f);
+  const glm::vec2 box(m_font->measure(text, size), lines * lineHeight);
+  m_sprites->drawRect(margin, box + 2.0f * padding, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
+  m_sprites->drawText(*m_font, text, margin + padding, size, glm::vec4(1.0f));
+}
+
 void Engine::calculateFrameStats() {
   m_frameCount++;
+  m_frameIndex++;
   m_fpsUpdateTimer += m_deltaTime;
 
   // Update FPS display every half second
@@ -491,6 +1018,75 @@ void Engine::keyTest(GLFWwindow* window) {
     cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
 };
 
+void Engine::pickObject(double x, double y) {
+  auto [width, height] = m_windowManager->getSize();
+  Ray ray = Ray::fromScreen(x, y, width, height, glm::inverse(m_viewProjection));
+
+  RaycastHit hit;
+  if (m_scene->pick(ray, 1000.0f, hit)) {
+    LOG_INFO_F("[Engine] Picked object {} at distance {}", hit.userData, hit.distance);
+  }
+}
+
+void Engine::captureScreenshot() {
+  std::error_code error;
+  std::filesystem::create_directories(m_config.captureDirectory, error);
+  const std::string path = m_config.captureDirectory + "/screenshot_" + std::to_string(m_frameIndex) + ".png";
+  LOG_INFO_F("[Engine] F12 pressed - saving a screenshot to {}", path);
+  m_capture->capture(path);
+}
+
+void Engine::toggleRecording() {
+  if (m_capture->isRecording()) {
+    m_capture->stopRecording();
+    return;
+  }
+  std::error_code error;
+  std::filesystem::create_directories(m_config.captureDirectory, error);
+  std::string path = m_config.captureDirectory + "/recording_" + std::to_string(m_frameIndex);
+  if (m_config.recordingFormat == CaptureFormat::Raw) {
+    path += ".rgba";
+  }
+  m_capture->startRecording(path, m_config.recordingFormat);
+}
+
+bool Engine::captureGoldenFrame() {
+  // Textures still streaming in would make the frame depend on how fast they loaded
+  const StreamingStats& streaming = m_textureStreamer->getStats();
+  if (m_frameIndex < static_cast<uint64_t>(m_config.goldenFrame) ||
+      streaming.queued + streaming.decoding + streaming.uploading > 0) {
+    return false;
+  }
+
+  // Failed until the comparison says otherwise, a frame that couldn't be read back fails too
+  m_exitCode = 1;
+  LOG_INFO_F("[Engine] Comparing frame {} to {}", m_frameIndex, m_config.goldenImage);
+  m_capture->capture([this](const CapturedFrame& frame) {
+    const ImageDifference difference = ImageIO::compareToFile(
+      m_config.goldenImage, frame.pixels.data(), frame.width, frame.height, 4, m_config.goldenTolerance);
+    const bool passed =
+      difference.sizeMatches && difference.differingFraction() <= static_cast<double>(m_config.goldenMaxDiffering);
+    if (difference.sizeMatches) {
+      LOG_INFO_F("[Engine] {} pixel(s) of {} differ by more than {}, at most {}, mean error {}",
+                 difference.differingPixels,
+                 difference.pixels,
+                 m_config.goldenTolerance,
+                 difference.maxDifference,
+                 difference.meanError);
+    }
+    if (passed) {
+      LOG_INFO("[Engine] Golden image test passed");
+      m_exitCode = 0;
+      return;
+    }
+    // Kept for inspection, or to become the new reference
+    const std::string actual = m_config.goldenImage + ".actual.png";
+    ImageIO::writePNG(actual, frame.pixels.data(), frame.width, frame.height, 4);
+    LOG_ERROR_F("[Engine] Golden image test failed, the frame was written to {}", actual);
+  });
+  return true;
+}
+
 void Engine::onMouseMove(double x, double y) {
   Event event;
   event.type = EventType::MouseMove;
@@ -611,8 +1207,36 @@ void Engine::shutdown() {
 
 void Engine::shutdownSystems() {
   // Clear event handlers
-  m_eventManager->clearSubscribers();
-  m_eventManager->clearQueue();
+  if (m_eventManager) {
+    m_eventManager->clearSubscribers();
+    m_eventManager->clearQueue();
+  }
+
+  // GPU resources have to be released while the context still exists, and whatever submits jobs
+  // or reads goes before the workers that run them
+  m_meshManager.reset();
+  m_resourceManager.reset();
+  m_textureStreamer.reset();
+  m_capture.reset();
+  m_sprites.reset();
+  m_debugRenderer.reset();
+  m_font.reset();
+  m_renderGraph.reset();
+  m_profiler.reset();
+  m_shadows.reset();
+  m_particles.reset();
+  m_lighting.reset();
+  m_materials.reset();
+  m_texturePool.reset();
+  m_shaderCache.reset();
+
+  // Queued jobs are finished first, reads in flight are dropped, then nothing reads the pack anymore
+  m_jobSystem.reset();
+  m_asyncIO.reset();
+  if (m_assetPack) {
+    PackFile::mount(nullptr);
+    m_assetPack.reset();
+  }
 
   // WindowManager will clean up automatically through its destructor
   m_windowManager.reset();
@@ -640,6 +1264,186 @@ void Engine::printFrameStats() const {
   LOG_INFO_F("Current FPS: {:.1f}", m_fps);
   LOG_INFO_F("Frame Time: {:.3f}ms", m_deltaTime * 1000.0f);
   LOG_INFO_F("Total Runtime: {:.2f}s", m_totalTime);
+  LOG_INFO_F("Visible Objects: {}/{}", m_visibleObjects.size(), m_scene->getObjectCount());
+  const LODStats& lod = m_lodSelector->getStats();
+  LOG_INFO_F("LOD: {} objects, {} triangles, {} switches", lod.objects, lod.triangles, lod.switches);
+  for (size_t level = 0; level < lod.objectsPerLevel.size(); level++) {
+    LOG_INFO_F("  LOD {}: {} objects", level, lod.objectsPerLevel[level]);
+  }
+  if (m_config.enableOcclusionCulling) {
+    const OcclusionStats& occlusion = m_occlusionCuller->getStats();
+    LOG_INFO_F("Occlusion: {}/{} culled ({}%), {} occluder tris, raster {}ms, test {}ms",
+               occlusion.culled,
+               occlusion.tested,
+               occlusion.culledPercent(),
+               occlusion.occluderTriangles,
+               occlusion.rasterMs,
+               occlusion.testMs);
+  }
+  if (m_textureStreamer) {
+    const StreamingStats& streaming = m_textureStreamer->getStats();
+    LOG_INFO_F("Textures: {} resident ({} reduced), {} uploading, {} decoding, {} queued, {} evicted, {} failed, {} "
+               "bytes on the GPU",
+               streaming.resident,
+               streaming.reduced,
+               streaming.uploading,
+               streaming.decoding,
+               streaming.queued,
+               streaming.evicted,
+               streaming.failed,
+               streaming.totalBytes);
+    LOG_INFO_F("  Last frame: {} uploads, {} bytes", streaming.uploadsThisFrame, streaming.bytesThisFrame);
+  }
+  const IOStats io = m_asyncIO->getStats();
+  LOG_INFO_F("File I/O ({}): {} read ({} bytes), {} failed, {} cancelled, {} in flight, {} queued, {} batches",
+             m_asyncIO->usesIoUring() ? "io_uring" : "threads",
+             io.completed,
+             io.bytesRead,
+             io.failed,
+             io.cancelled,
+             io.inFlight,
+             io.pending,
+             io.batches);
+  m_resourceManager->logStats();
+  if (m_shaderCache && m_shaderCache->isSupported()) {
+    const ShaderCacheStats& shaders = m_shaderCache->getStats();
+    LOG_INFO_F("Shader binaries: {} loaded, {} compiled, {} rejected, {} stored",
+               shaders.hits,
+               shaders.misses,
+               shaders.rejected,
+               shaders.stored);
+  }
+  const ResidencyStats& residency = m_residency->getStats();
+  LOG_INFO_F("GPU memory: {} / {} bytes (peak {}), {} in textures, {} in buffers, {} resource(s){}",
+             residency.used,
+             residency.budget,
+             residency.peak,
+             residency.textureBytes,
+             residency.bufferBytes,
+             residency.resources,
+             residency.overBudget() ? " - OVER BUDGET" : "");
+  LOG_INFO_F("  Last frame: {} touched, {} mips dropped, {} evicted, {} bytes freed",
+             residency.touchedThisFrame,
+             residency.mipsDroppedThisFrame,
+             residency.evictedThisFrame,
+             residency.bytesFreedThisFrame);
+  if (m_texturePool) {
+    const TexturePoolStats& pool = m_texturePool->getStats();
+    LOG_INFO_F("Texture pool: {} arrays ({} grown), {} layers, {} atlas pages holding {} textures, {} bytes",
+               pool.arrays,
+               pool.grows,
+               pool.layers,
+               pool.atlasPages,
+               pool.atlasRegions,
+               pool.bytes);
+  }
+  if (m_lighting) {
+    const LightingStats& lighting = m_lighting->getStats();
+    LOG_INFO_F("Lighting: {}/{} lights visible, {} cluster entries, at most {} per cluster, {} overflowed, {:.3f}ms",
+               lighting.visibleLights,
+               lighting.lights,
+               lighting.lightIndices,
+               lighting.maxClusterLights,
+               lighting.overflows,
+               lighting.binMs);
+  }
+  if (m_shadows) {
+    const ShadowStats& shadows = m_shadows->getStats();
+    LOG_INFO_F("Shadows: {} cascade(s) rendered, {} cached ({} restored for moving casters), {} draws, "
+               "{:.3f}ms GPU saved by caching",
+               shadows.rendered,
+               shadows.cached,
+               shadows.copied,
+               shadows.casters,
+               shadows.savedMs);
+  }
+  if (m_particles) {
+    const ParticleStats& particles = m_particles->getStats();
+    LOG_INFO_F("Particles: {} alive in {} emitter(s), {} spawned, {} died, {:.3f}ms simulating, {:.3f}ms streaming "
+               "{} bytes",
+               particles.alive,
+               particles.emitters,
+               particles.spawned,
+               particles.died,
+               particles.simulateMs,
+               particles.streamMs,
+               particles.streamBytes);
+  }
+  if (m_sprites) {
+    const SpriteStats& sprites = m_sprites->getStats();
+    LOG_INFO_F("Sprites: {} quad(s) in {} draw call(s), {} bytes streamed{}",
+               sprites.quads,
+               sprites.drawCalls,
+               sprites.streamBytes,
+               m_showHud ? "" : " - HUD hidden");
+  }
+  if (m_scene) {
+    const WorldStats world = m_scene->getWorld().getStats();
+    LOG_INFO_F("ECS: {} entities in {} archetype(s), {} chunk(s) of {} bytes, {} stage(s)",
+               world.entities,
+               world.archetypes,
+               world.chunks,
+               world.chunkBytes,
+               m_systems.getStageCount());
+    for (const SystemTiming& system : m_systems.getTimings()) {
+      LOG_INFO_F("  {}: stage {}, {:.3f}ms", system.name, system.stage, system.ms);
+    }
+  }
+  if (m_debugRenderer && MACHI_DEBUG_DRAW) {
+    const DebugDrawStats& debug = m_debugRenderer->getStats();
+    LOG_INFO_F("Debug draw: {} line(s), {} triangle(s) in {} draw call(s) from {} thread(s), {} bytes streamed",
+               debug.lines,
+               debug.triangles,
+               debug.drawCalls,
+               debug.threads,
+               debug.streamBytes);
+  }
+  if (m_dynamicResolution) {
+    const DynamicResolutionStats& resolution = m_dynamicResolution->getStats();
+    LOG_INFO_F("Resolution: {:.0f}% ({}), {:.2f}ms GPU of {:.2f}ms budget, {} change(s)",
+               resolution.scale * 100.0f,
+               m_dynamicResolution->isEnabled() ? "dynamic" : "fixed",
+               resolution.gpuMs,
+               resolution.budgetMs,
+               resolution.changes);
+  }
+  if (m_capture) {
+    const CaptureStats capture = m_capture->getStats();
+    LOG_INFO_F("Capture: {} frame(s) read back, {} written, {} dropped, {} failed, {} in flight, {} encoding, "
+               "{} frame(s) latency, {:.3f}ms copying{}",
+               capture.captured,
+               capture.written,
+               capture.dropped,
+               capture.failed,
+               capture.inFlight,
+               capture.encoding,
+               capture.latencyFrames,
+               capture.copyMs,
+               m_capture->isRecording() ? " - RECORDING" : "");
+  }
+  if (m_renderGraph) {
+    const RenderGraphStats& graph = m_renderGraph->getStats();
+    LOG_INFO_F("Render graph: {} passes ({} culled), {} transient targets in {} textures, {} bytes ({} without "
+               "aliasing), {} bytes pooled",
+               graph.passes,
+               graph.culledPasses,
+               graph.transientTextures,
+               graph.physicalTextures,
+               graph.physicalBytes,
+               graph.transientBytes,
+               graph.poolBytes);
+  }
+  if (m_profiler) {
+    LOG_INFO("Profiler (CPU / GPU ms, smoothed):");
+    for (const ProfileTiming& timing : m_profiler->getTimings()) {
+      LOG_INFO_F("  {}{}: {:.3f} / {:.3f}{}",
+                 std::string(timing.depth * 2, ' '),
+                 timing.name,
+                 timing.cpuMs,
+                 timing.gpuMs,
+                 timing.skippedFrames > 0 ? " (skipped last frame)" : "");
+    }
+  }
   LOG_INFO("========================");
 }
 
@@ -0,0 +1,638 @@
+#include "../include/FontAtlas.hpp"
+#include "../include/Logger.hpp"
+#include "../include/PackFile.hpp"
+#include "../include/Utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+constexpr int MaxCompositeDepth = 8;  // Composite glyphs nested deeper than this are left out
+constexpr int GlyphGap = 1;           // Texels between glyphs in the atlas
+
+// A piece of a flattened outline
+struct Edge {
+  glm::vec2 a;
+  glm::vec2 b;
+};
+
+// Placement of a composite glyph's parts, point * matrix + offset
+struct Transform {
+  glm::mat2 matrix = glm::mat2(1.0f);
+  glm::vec2 offset = glm::vec2(0.0f);
+
+  glm::vec2 apply(glm::vec2 point) const {
+    return matrix * point + offset;
+  }
+};
+
+// The tables of a TrueType font needed for outlines and horizontal metrics. Every read is bounds
+// checked, a damaged font throws instead of reading past the end.
+class TrueType {
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_loca = 0;
+  size_t m_glyf = 0;
+  size_t m_glyfLength = 0;
+  size_t m_hmtx = 0;
+  size_t m_cmap = 0;    // The chosen subtable
+  int m_cmapFormat = 0;  // 4 or 12
+  int m_locaFormat = 0;
+  int m_glyphCount = 0;
+  int m_metricCount = 0;
+
+  void check(size_t offset, size_t bytes) const {
+    if (offset > m_size || bytes > m_size - offset) {
+      throw std::runtime_error("Truncated font data");
+    }
+  }
+  uint8_t u8(size_t offset) const {
+    check(offset, 1);
+    return m_data[offset];
+  }
+  uint16_t u16(size_t offset) const {
+    check(offset, 2);
+    return static_cast<uint16_t>(m_data[offset] << 8 | m_data[offset + 1]);
+  }
+  int16_t s16(size_t offset) const {
+    return static_cast<int16_t>(u16(offset));
+  }
+  uint32_t u32(size_t offset) const {
+    return static_cast<uint32_t>(u16(offset)) << 16 | u16(offset + 2);
+  }
+  // 2.14 fixed point, the composite glyph scales
+  float f2dot14(size_t offset) const {
+    return s16(offset) / 16384.0f;
+  }
+
+  size_t findTable(const char* tag, size_t* length = nullptr) const {
+    const int tables = u16(4);
+    for (int i = 0; i < tables; i++) {
+      const size_t record = 12 + static_cast<size_t>(i) * 16;
+      check(record, 16);
+      if (std::equal(tag, tag + 4, m_data + record)) {
+        const size_t offset = u32(record + 8);
+        const size_t size = u32(record + 12);
+        check(offset, size);
+        if (length) {
+          *length = size;
+        }
+        return offset;
+      }
+    }
+    throw std::runtime_error(std::string("No ") + tag + " table");
+  }
+
+  void findCharacterMap() {
+    const size_t cmap = findTable("cmap");
+    const int subtables = u16(cmap + 2);
+    int best = 0;  // Full Unicode format 12 over BMP format 4 over anything else
+    for (int i = 0; i < subtables; i++) {
+      const size_t record = cmap + 4 + static_cast<size_t>(i) * 8;
+      const int platform = u16(record);
+      const int encoding = u16(record + 2);
+      const size_t subtable = cmap + u32(record + 4);
+      const int format = u16(subtable);
+      const bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+      const int rank = !unicode ? 0 : format == 12 ? 2 : format == 4 ? 1 : 0;
+      if (rank > best) {
+        best = rank;
+        m_cmap = subtable;
+        m_cmapFormat = format;
+      }
+    }
+    if (best == 0) {
+      throw std::runtime_error("No Unicode character map");
+    }
+  }
+
+  // Curves are split until they are within tolerance (font units) of their chords
+  static void addQuadratic(glm::vec2 a, glm::vec2 control, glm::vec2 b, float tolerance, std::vector<Edge>& edges) {
+    const float curvature = glm::length(a - 2.0f * control + b);
+    const int steps = std::clamp(static_cast<int>(std::ceil(std::sqrt(curvature / (4.0f * tolerance)))), 1, 16);
+    glm::vec2 previous = a;
+    for (int i = 1; i <= steps; i++) {
+      const float t = static_cast<float>(i) / steps;
+      const glm::vec2 point = (1.0f - t) * (1.0f - t) * a + 2.0f * (1.0f - t) * t * control + t * t * b;
+      edges.push_back({previous, point});
+      previous = point;
+    }
+  }
+
+  // Two off-curve points in a row have an implied on-curve point halfway between them
+  static void addContour(const std::vector<glm::vec2>& points,
+                         const std::vector<bool>& onCurve,
+                         size_t first,
+                         size_t last,
+                         float tolerance,
+                         std::vector<Edge>& edges) {
+    const size_t count = last - first + 1;
+    if (count < 2) {
+      return;
+    }
+    size_t start = first;
+    while (start <= last && !onCurve[start]) {
+      start++;
+    }
+    glm::vec2 origin;
+    size_t begin;
+    if (start > last) {
+      // Only off-curve points, begin between the last and the first
+      origin = 0.5f * (points[last] + points[first]);
+      begin = 0;
+    } else {
+      origin = points[start];
+      begin = start - first + 1;
+    }
+
+    glm::vec2 current = origin;
+    glm::vec2 control;
+    bool hasControl = false;
+    for (size_t i = 0; i < count; i++) {
+      const size_t index = first + (begin + i) % count;
+      const glm::vec2 point = points[index];
+      if (onCurve[index]) {
+        if (hasControl) {
+          addQuadratic(current, control, point, tolerance, edges);
+        } else {
+          edges.push_back({current, point});
+        }
+        current = point;
+        hasControl = false;
+      } else {
+        if (hasControl) {
+          const glm::vec2 middle = 0.5f * (control + point);
+          addQuadratic(current, control, middle, tolerance, edges);
+          current = middle;
+        }
+        control = point;
+        hasControl = true;
+      }
+    }
+    if (hasControl) {
+      addQuadratic(current, control, origin, tolerance, edges);
+    } else if (current != origin) {
+      edges.push_back({current, origin});
+    }
+  }
+
+  void addSimpleGlyph(size_t glyph, int contours, const Transform& transform, float tolerance, std::vector<Edge>& edges)
+    const {
+    std::vector<size_t> ends(contours);
+    for (int i = 0; i < contours; i++) {
+      ends[i] = u16(glyph + 10 + static_cast<size_t>(i) * 2);
+    }
+    const size_t pointCount = ends.back() + 1;
+    size_t cursor = glyph + 10 + static_cast<size_t>(contours) * 2;
+    cursor += 2 + u16(cursor);  // Hinting instructions
+
+    std::vector<uint8_t> flags;
+    flags.reserve(pointCount);
+    while (flags.size() < pointCount) {
+      const uint8_t flag = u8(cursor++);
+      flags.push_back(flag);
+      if (flag & 8) {
+        for (int repeat = u8(cursor++); repeat > 0 && flags.size() < pointCount; repeat--) {
+          flags.push_back(flag);
+        }
+      }
+    }
+
+    // Coordinates are deltas, a byte with a sign flag or a short, or unchanged
+    std::vector<glm::vec2> points(pointCount);
+    for (int axis = 0; axis < 2; axis++) {
+      const uint8_t shortFlag = axis == 0 ? 2 : 4;
+      const uint8_t sameFlag = axis == 0 ? 16 : 32;
+      int value = 0;
+      for (size_t i = 0; i < pointCount; i++) {
+        if (flags[i] & shortFlag) {
+          const int delta = u8(cursor++);
+          value += (flags[i] & sameFlag) ? delta : -delta;
+        } else if (!(flags[i] & sameFlag)) {
+          value += s16(cursor);
+          cursor += 2;
+        }
+        points[i][axis] = static_cast<float>(value);
+      }
+    }
+
+    std::vector<bool> onCurve(pointCount);
+    for (size_t i = 0; i < pointCount; i++) {
+      points[i] = transform.apply(points[i]);
+      onCurve[i] = flags[i] & 1;
+    }
+    size_t first = 0;
+    for (size_t end : ends) {
+      if (end < first || end >= pointCount) {
+        throw std::runtime_error("Bad contour end point");
+      }
+      addContour(points, onCurve, first, end, tolerance, edges);
+      first = end + 1;
+    }
+  }
+
+  void addCompositeGlyph(size_t glyph, const Transform& transform, float tolerance, int depth, std::vector<Edge>& edges)
+    const {
+    size_t cursor = glyph + 10;
+    uint16_t flags;
+    do {
+      flags = u16(cursor);
+      const uint32_t part = u16(cursor + 2);
+      cursor += 4;
+      float dx;
+      float dy;
+      if (flags & 0x0001) {
+        dx = s16(cursor);
+        dy = s16(cursor + 2);
+        cursor += 4;
+      } else {
+        dx = static_cast<int8_t>(u8(cursor));
+        dy = static_cast<int8_t>(u8(cursor + 1));
+        cursor += 2;
+      }
+      if (!(flags & 0x0002)) {
+        // The arguments are point numbers to align, rare enough to place the part unmoved
+        dx = dy = 0.0f;
+      }
+      Transform local;
+      if (flags & 0x0008) {
+        local.matrix = glm::mat2(f2dot14(cursor));
+        cursor += 2;
+      } else if (flags & 0x0040) {
+        local.matrix = glm::mat2(f2dot14(cursor), 0.0f, 0.0f, f2dot14(cursor + 2));
+        cursor += 4;
+      } else if (flags & 0x0080) {
+        local.matrix = glm::mat2(f2dot14(cursor), f2dot14(cursor + 2), f2dot14(cursor + 4), f2dot14(cursor + 6));
+        cursor += 8;
+      }
+      local.offset = glm::vec2(dx, dy);
+
+      Transform combined;
+      combined.matrix = transform.matrix * local.matrix;
+      combined.offset = transform.apply(local.offset);
+      addGlyph(part, combined, tolerance, depth + 1, edges);
+    } while (flags & 0x0020);
+  }
+
+public:
+  int unitsPerEm = 0;
+  int ascent = 0;
+  int descent = 0;
+  int lineGap = 0;
+
+  TrueType(const uint8_t* data, size_t size) : m_data(data), m_size(size) {
+    const uint32_t version = u32(0);
+    if (version != 0x00010000 && version != 0x74727565) {  // 'true' on old Apple fonts
+      throw std::runtime_error(version == 0x4F54544F ? "CFF outlines are not supported" : "Not a TrueType font");
+    }
+    const size_t head = findTable("head");
+    unitsPerEm = u16(head + 18);
+    m_locaFormat = s16(head + 50);
+    if (unitsPerEm == 0) {
+      throw std::runtime_error("Bad units per em");
+    }
+    m_glyphCount = u16(findTable("maxp") + 4);
+    const size_t hhea = findTable("hhea");
+    ascent = s16(hhea + 4);
+    descent = s16(hhea + 6);
+    lineGap = s16(hhea + 8);
+    m_metricCount = u16(hhea + 34);
+    m_hmtx = findTable("hmtx");
+    m_loca = findTable("loca");
+    m_glyf = findTable("glyf", &m_glyfLength);
+    findCharacterMap();
+  }
+
+  // 0, the missing glyph, for characters the font doesn't have
+  uint32_t glyphIndex(uint32_t codepoint) const {
+    if (m_cmapFormat == 12) {
+      const uint32_t groups = u32(m_cmap + 12);
+      for (uint32_t i = 0; i < groups; i++) {
+        const size_t group = m_cmap + 16 + static_cast<size_t>(i) * 12;
+        if (codepoint >= u32(group) && codepoint <= u32(group + 4)) {
+          return u32(group + 8) + codepoint - u32(group);
+        }
+      }
+      return 0;
+    }
+    if (codepoint > 0xFFFF) {
+      return 0;
+    }
+    const size_t segments = u16(m_cmap + 6) / 2;
+    const size_t endCodes = m_cmap + 14;
+    const size_t startCodes = endCodes + segments * 2 + 2;
+    const size_t deltas = startCodes + segments * 2;
+    const size_t rangeOffsets = deltas + segments * 2;
+    for (size_t i = 0; i < segments; i++) {
+      if (codepoint > u16(endCodes + i * 2)) {
+        continue;
+      }
+      const uint32_t start = u16(startCodes + i * 2);
+      if (codepoint < start) {
+        return 0;
+      }
+      const uint16_t delta = u16(deltas + i * 2);
+      const uint16_t rangeOffset = u16(rangeOffsets + i * 2);
+      if (rangeOffset == 0) {
+        return (codepoint + delta) & 0xFFFF;
+      }
+      // The offset is relative to where it is stored
+      const uint16_t glyph = u16(rangeOffsets + i * 2 + rangeOffset + (codepoint - start) * 2);
+      return glyph ? (glyph + delta) & 0xFFFF : 0;
+    }
+    return 0;
+  }
+
+  int advance(uint32_t glyph) const {
+    if (m_metricCount == 0) {
+      return 0;
+    }
+    const uint32_t metric = std::min(glyph, static_cast<uint32_t>(m_metricCount - 1));
+    return u16(m_hmtx + static_cast<size_t>(metric) * 4);
+  }
+
+  // Appends the glyph's outline in font units, y up, flattened to within tolerance
+  void addGlyph(uint32_t glyph, const Transform& transform, float tolerance, int depth, std::vector<Edge>& edges)
+    const {
+    if (glyph >= static_cast<uint32_t>(m_glyphCount) || depth > MaxCompositeDepth) {
+      return;
+    }
+    size_t begin;
+    size_t end;
+    if (m_locaFormat == 0) {
+      begin = static_cast<size_t>(u16(m_loca + glyph * 2)) * 2;
+      end = static_cast<size_t>(u16(m_loca + glyph * 2 + 2)) * 2;
+    } else {
+      begin = u32(m_loca + glyph * 4);
+      end = u32(m_loca + glyph * 4 + 4);
+    }
+    if (end <= begin) {
+      return;  // No outline, a space
+    }
+    if (end > m_glyfLength) {
+      throw std::runtime_error("Glyph outside the glyf table");
+    }
+    const size_t offset = m_glyf + begin;
+    const int contours = s16(offset);
+    if (contours > 0) {
+      addSimpleGlyph(offset, contours, transform, tolerance, edges);
+    } else if (contours < 0) {
+      addCompositeGlyph(offset, transform, tolerance, depth, edges);
+    }
+  }
+};
+
+// One glyph's field before it is packed into the atlas
+struct GlyphField {
+  std::vector<Edge> edges;  // In field pixels, y down
+  int width = 0;
+  int height = 0;
+  int x = 0;  // Place in the atlas
+  int y = 0;
+  std::vector<uint8_t> pixels;
+};
+
+// Distance to the nearest edge, signed by the nonzero winding rule so overlapping contours work
+void generateField(GlyphField& field) {
+  field.pixels.resize(static_cast<size_t>(field.width) * field.height);
+  const float scale = 0.5f / FontAtlas::Spread;
+  for (int y = 0; y < field.height; y++) {
+    for (int x = 0; x < field.width; x++) {
+      const glm::vec2 p(x + 0.5f, y + 0.5f);
+      float nearest = static_cast<float>(FontAtlas::Spread * FontAtlas::Spread * 4);
+      int winding = 0;
+      for (const Edge& edge : field.edges) {
+        const glm::vec2 ab = edge.b - edge.a;
+        const glm::vec2 ap = p - edge.a;
+        const float lengthSquared = glm::dot(ab, ab);
+        const float t = lengthSquared > 0.0f ? std::clamp(glm::dot(ap, ab) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+        const glm::vec2 offset = ap - t * ab;
+        nearest = std::min(nearest, glm::dot(offset, offset));
+
+        // Crossings of a ray towards +x, counted by direction
+        const float side = ab.x * ap.y - ab.y * ap.x;
+        if (edge.a.y <= p.y) {
+          if (edge.b.y > p.y && side > 0.0f) {
+            winding++;
+          }
+        } else if (edge.b.y <= p.y && side < 0.0f) {
+          winding--;
+        }
+      }
+      const float distance = winding != 0 ? std::sqrt(nearest) : -std::sqrt(nearest);
+      const float value = std::clamp(0.5f + distance * scale, 0.0f, 1.0f);
+      field.pixels[static_cast<size_t>(y) * field.width + x] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+    }
+  }
+}
+}  // namespace
+
+FontAtlas::FontAtlas(ResidencyManager* residency) :
+ m_texture(0),
+ m_width(0),
+ m_height(0),
+ m_first(0),
+ m_ascent(0.0f),
+ m_descent(0.0f),
+ m_lineGap(0.0f),
+ m_residency(residency),
+ m_residencyId(-1) {}
+
+FontAtlas::~FontAtlas() {
+  release();
+}
+
+void FontAtlas::release() {
+  if (m_texture) {
+    glDeleteTextures(1, &m_texture);
+    m_texture = 0;
+  }
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->remove(m_residencyId);
+    m_residencyId = -1;
+  }
+}
+
+bool FontAtlas::load(const std::string& filepath, JobSystem* jobs, uint32_t first, uint32_t last) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  if (last < first) {
+    LOG_ERROR_F("[FontAtlas] Empty character range for {}", filepath);
+    return false;
+  }
+
+  std::vector<GlyphField> fields(last - first + 1);
+  std::vector<Glyph> glyphs(fields.size());
+  float ascent;
+  float descent;
+  float lineGap;
+  try {
+    MappedFile file;
+    AssetView view;
+    if (const PackFile* pack = PackFile::mounted()) {
+      view = pack->find(filepath, AssetType::Raw);
+    }
+    if (!view) {
+      file = Utils::mapFile(filepath, FileAccess::Random, false);
+      view.data = file.data();
+      view.size = file.size();
+    }
+    const TrueType font(view.data, view.size);
+
+    const float scale = static_cast<float>(GlyphSize) / font.unitsPerEm;
+    ascent = font.ascent * scale;
+    descent = font.descent * scale;
+    lineGap = font.lineGap * scale;
+
+    // A tenth of a field pixel is far below what the smoothing shows
+    const float tolerance = 0.1f / scale;
+    for (size_t i = 0; i < fields.size(); i++) {
+      const uint32_t glyph = font.glyphIndex(first + static_cast<uint32_t>(i));
+      GlyphField& field = fields[i];
+      glyphs[i].advance = font.advance(glyph) * scale;
+      font.addGlyph(glyph, Transform(), tolerance, 0, field.edges);
+      if (field.edges.empty()) {
+        continue;
+      }
+
+      glm::vec2 low(field.edges[0].a);
+      glm::vec2 high(field.edges[0].a);
+      for (const Edge& edge : field.edges) {
+        low = glm::min(low, glm::min(edge.a, edge.b));
+        high = glm::max(high, glm::max(edge.a, edge.b));
+      }
+      // Into field pixels with the spread as a margin, rows from the top
+      for (Edge& edge : field.edges) {
+        edge.a = glm::vec2(edge.a.x - low.x, high.y - edge.a.y) * scale + glm::vec2(Spread);
+        edge.b = glm::vec2(edge.b.x - low.x, high.y - edge.b.y) * scale + glm::vec2(Spread);
+      }
+      field.width = static_cast<int>(std::ceil((high.x - low.x) * scale)) + Spread * 2;
+      field.height = static_cast<int>(std::ceil((high.y - low.y) * scale)) + Spread * 2;
+      glyphs[i].offset = glm::vec2(low.x * scale - Spread, -high.y * scale - Spread);
+      glyphs[i].size = glm::vec2(field.width, field.height);
+    }
+  } catch (const std::exception& e) {
+    LOG_ERROR_F("[FontAtlas] Failed to load {}: {}", filepath, e.what());
+    return false;
+  }
+
+  if (jobs) {
+    jobs->parallelFor(fields.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        generateField(fields[i]);
+      }
+    });
+  } else {
+    for (GlyphField& field : fields) {
+      generateField(field);
+    }
+  }
+
+  // Shelves from the tallest glyph down
+  std::vector<size_t> order;
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (!fields[i].pixels.empty()) {
+      order.push_back(i);
+    }
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return fields[a].height > fields[b].height; });
+  int x = 0;
+  int y = 0;
+  int shelfHeight = 0;
+  for (size_t i : order) {
+    GlyphField& field = fields[i];
+    if (field.width > AtlasWidth) {
+      LOG_WARNING_F("[FontAtlas] Character {} of {} is too wide for the atlas", first + i, filepath);
+      field.pixels.clear();
+      glyphs[i].size = glm::vec2(0.0f);
+      continue;
+    }
+    if (x + field.width > AtlasWidth) {
+      x = 0;
+      y += shelfHeight + GlyphGap;
+      shelfHeight = 0;
+    }
+    field.x = x;
+    field.y = y;
+    x += field.width + GlyphGap;
+    shelfHeight = std::max(shelfHeight, field.height);
+  }
+  const int height = std::max((y + shelfHeight + 3) & ~3, 4);
+
+  std::vector<uint8_t> atlas(static_cast<size_t>(AtlasWidth) * height, 0);
+  for (size_t i : order) {
+    const GlyphField& field = fields[i];
+    if (field.pixels.empty()) {
+      continue;
+    }
+    for (int row = 0; row < field.height; row++) {
+      std::copy_n(&field.pixels[static_cast<size_t>(row) * field.width],
+                  field.width,
+                  &atlas[static_cast<size_t>(field.y + row) * AtlasWidth + field.x]);
+    }
+    glyphs[i].uv = glm::vec4(static_cast<float>(field.x) / AtlasWidth,
+                             static_cast<float>(field.y) / height,
+                             static_cast<float>(field.x + field.width) / AtlasWidth,
+                             static_cast<float>(field.y + field.height) / height);
+  }
+
+  release();
+  glGenTextures(1, &m_texture);
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, AtlasWidth, height, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  if (m_residency) {
+    m_residencyId = m_residency->add(ResidencyKind::Texture, "font atlas " + filepath, atlas.size());
+  }
+
+  m_width = AtlasWidth;
+  m_height = height;
+  m_first = first;
+  m_glyphs = std::move(glyphs);
+  m_ascent = ascent;
+  m_descent = descent;
+  m_lineGap = lineGap;
+
+  const float milliseconds =
+    std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  LOG_INFO_F("[FontAtlas] {} character(s) from {} in a {}x{} atlas, {:.1f}ms",
+             m_glyphs.size(),
+             filepath,
+             m_width,
+             m_height,
+             milliseconds);
+  return true;
+}
+
+const FontAtlas::Glyph& FontAtlas::getGlyph(uint32_t codepoint) const {
+  if (codepoint >= m_first && codepoint - m_first < m_glyphs.size()) {
+    return m_glyphs[codepoint - m_first];
+  }
+  if ('?' >= m_first && '?' - m_first < m_glyphs.size()) {
+    return m_glyphs['?' - m_first];
+  }
+  return m_glyphs.front();
+}
+
+float FontAtlas::measure(std::string_view text, float pixelSize) const {
+  const float scale = pixelSize / GlyphSize;
+  float width = 0.0f;
+  float line = 0.0f;
+  for (char c : text) {
+    if (c == '\n') {
+      line = 0.0f;
+      continue;
+    }
+    line += getGlyph(static_cast<unsigned char>(c)).advance * scale;
+    width = std::max(width, line);
+  }
+  return width;
+}
@@ -0,0 +1,293 @@
+#include "../include/FrameCapture.hpp"
+#include "../include/ImageIO.hpp"
+#include "../include/Logger.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+constexpr GLuint64 FlushTimeout = 1000000000;  // Nanoseconds flush() waits on a fence per try
+
+std::string numberedPath(const std::string& prefix, uint64_t number) {
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), "_%06llu.png", static_cast<unsigned long long>(number));
+  return prefix + suffix;
+}
+}  // namespace
+
+int FrameCapture::RawStream::append(uint64_t sequence, std::shared_ptr<const CapturedFrame> frame) {
+  std::lock_guard<std::mutex> lock(mutex);
+  waiting[sequence] = std::move(frame);
+  int written = 0;
+  while (!waiting.empty() && waiting.begin()->first == nextSequence) {
+    const CapturedFrame& next = *waiting.begin()->second;
+    const auto size = static_cast<std::streamsize>(next.pixels.size());
+    if (size > 0 && file.write(reinterpret_cast<const char*>(next.pixels.data()), size)) {
+      written++;
+    }
+    waiting.erase(waiting.begin());
+    nextSequence++;
+  }
+  return written;
+}
+
+FrameCapture::FrameCapture(JobSystem& jobs, ResidencyManager* residency) :
+ m_frame(0),
+ m_recording(false),
+ m_recordFormat(CaptureFormat::PNG),
+ m_recordSequence(0),
+ m_recordWidth(0),
+ m_recordHeight(0),
+ m_jobs(jobs),
+ m_encoding(std::make_shared<Encoding>()),
+ m_residency(residency) {
+  for (ReadbackBuffer& buffer : m_buffers) {
+    glGenBuffers(1, &buffer.pbo);
+    if (m_residency) {
+      buffer.residencyId = m_residency->add(ResidencyKind::Buffer, "frame readback buffer", 0);
+    }
+  }
+}
+
+FrameCapture::~FrameCapture() {
+  stopRecording();
+  flush();
+  for (ReadbackBuffer& buffer : m_buffers) {
+    glDeleteBuffers(1, &buffer.pbo);
+    if (m_residency) {
+      m_residency->remove(buffer.residencyId);
+    }
+  }
+}
+
+void FrameCapture::capture(const std::string& path, CaptureFormat format) {
+  Target target;
+  target.path = path;
+  target.format = format;
+  m_requests.push_back(std::move(target));
+}
+
+void FrameCapture::capture(Callback callback) {
+  Target target;
+  target.callback = std::move(callback);
+  m_requests.push_back(std::move(target));
+}
+
+void FrameCapture::startRecording(const std::string& path, CaptureFormat format) {
+  stopRecording();
+  if (format == CaptureFormat::Raw) {
+    m_stream = std::make_shared<RawStream>();
+    m_stream->file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_stream->file) {
+      LOG_ERROR_F("[FrameCapture] Failed to open {} for recording", path);
+      m_stream.reset();
+      return;
+    }
+  }
+  m_recording = true;
+  m_recordPath = path;
+  m_recordFormat = format;
+  m_recordSequence = 0;
+  m_recordWidth = 0;
+  m_recordHeight = 0;
+  LOG_INFO_F("[FrameCapture] Recording to {}", path);
+}
+
+void FrameCapture::stopRecording() {
+  if (!m_recording) {
+    return;
+  }
+  // Frames still in flight hold on to the stream, the file is closed after the last of them
+  m_recording = false;
+  m_stream.reset();
+  LOG_INFO_F("[FrameCapture] Stopped recording {} after {} frame(s)", m_recordPath, m_recordSequence);
+}
+
+void FrameCapture::readBack(int width, int height) {
+  collect(false);
+
+  if (m_recording && m_recordFormat == CaptureFormat::Raw && m_recordWidth > 0 &&
+      (width != m_recordWidth || height != m_recordHeight)) {
+    LOG_WARNING_F("[FrameCapture] The window changed size, stopping the raw recording of {}x{} frames",
+                  m_recordWidth,
+                  m_recordHeight);
+    stopRecording();
+  }
+  if (m_recording && m_recordWidth == 0) {
+    m_recordWidth = width;
+    m_recordHeight = height;
+    if (m_recordFormat == CaptureFormat::Raw) {
+      LOG_INFO_F("[FrameCapture] Raw frames are {}x{} RGBA8", width, height);
+    }
+  }
+
+  if (!m_requests.empty() || m_recording) {
+    issue(width, height);
+  }
+  m_frame++;
+}
+
+void FrameCapture::issue(int width, int height) {
+  ReadbackBuffer* buffer = nullptr;
+  for (ReadbackBuffer& candidate : m_buffers) {
+    if (!candidate.fence) {
+      buffer = &candidate;
+      break;
+    }
+  }
+  if (!buffer) {
+    // Captures wait for the next frame, a recording can't without stalling
+    if (m_recording) {
+      m_stats.dropped++;
+    }
+    return;
+  }
+
+  buffer->targets.swap(m_requests);
+  m_requests.clear();
+  if (m_recording) {
+    Target target;
+    target.format = m_recordFormat;
+    if (m_recordFormat == CaptureFormat::PNG) {
+      target.path = numberedPath(m_recordPath, m_recordSequence);
+    } else {
+      target.stream = m_stream;
+      target.sequence = m_recordSequence;
+    }
+    buffer->targets.push_back(std::move(target));
+    m_recordSequence++;
+  }
+
+  const size_t size = static_cast<size_t>(width) * height * 4;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->pbo);
+  if (buffer->capacity < size) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+    buffer->capacity = size;
+    if (m_residency) {
+      m_residency->resize(buffer->residencyId, size);
+    }
+  }
+  // With a buffer bound the copy is queued on the GPU and the pointer is an offset into the buffer
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glReadBuffer(GL_BACK);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  buffer->width = width;
+  buffer->height = height;
+  buffer->frame = m_frame;
+  m_inFlight.push_back(static_cast<int>(buffer - m_buffers.data()));
+}
+
+void FrameCapture::collect(bool wait) {
+  while (!m_inFlight.empty()) {
+    ReadbackBuffer& buffer = m_buffers[m_inFlight.front()];
+    GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED) {
+      status = glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FlushTimeout);
+    }
+    // Readbacks complete in the order they were issued, nothing behind this one is done either
+    if (status == GL_TIMEOUT_EXPIRED) {
+      break;
+    }
+    glDeleteSync(buffer.fence);
+    buffer.fence = nullptr;
+    m_inFlight.pop_front();
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    auto frame = std::make_shared<CapturedFrame>();
+    frame->width = buffer.width;
+    frame->height = buffer.height;
+    frame->frame = buffer.frame;
+    if (status == GL_WAIT_FAILED) {
+      LOG_ERROR_F("[FrameCapture] Waiting for the readback of frame {} failed", buffer.frame);
+    } else {
+      // The fence says the copy is done, mapping doesn't have to wait for anything
+      const size_t stride = static_cast<size_t>(buffer.width) * 4;
+      const size_t size = stride * buffer.height;
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.pbo);
+      const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+      if (mapped) {
+        // GL rows start at the bottom
+        frame->pixels.resize(size);
+        const uint8_t* source = static_cast<const uint8_t*>(mapped);
+        for (int y = 0; y < buffer.height; y++) {
+          std::memcpy(&frame->pixels[stride * y], source + stride * (buffer.height - 1 - y), stride);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      } else {
+        LOG_ERROR_F("[FrameCapture] Failed to map the readback of frame {}", buffer.frame);
+      }
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    if (frame->pixels.empty()) {
+      m_stats.failed++;
+    } else {
+      m_stats.captured++;
+    }
+    m_stats.latencyFrames = static_cast<int>(m_frame - buffer.frame);
+    m_stats.copyMs =
+      std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::vector<Target> targets;
+    targets.swap(buffer.targets);
+    submit(std::move(frame), std::move(targets));
+  }
+}
+
+void FrameCapture::submit(std::shared_ptr<const CapturedFrame> frame, std::vector<Target> targets) {
+  std::shared_ptr<Encoding> encoding = m_encoding;
+  {
+    std::lock_guard<std::mutex> lock(encoding->mutex);
+    encoding->pending++;
+  }
+  m_jobs.submit([encoding, frame, targets = std::move(targets)]() {
+    uint64_t written = 0;
+    uint64_t failed = 0;
+    for (const Target& target : targets) {
+      if (target.stream) {
+        // Appended even without pixels so the frames after it aren't held back forever
+        written += target.stream->append(target.sequence, frame);
+      } else if (frame->pixels.empty()) {
+        // Already counted as a failed readback
+      } else if (target.callback) {
+        target.callback(*frame);
+      } else {
+        const bool success =
+          target.format == CaptureFormat::PNG
+            ? ImageIO::writePNG(target.path, frame->pixels.data(), frame->width, frame->height, 4)
+            : ImageIO::writeRaw(target.path, frame->pixels.data(), frame->pixels.size());
+        if (success) {
+          written++;
+        } else {
+          failed++;
+        }
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(encoding->mutex);
+    encoding->written += written;
+    encoding->failed += failed;
+    encoding->pending--;
+    encoding->done.notify_all();
+  });
+}
+
+void FrameCapture::flush() {
+  collect(true);
+  std::unique_lock<std::mutex> lock(m_encoding->mutex);
+  m_encoding->done.wait(lock, [this] { return m_encoding->pending == 0; });
+}
+
+CaptureStats FrameCapture::getStats() const {
+  CaptureStats stats = m_stats;
+  stats.inFlight = static_cast<int>(m_inFlight.size());
+  std::lock_guard<std::mutex> lock(m_encoding->mutex);
+  stats.encoding = m_encoding->pending;
+  stats.written = m_encoding->written;
+  stats.failed += m_encoding->failed;
+  return stats;
+}
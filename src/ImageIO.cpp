@@ -0,0 +1,361 @@
+#include "../include/ImageIO.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "stb_image.h"
+
+namespace {
+constexpr int WindowSize = 32768;  // Farthest a deflate match may reach back
+constexpr int HashBits = 15;
+constexpr int MaxChain = 32;  // Candidates tried per position, trades speed for compression
+constexpr int MinMatch = 3;
+constexpr int MaxMatch = 258;
+
+// Deflate length and distance codes, their first value and extra bits
+constexpr std::array<int, 29> LengthBase = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                            31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<int, 29> LengthExtra = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                             2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<int, 30> DistanceBase = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                              33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                              1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<int, 30> DistanceExtra = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                               6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Deflate streams are packed starting at the least significant bit, Huffman codes most significant
+// bit first
+class BitWriter {
+private:
+  std::vector<uint8_t>& m_out;
+  uint32_t m_bits;
+  int m_count;
+
+public:
+  explicit BitWriter(std::vector<uint8_t>& out) : m_out(out), m_bits(0), m_count(0) {}
+
+  void write(uint32_t value, int count) {
+    m_bits |= value << m_count;
+    m_count += count;
+    while (m_count >= 8) {
+      m_out.push_back(static_cast<uint8_t>(m_bits));
+      m_bits >>= 8;
+      m_count -= 8;
+    }
+  }
+
+  void writeCode(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+      reversed |= ((code >> i) & 1u) << (length - 1 - i);
+    }
+    write(reversed, length);
+  }
+
+  void flush() {
+    if (m_count > 0) {
+      m_out.push_back(static_cast<uint8_t>(m_bits));
+    }
+    m_bits = 0;
+    m_count = 0;
+  }
+};
+
+// Fixed Huffman code of a literal/length symbol
+void writeSymbol(BitWriter& bits, int symbol) {
+  if (symbol < 144) {
+    bits.writeCode(0x30 + symbol, 8);
+  } else if (symbol < 256) {
+    bits.writeCode(0x190 + symbol - 144, 9);
+  } else if (symbol < 280) {
+    bits.writeCode(symbol - 256, 7);
+  } else {
+    bits.writeCode(0xC0 + symbol - 280, 8);
+  }
+}
+
+void writeMatch(BitWriter& bits, int length, int distance) {
+  int code = static_cast<int>(LengthBase.size()) - 1;
+  while (LengthBase[code] > length) {
+    code--;
+  }
+  writeSymbol(bits, 257 + code);
+  bits.write(length - LengthBase[code], LengthExtra[code]);
+
+  code = static_cast<int>(DistanceBase.size()) - 1;
+  while (DistanceBase[code] > distance) {
+    code--;
+  }
+  bits.writeCode(code, 5);
+  bits.write(distance - DistanceBase[code], DistanceExtra[code]);
+}
+
+uint32_t hash3(const uint8_t* data) {
+  const uint32_t value = data[0] << 16 | data[1] << 8 | data[2];
+  return (value * 2654435761u) >> (32 - HashBits);
+}
+
+// One final block with the fixed codes, matches found through hash chains over the window
+void deflate(const std::vector<uint8_t>& data, std::vector<uint8_t>& out) {
+  BitWriter bits(out);
+  bits.write(1, 1);  // Final block
+  bits.write(1, 2);  // Fixed Huffman codes
+
+  const int size = static_cast<int>(data.size());
+  std::vector<int> head(1 << HashBits, -1);
+  std::vector<int> previous(WindowSize, -1);
+  auto insert = [&](int position) {
+    if (position + MinMatch <= size) {
+      const uint32_t hash = hash3(&data[position]);
+      previous[position & (WindowSize - 1)] = head[hash];
+      head[hash] = position;
+    }
+  };
+
+  int position = 0;
+  while (position < size) {
+    int bestLength = 0;
+    int bestDistance = 0;
+    if (position + MinMatch <= size) {
+      const int maxLength = std::min(MaxMatch, size - position);
+      int candidate = head[hash3(&data[position])];
+      for (int chain = 0; chain < MaxChain && candidate >= 0 && position - candidate <= WindowSize; chain++) {
+        int length = 0;
+        while (length < maxLength && data[candidate + length] == data[position + length]) {
+          length++;
+        }
+        if (length > bestLength) {
+          bestLength = length;
+          bestDistance = position - candidate;
+          if (length == maxLength) {
+            break;
+          }
+        }
+        candidate = previous[candidate & (WindowSize - 1)];
+      }
+    }
+
+    if (bestLength >= MinMatch) {
+      writeMatch(bits, bestLength, bestDistance);
+      for (int i = 0; i < bestLength; i++) {
+        insert(position + i);
+      }
+      position += bestLength;
+    } else {
+      writeSymbol(bits, data[position]);
+      insert(position);
+      position++;
+    }
+  }
+  writeSymbol(bits, 256);  // End of block
+  bits.flush();
+}
+
+uint32_t adler32(const std::vector<uint8_t>& data) {
+  uint32_t a = 1;
+  uint32_t b = 0;
+  size_t i = 0;
+  while (i < data.size()) {
+    // Largest run that can't overflow before the modulo
+    const size_t end = std::min(data.size(), i + 5552);
+    for (; i < end; i++) {
+      a += data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return b << 16 | a;
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> entries{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++) {
+        value = value & 1u ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+      }
+      entries[i] = value;
+    }
+    return entries;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+void appendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+  appendBigEndian(png, static_cast<uint32_t>(data.size()));
+  const size_t start = png.size();
+  png.insert(png.end(), type, type + 4);
+  png.insert(png.end(), data.begin(), data.end());
+  appendBigEndian(png, crc32(&png[start], png.size() - start));
+}
+
+uint8_t paeth(int left, int up, int upLeft) {
+  const int estimate = left + up - upLeft;
+  const int toLeft = std::abs(estimate - left);
+  const int toUp = std::abs(estimate - up);
+  const int toUpLeft = std::abs(estimate - upLeft);
+  if (toLeft <= toUp && toLeft <= toUpLeft) {
+    return static_cast<uint8_t>(left);
+  }
+  return static_cast<uint8_t>(toUp <= toUpLeft ? up : upLeft);
+}
+
+// Rows prefixed with their filter type, the filter is the one with the smallest sum of residuals
+std::vector<uint8_t> filterRows(const uint8_t* pixels, int width, int height, int channels) {
+  const size_t stride = static_cast<size_t>(width) * channels;
+  std::vector<uint8_t> filtered;
+  filtered.reserve((stride + 1) * height);
+  std::array<std::vector<uint8_t>, 5> candidates;
+  for (auto& candidate : candidates) {
+    candidate.resize(stride);
+  }
+  const std::vector<uint8_t> zeros(stride, 0);
+
+  for (int y = 0; y < height; y++) {
+    const uint8_t* row = pixels + stride * y;
+    const uint8_t* above = y > 0 ? row - stride : zeros.data();
+    for (size_t i = 0; i < stride; i++) {
+      const int left = i >= static_cast<size_t>(channels) ? row[i - channels] : 0;
+      const int upLeft = i >= static_cast<size_t>(channels) ? above[i - channels] : 0;
+      candidates[0][i] = row[i];
+      candidates[1][i] = static_cast<uint8_t>(row[i] - left);
+      candidates[2][i] = static_cast<uint8_t>(row[i] - above[i]);
+      candidates[3][i] = static_cast<uint8_t>(row[i] - ((left + above[i]) >> 1));
+      candidates[4][i] = static_cast<uint8_t>(row[i] - paeth(left, above[i], upLeft));
+    }
+
+    int best = 0;
+    uint64_t bestSum = UINT64_MAX;
+    for (int filter = 0; filter < 5; filter++) {
+      uint64_t sum = 0;
+      for (uint8_t residual : candidates[filter]) {
+        sum += std::abs(static_cast<int8_t>(residual));
+      }
+      if (sum < bestSum) {
+        bestSum = sum;
+        best = filter;
+      }
+    }
+    filtered.push_back(static_cast<uint8_t>(best));
+    filtered.insert(filtered.end(), candidates[best].begin(), candidates[best].end());
+  }
+  return filtered;
+}
+}  // namespace
+
+namespace ImageIO {
+std::vector<uint8_t> encodePNG(const uint8_t* pixels, int width, int height, int channels) {
+  static const uint8_t ColorTypes[] = {0, 0, 4, 2, 6};  // By channel count
+  if (!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+    return {};
+  }
+
+  std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  std::vector<uint8_t> header;
+  appendBigEndian(header, static_cast<uint32_t>(width));
+  appendBigEndian(header, static_cast<uint32_t>(height));
+  header.push_back(8);  // Bits per channel
+  header.push_back(ColorTypes[channels]);
+  header.push_back(0);  // Deflate
+  header.push_back(0);  // Adaptive filtering
+  header.push_back(0);  // Not interlaced
+  appendChunk(png, "IHDR", header);
+
+  const std::vector<uint8_t> filtered = filterRows(pixels, width, height, channels);
+  std::vector<uint8_t> zlib = {0x78, 0x01};  // 32K window, no dictionary
+  deflate(filtered, zlib);
+  appendBigEndian(zlib, adler32(filtered));
+  appendChunk(png, "IDAT", zlib);
+  appendChunk(png, "IEND", {});
+  return png;
+}
+
+bool writePNG(const std::string& filepath, const uint8_t* pixels, int width, int height, int channels) {
+  const std::vector<uint8_t> png = encodePNG(pixels, width, height, channels);
+  if (png.empty()) {
+    LOG_ERROR_F("[ImageIO] Cannot encode a {}x{} image with {} channel(s)", width, height, channels);
+    return false;
+  }
+  return writeRaw(filepath, png.data(), png.size());
+}
+
+bool writeRaw(const std::string& filepath, const uint8_t* pixels, size_t size) {
+  std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+  if (!file.write(reinterpret_cast<const char*>(pixels), static_cast<std::streamsize>(size))) {
+    LOG_ERROR_F("[ImageIO] Failed to write {}", filepath);
+    return false;
+  }
+  return true;
+}
+
+ImageDifference compare(const uint8_t* a, const uint8_t* b, int width, int height, int channels, int tolerance) {
+  ImageDifference difference;
+  difference.sizeMatches = true;
+  difference.pixels = static_cast<size_t>(width) * height;
+  uint64_t total = 0;
+  for (size_t pixel = 0; pixel < difference.pixels; pixel++) {
+    int pixelDifference = 0;
+    for (int c = 0; c < channels; c++) {
+      const size_t i = pixel * channels + c;
+      const int channelDifference = std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+      pixelDifference = std::max(pixelDifference, channelDifference);
+      total += channelDifference;
+    }
+    difference.maxDifference = std::max(difference.maxDifference, pixelDifference);
+    if (pixelDifference > tolerance) {
+      difference.differingPixels++;
+    }
+  }
+  if (difference.pixels > 0) {
+    difference.meanError = static_cast<double>(total) / (difference.pixels * channels);
+  }
+  return difference;
+}
+
+ImageDifference compareToFile(const std::string& reference,
+                              const uint8_t* pixels,
+                              int width,
+                              int height,
+                              int channels,
+                              int tolerance) {
+  // Textures are loaded flipped for GL, this thread may have done that before
+  stbi_set_flip_vertically_on_load_thread(false);
+  int referenceWidth = 0;
+  int referenceHeight = 0;
+  int referenceChannels = 0;
+  stbi_uc* data = stbi_load(reference.c_str(), &referenceWidth, &referenceHeight, &referenceChannels, channels);
+  if (!data) {
+    LOG_ERROR_F("[ImageIO] Failed to load reference image {}: {}", reference, stbi_failure_reason());
+    return {};
+  }
+  if (referenceWidth != width || referenceHeight != height) {
+    LOG_ERROR_F("[ImageIO] Reference image {} is {}x{}, expected {}x{}",
+                reference,
+                referenceWidth,
+                referenceHeight,
+                width,
+                height);
+    stbi_image_free(data);
+    return {};
+  }
+  ImageDifference difference = compare(data, pixels, width, height, channels, tolerance);
+  stbi_image_free(data);
+  return difference;
+}
+}  // namespace ImageIO
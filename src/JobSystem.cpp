@@ -0,0 +1,112 @@
+#include "../include/JobSystem.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+
+JobSystem::JobSystem(unsigned int workerCount) : m_activeJobs(0), m_stopping(false) {
+  if (workerCount == 0) {
+    workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  }
+
+  m_workers.reserve(workerCount);
+  for (unsigned int i = 0; i < workerCount; i++) {
+    m_workers.emplace_back(&JobSystem::workerLoop, this);
+  }
+
+  LOG_INFO_F("[JobSystem] Started {} worker thread(s)", workerCount);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_jobAvailable.notify_all();
+
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void JobSystem::submit(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(std::move(job));
+  }
+  m_jobAvailable.notify_one();
+}
+
+void JobSystem::waitIdle() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle.wait(lock, [this] { return m_jobs.empty() && m_activeJobs == 0; });
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+  grain = std::max<size_t>(grain, 1);
+  const size_t chunks = (count + grain - 1) / grain;
+  if (chunks <= 1 || m_workers.empty()) {
+    if (count > 0) {
+      body(0, count);
+    }
+    return;
+  }
+
+  // Shared with the helpers, a helper that only starts after everything is done finds no chunk left
+  struct Batch {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+  auto batch = std::make_shared<Batch>();
+  const std::function<void(size_t, size_t)>* work = &body;
+  auto run = [batch, work, count, grain, chunks]() {
+    size_t chunk;
+    while ((chunk = batch->next.fetch_add(1)) < chunks) {
+      (*work)(chunk * grain, std::min(count, (chunk + 1) * grain));
+      if (batch->finished.fetch_add(1) + 1 == chunks) {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        batch->done.notify_all();
+      }
+    }
+  };
+
+  const size_t helpers = std::min(m_workers.size(), chunks - 1);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < helpers; i++) {
+      m_jobs.push_front(run);
+    }
+  }
+  m_jobAvailable.notify_all();
+
+  run();
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->done.wait(lock, [&batch, chunks] { return batch->finished.load() == chunks; });
+}
+
+void JobSystem::workerLoop() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+      if (m_jobs.empty()) {
+        return;  // Stopping and drained
+      }
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+      m_activeJobs++;
+    }
+
+    job();
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_activeJobs--;
+      if (m_jobs.empty() && m_activeJobs == 0) {
+        m_idle.notify_all();
+      }
+    }
+  }
+}
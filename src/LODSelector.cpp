@@ -0,0 +1,57 @@
+#include "../include/LODSelector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+LODSelector::LODSelector(float pixelError, float hysteresis) : m_pixelError(pixelError), m_hysteresis(hysteresis) {}
+
+float LODSelector::projectedRadius(const AABB& worldBounds, const glm::vec3& eye, float fovY, int viewportHeight) {
+  float radius = glm::length(worldBounds.extent()) * 0.5f;
+  float distance = glm::length(worldBounds.center() - eye);
+
+  // Inside the bounding sphere the object covers the screen
+  if (distance <= radius) {
+    return std::numeric_limits<float>::max();
+  }
+
+  return radius / (distance * std::tan(fovY * 0.5f)) * (viewportHeight * 0.5f);
+}
+
+void LODSelector::beginFrame() {
+  m_stats.objects = 0;
+  m_stats.triangles = 0;
+  m_stats.switches = 0;
+  std::fill(m_stats.objectsPerLevel.begin(), m_stats.objectsPerLevel.end(), 0);
+}
+
+int LODSelector::select(const std::vector<MeshLOD>& lods, float projectedRadius, int currentLOD) {
+  if (lods.empty()) {
+    return 0;
+  }
+  int level = std::clamp(currentLOD, 0, static_cast<int>(lods.size()) - 1);
+
+  // LOD errors are relative to the mesh radius, so this is the error in pixels
+  auto pixelError = [&](int lod) { return lods[lod].error * projectedRadius; };
+
+  // Coarsen only once the next level is comfortably under budget, refine as soon as the current
+  // one is clearly over it
+  while (level + 1 < static_cast<int>(lods.size()) && pixelError(level + 1) <= m_pixelError * (1.0f - m_hysteresis)) {
+    level++;
+  }
+  while (level > 0 && pixelError(level) > m_pixelError * (1.0f + m_hysteresis)) {
+    level--;
+  }
+
+  if (static_cast<int>(m_stats.objectsPerLevel.size()) <= level) {
+    m_stats.objectsPerLevel.resize(level + 1, 0);
+  }
+  m_stats.objects++;
+  m_stats.triangles += lods[level].indexCount / 3;
+  m_stats.objectsPerLevel[level]++;
+  if (level != currentLOD) {
+    m_stats.switches++;
+  }
+
+  return level;
+}
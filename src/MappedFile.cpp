@@ -0,0 +1,170 @@
+#include "../include/MappedFile.hpp"
+#include "../include/Logger.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_open, other.m_open);
+    std::swap(m_mapped, other.m_mapped);
+    // Moving a vector keeps its storage, so m_data stays valid for read files too
+    std::swap(m_buffer, other.m_buffer);
+#ifdef _WIN32
+    std::swap(m_file, other.m_file);
+    std::swap(m_mapping, other.m_mapping);
+#else
+    std::swap(m_fd, other.m_fd);
+#endif
+  }
+  return *this;
+}
+
+bool MappedFile::open(const std::string& filepath, FileAccess access) {
+  close();
+  if (map(filepath, access)) {
+    m_open = true;
+    m_mapped = true;
+    return true;
+  }
+  if (read(filepath)) {
+    m_open = true;
+    return true;
+  }
+  LOG_ERROR_F("[MappedFile] Unable to open {}", filepath);
+  return false;
+}
+
+bool MappedFile::read(const std::string& filepath) {
+  std::ifstream file(filepath, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  if (file.bad()) {
+    m_buffer.clear();
+    return false;
+  }
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+  return true;
+}
+
+#ifdef _WIN32
+bool MappedFile::map(const std::string& filepath, FileAccess access) {
+  const DWORD hint = access == FileAccess::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+  HANDLE file =
+    CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, hint, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  // Empty files can't be mapped, they go through the read path
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!view) {
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file = file;
+  m_mapping = mapping;
+  m_data = static_cast<const uint8_t*>(view);
+  m_size = static_cast<size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_mapped) {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping) {
+    CloseHandle(m_mapping);
+  }
+  if (m_file) {
+    CloseHandle(m_file);
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+  m_mapped = false;
+  m_buffer = {};
+  m_mapping = nullptr;
+  m_file = nullptr;
+}
+#else
+bool MappedFile::map(const std::string& filepath, FileAccess access) {
+  int fd = ::open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  // Only regular, non-empty files can be mapped, everything else goes through the read path
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  size_t size = static_cast<size_t>(info.st_size);
+  void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (view == MAP_FAILED) {
+    ::close(fd);
+    return false;
+  }
+  // Only a hint, the mapping works the same if the kernel ignores it
+  madvise(view, size, access == FileAccess::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+  m_fd = fd;
+  m_data = static_cast<const uint8_t*>(view);
+  m_size = size;
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_mapped) {
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+  m_mapped = false;
+  m_buffer = {};
+  m_fd = -1;
+}
+#endif
@@ -0,0 +1,457 @@
+#include "../include/Material.hpp"
+#include "../include/Logger.hpp"
+#include "../include/PackFile.hpp"
+#include "../include/Utils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+// Just enough XML for MaterialX: elements and their attributes, text and comments are skipped
+struct XmlElement {
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> attributes;
+  std::vector<XmlElement> children;
+
+  const std::string* attribute(std::string_view key) const {
+    for (const auto& [name, value] : attributes) {
+      if (name == key) {
+        return &value;
+      }
+    }
+    return nullptr;
+  }
+  std::string get(std::string_view key) const {
+    const std::string* value = attribute(key);
+    return value ? *value : std::string();
+  }
+};
+
+class XmlParser {
+private:
+  std::string_view m_text;
+  size_t m_position = 0;
+
+  [[noreturn]] void fail(const char* what) const {
+    throw std::runtime_error(std::string("Malformed MaterialX document: ") + what + " at offset " +
+                             std::to_string(m_position));
+  }
+
+  bool startsWith(std::string_view prefix) const {
+    return m_text.compare(m_position, prefix.size(), prefix) == 0;
+  }
+
+  void skipPast(std::string_view terminator) {
+    size_t end = m_text.find(terminator, m_position);
+    if (end == std::string_view::npos) {
+      fail("unterminated markup");
+    }
+    m_position = end + terminator.size();
+  }
+
+  void skipSpace() {
+    while (m_position < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_position]))) {
+      m_position++;
+    }
+  }
+
+  std::string readName() {
+    size_t begin = m_position;
+    while (m_position < m_text.size()) {
+      char c = m_text[m_position];
+      if (std::isspace(static_cast<unsigned char>(c)) || c == '=' || c == '>' || c == '/') {
+        break;
+      }
+      m_position++;
+    }
+    if (m_position == begin) {
+      fail("expected a name");
+    }
+    return std::string(m_text.substr(begin, m_position - begin));
+  }
+
+  static std::string decode(std::string_view value) {
+    static const std::pair<std::string_view, char> entities[] = {
+      {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+    std::string out;
+    for (size_t i = 0; i < value.size(); i++) {
+      bool replaced = false;
+      if (value[i] == '&') {
+        for (const auto& [entity, c] : entities) {
+          if (value.compare(i, entity.size(), entity) == 0) {
+            out += c;
+            i += entity.size() - 1;
+            replaced = true;
+            break;
+          }
+        }
+      }
+      if (!replaced) {
+        out += value[i];
+      }
+    }
+    return out;
+  }
+
+  // Declarations, comments, processing instructions and text between elements
+  void skipMisc() {
+    while (true) {
+      size_t next = m_text.find('<', m_position);
+      m_position = next == std::string_view::npos ? m_text.size() : next;
+      if (startsWith("<!--")) {
+        skipPast("-->");
+      } else if (startsWith("<?") || startsWith("<!")) {
+        skipPast(">");
+      } else {
+        return;
+      }
+    }
+  }
+
+  XmlElement readElement() {
+    m_position++;  // '<'
+    XmlElement element;
+    element.name = readName();
+    while (true) {
+      skipSpace();
+      if (startsWith("/>")) {
+        m_position += 2;
+        return element;
+      }
+      if (startsWith(">")) {
+        m_position++;
+        break;
+      }
+      std::string key = readName();
+      skipSpace();
+      if (!startsWith("=")) {
+        fail("expected '='");
+      }
+      m_position++;
+      skipSpace();
+      if (m_position >= m_text.size() || (m_text[m_position] != '"' && m_text[m_position] != '\'')) {
+        fail("expected a quoted value");
+      }
+      char quote = m_text[m_position++];
+      size_t end = m_text.find(quote, m_position);
+      if (end == std::string_view::npos) {
+        fail("unterminated value");
+      }
+      element.attributes.emplace_back(std::move(key), decode(m_text.substr(m_position, end - m_position)));
+      m_position = end + 1;
+    }
+
+    while (true) {
+      skipMisc();
+      if (m_position >= m_text.size()) {
+        fail("unclosed element");
+      }
+      if (startsWith("</")) {
+        skipPast(">");
+        return element;
+      }
+      element.children.push_back(readElement());
+    }
+  }
+
+public:
+  explicit XmlParser(std::string_view text) : m_text(text) {}
+
+  XmlElement parse() {
+    skipMisc();
+    if (m_position >= m_text.size()) {
+      fail("no root element");
+    }
+    return readElement();
+  }
+};
+
+// What an input comes down to: a value, or an image and how it is tiled
+struct Resolved {
+  std::string value;
+  std::string file;
+  glm::vec2 tiling = glm::vec2(1.0f);
+  float scale = 1.0f;  // Of a normalmap node on the way
+};
+
+std::vector<float> parseFloats(const std::string& value) {
+  std::vector<float> result;
+  const char* cursor = value.c_str();
+  while (*cursor) {
+    char* end = nullptr;
+    float number = std::strtof(cursor, &end);
+    if (end == cursor) {
+      cursor++;  // Separator
+      continue;
+    }
+    result.push_back(number);
+    cursor = end;
+  }
+  return result;
+}
+
+class Resolver {
+private:
+  const XmlElement& m_root;
+  std::string m_directory;
+  static constexpr int MaxDepth = 16;
+
+  static const XmlElement* findChild(const XmlElement& parent, const std::string& name, const char* tag = nullptr) {
+    for (const XmlElement& child : parent.children) {
+      if ((!tag || child.name == tag) && child.get("name") == name) {
+        return &child;
+      }
+    }
+    return nullptr;
+  }
+
+  std::string filePath(const std::string& file, const XmlElement* graph) const {
+    std::string prefix = m_root.get("fileprefix") + (graph ? graph->get("fileprefix") : std::string());
+    std::filesystem::path path = std::filesystem::path(m_directory) / (prefix + file);
+    return path.lexically_normal().generic_string();
+  }
+
+  Resolved node(const XmlElement& element, const XmlElement* graph, int depth) const {
+    Resolved result;
+    if (element.name == "tiledimage" || element.name == "image") {
+      if (const XmlElement* file = findChild(element, "file", "input")) {
+        Resolved path = input(*file, graph, depth + 1);
+        if (!path.value.empty()) {
+          result.file = filePath(path.value, graph);
+        }
+      }
+      if (const XmlElement* tiling = findChild(element, "uvtiling", "input")) {
+        std::vector<float> values = parseFloats(input(*tiling, graph, depth + 1).value);
+        if (values.size() >= 2) {
+          result.tiling = glm::vec2(values[0], values[1]);
+        }
+      }
+      return result;
+    }
+    if (element.name == "constant") {
+      const XmlElement* value = findChild(element, "value", "input");
+      return value ? input(*value, graph, depth + 1) : result;
+    }
+    if (element.name == "normalmap") {
+      if (const XmlElement* in = findChild(element, "in", "input")) {
+        result = input(*in, graph, depth + 1);
+      }
+      if (const XmlElement* scale = findChild(element, "scale", "input")) {
+        std::vector<float> values = parseFloats(input(*scale, graph, depth + 1).value);
+        result.scale = values.empty() ? 1.0f : values[0];
+      }
+      return result;
+    }
+    // Anything else combining inputs stands for the first image it reads
+    for (const XmlElement& child : element.children) {
+      if (child.name == "input" && (child.attribute("nodename") || child.attribute("nodegraph"))) {
+        Resolved candidate = input(child, graph, depth + 1);
+        if (!candidate.file.empty()) {
+          return candidate;
+        }
+      }
+    }
+    return result;
+  }
+
+public:
+  Resolver(const XmlElement& root, std::string directory) : m_root(root), m_directory(std::move(directory)) {}
+
+  Resolved input(const XmlElement& element, const XmlElement* graph, int depth = 0) const {
+    Resolved result;
+    result.value = element.get("value");
+    if (depth > MaxDepth) {
+      return result;
+    }
+
+    if (const std::string* graphName = element.attribute("nodegraph")) {
+      const XmlElement* target = findChild(m_root, *graphName, "nodegraph");
+      if (!target) {
+        return result;
+      }
+      const XmlElement* output = nullptr;
+      if (const std::string* outputName = element.attribute("output")) {
+        output = findChild(*target, *outputName, "output");
+      } else {
+        for (const XmlElement& child : target->children) {
+          if (child.name == "output") {
+            output = &child;
+            break;
+          }
+        }
+      }
+      return output ? input(*output, target, depth + 1) : result;
+    }
+
+    const XmlElement* scope = graph ? graph : &m_root;
+    if (const std::string* nodeName = element.attribute("nodename")) {
+      const XmlElement* target = findChild(*scope, *nodeName);
+      if (target) {
+        Resolved resolved = node(*target, graph, depth + 1);
+        if (resolved.value.empty()) {
+          resolved.value = result.value;
+        }
+        return resolved;
+      }
+      return result;
+    }
+
+    // A nodegraph's interface input, its value is set on the graph
+    if (const std::string* interfaceName = element.attribute("interfacename")) {
+      if (graph) {
+        if (const XmlElement* source = findChild(*graph, *interfaceName, "input")) {
+          return input(*source, nullptr, depth + 1);
+        }
+      }
+    }
+    return result;
+  }
+
+  const XmlElement* find(const std::string& name) const {
+    return findChild(m_root, name);
+  }
+};
+
+void applyFloat(const Resolved& input, float& target) {
+  std::vector<float> values = parseFloats(input.value);
+  if (!values.empty()) {
+    target = values[0];
+  }
+}
+
+void applyColor(const Resolved& input, glm::vec3& target) {
+  std::vector<float> values = parseFloats(input.value);
+  if (values.size() >= 3) {
+    target = glm::vec3(values[0], values[1], values[2]);
+  } else if (values.size() == 1) {
+    target = glm::vec3(values[0]);
+  }
+}
+
+Material surface(const Resolver& resolver, const XmlElement& shader, std::string name) {
+  Material material;
+  material.name = std::move(name);
+
+  // Connections first: exporters repeat inputs with and without one, and the plain value of a
+  // connected input is only its fallback. A map's factor is 1, the map alone gives the value.
+  std::vector<std::string> connected;
+  for (const XmlElement& child : shader.children) {
+    if (child.name != "input" || (!child.attribute("nodename") && !child.attribute("nodegraph"))) {
+      continue;
+    }
+    const std::string inputName = child.get("name");
+    Resolved input = resolver.input(child, nullptr);
+    if (input.file.empty() || std::find(connected.begin(), connected.end(), inputName) != connected.end()) {
+      continue;
+    }
+
+    if (inputName == "base_color") {
+      material.baseColorMap = input.file;
+      material.baseColor = glm::vec3(1.0f);
+    } else if (inputName == "metalness") {
+      material.metalnessMap = input.file;
+      material.metalness = 1.0f;
+    } else if (inputName == "specular_roughness") {
+      material.roughnessMap = input.file;
+      material.roughness = 1.0f;
+    } else if (inputName == "normal") {
+      material.normalMap = input.file;
+      material.normalScale = input.scale;
+    } else {
+      continue;
+    }
+    // One set of texture coordinates for the whole material, the base color's when it has a map
+    if (connected.empty() || inputName == "base_color") {
+      material.uvTiling = input.tiling;
+    }
+    connected.push_back(inputName);
+  }
+
+  for (const XmlElement& child : shader.children) {
+    const std::string inputName = child.get("name");
+    if (child.name != "input" || std::find(connected.begin(), connected.end(), inputName) != connected.end()) {
+      continue;
+    }
+    Resolved input = resolver.input(child, nullptr);
+
+    if (inputName == "base") {
+      applyFloat(input, material.base);
+    } else if (inputName == "base_color") {
+      applyColor(input, material.baseColor);
+    } else if (inputName == "metalness") {
+      applyFloat(input, material.metalness);
+    } else if (inputName == "specular_roughness") {
+      applyFloat(input, material.roughness);
+    } else if (inputName == "specular") {
+      applyFloat(input, material.specular);
+    } else if (inputName == "specular_IOR") {
+      applyFloat(input, material.specularIOR);
+    } else if (inputName == "coat") {
+      applyFloat(input, material.coat);
+    } else if (inputName == "coat_color") {
+      applyColor(input, material.coatColor);
+    } else if (inputName == "coat_roughness") {
+      applyFloat(input, material.coatRoughness);
+    } else if (inputName == "emission") {
+      applyFloat(input, material.emission);
+    } else if (inputName == "emission_color") {
+      applyColor(input, material.emissionColor);
+    } else if (inputName == "opacity") {
+      applyFloat(input, material.opacity);  // color3, the first channel stands for all
+    }
+  }
+  return material;
+}
+}  // namespace
+
+namespace MaterialX {
+std::vector<Material> load(const std::string& filepath) {
+  const std::string directory = std::filesystem::path(filepath).parent_path().string();
+  if (const PackFile* pack = PackFile::mounted()) {
+    if (AssetView view = pack->find(filepath, AssetType::Raw)) {
+      return parse(view.text(), directory);
+    }
+  }
+  MappedFile file = Utils::mapFile(filepath, FileAccess::Sequential, false);
+  return parse(file.text(), directory);
+}
+
+std::vector<Material> parse(std::string_view document, const std::string& directory) {
+  XmlElement root = XmlParser(document).parse();
+  if (root.name != "materialx") {
+    throw std::runtime_error("Not a MaterialX document (root element <" + root.name + ">)");
+  }
+
+  Resolver resolver(root, directory);
+  std::vector<Material> materials;
+  for (const XmlElement& element : root.children) {
+    if (element.name != "surfacematerial") {
+      continue;
+    }
+    for (const XmlElement& input : element.children) {
+      if (input.name != "input" || input.get("name") != "surfaceshader") {
+        continue;
+      }
+      const XmlElement* shader = resolver.find(input.get("nodename"));
+      if (shader && shader->name == "standard_surface") {
+        materials.push_back(surface(resolver, *shader, element.get("name")));
+      } else {
+        LOG_WARNING_F("[MaterialX] {} has no standard_surface, skipped", element.get("name"));
+      }
+    }
+  }
+
+  if (materials.empty()) {
+    for (const XmlElement& element : root.children) {
+      if (element.name == "standard_surface") {
+        materials.push_back(surface(resolver, element, element.get("name")));
+      }
+    }
+  }
+  return materials;
+}
+}  // namespace MaterialX
@@ -0,0 +1,182 @@
+#include "../include/MaterialTable.hpp"
+#include "../include/Logger.hpp"
+#include "../include/PackFile.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+MaterialTable::MaterialTable(TexturePool& pool, ResidencyManager* residency) :
+ m_pool(pool), m_residency(residency), m_buffer(0), m_residencyId(-1), m_dirtyBegin(0), m_dirtyEnd(0) {
+  // Allocated at full size once, adding materials only ever writes into it
+  const size_t bytes = sizeof(GPUMaterial) * Capacity;
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferData(GL_UNIFORM_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  if (m_residency) {
+    m_residencyId = m_residency->add(ResidencyKind::Buffer, "material table", bytes);
+  }
+
+  Material fallback;
+  fallback.name = "default";
+  add(fallback);
+}
+
+MaterialTable::~MaterialTable() {
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->remove(m_residencyId);
+  }
+  if (m_buffer) {
+    glDeleteBuffers(1, &m_buffer);
+  }
+}
+
+namespace {
+// In the order of the MAP_* slots in materials.glsl
+constexpr TextureUsage MapUsages[4] = {
+  TextureUsage::Color, TextureUsage::Normal, TextureUsage::Mask, TextureUsage::Mask};
+}  // namespace
+
+TextureRegion MaterialTable::defaultMap(int map) {
+  static const char* const names[4] = {
+    "<default base color>", "<default normal>", "<default roughness>", "<default metalness>"};
+  // A grey checker for base color so the gap shows, the others hold the standard_surface defaults
+  // (flat, roughness 0.2, metalness 0) since the factor of a material with a map is 1
+  const uint8_t constants[4][4] = {{0, 0, 0, 0}, {128, 128, 255, 255}, {51, 51, 51, 255}, {0, 0, 0, 255}};
+  uint8_t pixels[4 * 4 * 4];
+  for (int i = 0; i < 16; i++) {
+    const uint8_t grey = ((i % 4) / 2 + i / 8) % 2 ? 192 : 128;
+    const uint8_t checker[4] = {grey, grey, grey, 255};
+    std::copy_n(map == 0 ? checker : constants[map], 4, pixels + i * 4);
+  }
+  return m_pool.add(names[map], pixels, 4, 4, MapUsages[map]);
+}
+
+TextureRegion MaterialTable::loadMap(const std::string& path, int map) {
+  if (path.empty()) {
+    return {};
+  }
+  // Documents often name maps that weren't shipped with them, those get a stand-in
+  const PackFile* pack = PackFile::mounted();
+  std::error_code error;
+  if (!(pack && pack->find(path)) && !std::filesystem::exists(path, error)) {
+    LOG_WARNING_F("[MaterialTable] Missing map {}, using a default texture", path);
+    return defaultMap(map);
+  }
+  const TextureUsage usage = MapUsages[map];
+
+  TextureRegion region = m_pool.load(path, usage);
+  if (region.isValid() && region.array >= MaxArrays) {
+    LOG_WARNING_F(
+      "[MaterialTable] {} is in texture array {}, materials can only sample {}", path, region.array, MaxArrays);
+    return {};
+  }
+  return region;
+}
+
+MaterialTable::GPUMaterial MaterialTable::pack(const Material& material) {
+  GPUMaterial entry;
+  entry.baseColor = glm::vec4(material.baseColor * material.base, material.opacity);
+  entry.surface = glm::vec4(material.metalness, material.roughness, material.specular, material.normalScale);
+  entry.coat = glm::vec4(material.coatColor, material.coat);
+  entry.emission = glm::vec4(material.emissionColor * material.emission, material.coatRoughness);
+  entry.uv = glm::vec4(material.uvTiling, material.specularIOR, 0.0f);
+
+  const TextureRegion maps[4] = {
+    loadMap(material.baseColorMap, 0),
+    loadMap(material.normalMap, 1),
+    loadMap(material.roughnessMap, 2),
+    loadMap(material.metalnessMap, 3),
+  };
+  for (int i = 0; i < 4; i++) {
+    entry.arrays[i] = maps[i].array;
+    entry.layers[i] = maps[i].layer;
+    entry.rects[i] = maps[i].uvRect;
+  }
+  m_pool.finalize();
+  return entry;
+}
+
+int MaterialTable::add(const Material& material) {
+  int existing = find(material.name);
+  if (existing >= 0) {
+    return existing;
+  }
+  if (getCount() >= Capacity) {
+    LOG_ERROR_F("[MaterialTable] Table is full ({} materials), {} not added", Capacity, material.name);
+    return -1;
+  }
+
+  const int index = getCount();
+  m_materials.push_back(material);
+  m_entries.push_back(pack(material));
+  m_lookup[material.name] = index;
+  m_dirtyBegin = m_dirtyBegin < m_dirtyEnd ? std::min(m_dirtyBegin, index) : index;
+  m_dirtyEnd = index + 1;
+  return index;
+}
+
+int MaterialTable::load(const std::string& path) {
+  std::vector<Material> materials;
+  try {
+    materials = MaterialX::load(path);
+  } catch (const std::exception& e) {
+    LOG_ERROR_F("[MaterialTable] Failed to load {}: {}", path, e.what());
+    return -1;
+  }
+
+  int first = -1;
+  for (Material& material : materials) {
+    material.name = path + ":" + material.name;
+    int index = add(material);
+    if (first < 0) {
+      first = index;
+    }
+  }
+  LOG_INFO_F("[MaterialTable] {} material(s) from {}", materials.size(), path);
+  return first;
+}
+
+void MaterialTable::set(int index, const Material& material) {
+  if (m_materials[index].name != material.name) {
+    m_lookup.erase(m_materials[index].name);
+    m_lookup[material.name] = index;
+  }
+  m_materials[index] = material;
+  m_entries[index] = pack(material);
+  m_dirtyBegin = m_dirtyBegin < m_dirtyEnd ? std::min(m_dirtyBegin, index) : index;
+  m_dirtyEnd = std::max(m_dirtyEnd, index + 1);
+}
+
+int MaterialTable::find(const std::string& name) const {
+  auto it = m_lookup.find(name);
+  return it != m_lookup.end() ? it->second : -1;
+}
+
+void MaterialTable::upload() {
+  if (m_dirtyBegin >= m_dirtyEnd) {
+    return;
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER,
+                  sizeof(GPUMaterial) * m_dirtyBegin,
+                  sizeof(GPUMaterial) * (m_dirtyEnd - m_dirtyBegin),
+                  m_entries.data() + m_dirtyBegin);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+void MaterialTable::bind(const Shader& shader) const {
+  GLuint block = glGetUniformBlockIndex(shader.m_id, "MaterialTable");
+  if (block != GL_INVALID_INDEX) {
+    glUniformBlockBinding(shader.m_id, block, BindingPoint);
+  }
+  glBindBufferBase(GL_UNIFORM_BUFFER, BindingPoint, m_buffer);
+
+  const int arrays = std::min(static_cast<int>(m_pool.getArrayCount()), MaxArrays);
+  for (int i = 0; i < arrays; i++) {
+    m_pool.bind(i, i);
+    shader.setInt("materialArrays[" + std::to_string(i) + "]", i);
+  }
+}
@@ -0,0 +1,97 @@
+#include "../include/Mesh.hpp"
+
+#include <utility>
+
+Mesh::Mesh(const MeshData& data, const VertexEncoding& encoding) :
+ m_vao(0),
+ m_vbo(0),
+ m_ebo(0),
+ m_vertexCount(data.vertices.size()),
+ m_bytes(0),
+ m_lods(data.lods),
+ m_bounds(data.bounds) {
+  EncodedVertices encoded = encodeVertices(data.vertices, data.bounds, encoding);
+  m_layout = std::move(encoded.layout);
+  m_positionScale = encoded.positionScale;
+  m_positionOffset = encoded.positionOffset;
+  m_octahedralNormals = encoded.octahedralNormals;
+  m_bytes = encoded.data.size() + data.indices.size() * sizeof(unsigned int);
+
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_vbo);
+  glGenBuffers(1, &m_ebo);
+
+  glBindVertexArray(m_vao);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBufferData(GL_ARRAY_BUFFER, encoded.data.size(), encoded.data.data(), GL_STATIC_DRAW);
+
+  // The element buffer binding is VAO state, so it stays attached after unbinding
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+  glBufferData(
+    GL_ELEMENT_ARRAY_BUFFER, data.indices.size() * sizeof(unsigned int), data.indices.data(), GL_STATIC_DRAW);
+
+  m_layout.apply();
+
+  glBindVertexArray(0);
+}
+
+Mesh::~Mesh() {
+  release();
+}
+
+Mesh::Mesh(Mesh&& other) noexcept :
+ m_vao(std::exchange(other.m_vao, 0)),
+ m_vbo(std::exchange(other.m_vbo, 0)),
+ m_ebo(std::exchange(other.m_ebo, 0)),
+ m_vertexCount(other.m_vertexCount),
+ m_bytes(other.m_bytes),
+ m_lods(std::move(other.m_lods)),
+ m_bounds(other.m_bounds),
+ m_layout(std::move(other.m_layout)),
+ m_positionScale(other.m_positionScale),
+ m_positionOffset(other.m_positionOffset),
+ m_octahedralNormals(other.m_octahedralNormals) {}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+  if (this != &other) {
+    release();
+    m_vao = std::exchange(other.m_vao, 0);
+    m_vbo = std::exchange(other.m_vbo, 0);
+    m_ebo = std::exchange(other.m_ebo, 0);
+    m_vertexCount = other.m_vertexCount;
+    m_bytes = other.m_bytes;
+    m_lods = std::move(other.m_lods);
+    m_bounds = other.m_bounds;
+    m_layout = std::move(other.m_layout);
+    m_positionScale = other.m_positionScale;
+    m_positionOffset = other.m_positionOffset;
+    m_octahedralNormals = other.m_octahedralNormals;
+  }
+  return *this;
+}
+
+void Mesh::release() {
+  if (m_vao != 0) {
+    glDeleteVertexArrays(1, &m_vao);
+  }
+  if (m_vbo != 0) {
+    glDeleteBuffers(1, &m_vbo);
+  }
+  if (m_ebo != 0) {
+    glDeleteBuffers(1, &m_ebo);
+  }
+  m_vao = m_vbo = m_ebo = 0;
+}
+
+void Mesh::bind() const {
+  glBindVertexArray(m_vao);
+}
+
+void Mesh::draw(int lod) const {
+  const MeshLOD& range = m_lods[lod];
+  glDrawElements(GL_TRIANGLES,
+                 range.indexCount,
+                 GL_UNSIGNED_INT,
+                 reinterpret_cast<void*>(static_cast<size_t>(range.indexOffset) * sizeof(unsigned int)));
+}
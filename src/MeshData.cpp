@@ -0,0 +1,138 @@
+#include "../include/MeshData.hpp"
+
+#include <cstring>
+
+namespace {
+const char MeshMagic[4] = {'M', 'M', 'S', 'H'};
+const uint32_t MeshVersion = 1;
+
+struct MeshHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint32_t lodCount;
+  uint32_t reserved;
+  float boundsMin[3];
+  float boundsMax[3];
+};
+
+// The arrays are copied as they are in memory
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must stay tightly packed");
+static_assert(sizeof(MeshLOD) == 3 * 4, "MeshLOD must stay tightly packed");
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T* data, size_t count) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+  out.insert(out.end(), bytes, bytes + count * sizeof(T));
+}
+}  // namespace
+
+void MeshData::computeBounds() {
+  bounds = AABB::empty();
+  for (const auto& vertex : vertices) {
+    bounds.expand(vertex.position);
+  }
+}
+
+void MeshData::computeNormals() {
+  for (auto& vertex : vertices) {
+    vertex.normal = glm::vec3(0.0f);
+  }
+
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    Vertex& a = vertices[indices[i]];
+    Vertex& b = vertices[indices[i + 1]];
+    Vertex& c = vertices[indices[i + 2]];
+    glm::vec3 normal = glm::cross(b.position - a.position, c.position - a.position);
+    a.normal += normal;
+    b.normal += normal;
+    c.normal += normal;
+  }
+
+  for (auto& vertex : vertices) {
+    float length = glm::length(vertex.normal);
+    vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+  }
+}
+
+MeshData MeshData::fromInterleaved(const float* data, size_t vertexCount) {
+  MeshData mesh;
+  mesh.vertices.resize(vertexCount);
+  mesh.indices.resize(vertexCount);
+
+  for (size_t i = 0; i < vertexCount; i++) {
+    const float* v = data + i * 5;
+    mesh.vertices[i].position = glm::vec3(v[0], v[1], v[2]);
+    mesh.vertices[i].texCoord = glm::vec2(v[3], v[4]);
+    mesh.indices[i] = static_cast<unsigned int>(i);
+  }
+
+  mesh.lods.push_back({0, static_cast<unsigned int>(vertexCount), 0.0f});
+  mesh.computeBounds();
+  mesh.computeNormals();
+  return mesh;
+}
+
+std::vector<uint8_t> MeshData::serialize() const {
+  MeshHeader header = {};
+  std::memcpy(header.magic, MeshMagic, sizeof(header.magic));
+  header.version = MeshVersion;
+  header.vertexCount = static_cast<uint32_t>(vertices.size());
+  header.indexCount = static_cast<uint32_t>(indices.size());
+  header.lodCount = static_cast<uint32_t>(lods.size());
+  std::memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+  std::memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+
+  std::vector<uint8_t> out;
+  out.reserve(sizeof(header) + vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int) +
+              lods.size() * sizeof(MeshLOD));
+  append(out, &header, 1);
+  append(out, vertices.data(), vertices.size());
+  append(out, indices.data(), indices.size());
+  append(out, lods.data(), lods.size());
+  return out;
+}
+
+bool MeshData::deserialize(const uint8_t* data, size_t size, MeshData& mesh) {
+  MeshHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, MeshMagic, sizeof(header.magic)) != 0 || header.version != MeshVersion ||
+      header.lodCount == 0) {
+    return false;
+  }
+
+  const size_t vertexBytes = static_cast<size_t>(header.vertexCount) * sizeof(Vertex);
+  const size_t indexBytes = static_cast<size_t>(header.indexCount) * sizeof(unsigned int);
+  const size_t lodBytes = static_cast<size_t>(header.lodCount) * sizeof(MeshLOD);
+  if (size - sizeof(header) < vertexBytes + indexBytes + lodBytes) {
+    return false;
+  }
+
+  const uint8_t* cursor = data + sizeof(header);
+  mesh.vertices.resize(header.vertexCount);
+  std::memcpy(mesh.vertices.data(), cursor, vertexBytes);
+  cursor += vertexBytes;
+  mesh.indices.resize(header.indexCount);
+  std::memcpy(mesh.indices.data(), cursor, indexBytes);
+  cursor += indexBytes;
+  mesh.lods.resize(header.lodCount);
+  std::memcpy(mesh.lods.data(), cursor, lodBytes);
+  std::memcpy(&mesh.bounds.min, header.boundsMin, sizeof(header.boundsMin));
+  std::memcpy(&mesh.bounds.max, header.boundsMax, sizeof(header.boundsMax));
+
+  for (const MeshLOD& lod : mesh.lods) {
+    if (static_cast<size_t>(lod.indexOffset) + lod.indexCount > mesh.indices.size()) {
+      return false;
+    }
+  }
+  for (unsigned int index : mesh.indices) {
+    if (index >= mesh.vertices.size()) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,93 @@
+#include "../include/MeshManager.hpp"
+#include "../include/Logger.hpp"
+
+MeshManager::MeshManager(ResidencyManager* residency) : m_residency(residency) {}
+
+MeshManager::~MeshManager() {
+  clear();
+}
+
+Mesh* MeshManager::load(const std::string& name, MeshData data) {
+  data.computeBounds();
+  VertexEncoding encoding = m_compressVertices ? VertexEncoding::select(data) : VertexEncoding::uncompressed();
+  return load(name, std::move(data), encoding);
+}
+
+Mesh* MeshManager::load(const std::string& name, MeshData data, const VertexEncoding& encoding) {
+  const size_t inputVertices = data.vertices.size();
+  const float inputACMR = MeshOptimizer::computeACMR(data.indices.data(), data.indices.size(), inputVertices);
+
+  MeshOptimizer::optimize(data, m_lodSettings);
+
+  const MeshLOD& base = data.lods[0];
+  const float outputACMR =
+    MeshOptimizer::computeACMR(data.indices.data() + base.indexOffset, base.indexCount, data.vertices.size());
+  LOG_INFO_F("[MeshManager] Loaded '{}': {} -> {} vertices, {} triangles, {} LOD(s), ACMR {:.3f} -> {:.3f}",
+             name,
+             inputVertices,
+             data.vertices.size(),
+             base.indexCount / 3,
+             data.lods.size(),
+             inputACMR,
+             outputACMR);
+  return upload(name, data, encoding);
+}
+
+Mesh* MeshManager::loadCooked(const std::string& name, const uint8_t* data, size_t size) {
+  MeshData mesh;
+  if (!MeshData::deserialize(data, size, mesh)) {
+    LOG_ERROR_F("[MeshManager] '{}' is not a valid cooked mesh", name);
+    return nullptr;
+  }
+
+  LOG_INFO_F("[MeshManager] Loaded cooked '{}': {} vertices, {} triangles, {} LOD(s)",
+             name,
+             mesh.vertices.size(),
+             mesh.lods[0].indexCount / 3,
+             mesh.lods.size());
+  VertexEncoding encoding = m_compressVertices ? VertexEncoding::select(mesh) : VertexEncoding::uncompressed();
+  return upload(name, mesh, encoding);
+}
+
+Mesh* MeshManager::upload(const std::string& name, const MeshData& data, const VertexEncoding& encoding) {
+  auto& slot = m_meshes[name];
+  slot = std::make_unique<Mesh>(data, encoding);
+  if (m_residency) {
+    auto it = m_residencyIds.find(name);
+    if (it != m_residencyIds.end()) {
+      m_residency->resize(it->second, slot->getMemoryUsage());
+    } else {
+      m_residencyIds[name] = m_residency->add(ResidencyKind::Buffer, "mesh " + name, slot->getMemoryUsage());
+    }
+  }
+
+  const unsigned int stride = slot->getLayout().getStride();
+  LOG_INFO_F("[MeshManager] '{}' vertex format: {} bytes/vertex ({} bytes uncompressed), {:.1f} KB vertex data",
+             name,
+             stride,
+             VertexEncoding::uncompressed().layout().getStride(),
+             data.vertices.size() * stride / 1024.0f);
+  return slot.get();
+}
+
+Mesh* MeshManager::get(const std::string& name) const {
+  auto it = m_meshes.find(name);
+  return it != m_meshes.end() ? it->second.get() : nullptr;
+}
+
+void MeshManager::unload(const std::string& name) {
+  m_meshes.erase(name);
+  auto it = m_residencyIds.find(name);
+  if (it != m_residencyIds.end()) {
+    m_residency->remove(it->second);
+    m_residencyIds.erase(it);
+  }
+}
+
+void MeshManager::clear() {
+  m_meshes.clear();
+  for (const auto& [name, id] : m_residencyIds) {
+    m_residency->remove(id);
+  }
+  m_residencyIds.clear();
+}
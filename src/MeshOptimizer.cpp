@@ -0,0 +1,744 @@
+#include "../include/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+// Quadric over (x, y, z, u, v). Positions are normalized by the mesh radius and uvs scaled by the
+// attribute weight so one error value covers both.
+constexpr int QuadricSize = 5;
+
+struct Quadric {
+  double A[QuadricSize][QuadricSize] = {};
+  double b[QuadricSize] = {};
+  double c = 0.0;
+
+  void add(const Quadric& other) {
+    for (int i = 0; i < QuadricSize; i++) {
+      for (int j = 0; j < QuadricSize; j++) {
+        A[i][j] += other.A[i][j];
+      }
+      b[i] += other.b[i];
+    }
+    c += other.c;
+  }
+
+  double evaluate(const double* v) const {
+    double result = c;
+    for (int i = 0; i < QuadricSize; i++) {
+      double row = 0.0;
+      for (int j = 0; j < QuadricSize; j++) {
+        row += A[i][j] * v[j];
+      }
+      result += v[i] * row + 2.0 * b[i] * v[i];
+    }
+    return result;
+  }
+};
+
+double dot5(const double* a, const double* b) {
+  double result = 0.0;
+  for (int i = 0; i < QuadricSize; i++) {
+    result += a[i] * b[i];
+  }
+  return result;
+}
+
+bool normalize5(double* v) {
+  double length = std::sqrt(dot5(v, v));
+  if (length < 1e-12) {
+    return false;
+  }
+  for (int i = 0; i < QuadricSize; i++) {
+    v[i] /= length;
+  }
+  return true;
+}
+
+// Generalized quadric of the plane spanned by a triangle in 5D (Garland & Heckbert 1998)
+bool triangleQuadric(const double* p1, const double* p2, const double* p3, double weight, Quadric& q) {
+  double e1[QuadricSize], e2[QuadricSize];
+  for (int i = 0; i < QuadricSize; i++) {
+    e1[i] = p2[i] - p1[i];
+    e2[i] = p3[i] - p1[i];
+  }
+  if (!normalize5(e1)) {
+    return false;
+  }
+  double projection = dot5(e1, e2);
+  for (int i = 0; i < QuadricSize; i++) {
+    e2[i] -= projection * e1[i];
+  }
+  if (!normalize5(e2)) {
+    return false;
+  }
+
+  double p1e1 = dot5(p1, e1);
+  double p1e2 = dot5(p1, e2);
+
+  for (int i = 0; i < QuadricSize; i++) {
+    for (int j = 0; j < QuadricSize; j++) {
+      q.A[i][j] = weight * ((i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j]);
+    }
+    q.b[i] = weight * (p1e1 * e1[i] + p1e2 * e2[i] - p1[i]);
+  }
+  q.c = weight * (dot5(p1, p1) - p1e1 * p1e1 - p1e2 * p1e2);
+  return true;
+}
+
+struct Collapse {
+  unsigned int from;
+  unsigned int to;
+  double cost;
+};
+
+uint64_t edgeKey(unsigned int a, unsigned int b) {
+  if (a > b) {
+    std::swap(a, b);
+  }
+  return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+// Groups vertices that compare equal and returns, for every vertex, the first vertex of its group
+template <typename Less, typename Equal>
+std::vector<unsigned int> buildRemap(size_t count, Less less, Equal equal) {
+  std::vector<unsigned int> order(count);
+  std::iota(order.begin(), order.end(), 0u);
+  std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+    return less(a, b) || (!less(b, a) && a < b);
+  });
+
+  std::vector<unsigned int> remap(count);
+  for (size_t i = 0; i < count; i++) {
+    bool startsGroup = i == 0 || !equal(order[i - 1], order[i]);
+    remap[order[i]] = startsGroup ? order[i] : remap[order[i - 1]];
+  }
+  return remap;
+}
+
+struct VertexHash {
+  size_t operator()(const Vertex& v) const {
+    uint32_t bits[8];
+    std::memcpy(bits, &v.position, sizeof(float) * 3);
+    std::memcpy(bits + 3, &v.normal, sizeof(float) * 3);
+    std::memcpy(bits + 6, &v.texCoord, sizeof(float) * 2);
+    size_t hash = 2166136261u;
+    for (uint32_t b : bits) {
+      hash = (hash ^ b) * 16777619u;
+    }
+    return hash;
+  }
+};
+
+struct VertexEqual {
+  bool operator()(const Vertex& a, const Vertex& b) const {
+    return a.position == b.position && a.normal == b.normal && a.texCoord == b.texCoord;
+  }
+};
+
+// Forsyth's scoring: recently used vertices and vertices with few remaining triangles score high
+constexpr int ForsythCacheSize = 32;
+
+float forsythVertexScore(int cachePosition, unsigned int remainingValence) {
+  if (remainingValence == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // The last triangle's vertices get a fixed score so the next triangle does not just reuse them
+      score = 0.75f;
+    } else {
+      score = std::pow(1.0f - (cachePosition - 3) * (1.0f / (ForsythCacheSize - 3)), 1.5f);
+    }
+  }
+
+  return score + 2.0f / std::sqrt(static_cast<float>(remainingValence));
+}
+
+// FIFO cache simulation, returns the number of misses per triangle
+std::vector<unsigned int> simulateCacheMisses(const unsigned int* indices,
+                                              size_t indexCount,
+                                              size_t vertexCount,
+                                              int cacheSize) {
+  std::vector<unsigned int> timestamps(vertexCount, 0);
+  std::vector<unsigned int> misses(indexCount / 3, 0);
+  unsigned int time = cacheSize + 1;
+
+  for (size_t i = 0; i < indexCount; i++) {
+    unsigned int v = indices[i];
+    if (time - timestamps[v] > static_cast<unsigned int>(cacheSize)) {
+      timestamps[v] = time++;
+      misses[i / 3]++;
+    }
+  }
+  return misses;
+}
+}  // namespace
+
+namespace MeshOptimizer {
+std::vector<unsigned int> simplify(const std::vector<Vertex>& vertices,
+                                   const std::vector<unsigned int>& indices,
+                                   size_t targetIndexCount,
+                                   float targetError,
+                                   float* resultError,
+                                   const SimplifyOptions& options) {
+  const size_t vertexCount = vertices.size();
+
+  auto positionLess = [&](unsigned int a, unsigned int b) {
+    const glm::vec3 &pa = vertices[a].position, &pb = vertices[b].position;
+    return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+  };
+  auto positionEqual = [&](unsigned int a, unsigned int b) { return vertices[a].position == vertices[b].position; };
+  auto vertexLess = [&](unsigned int a, unsigned int b) {
+    if (positionLess(a, b) || positionLess(b, a)) {
+      return positionLess(a, b);
+    }
+    const glm::vec2 &ta = vertices[a].texCoord, &tb = vertices[b].texCoord;
+    if (ta != tb) {
+      return ta.x != tb.x ? ta.x < tb.x : ta.y < tb.y;
+    }
+    const glm::vec3 &na = vertices[a].normal, &nb = vertices[b].normal;
+    return na.x != nb.x ? na.x < nb.x : na.y != nb.y ? na.y < nb.y : na.z < nb.z;
+  };
+  auto vertexEqual = [&](unsigned int a, unsigned int b) {
+    return positionEqual(a, b) && vertices[a].texCoord == vertices[b].texCoord &&
+           vertices[a].normal == vertices[b].normal;
+  };
+
+  // Exact duplicates become one vertex, vertices that only share a position form a uv or normal seam
+  std::vector<unsigned int> canonical = buildRemap(vertexCount, vertexLess, vertexEqual);
+  std::vector<unsigned int> positionId = buildRemap(vertexCount, positionLess, positionEqual);
+
+  std::vector<unsigned int> result(indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    result[i] = canonical[indices[i]];
+  }
+
+  // Normalized 5D points used by the quadrics
+  AABB bounds = AABB::empty();
+  for (unsigned int index : result) {
+    bounds.expand(vertices[index].position);
+  }
+  float radius = std::max(glm::length(bounds.extent()) * 0.5f, 1e-6f);
+  glm::vec3 center = bounds.center();
+
+  std::vector<double> points(vertexCount * QuadricSize);
+  for (size_t i = 0; i < vertexCount; i++) {
+    glm::vec3 p = (vertices[i].position - center) / radius;
+    double* point = &points[i * QuadricSize];
+    point[0] = p.x;
+    point[1] = p.y;
+    point[2] = p.z;
+    point[3] = vertices[i].texCoord.x * options.attributeWeight;
+    point[4] = vertices[i].texCoord.y * options.attributeWeight;
+  }
+
+  // Lock seams (several canonical vertices on one position) and open or non-manifold borders
+  std::vector<char> locked(vertexCount, 0);
+  if (options.lockBorders) {
+    std::unordered_map<unsigned int, unsigned int> positionOwner;
+    for (unsigned int index : result) {
+      auto [it, inserted] = positionOwner.emplace(positionId[index], index);
+      if (!inserted && it->second != index) {
+        locked[index] = 1;
+        locked[it->second] = 1;
+      }
+    }
+
+    std::unordered_map<uint64_t, int> edgeUse;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (int e = 0; e < 3; e++) {
+        edgeUse[edgeKey(positionId[result[i + e]], positionId[result[i + (e + 1) % 3]])]++;
+      }
+    }
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (int e = 0; e < 3; e++) {
+        unsigned int a = result[i + e], b = result[i + (e + 1) % 3];
+        if (edgeUse[edgeKey(positionId[a], positionId[b])] != 2) {
+          locked[a] = 1;
+          locked[b] = 1;
+        }
+      }
+    }
+    // Every wedge of a locked position is locked
+    for (size_t i = 0; i < vertexCount; i++) {
+      if (locked[i]) {
+        locked[positionId[i]] = 1;
+      }
+    }
+    for (size_t i = 0; i < vertexCount; i++) {
+      locked[i] |= locked[positionId[i]];
+    }
+  }
+
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < result.size(); i += 3) {
+    const double* p1 = &points[result[i] * QuadricSize];
+    const double* p2 = &points[result[i + 1] * QuadricSize];
+    const double* p3 = &points[result[i + 2] * QuadricSize];
+
+    glm::vec3 a = vertices[result[i]].position, b = vertices[result[i + 1]].position, c = vertices[result[i + 2]].position;
+    double area = 0.5 * glm::length(glm::cross(b - a, c - a)) / (radius * radius);
+
+    Quadric q;
+    if (triangleQuadric(p1, p2, p3, area, q)) {
+      for (int k = 0; k < 3; k++) {
+        quadrics[result[i + k]].add(q);
+      }
+    }
+  }
+
+  const double errorLimit = static_cast<double>(targetError) * targetError;
+  double maxError = 0.0;
+
+  std::vector<unsigned int> remap(vertexCount);
+  std::vector<unsigned int> triangleOffsets(vertexCount + 1);
+  std::vector<unsigned int> vertexTriangles;
+  std::vector<Collapse> collapses;
+  std::vector<char> touched(vertexCount);
+
+  while (result.size() > targetIndexCount) {
+    // Vertex -> triangle adjacency of the current mesh (CSR layout)
+    std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0u);
+    for (unsigned int index : result) {
+      triangleOffsets[index + 1]++;
+    }
+    std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+    vertexTriangles.resize(result.size());
+    std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t i = 0; i < result.size(); i++) {
+      vertexTriangles[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    // Candidate edges with the cheapest legal direction
+    collapses.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (int e = 0; e < 3; e++) {
+        unsigned int a = result[i + e], b = result[i + (e + 1) % 3];
+        if (a > b) {
+          continue;  // Each interior edge is seen from both triangles, keep one
+        }
+
+        Quadric merged = quadrics[a];
+        merged.add(quadrics[b]);
+        double costAB = locked[a] ? HUGE_VAL : merged.evaluate(&points[b * QuadricSize]);
+        double costBA = locked[b] ? HUGE_VAL : merged.evaluate(&points[a * QuadricSize]);
+        if (costAB == HUGE_VAL && costBA == HUGE_VAL) {
+          continue;
+        }
+
+        if (costAB <= costBA) {
+          collapses.push_back({a, b, std::max(0.0, costAB)});
+        } else {
+          collapses.push_back({b, a, std::max(0.0, costBA)});
+        }
+      }
+    }
+
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+    std::iota(remap.begin(), remap.end(), 0u);
+    std::fill(touched.begin(), touched.end(), 0);
+
+    size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+    size_t removed = 0;
+    size_t applied = 0;
+
+    for (const Collapse& collapse : collapses) {
+      if (collapse.cost > errorLimit) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to]) {
+        continue;
+      }
+
+      // Reject collapses that flip or degenerate a surrounding triangle
+      bool flips = false;
+      size_t shared = 0;
+      glm::vec3 target = vertices[collapse.to].position;
+      for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; t++) {
+        const unsigned int* tri = &result[vertexTriangles[t] * 3];
+        if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+          shared++;
+          continue;
+        }
+
+        glm::vec3 p[3], q[3];
+        for (int k = 0; k < 3; k++) {
+          p[k] = vertices[tri[k]].position;
+          q[k] = tri[k] == collapse.from ? target : p[k];
+        }
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+        flips = glm::dot(before, after) <= 0.0f;
+      }
+      if (flips) {
+        continue;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to].add(quadrics[collapse.from]);
+      maxError = std::max(maxError, collapse.cost);
+
+      // The one-ring of the removed vertex changes shape, so leave it alone for the rest of the pass
+      for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++) {
+        const unsigned int* tri = &result[vertexTriangles[t] * 3];
+        touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+      }
+
+      applied++;
+      removed += shared;
+      if (removed >= trianglesToRemove) {
+        break;
+      }
+    }
+
+    if (applied == 0) {
+      break;
+    }
+
+    // Rewrite the index buffer and drop the triangles that collapsed to a line
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+      if (a != b && b != c && c != a) {
+        result[write++] = a;
+        result[write++] = b;
+        result[write++] = c;
+      }
+    }
+    result.resize(write);
+  }
+
+  if (resultError) {
+    *resultError = static_cast<float>(std::sqrt(maxError));
+  }
+  return result;
+}
+
+void generateLODChain(MeshData& mesh, const LODSettings& settings) {
+  if (mesh.lods.empty()) {
+    mesh.lods.push_back({0, static_cast<unsigned int>(mesh.indices.size()), 0.0f});
+  }
+
+  const MeshLOD& base = mesh.lods.front();
+  std::vector<unsigned int> previous(mesh.indices.begin() + base.indexOffset,
+                                     mesh.indices.begin() + base.indexOffset + base.indexCount);
+  float accumulatedError = 0.0f;
+
+  for (int level = 1; level < settings.maxLevels; level++) {
+    size_t target = static_cast<size_t>(previous.size() / 3 * settings.reduction) * 3;
+
+    // Each level is simplified from the previous one, so the errors add up
+    float levelError = 0.0f;
+    std::vector<unsigned int> next = simplify(
+      mesh.vertices, previous, target, settings.maxError - accumulatedError, &levelError, settings.simplify);
+
+    // Not worth a level if the mesh barely shrank
+    if (next.empty() || next.size() > previous.size() * 9 / 10) {
+      break;
+    }
+
+    accumulatedError += levelError;
+    MeshLOD lod;
+    lod.indexOffset = static_cast<unsigned int>(mesh.indices.size());
+    lod.indexCount = static_cast<unsigned int>(next.size());
+    lod.error = accumulatedError;
+
+    mesh.indices.insert(mesh.indices.end(), next.begin(), next.end());
+    mesh.lods.push_back(lod);
+    previous = std::move(next);
+  }
+}
+
+size_t generateIndexBuffer(MeshData& mesh) {
+  std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+  unique.reserve(mesh.vertices.size());
+
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> remap(mesh.vertices.size());
+
+  for (size_t i = 0; i < mesh.vertices.size(); i++) {
+    auto [it, inserted] = unique.emplace(mesh.vertices[i], static_cast<unsigned int>(vertices.size()));
+    if (inserted) {
+      vertices.push_back(mesh.vertices[i]);
+    }
+    remap[i] = it->second;
+  }
+
+  for (auto& index : mesh.indices) {
+    index = remap[index];
+  }
+
+  mesh.vertices = std::move(vertices);
+  return mesh.vertices.size();
+}
+
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Vertex -> triangle adjacency
+  std::vector<unsigned int> remaining(vertexCount, 0);
+  for (size_t i = 0; i < indexCount; i++) {
+    remaining[indices[i]]++;
+  }
+  std::vector<unsigned int> offsets(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++) {
+    offsets[v + 1] = offsets[v] + remaining[v];
+  }
+  std::vector<unsigned int> adjacency(indexCount);
+  std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < indexCount; i++) {
+    adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> vertexScore(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) {
+    vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+  }
+
+  std::vector<float> triangleScore(triangleCount);
+  for (size_t t = 0; t < triangleCount; t++) {
+    triangleScore[t] =
+      vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+  }
+
+  std::vector<char> emitted(triangleCount, 0);
+  std::vector<unsigned int> output;
+  output.reserve(indexCount);
+
+  std::vector<unsigned int> cache, nextCache;
+  cache.reserve(ForsythCacheSize + 3);
+  nextCache.reserve(ForsythCacheSize + 3);
+
+  int best = static_cast<int>(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+  size_t scanCursor = 0;
+
+  while (output.size() < indexCount) {
+    if (best < 0) {
+      // Nothing useful in the cache, continue with the next triangle in input order
+      while (emitted[scanCursor]) {
+        scanCursor++;
+      }
+      best = static_cast<int>(scanCursor);
+    }
+
+    const unsigned int* tri = &indices[best * 3];
+    unsigned int a = tri[0], b = tri[1], c = tri[2];
+    emitted[best] = 1;
+    output.insert(output.end(), {a, b, c});
+    remaining[a]--;
+    remaining[b]--;
+    remaining[c]--;
+
+    // LRU update: the emitted vertices move to the front
+    nextCache.assign({a, b, c});
+    for (unsigned int v : cache) {
+      if (v != a && v != b && v != c) {
+        nextCache.push_back(v);
+      }
+    }
+
+    for (size_t i = 0; i < nextCache.size(); i++) {
+      unsigned int v = nextCache[i];
+      cachePosition[v] = i < ForsythCacheSize ? static_cast<int>(i) : -1;
+
+      float score = forsythVertexScore(cachePosition[v], remaining[v]);
+      float delta = score - vertexScore[v];
+      vertexScore[v] = score;
+      for (unsigned int k = offsets[v]; k < offsets[v + 1]; k++) {
+        triangleScore[adjacency[k]] += delta;
+      }
+    }
+
+    if (nextCache.size() > ForsythCacheSize) {
+      nextCache.resize(ForsythCacheSize);
+    }
+    std::swap(cache, nextCache);
+
+    // Next triangle is the best scoring one touching the cache
+    best = -1;
+    float bestScore = -1.0f;
+    for (unsigned int v : cache) {
+      for (unsigned int k = offsets[v]; k < offsets[v + 1]; k++) {
+        unsigned int t = adjacency[k];
+        if (!emitted[t] && triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          best = static_cast<int>(t);
+        }
+      }
+    }
+  }
+
+  std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(unsigned int* indices,
+                      size_t indexCount,
+                      const std::vector<Vertex>& vertices,
+                      float threshold) {
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+
+  const int cacheSize = 16;
+  std::vector<unsigned int> misses = simulateCacheMisses(indices, indexCount, vertices.size(), cacheSize);
+
+  // Hard boundaries: triangles where the cache starts over anyway (all three vertices missed)
+  std::vector<size_t> hardBoundaries;
+  for (size_t t = 0; t < triangleCount; t++) {
+    if (t == 0 || misses[t] == 3) {
+      hardBoundaries.push_back(t);
+    }
+  }
+  hardBoundaries.push_back(triangleCount);
+
+  // Soft boundaries: split hard clusters wherever a restarted cache would stay within the threshold
+  std::vector<size_t> clusters;
+  std::vector<unsigned int> timestamps(vertices.size(), 0);
+  unsigned int time = cacheSize + 1;
+
+  for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+    size_t start = hardBoundaries[h], end = hardBoundaries[h + 1];
+
+    unsigned int clusterMisses = 0;
+    for (size_t t = start; t < end; t++) {
+      clusterMisses += misses[t];
+    }
+    float clusterThreshold = threshold * clusterMisses / (end - start);
+
+    size_t clusterStart = start;
+    unsigned int runningMisses = 0;
+    time += cacheSize + 1;
+    clusters.push_back(start);
+
+    for (size_t t = start; t < end; t++) {
+      for (int k = 0; k < 3; k++) {
+        unsigned int v = indices[t * 3 + k];
+        if (time - timestamps[v] > static_cast<unsigned int>(cacheSize)) {
+          timestamps[v] = time++;
+          runningMisses++;
+        }
+      }
+
+      size_t size = t - clusterStart + 1;
+      if (t + 1 < end && static_cast<float>(runningMisses) / size <= clusterThreshold) {
+        clusters.push_back(t + 1);
+        clusterStart = t + 1;
+        runningMisses = 0;
+        time += cacheSize + 1;  // Flush the simulated cache
+      }
+    }
+  }
+  clusters.push_back(triangleCount);
+
+  // Sort key: how much the cluster faces away from the mesh centre
+  glm::vec3 meshCentroid(0.0f);
+  float meshArea = 0.0f;
+  std::vector<glm::vec3> clusterCentroid(clusters.size() - 1, glm::vec3(0.0f));
+  std::vector<glm::vec3> clusterNormal(clusters.size() - 1, glm::vec3(0.0f));
+
+  for (size_t c = 0; c + 1 < clusters.size(); c++) {
+    float clusterArea = 0.0f;
+    for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+      const glm::vec3& p0 = vertices[indices[t * 3]].position;
+      const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+      const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float area = glm::length(normal);
+      glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+      clusterCentroid[c] += centroid * area;
+      clusterNormal[c] += normal;
+      clusterArea += area;
+      meshCentroid += centroid * area;
+      meshArea += area;
+    }
+    if (clusterArea > 0.0f) {
+      clusterCentroid[c] /= clusterArea;
+    }
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid /= meshArea;
+  }
+
+  std::vector<float> sortKey(clusters.size() - 1, 0.0f);
+  for (size_t c = 0; c < sortKey.size(); c++) {
+    float length = glm::length(clusterNormal[c]);
+    if (length > 0.0f) {
+      sortKey[c] = glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / length);
+    }
+  }
+
+  std::vector<size_t> order(sortKey.size());
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+  std::vector<unsigned int> output;
+  output.reserve(indexCount);
+  for (size_t c : order) {
+    output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+  }
+  std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeVertexFetch(MeshData& mesh) {
+  const unsigned int unused = ~0u;
+  std::vector<unsigned int> remap(mesh.vertices.size(), unused);
+  std::vector<Vertex> vertices;
+  vertices.reserve(mesh.vertices.size());
+
+  for (auto& index : mesh.indices) {
+    if (remap[index] == unused) {
+      remap[index] = static_cast<unsigned int>(vertices.size());
+      vertices.push_back(mesh.vertices[index]);
+    }
+    index = remap[index];
+  }
+
+  mesh.vertices = std::move(vertices);
+}
+
+float computeACMR(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize) {
+  if (indexCount < 3) {
+    return 0.0f;
+  }
+
+  std::vector<unsigned int> misses = simulateCacheMisses(indices, indexCount, vertexCount, cacheSize);
+  unsigned int total = std::accumulate(misses.begin(), misses.end(), 0u);
+  return static_cast<float>(total) / (indexCount / 3);
+}
+
+void optimize(MeshData& mesh, const LODSettings& settings) {
+  generateIndexBuffer(mesh);
+
+  // LODs are generated before reordering, the simplifier does not care about triangle order. An
+  // existing chain is rebuilt from its LOD 0, a mesh without one is all LOD 0.
+  if (mesh.lods.empty()) {
+    mesh.lods.push_back({0, static_cast<unsigned int>(mesh.indices.size()), 0.0f});
+  }
+  mesh.lods.resize(1);
+  mesh.indices.resize(mesh.lods[0].indexCount);
+  generateLODChain(mesh, settings);
+
+  for (const MeshLOD& lod : mesh.lods) {
+    unsigned int* indices = mesh.indices.data() + lod.indexOffset;
+    optimizeVertexCache(indices, lod.indexCount, mesh.vertices.size());
+    optimizeOverdraw(indices, lod.indexCount, mesh.vertices);
+  }
+
+  optimizeVertexFetch(mesh);
+  mesh.computeBounds();
+}
+}  // namespace MeshOptimizer
@@ -0,0 +1,299 @@
+#include "../include/OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MACHI_OCCLUSION_SSE 1
+#endif
+
+namespace {
+using Clock = std::chrono::high_resolution_clock;
+
+float elapsedMs(Clock::time_point start) {
+  return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+int roundUp(int value, int multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+}  // namespace
+
+OccluderMesh OccluderMesh::fromBox(const AABB& bounds) {
+  const glm::vec3& a = bounds.min;
+  const glm::vec3& b = bounds.max;
+
+  OccluderMesh mesh;
+  mesh.vertices = {
+    {a.x, a.y, a.z}, {b.x, a.y, a.z}, {b.x, b.y, a.z}, {a.x, b.y, a.z},
+    {a.x, a.y, b.z}, {b.x, a.y, b.z}, {b.x, b.y, b.z}, {a.x, b.y, b.z},
+  };
+
+  // clang-format off
+  mesh.indices = {
+    0, 2, 1, 0, 3, 2,  // -Z
+    4, 5, 6, 4, 6, 7,  // +Z
+    0, 4, 7, 0, 7, 3,  // -X
+    1, 2, 6, 1, 6, 5,  // +X
+    0, 1, 5, 0, 5, 4,  // -Y
+    3, 7, 6, 3, 6, 2   // +Y
+  };
+  // clang-format on
+
+  return mesh;
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height) :
+ m_width(roundUp(std::max(width, TileSize), TileSize)),
+ m_height(roundUp(std::max(height, TileSize), TileSize)),
+ m_viewProjection(1.0f) {
+  m_tilesX = m_width / TileSize;
+  m_tilesY = m_height / TileSize;
+  m_depth.assign(m_width * m_height, 1.0f);
+  m_tileMax.assign(m_tilesX * m_tilesY, 1.0f);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection) {
+  m_viewProjection = viewProjection;
+  m_stats = OcclusionStats();
+  std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+}
+
+void OcclusionCuller::renderOccluder(const OccluderMesh& mesh, const glm::mat4& model) {
+  auto start = Clock::now();
+  glm::mat4 mvp = m_viewProjection * model;
+
+  std::vector<glm::vec4> clip(mesh.vertices.size());
+  for (size_t i = 0; i < mesh.vertices.size(); i++) {
+    clip[i] = mvp * glm::vec4(mesh.vertices[i], 1.0f);
+  }
+
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    clipAndRasterize(clip[mesh.indices[i]], clip[mesh.indices[i + 1]], clip[mesh.indices[i + 2]]);
+  }
+
+  m_stats.occluderTriangles += static_cast<int>(mesh.indices.size() / 3);
+  m_stats.rasterMs += elapsedMs(start);
+}
+
+OcclusionCuller::ScreenVertex OcclusionCuller::toScreen(const glm::vec4& clip) const {
+  float invW = 1.0f / clip.w;
+  return {(clip.x * invW * 0.5f + 0.5f) * m_width,
+          (clip.y * invW * 0.5f + 0.5f) * m_height,
+          clip.z * invW * 0.5f + 0.5f};
+}
+
+void OcclusionCuller::clipAndRasterize(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2) {
+  // Triangles entirely behind one clip plane never reach the buffer
+  if ((c0.x > c0.w && c1.x > c1.w && c2.x > c2.w) || (c0.x < -c0.w && c1.x < -c1.w && c2.x < -c2.w) ||
+      (c0.y > c0.w && c1.y > c1.w && c2.y > c2.w) || (c0.y < -c0.w && c1.y < -c1.w && c2.y < -c2.w) ||
+      (c0.z > c0.w && c1.z > c1.w && c2.z > c2.w)) {
+    return;
+  }
+
+  auto nearDistance = [](const glm::vec4& v) { return v.z + v.w; };
+  float d0 = nearDistance(c0), d1 = nearDistance(c1), d2 = nearDistance(c2);
+
+  if (d0 >= 0.0f && d1 >= 0.0f && d2 >= 0.0f) {
+    rasterizeTriangle(toScreen(c0), toScreen(c1), toScreen(c2));
+    return;
+  }
+
+  // Sutherland-Hodgman against the near plane only, the rasterizer clamps to the screen
+  const glm::vec4 input[3] = {c0, c1, c2};
+  const float distance[3] = {d0, d1, d2};
+  glm::vec4 output[4];
+  int count = 0;
+
+  for (int i = 0; i < 3; i++) {
+    int j = (i + 1) % 3;
+    if (distance[i] >= 0.0f) {
+      output[count++] = input[i];
+    }
+    if ((distance[i] >= 0.0f) != (distance[j] >= 0.0f)) {
+      float t = distance[i] / (distance[i] - distance[j]);
+      output[count++] = input[i] + (input[j] - input[i]) * t;
+    }
+  }
+
+  for (int i = 1; i + 1 < count; i++) {
+    rasterizeTriangle(toScreen(output[0]), toScreen(output[i]), toScreen(output[i + 1]));
+  }
+}
+
+void OcclusionCuller::rasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2) {
+  float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+  if (area <= 0.0f) {
+    return;  // Back facing or degenerate
+  }
+
+  int minX = std::max(0, static_cast<int>(std::floor(std::min({v0.x, v1.x, v2.x}))));
+  int maxX = std::min(m_width - 1, static_cast<int>(std::ceil(std::max({v0.x, v1.x, v2.x}))));
+  int minY = std::max(0, static_cast<int>(std::floor(std::min({v0.y, v1.y, v2.y}))));
+  int maxY = std::min(m_height - 1, static_cast<int>(std::ceil(std::max({v0.y, v1.y, v2.y}))));
+  if (minX > maxX || minY > maxY) {
+    return;
+  }
+
+  // Edge functions E(x, y) = A * x + B * y + C, positive inside a counter-clockwise triangle
+  auto edge = [](const ScreenVertex& a, const ScreenVertex& b, float& A, float& B, float& C) {
+    A = a.y - b.y;
+    B = b.x - a.x;
+    C = -(A * a.x + B * a.y);
+  };
+
+  float A0, B0, C0, A1, B1, C1, A2, B2, C2;
+  edge(v1, v2, A0, B0, C0);  // Weight of v0
+  edge(v2, v0, A1, B1, C1);  // Weight of v1
+  edge(v0, v1, A2, B2, C2);  // Weight of v2
+
+  // Window depth is affine in screen space: z = zA * x + zB * y + zC
+  float invArea = 1.0f / area;
+  float zA = (v0.z * A0 + v1.z * A1 + v2.z * A2) * invArea;
+  float zB = (v0.z * B0 + v1.z * B1 + v2.z * B2) * invArea;
+  float zC = (v0.z * C0 + v1.z * C1 + v2.z * C2) * invArea;
+
+  int startX = minX & ~3;
+
+#ifdef MACHI_OCCLUSION_SSE
+  const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 vA0 = _mm_set1_ps(A0), vA1 = _mm_set1_ps(A1), vA2 = _mm_set1_ps(A2), vZA = _mm_set1_ps(zA);
+
+  for (int y = minY; y <= maxY; y++) {
+    float py = y + 0.5f;
+    __m128 rowE0 = _mm_set1_ps(B0 * py + C0);
+    __m128 rowE1 = _mm_set1_ps(B1 * py + C1);
+    __m128 rowE2 = _mm_set1_ps(B2 * py + C2);
+    __m128 rowZ = _mm_set1_ps(zB * py + zC);
+    float* row = &m_depth[y * m_width];
+
+    for (int x = startX; x <= maxX; x += 4) {
+      __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+      __m128 e0 = _mm_add_ps(_mm_mul_ps(vA0, px), rowE0);
+      __m128 e1 = _mm_add_ps(_mm_mul_ps(vA1, px), rowE1);
+      __m128 e2 = _mm_add_ps(_mm_mul_ps(vA2, px), rowE2);
+      __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+      if (_mm_movemask_ps(inside) == 0) {
+        continue;
+      }
+
+      __m128 z = _mm_add_ps(_mm_mul_ps(vZA, px), rowZ);
+      __m128 depth = _mm_loadu_ps(row + x);
+      __m128 nearest = _mm_min_ps(depth, z);
+      _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+    }
+  }
+#else
+  for (int y = minY; y <= maxY; y++) {
+    float py = y + 0.5f;
+    float* row = &m_depth[y * m_width];
+    for (int x = startX; x <= maxX; x++) {
+      float px = x + 0.5f;
+      if (A0 * px + B0 * py + C0 < 0.0f || A1 * px + B1 * py + C1 < 0.0f || A2 * px + B2 * py + C2 < 0.0f) {
+        continue;
+      }
+      row[x] = std::min(row[x], zA * px + zB * py + zC);
+    }
+  }
+#endif
+}
+
+void OcclusionCuller::finalize() {
+  auto start = Clock::now();
+
+  for (int ty = 0; ty < m_tilesY; ty++) {
+    for (int tx = 0; tx < m_tilesX; tx++) {
+      const float* tile = &m_depth[ty * TileSize * m_width + tx * TileSize];
+
+#ifdef MACHI_OCCLUSION_SSE
+      __m128 farthest = _mm_setzero_ps();
+      for (int y = 0; y < TileSize; y++) {
+        const float* row = tile + y * m_width;
+        farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+      }
+      farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+      farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+      m_tileMax[ty * m_tilesX + tx] = _mm_cvtss_f32(farthest);
+#else
+      float farthest = 0.0f;
+      for (int y = 0; y < TileSize; y++) {
+        for (int x = 0; x < TileSize; x++) {
+          farthest = std::max(farthest, tile[y * m_width + x]);
+        }
+      }
+      m_tileMax[ty * m_tilesX + tx] = farthest;
+#endif
+    }
+  }
+
+  m_stats.rasterMs += elapsedMs(start);
+}
+
+bool OcclusionCuller::isRegionOccluded(int minX, int minY, int maxX, int maxY, float nearestDepth) const {
+  for (int ty = minY / TileSize; ty <= maxY / TileSize; ty++) {
+    for (int tx = minX / TileSize; tx <= maxX / TileSize; tx++) {
+      // Whole tile is nearer than the object - nothing to refine
+      if (nearestDepth > m_tileMax[ty * m_tilesX + tx]) {
+        continue;
+      }
+
+      // Inconclusive tile, check the covered pixels individually
+      int x0 = std::max(minX, tx * TileSize), x1 = std::min(maxX, tx * TileSize + TileSize - 1);
+      int y0 = std::max(minY, ty * TileSize), y1 = std::min(maxY, ty * TileSize + TileSize - 1);
+      for (int y = y0; y <= y1; y++) {
+        const float* row = &m_depth[y * m_width];
+        for (int x = x0; x <= x1; x++) {
+          if (nearestDepth <= row[x]) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool OcclusionCuller::isVisible(const AABB& worldBounds) {
+  auto start = Clock::now();
+  m_stats.tested++;
+
+  float minX = static_cast<float>(m_width), minY = static_cast<float>(m_height), nearestDepth = 1.0f;
+  float maxX = 0.0f, maxY = 0.0f;
+
+  for (int i = 0; i < 8; i++) {
+    glm::vec3 corner((i & 1) ? worldBounds.max.x : worldBounds.min.x,
+                     (i & 2) ? worldBounds.max.y : worldBounds.min.y,
+                     (i & 4) ? worldBounds.max.z : worldBounds.min.z);
+    glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+
+    // Bounds crossing the near plane cannot be projected safely - treat them as visible
+    if (clip.w <= 1e-5f || clip.z < -clip.w) {
+      m_stats.testMs += elapsedMs(start);
+      return true;
+    }
+
+    ScreenVertex screen = toScreen(clip);
+    minX = std::min(minX, screen.x);
+    maxX = std::max(maxX, screen.x);
+    minY = std::min(minY, screen.y);
+    maxY = std::max(maxY, screen.y);
+    nearestDepth = std::min(nearestDepth, screen.z);
+  }
+
+  int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+  int x1 = std::min(m_width - 1, static_cast<int>(std::ceil(maxX)));
+  int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+  int y1 = std::min(m_height - 1, static_cast<int>(std::ceil(maxY)));
+
+  bool visible = x0 > x1 || y0 > y1 || !isRegionOccluded(x0, y0, x1, y1, nearestDepth);
+  if (!visible) {
+    m_stats.culled++;
+  }
+
+  m_stats.testMs += elapsedMs(start);
+  return visible;
+}
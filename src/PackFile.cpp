@@ -0,0 +1,199 @@
+#include "../include/PackFile.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+const PackFile* g_mountedPack = nullptr;
+
+std::filesystem::path normalizedPath(const std::string& path) {
+  std::error_code error;
+  std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+  return error ? std::filesystem::path(path).lexically_normal() : canonical;
+}
+}  // namespace
+
+namespace PackFormat {
+uint64_t hash(const void* data, size_t size, uint64_t seed) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  uint64_t result = seed;
+  for (size_t i = 0; i < size; i++) {
+    result ^= bytes[i];
+    result *= 1099511628211ull;
+  }
+  return result;
+}
+}  // namespace PackFormat
+
+PackFile::~PackFile() {
+  close();
+}
+
+bool PackFile::open(const std::string& filepath, const std::string& mountPoint) {
+  close();
+  if (!m_file.open(filepath, FileAccess::Random)) {
+    return false;
+  }
+  if (!validate(filepath)) {
+    close();
+    return false;
+  }
+
+  m_mountPoint = mountPoint.empty() ? "" : normalizedPath(mountPoint).string();
+  findStaleEntries(filepath);
+  LOG_INFO_F("[PackFile] Opened {}: {} asset(s), {} bytes, mounted at '{}'",
+             filepath,
+             m_entryCount,
+             m_file.size(),
+             m_mountPoint);
+  return true;
+}
+
+bool PackFile::validate(const std::string& filepath) {
+  const uint8_t* data = m_file.data();
+  const size_t size = m_file.size();
+
+  PackFormat::Header header;
+  if (size < sizeof(header)) {
+    LOG_ERROR_F("[PackFile] {} is too small to be a pack", filepath);
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, PackFormat::Magic, sizeof(header.magic)) != 0) {
+    LOG_ERROR_F("[PackFile] {} is not a pack file", filepath);
+    return false;
+  }
+  if (header.version != PackFormat::Version) {
+    LOG_ERROR_F("[PackFile] {} has version {}, expected {} (cook it again)", filepath, header.version,
+                PackFormat::Version);
+    return false;
+  }
+
+  const uint64_t tocSize = static_cast<uint64_t>(header.entryCount) * sizeof(PackFormat::Entry);
+  if (header.tocOffset % alignof(PackFormat::Entry) != 0 || header.tocOffset > size ||
+      tocSize > size - header.tocOffset || header.stringTableOffset > size ||
+      header.stringTableSize > size - header.stringTableOffset) {
+    LOG_ERROR_F("[PackFile] {} is truncated or corrupt", filepath);
+    return false;
+  }
+
+  // Mappings are page aligned (and the read fallback heap aligned), so the TOC can be used in place
+  m_entries = reinterpret_cast<const PackFormat::Entry*>(data + header.tocOffset);
+  m_entryCount = header.entryCount;
+  m_strings = reinterpret_cast<const char*>(data + header.stringTableOffset);
+
+  for (uint32_t i = 0; i < m_entryCount; i++) {
+    const PackFormat::Entry& entry = m_entries[i];
+    if (entry.offset > size || entry.size > size - entry.offset ||
+        static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > header.stringTableSize ||
+        (i > 0 && m_entries[i - 1].nameHash > entry.nameHash)) {
+      LOG_ERROR_F("[PackFile] {} has a corrupt entry ({})", filepath, i);
+      return false;
+    }
+  }
+  return true;
+}
+
+void PackFile::findStaleEntries(const std::string& filepath) {
+  m_stale.assign(m_entryCount, false);
+  m_staleCount = 0;
+  if (m_mountPoint.empty()) {
+    return;
+  }
+
+  // One stat per entry at startup. A file newer than the pack was edited after the last cook.
+  std::error_code error;
+  const auto packTime = std::filesystem::last_write_time(filepath, error);
+  if (error) {
+    return;
+  }
+  for (uint32_t i = 0; i < m_entryCount; i++) {
+    const std::filesystem::path loose = std::filesystem::path(m_mountPoint) / std::string(getEntryName(i));
+    const auto looseTime = std::filesystem::last_write_time(loose, error);
+    if (error || looseTime <= packTime) {
+      continue;
+    }
+    m_stale[i] = true;
+    if (m_staleCount++ < 10) {
+      LOG_WARNING_F("[PackFile] {} changed since {} was cooked, using the loose file", loose.string(), filepath);
+    }
+  }
+  if (m_staleCount > 0) {
+    LOG_WARNING_F("[PackFile] {} of {} packed asset(s) are out of date, run machi_cook again",
+                  m_staleCount,
+                  m_entryCount);
+  }
+}
+
+void PackFile::close() {
+  if (g_mountedPack == this) {
+    g_mountedPack = nullptr;
+  }
+  m_file.close();
+  m_entries = nullptr;
+  m_entryCount = 0;
+  m_strings = nullptr;
+  m_mountPoint.clear();
+  m_stale.clear();
+  m_staleCount = 0;
+}
+
+AssetView PackFile::find(const std::string& path) const {
+  if (!m_entries) {
+    return {};
+  }
+
+  std::string name;
+  if (!m_mountPoint.empty()) {
+    std::filesystem::path relative = normalizedPath(path).lexically_relative(m_mountPoint);
+    if (!relative.empty() && *relative.begin() != "..") {
+      name = relative.generic_string();
+    }
+  }
+  if (name.empty()) {
+    name = std::filesystem::path(path).lexically_normal().generic_string();
+  }
+
+  // Different names can share a hash, the TOC keeps them next to each other
+  const uint64_t hash = PackFormat::hash(name.data(), name.size());
+  const PackFormat::Entry* end = m_entries + m_entryCount;
+  const PackFormat::Entry* it = std::lower_bound(
+    m_entries, end, hash, [](const PackFormat::Entry& entry, uint64_t value) { return entry.nameHash < value; });
+  for (; it != end && it->nameHash == hash; ++it) {
+    uint32_t index = static_cast<uint32_t>(it - m_entries);
+    if (getEntryName(index) == name) {
+      return m_stale[index] ? AssetView() : getEntry(index);
+    }
+  }
+  return {};
+}
+
+AssetView PackFile::find(const std::string& path, AssetType type) const {
+  AssetView view = find(path);
+  return view.type == type ? view : AssetView();
+}
+
+AssetView PackFile::getEntry(uint32_t index) const {
+  const PackFormat::Entry& entry = m_entries[index];
+  AssetView view;
+  view.data = m_file.data() + entry.offset;
+  view.size = static_cast<size_t>(entry.size);
+  view.type = static_cast<AssetType>(entry.type);
+  view.contentHash = entry.contentHash;
+  return view;
+}
+
+std::string_view PackFile::getEntryName(uint32_t index) const {
+  const PackFormat::Entry& entry = m_entries[index];
+  return {m_strings + entry.nameOffset, entry.nameLength};
+}
+
+void PackFile::mount(const PackFile* pack) {
+  g_mountedPack = pack;
+}
+
+const PackFile* PackFile::mounted() {
+  return g_mountedPack;
+}
@@ -0,0 +1,317 @@
+#include "../include/ParticleSimulation.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MACHI_PARTICLES_SSE 1
+#endif
+
+namespace {
+constexpr size_t PackGrain = 16384;  // Particles per packing job
+
+// Color and size at the start of life and their change until the end, color scaled to 0-255
+struct LifeCurve {
+  float size;
+  float sizeDelta;
+  float color[4];
+  float colorDelta[4];
+
+  explicit LifeCurve(const ParticleEmitter& emitter) {
+    size = emitter.startSize;
+    sizeDelta = emitter.endSize - emitter.startSize;
+    for (int c = 0; c < 4; c++) {
+      color[c] = std::clamp(emitter.startColor[c], 0.0f, 1.0f) * 255.0f;
+      colorDelta[c] = std::clamp(emitter.endColor[c], 0.0f, 1.0f) * 255.0f - color[c];
+    }
+  }
+};
+
+float nextRandom(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+}
+
+size_t padded(int capacity) {
+  return (static_cast<size_t>(std::max(capacity, 0)) + 3) & ~static_cast<size_t>(3);
+}
+
+void writeInstance(uint8_t* out, float x, float y, float z, float size, uint32_t color) {
+  const float position[4] = {x, y, z, size};
+  std::memcpy(out, position, sizeof(position));
+  std::memcpy(out + sizeof(position), &color, sizeof(color));
+}
+}  // namespace
+
+ParticleSimulation::ParticleSimulation(JobSystem* jobs) :
+ m_jobs(jobs),
+ m_alive(0),
+ m_spawned(0),
+ m_died(0),
+ m_simd(hasSimd()) {}
+
+bool ParticleSimulation::hasSimd() {
+#ifdef MACHI_PARTICLES_SSE
+  return true;
+#else
+  return false;
+#endif
+}
+
+int ParticleSimulation::addEmitter(const ParticleEmitter& emitter) {
+  Pool pool;
+  pool.emitter = emitter;
+  pool.random = static_cast<uint32_t>(m_pools.size() + 1) * 2654435761u;
+  reserve(pool);
+  m_pools.push_back(std::move(pool));
+  return static_cast<int>(m_pools.size()) - 1;
+}
+
+void ParticleSimulation::setEmitter(int index, const ParticleEmitter& emitter) {
+  Pool& pool = m_pools[index];
+  pool.emitter = emitter;
+  reserve(pool);
+}
+
+void ParticleSimulation::clear() {
+  m_pools.clear();
+  m_offsets.clear();
+  m_alive = 0;
+  m_spawned = 0;
+  m_died = 0;
+}
+
+void ParticleSimulation::reserve(Pool& pool) {
+  const size_t size = padded(pool.emitter.capacity);
+  for (std::vector<float>* array :
+       {&pool.x, &pool.y, &pool.z, &pool.vx, &pool.vy, &pool.vz, &pool.life, &pool.lifeRate}) {
+    array->resize(size, 0.0f);
+  }
+  pool.count = std::min(pool.count, static_cast<size_t>(std::max(pool.emitter.capacity, 0)));
+}
+
+void ParticleSimulation::simulate(Pool& pool, float deltaTime, bool simd) {
+  const ParticleEmitter& emitter = pool.emitter;
+  const float keep = std::max(1.0f - emitter.drag * deltaTime, 0.0f);
+  const glm::vec3 acceleration = emitter.acceleration * deltaTime;
+  float* x = pool.x.data();
+  float* y = pool.y.data();
+  float* z = pool.z.data();
+  float* vx = pool.vx.data();
+  float* vy = pool.vy.data();
+  float* vz = pool.vz.data();
+  float* life = pool.life.data();
+  const float* lifeRate = pool.lifeRate.data();
+
+  // Integration, the padding lanes past count are harmless to update. The scalar loops pick up
+  // wherever the SSE ones stopped, which is nowhere when they ran.
+  size_t i = 0;
+#ifdef MACHI_PARTICLES_SSE
+  const __m128 step = _mm_set1_ps(deltaTime);
+  const __m128 keep4 = _mm_set1_ps(keep);
+  const __m128 ax = _mm_set1_ps(acceleration.x);
+  const __m128 ay = _mm_set1_ps(acceleration.y);
+  const __m128 az = _mm_set1_ps(acceleration.z);
+  for (; simd && i < pool.count; i += 4) {
+    const __m128 nx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), ax), keep4);
+    const __m128 ny = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), ay), keep4);
+    const __m128 nz = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vz + i), az), keep4);
+    _mm_storeu_ps(vx + i, nx);
+    _mm_storeu_ps(vy + i, ny);
+    _mm_storeu_ps(vz + i, nz);
+    _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(nx, step)));
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(ny, step)));
+    _mm_storeu_ps(z + i, _mm_add_ps(_mm_loadu_ps(z + i), _mm_mul_ps(nz, step)));
+    _mm_storeu_ps(life + i, _mm_add_ps(_mm_loadu_ps(life + i), _mm_mul_ps(_mm_loadu_ps(lifeRate + i), step)));
+  }
+#endif
+  for (; i < pool.count; i++) {
+    vx[i] = (vx[i] + acceleration.x) * keep;
+    vy[i] = (vy[i] + acceleration.y) * keep;
+    vz[i] = (vz[i] + acceleration.z) * keep;
+    x[i] += vx[i] * deltaTime;
+    y[i] += vy[i] * deltaTime;
+    z[i] += vz[i] * deltaTime;
+    life[i] += lifeRate[i] * deltaTime;
+  }
+
+  // Compaction, the survivors keep their order, which keeps them roughly sorted by age
+  size_t alive = 0;
+  auto moveParticle = [&](size_t from) {
+    x[alive] = x[from];
+    y[alive] = y[from];
+    z[alive] = z[from];
+    vx[alive] = vx[from];
+    vy[alive] = vy[from];
+    vz[alive] = vz[from];
+    life[alive] = life[from];
+    pool.lifeRate[alive] = lifeRate[from];
+    alive++;
+  };
+  i = 0;
+#ifdef MACHI_PARTICLES_SSE
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (; simd && i < pool.count; i += 4) {
+    int mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(life + i), one));
+    if (pool.count - i < 4) {
+      mask &= (1 << (pool.count - i)) - 1;
+    }
+    if (mask == 0xF) {
+      // Most deaths are near the front where the oldest particles are, the rest moves in blocks
+      if (alive != i) {
+        for (float* array : {x, y, z, vx, vy, vz, life, pool.lifeRate.data()}) {
+          _mm_storeu_ps(array + alive, _mm_loadu_ps(array + i));
+        }
+      }
+      alive += 4;
+      continue;
+    }
+    for (int lane = 0; mask && lane < 4; lane++) {
+      if (mask & (1 << lane)) {
+        moveParticle(i + lane);
+      }
+    }
+  }
+#endif
+  for (; i < pool.count; i++) {
+    if (life[i] < 1.0f) {
+      moveParticle(i);
+    }
+  }
+  pool.died = pool.count - alive;
+  pool.count = alive;
+
+  spawn(pool, deltaTime);
+}
+
+void ParticleSimulation::spawn(Pool& pool, float deltaTime) {
+  const ParticleEmitter& emitter = pool.emitter;
+  pool.spawned = 0;
+  if (!emitter.active) {
+    pool.spawnDebt = 0.0f;
+    return;
+  }
+  pool.spawnDebt += emitter.rate * deltaTime;
+  const size_t wanted = static_cast<size_t>(pool.spawnDebt);
+  pool.spawnDebt -= static_cast<float>(wanted);
+  const size_t capacity = static_cast<size_t>(std::max(emitter.capacity, 0));
+  const size_t count = std::min(wanted, capacity - pool.count);
+
+  for (size_t n = 0; n < count; n++) {
+    // Uniform in a ball, by rejection
+    glm::vec3 offset;
+    do {
+      offset = glm::vec3(nextRandom(pool.random), nextRandom(pool.random), nextRandom(pool.random)) * 2.0f -
+               glm::vec3(1.0f);
+    } while (glm::dot(offset, offset) > 1.0f);
+    const glm::vec3 velocity = emitter.velocity + offset * emitter.velocitySpread;
+    const float lifetime =
+      std::max(emitter.minLifetime + (emitter.maxLifetime - emitter.minLifetime) * nextRandom(pool.random), 1e-3f);
+    // Born at some point during the frame, so a fast stream doesn't come out in clumps
+    const float age = nextRandom(pool.random) * deltaTime;
+
+    const size_t i = pool.count++;
+    pool.x[i] = emitter.position.x + velocity.x * age;
+    pool.y[i] = emitter.position.y + velocity.y * age;
+    pool.z[i] = emitter.position.z + velocity.z * age;
+    pool.vx[i] = velocity.x;
+    pool.vy[i] = velocity.y;
+    pool.vz[i] = velocity.z;
+    pool.lifeRate[i] = 1.0f / lifetime;
+    pool.life[i] = age * pool.lifeRate[i];
+  }
+  pool.spawned = count;
+}
+
+void ParticleSimulation::pack(const Pool& pool, size_t begin, size_t end, uint8_t* out, bool simd) {
+  const LifeCurve curve(pool.emitter);
+  size_t i = begin;
+#ifdef MACHI_PARTICLES_SSE
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 size = _mm_set1_ps(curve.size);
+  const __m128 sizeDelta = _mm_set1_ps(curve.sizeDelta);
+  __m128 color[4];
+  __m128 colorDelta[4];
+  for (int c = 0; c < 4; c++) {
+    color[c] = _mm_set1_ps(curve.color[c] + 0.5f);
+    colorDelta[c] = _mm_set1_ps(curve.colorDelta[c]);
+  }
+  for (; simd && i + 4 <= end; i += 4) {
+    const __m128 t = _mm_min_ps(_mm_loadu_ps(&pool.life[i]), one);
+    alignas(16) float sizes[4];
+    alignas(16) uint32_t colors[4];
+    _mm_store_ps(sizes, _mm_add_ps(size, _mm_mul_ps(sizeDelta, t)));
+    // Each channel rounded to a byte and shifted into place, RGBA in memory order
+    __m128i packed = _mm_setzero_si128();
+    for (int c = 0; c < 4; c++) {
+      const __m128 value = _mm_add_ps(color[c], _mm_mul_ps(colorDelta[c], t));
+      const __m128i channel = _mm_cvttps_epi32(_mm_max_ps(value, zero));
+      packed = _mm_or_si128(packed, _mm_slli_epi32(channel, c * 8));
+    }
+    _mm_store_si128(reinterpret_cast<__m128i*>(colors), packed);
+    for (int lane = 0; lane < 4; lane++) {
+      writeInstance(out, pool.x[i + lane], pool.y[i + lane], pool.z[i + lane], sizes[lane], colors[lane]);
+      out += InstanceBytes;
+    }
+  }
+#endif
+  for (; i < end; i++) {
+    const float t = std::min(pool.life[i], 1.0f);
+    uint32_t color = 0;
+    for (int c = 0; c < 4; c++) {
+      color |= static_cast<uint32_t>(curve.color[c] + curve.colorDelta[c] * t + 0.5f) << (c * 8);
+    }
+    writeInstance(out, pool.x[i], pool.y[i], pool.z[i], curve.size + curve.sizeDelta * t, color);
+    out += InstanceBytes;
+  }
+}
+
+void ParticleSimulation::simulate(float deltaTime) {
+  deltaTime = std::clamp(deltaTime, 0.0f, MaxStep);
+  // Emitters don't share anything, each one is a job
+  auto simulatePools = [this, deltaTime](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      simulate(m_pools[i], deltaTime, m_simd);
+    }
+  };
+  if (m_jobs) {
+    m_jobs->parallelFor(m_pools.size(), 1, simulatePools);
+  } else {
+    simulatePools(0, m_pools.size());
+  }
+
+  m_alive = 0;
+  m_spawned = 0;
+  m_died = 0;
+  m_offsets.resize(m_pools.size());
+  for (size_t i = 0; i < m_pools.size(); i++) {
+    m_offsets[i] = m_alive;
+    m_alive += m_pools[i].count;
+    m_spawned += m_pools[i].spawned;
+    m_died += m_pools[i].died;
+  }
+}
+
+void ParticleSimulation::pack(uint8_t* out) const {
+  // Ranges of the whole particle list, split where one emitter's particles end
+  auto packRange = [this, out](size_t begin, size_t end) {
+    size_t pool = std::upper_bound(m_offsets.begin(), m_offsets.end(), begin) - m_offsets.begin() - 1;
+    while (begin < end && pool < m_pools.size()) {
+      const size_t poolEnd = std::min(end, m_offsets[pool] + m_pools[pool].count);
+      if (poolEnd > begin) {
+        pack(m_pools[pool], begin - m_offsets[pool], poolEnd - m_offsets[pool], out + begin * InstanceBytes, m_simd);
+        begin = poolEnd;
+      }
+      pool++;
+    }
+  };
+  if (m_jobs) {
+    m_jobs->parallelFor(m_alive, PackGrain, packRange);
+  } else {
+    packRange(0, m_alive);
+  }
+}
@@ -0,0 +1,114 @@
+#include "../include/ParticleSystem.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+ParticleSystem::ParticleSystem(JobSystem* jobs, ResidencyManager* residency) :
+ m_simulation(jobs),
+ m_residency(residency),
+ m_vao(0),
+ m_buffer(0),
+ m_capacity(InstanceBytes * 1024),
+ m_drawCount(0),
+ m_residencyId(-1) {
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_buffer);
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_capacity), nullptr, GL_STREAM_DRAW);
+  // One instance per particle, the quad's corners come from gl_VertexID
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, InstanceBytes, reinterpret_cast<void*>(0));
+  glVertexAttribDivisor(0, 1);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, InstanceBytes, reinterpret_cast<void*>(16));
+  glVertexAttribDivisor(1, 1);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  if (m_residency) {
+    m_residencyId = m_residency->add(ResidencyKind::Buffer, "particle instances", m_capacity);
+  }
+}
+
+ParticleSystem::~ParticleSystem() {
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->remove(m_residencyId);
+  }
+  glDeleteBuffers(1, &m_buffer);
+  glDeleteVertexArrays(1, &m_vao);
+}
+
+void ParticleSystem::clear() {
+  m_simulation.clear();
+  m_drawCount = 0;
+  m_stats = ParticleStats();
+}
+
+void ParticleSystem::update(float deltaTime) {
+  auto start = std::chrono::high_resolution_clock::now();
+  m_simulation.simulate(deltaTime);
+  m_stats.emitters = static_cast<int>(m_simulation.getEmitterCount());
+  m_stats.alive = m_simulation.getAliveCount();
+  m_stats.spawned = m_simulation.getSpawnedCount();
+  m_stats.died = m_simulation.getDiedCount();
+  auto packStart = std::chrono::high_resolution_clock::now();
+  m_stats.simulateMs = std::chrono::duration<float, std::milli>(packStart - start).count();
+
+  m_drawCount = 0;
+  m_stats.streamBytes = m_stats.alive * InstanceBytes;
+  m_stats.streamMs = 0.0f;
+  if (m_stats.alive == 0) {
+    return;
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  if (m_stats.streamBytes > m_capacity) {
+    // Grown with headroom so a slowly rising particle count doesn't reallocate every frame
+    m_capacity = std::max(m_stats.streamBytes, m_capacity * 2);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_capacity), nullptr, GL_STREAM_DRAW);
+    if (m_residency && m_residencyId >= 0) {
+      m_residency->resize(m_residencyId, m_capacity);
+    }
+  }
+  // Invalidated, the driver hands out fresh storage instead of waiting for last frame's draw. The
+  // workers write into the mapping directly.
+  auto* mapped = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER,
+                                                        0,
+                                                        static_cast<GLsizeiptr>(m_stats.streamBytes),
+                                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  if (!mapped) {
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    LOG_ERROR("[ParticleSystem] Failed to map the instance buffer");
+    return;
+  }
+
+  m_simulation.pack(mapped);
+  // The contents are lost if the display mode changed while mapped, skip drawing them this frame
+  if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE) {
+    m_drawCount = static_cast<GLsizei>(m_stats.alive);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  m_stats.streamMs =
+    std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - packStart).count();
+}
+
+void ParticleSystem::draw() const {
+  if (m_drawCount == 0) {
+    return;
+  }
+  // Additive so the order doesn't matter. Hidden behind the scene but they don't hide each other.
+  const GLboolean blending = glIsEnabled(GL_BLEND);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+  glDepthMask(GL_FALSE);
+  glBindVertexArray(m_vao);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_drawCount);
+  glBindVertexArray(0);
+  glDepthMask(GL_TRUE);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  if (!blending) {
+    glDisable(GL_BLEND);
+  }
+}
@@ -0,0 +1,126 @@
+#include "../include/Profiler.hpp"
+#include "../include/Logger.hpp"
+
+namespace {
+// Weight of a new sample in the smoothed times
+constexpr float Smoothing = 0.1f;
+
+float smooth(float average, float sample, int frames) {
+  return frames == 0 ? sample : average + (sample - average) * Smoothing;
+}
+}  // namespace
+
+Profiler::Profiler() : m_frame(0) {}
+
+Profiler::~Profiler() {
+  for (std::vector<Event>& events : m_frames) {
+    for (const Event& event : events) {
+      m_freeQueries.push_back(event.queries[0]);
+      m_freeQueries.push_back(event.queries[1]);
+    }
+  }
+  if (!m_freeQueries.empty()) {
+    glDeleteQueries(static_cast<GLsizei>(m_freeQueries.size()), m_freeQueries.data());
+  }
+}
+
+GLuint Profiler::takeQuery() {
+  if (m_freeQueries.empty()) {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    return query;
+  }
+  GLuint query = m_freeQueries.back();
+  m_freeQueries.pop_back();
+  return query;
+}
+
+void Profiler::collect(std::vector<Event>& events) {
+  // Summed per scope first, a scope that ran several times counts as one sample
+  std::vector<float> cpu(m_timings.size(), 0.0f);
+  std::vector<float> gpu(m_timings.size(), 0.0f);
+  std::vector<int> calls(m_timings.size(), 0);
+  for (const Event& event : events) {
+    // Latency frames later the result is as good as always there, waiting here is the exception
+    GLuint64 start = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(event.queries[0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(event.queries[1], GL_QUERY_RESULT, &end);
+    cpu[event.timing] += event.cpuMs;
+    gpu[event.timing] += static_cast<float>(end - start) / 1e6f;
+    calls[event.timing]++;
+    m_freeQueries.push_back(event.queries[0]);
+    m_freeQueries.push_back(event.queries[1]);
+  }
+  events.clear();
+
+  for (size_t i = 0; i < m_timings.size(); i++) {
+    ProfileTiming& timing = m_timings[i];
+    timing.calls = calls[i];
+    if (calls[i] == 0) {
+      timing.skippedFrames++;
+      continue;
+    }
+    timing.cpuMs = smooth(timing.cpuMs, cpu[i], timing.frames);
+    timing.gpuMs = smooth(timing.gpuMs, gpu[i], timing.frames);
+    timing.lastCpuMs = cpu[i];
+    timing.lastGpuMs = gpu[i];
+    timing.skippedFrames = 0;
+    timing.frames++;
+  }
+}
+
+void Profiler::beginFrame() {
+  if (!m_open.empty()) {
+    LOG_WARNING_F("[Profiler] {} scope(s) still open at the end of the frame", m_open.size());
+    while (!m_open.empty()) {
+      pop();
+    }
+  }
+  m_frame = (m_frame + 1) % Latency;
+  collect(m_frames[m_frame]);
+}
+
+void Profiler::push(const char* name) {
+  auto it = m_lookup.find(name);
+  int timing;
+  if (it != m_lookup.end()) {
+    timing = it->second;
+  } else {
+    timing = static_cast<int>(m_timings.size());
+    ProfileTiming entry;
+    entry.name = name;
+    entry.depth = static_cast<int>(m_open.size());
+    m_timings.push_back(entry);
+    m_lookup[name] = timing;
+  }
+
+  Event event;
+  event.timing = timing;
+  event.queries[0] = takeQuery();
+  event.queries[1] = takeQuery();
+  event.start = Clock::now();
+  event.cpuMs = 0.0f;
+  glQueryCounter(event.queries[0], GL_TIMESTAMP);
+  m_open.push_back(static_cast<int>(m_frames[m_frame].size()));
+  m_frames[m_frame].push_back(event);
+}
+
+void Profiler::pop() {
+  if (m_open.empty()) {
+    LOG_WARNING("[Profiler] pop() without a matching push()");
+    return;
+  }
+  Event& event = m_frames[m_frame][m_open.back()];
+  m_open.pop_back();
+  glQueryCounter(event.queries[1], GL_TIMESTAMP);
+  event.cpuMs = std::chrono::duration<float, std::milli>(Clock::now() - event.start).count();
+}
+
+const ProfileTiming* Profiler::find(const std::string& name) const {
+  auto it = m_lookup.find(name);
+  if (it == m_lookup.end() || m_timings[it->second].frames == 0) {
+    return nullptr;
+  }
+  return &m_timings[it->second];
+}
@@ -0,0 +1,459 @@
+#include "../include/RenderGraph.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+
+namespace {
+bool isDepthFormat(GLenum format) {
+  switch (format) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool hasStencil(GLenum format) {
+  return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+size_t bytesPerPixel(GLenum format) {
+  switch (format) {
+    case GL_R8:
+      return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+      return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+      return 8;
+    case GL_RGBA32F:
+      return 16;
+    default:
+      return 4;
+  }
+}
+
+size_t textureBytes(const RenderGraph::TextureDesc& desc) {
+  return bytesPerPixel(desc.format) * desc.width * desc.height * std::max(desc.samples, 1);
+}
+
+GLenum textureTarget(const RenderGraph::TextureDesc& desc) {
+  return desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+}
+}  // namespace
+
+RenderGraph::Handle RenderGraph::Builder::create(const std::string& name, const TextureDesc& desc) {
+  Resource resource;
+  resource.name = name;
+  resource.desc = desc;
+  m_graph.m_resources.push_back(resource);
+  Handle handle = static_cast<Handle>(m_graph.m_resources.size()) - 1;
+  write(handle);
+  return handle;
+}
+
+void RenderGraph::Builder::read(Handle resource) {
+  m_graph.m_passes[m_pass].reads.push_back(resource);
+}
+
+void RenderGraph::Builder::write(Handle resource) {
+  Pass& pass = m_graph.m_passes[m_pass];
+  if (std::find(pass.writes.begin(), pass.writes.end(), resource) == pass.writes.end()) {
+    pass.writes.push_back(resource);
+    m_graph.m_resources[resource].writers.push_back(m_pass);
+  }
+}
+
+void RenderGraph::Builder::colorTarget(Handle resource, int index) {
+  std::vector<Handle>& targets = m_graph.m_passes[m_pass].colorTargets;
+  if (static_cast<int>(targets.size()) <= index) {
+    targets.resize(index + 1, InvalidHandle);
+  }
+  targets[index] = resource;
+  write(resource);
+}
+
+void RenderGraph::Builder::depthTarget(Handle resource) {
+  m_graph.m_passes[m_pass].depthTarget = resource;
+  write(resource);
+}
+
+void RenderGraph::Builder::sideEffect() {
+  m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+GLuint RenderGraph::Context::texture(Handle resource) const {
+  return m_graph.m_resources[resource].texture;
+}
+
+const RenderGraph::TextureDesc& RenderGraph::Context::desc(Handle resource) const {
+  return m_graph.m_resources[resource].desc;
+}
+
+void RenderGraph::Context::blit(Handle source, Handle destination, GLbitfield mask) const {
+  auto framebufferOf = [this](Handle resource) {
+    if (isDepthFormat(m_graph.m_resources[resource].desc.format)) {
+      return m_graph.framebuffer({}, resource);
+    }
+    return m_graph.framebuffer({resource}, InvalidHandle);
+  };
+  const TextureDesc& from = desc(source);
+  const TextureDesc& to = desc(destination);
+  const GLuint readFramebuffer = framebufferOf(source);
+  const GLuint drawFramebuffer = framebufferOf(destination);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+  // Depth and resolves have to be copied 1:1, only color can be scaled
+  const bool sameSize = from.width == to.width && from.height == to.height;
+  glBlitFramebuffer(0,
+                    0,
+                    from.width,
+                    from.height,
+                    0,
+                    0,
+                    to.width,
+                    to.height,
+                    mask,
+                    sameSize || mask != GL_COLOR_BUFFER_BIT ? GL_NEAREST : GL_LINEAR);
+}
+
+void RenderGraph::Context::drawFullscreenTriangle() const {
+  glBindVertexArray(m_graph.m_emptyVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+}
+
+RenderGraph::RenderGraph(ResidencyManager* residency) : m_emptyVAO(0), m_residency(residency) {
+  // The core profile can't draw without a vertex array, even with no attributes
+  glGenVertexArrays(1, &m_emptyVAO);
+}
+
+RenderGraph::~RenderGraph() {
+  while (!m_pool.empty()) {
+    release(m_pool.size() - 1);
+  }
+  for (const auto& entry : m_framebuffers) {
+    glDeleteFramebuffers(1, &entry.second);
+  }
+  glDeleteVertexArrays(1, &m_emptyVAO);
+}
+
+void RenderGraph::reset() {
+  m_resources.clear();
+  m_passes.clear();
+  m_order.clear();
+}
+
+RenderGraph::Handle RenderGraph::importTexture(const std::string& name, GLuint texture, const TextureDesc& desc) {
+  Resource resource;
+  resource.name = name;
+  resource.desc = desc;
+  resource.texture = texture;
+  resource.imported = true;
+  m_resources.push_back(resource);
+  return static_cast<Handle>(m_resources.size()) - 1;
+}
+
+RenderGraph::Handle RenderGraph::importBackbuffer(const std::string& name, int width, int height) {
+  TextureDesc desc;
+  desc.width = width;
+  desc.height = height;
+  Handle handle = importTexture(name, 0, desc);
+  m_resources[handle].backbuffer = true;
+  return handle;
+}
+
+void RenderGraph::addPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute) {
+  Pass pass;
+  pass.name = name;
+  pass.execute = std::move(execute);
+  m_passes.push_back(std::move(pass));
+  Builder builder(*this, static_cast<int>(m_passes.size()) - 1);
+  setup(builder);
+}
+
+void RenderGraph::cull() {
+  // Passes whose results end up somewhere outside the graph, and everything they depend on
+  std::vector<int> stack;
+  for (size_t i = 0; i < m_passes.size(); i++) {
+    Pass& pass = m_passes[i];
+    pass.culled = true;
+    bool root = pass.sideEffect;
+    for (Handle resource : pass.writes) {
+      root = root || m_resources[resource].imported;
+    }
+    if (root) {
+      pass.culled = false;
+      stack.push_back(static_cast<int>(i));
+    }
+  }
+  while (!stack.empty()) {
+    const Pass& pass = m_passes[stack.back()];
+    stack.pop_back();
+    for (Handle resource : pass.reads) {
+      for (int writer : m_resources[resource].writers) {
+        if (m_passes[writer].culled) {
+          m_passes[writer].culled = false;
+          stack.push_back(writer);
+        }
+      }
+    }
+  }
+  for (const Pass& pass : m_passes) {
+    m_stats.culledPasses += pass.culled ? 1 : 0;
+  }
+}
+
+bool RenderGraph::sort() {
+  // A pass runs after the writers of what it reads, and after earlier writers of what it writes.
+  // Reads of a resource only written by later declared passes wait for them, otherwise the
+  // declaration order decides.
+  const int count = static_cast<int>(m_passes.size());
+  std::vector<std::vector<int>> dependencies(count);
+  for (int i = 0; i < count; i++) {
+    const Pass& pass = m_passes[i];
+    if (pass.culled) {
+      continue;
+    }
+    for (Handle resource : pass.reads) {
+      const std::vector<int>& writers = m_resources[resource].writers;
+      const bool writtenBefore = std::any_of(writers.begin(), writers.end(), [i](int writer) { return writer < i; });
+      for (int writer : writers) {
+        if (writer != i && (!writtenBefore || writer < i) && !m_passes[writer].culled) {
+          dependencies[i].push_back(writer);
+        }
+      }
+    }
+    for (Handle resource : pass.writes) {
+      for (int writer : m_resources[resource].writers) {
+        if (writer < i && !m_passes[writer].culled) {
+          dependencies[i].push_back(writer);
+        }
+      }
+    }
+  }
+
+  // Kahn's algorithm, picking the earliest declared pass that is ready
+  std::vector<bool> done(count, false);
+  int remaining = count - m_stats.culledPasses;
+  while (remaining > 0) {
+    int next = -1;
+    for (int i = 0; i < count && next < 0; i++) {
+      if (done[i] || m_passes[i].culled) {
+        continue;
+      }
+      const bool ready = std::all_of(
+        dependencies[i].begin(), dependencies[i].end(), [&done](int dependency) { return done[dependency]; });
+      if (ready) {
+        next = i;
+      }
+    }
+    if (next < 0) {
+      return false;
+    }
+    done[next] = true;
+    m_order.push_back(next);
+    remaining--;
+  }
+  return true;
+}
+
+void RenderGraph::allocate() {
+  for (size_t position = 0; position < m_order.size(); position++) {
+    const Pass& pass = m_passes[m_order[position]];
+    auto use = [this, position](Handle resource) {
+      Resource& used = m_resources[resource];
+      if (used.firstUse < 0) {
+        used.firstUse = static_cast<int>(position);
+      }
+      used.lastUse = static_cast<int>(position);
+    };
+    std::for_each(pass.reads.begin(), pass.reads.end(), use);
+    std::for_each(pass.writes.begin(), pass.writes.end(), use);
+  }
+
+  std::vector<Handle> transients;
+  for (size_t i = 0; i < m_resources.size(); i++) {
+    if (!m_resources[i].imported && m_resources[i].firstUse >= 0) {
+      transients.push_back(static_cast<Handle>(i));
+    }
+  }
+  std::sort(transients.begin(), transients.end(), [this](Handle a, Handle b) {
+    return m_resources[a].firstUse < m_resources[b].firstUse;
+  });
+
+  // Greedy by first use: any pool texture of the same description that is free by then is taken
+  for (PoolTexture& entry : m_pool) {
+    entry.busyUntil = -1;
+  }
+  std::vector<bool> usedThisFrame(m_pool.size(), false);
+  for (Handle handle : transients) {
+    Resource& resource = m_resources[handle];
+    int chosen = -1;
+    for (size_t i = 0; i < m_pool.size() && chosen < 0; i++) {
+      if (m_pool[i].desc == resource.desc && m_pool[i].busyUntil < resource.firstUse) {
+        chosen = static_cast<int>(i);
+      }
+    }
+    if (chosen < 0) {
+      PoolTexture entry;
+      entry.desc = resource.desc;
+      const GLenum target = textureTarget(resource.desc);
+      glGenTextures(1, &entry.texture);
+      glBindTexture(target, entry.texture);
+      if (resource.desc.samples > 1) {
+        glTexImage2DMultisample(
+          target, resource.desc.samples, resource.desc.format, resource.desc.width, resource.desc.height, GL_TRUE);
+      } else {
+        // Only the storage matters, the format and type just have to be compatible with it
+        GLenum format = isDepthFormat(resource.desc.format) ? GL_DEPTH_COMPONENT : GL_RGBA;
+        GLenum type = GL_FLOAT;
+        if (hasStencil(resource.desc.format)) {
+          format = GL_DEPTH_STENCIL;
+          type = resource.desc.format == GL_DEPTH24_STENCIL8 ? GL_UNSIGNED_INT_24_8 : GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+        }
+        glTexImage2D(
+          target, 0, resource.desc.format, resource.desc.width, resource.desc.height, 0, format, type, nullptr);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      }
+      glBindTexture(target, 0);
+      if (m_residency) {
+        entry.residencyId = m_residency->add(ResidencyKind::Texture, "render target", textureBytes(entry.desc));
+      }
+      m_pool.push_back(entry);
+      usedThisFrame.push_back(false);
+      chosen = static_cast<int>(m_pool.size()) - 1;
+    }
+
+    PoolTexture& entry = m_pool[chosen];
+    entry.busyUntil = resource.lastUse;
+    resource.texture = entry.texture;
+    m_stats.transientTextures++;
+    m_stats.transientBytes += textureBytes(resource.desc);
+    if (!usedThisFrame[chosen]) {
+      usedThisFrame[chosen] = true;
+      m_stats.physicalTextures++;
+      m_stats.physicalBytes += textureBytes(entry.desc);
+    }
+  }
+
+  // Textures of targets that went away (a resize, a disabled pass) are let go after a while
+  for (size_t i = m_pool.size(); i-- > 0;) {
+    PoolTexture& entry = m_pool[i];
+    if (usedThisFrame[i]) {
+      entry.unusedFrames = 0;
+      if (m_residency && entry.residencyId >= 0) {
+        m_residency->touch(entry.residencyId);
+      }
+    } else if (++entry.unusedFrames > KeepFrames) {
+      release(i);
+    }
+  }
+  for (const PoolTexture& entry : m_pool) {
+    m_stats.poolBytes += textureBytes(entry.desc);
+  }
+}
+
+void RenderGraph::release(size_t poolIndex) {
+  PoolTexture& entry = m_pool[poolIndex];
+  for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+    if (std::find(it->first.begin(), it->first.end(), entry.texture) != it->first.end()) {
+      glDeleteFramebuffers(1, &it->second);
+      it = m_framebuffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (m_residency && entry.residencyId >= 0) {
+    m_residency->remove(entry.residencyId);
+  }
+  glDeleteTextures(1, &entry.texture);
+  m_pool.erase(m_pool.begin() + poolIndex);
+}
+
+GLuint RenderGraph::framebuffer(const std::vector<Handle>& colors, Handle depth) {
+  if (colors.size() == 1 && depth == InvalidHandle && m_resources[colors[0]].backbuffer) {
+    return 0;
+  }
+
+  std::vector<GLuint> key;
+  for (Handle color : colors) {
+    key.push_back(color == InvalidHandle ? 0 : m_resources[color].texture);
+  }
+  key.push_back(depth == InvalidHandle ? 0 : m_resources[depth].texture);
+  auto it = m_framebuffers.find(key);
+  if (it != m_framebuffers.end()) {
+    return it->second;
+  }
+
+  GLuint framebuffer = 0;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  std::vector<GLenum> drawBuffers;
+  for (size_t i = 0; i < colors.size(); i++) {
+    if (colors[i] == InvalidHandle) {
+      drawBuffers.push_back(GL_NONE);
+      continue;
+    }
+    const Resource& color = m_resources[colors[i]];
+    if (color.backbuffer) {
+      LOG_ERROR_F("[RenderGraph] {} can't be attached next to other targets", color.name);
+    }
+    glFramebufferTexture2D(
+      GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i), textureTarget(color.desc), color.texture, 0);
+    drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i));
+  }
+  if (drawBuffers.empty()) {
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  } else {
+    glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+  }
+  if (depth != InvalidHandle) {
+    const Resource& target = m_resources[depth];
+    const GLenum attachment = hasStencil(target.desc.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, textureTarget(target.desc), target.texture, 0);
+  }
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    LOG_ERROR("[RenderGraph] Incomplete framebuffer for a pass");
+  }
+  m_framebuffers[key] = framebuffer;
+  return framebuffer;
+}
+
+void RenderGraph::execute(Profiler* profiler) {
+  m_stats = RenderGraphStats();
+  m_stats.passes = static_cast<int>(m_passes.size());
+  cull();
+  if (!sort()) {
+    LOG_ERROR("[RenderGraph] The passes depend on each other in a cycle, nothing is rendered");
+    return;
+  }
+  allocate();
+
+  Context context(*this);
+  for (int index : m_order) {
+    Pass& pass = m_passes[index];
+    Profiler::Scope scope(profiler, pass.name.c_str());
+    const Handle sizeFrom = pass.depthTarget != InvalidHandle ? pass.depthTarget
+                            : pass.colorTargets.empty()        ? InvalidHandle
+                                                               : pass.colorTargets[0];
+    if (sizeFrom != InvalidHandle) {
+      glBindFramebuffer(GL_FRAMEBUFFER, framebuffer(pass.colorTargets, pass.depthTarget));
+      glViewport(0, 0, m_resources[sizeFrom].desc.width, m_resources[sizeFrom].desc.height);
+    }
+    pass.execute(context);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,126 @@
+#include "../include/ResidencyManager.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+
+ResidencyManager::ResidencyManager(size_t budget) : m_frame(1) {
+  m_stats.budget = budget;
+}
+
+void ResidencyManager::account(const Entry& entry, bool add) {
+  size_t& kindBytes = entry.kind == ResidencyKind::Texture ? m_stats.textureBytes : m_stats.bufferBytes;
+  if (add) {
+    kindBytes += entry.bytes;
+    m_stats.used += entry.bytes;
+    m_stats.peak = std::max(m_stats.peak, m_stats.used);
+  } else {
+    kindBytes -= entry.bytes;
+    m_stats.used -= entry.bytes;
+  }
+}
+
+int ResidencyManager::add(ResidencyKind kind,
+                          const std::string& name,
+                          size_t bytes,
+                          DropMipFunction dropMip,
+                          EvictFunction evict) {
+  int id;
+  if (!m_freeEntries.empty()) {
+    id = m_freeEntries.back();
+    m_freeEntries.pop_back();
+  } else {
+    id = static_cast<int>(m_entries.size());
+    m_entries.emplace_back();
+  }
+
+  Entry& entry = m_entries[id];
+  entry.kind = kind;
+  entry.name = name;
+  entry.bytes = bytes;
+  entry.lastUsedFrame = m_frame;
+  entry.dropMip = std::move(dropMip);
+  entry.evict = std::move(evict);
+  entry.active = true;
+
+  account(entry, true);
+  m_stats.resources++;
+  return id;
+}
+
+void ResidencyManager::resize(int id, size_t bytes) {
+  Entry& entry = m_entries[id];
+  if (bytes > entry.bytes) {
+    entry.exhausted = false;
+  }
+  account(entry, false);
+  entry.bytes = bytes;
+  account(entry, true);
+}
+
+void ResidencyManager::remove(int id) {
+  Entry& entry = m_entries[id];
+  account(entry, false);
+  entry = Entry();
+  m_freeEntries.push_back(id);
+  m_stats.resources--;
+}
+
+void ResidencyManager::touch(int id) {
+  Entry& entry = m_entries[id];
+  if (entry.lastUsedFrame != m_frame) {
+    entry.lastUsedFrame = m_frame;
+    entry.exhausted = false;
+    m_stats.touchedThisFrame++;
+  }
+}
+
+void ResidencyManager::beginFrame() {
+  m_frame++;
+  m_stats.touchedThisFrame = 0;
+  m_stats.mipsDroppedThisFrame = 0;
+  m_stats.evictedThisFrame = 0;
+  m_stats.bytesFreedThisFrame = 0;
+}
+
+void ResidencyManager::enforceBudget() {
+  while (m_stats.used > m_stats.budget) {
+    // Linear scan for the least recently used candidate, eviction is rare and entries are few
+    int victim = -1;
+    for (size_t i = 0; i < m_entries.size(); i++) {
+      const Entry& entry = m_entries[i];
+      bool canFree = (entry.dropMip && !entry.exhausted) || entry.evict;
+      if (!entry.active || entry.bytes == 0 || entry.lastUsedFrame == m_frame || !canFree) {
+        continue;
+      }
+      if (victim < 0 || entry.lastUsedFrame < m_entries[victim].lastUsedFrame) {
+        victim = static_cast<int>(i);
+      }
+    }
+    if (victim < 0) {
+      // Everything left is in use this frame (or can't be freed), stay over budget
+      return;
+    }
+
+    Entry& entry = m_entries[victim];
+    const size_t before = entry.bytes;
+    size_t after = before;
+    if (entry.dropMip && !entry.exhausted) {
+      after = entry.dropMip();
+    }
+
+    if (after < before) {
+      m_stats.mipsDroppedThisFrame++;
+    } else if (entry.evict) {
+      entry.evict();
+      after = 0;
+      m_stats.evictedThisFrame++;
+      LOG_INFO_F("[Residency] Evicted {} ({} bytes)", entry.name, before);
+    } else {
+      entry.exhausted = true;
+      continue;
+    }
+
+    resize(victim, after);
+    m_stats.bytesFreedThisFrame += before - after;
+  }
+}
@@ -0,0 +1,160 @@
+#include "../include/ResourceManager.hpp"
+#include "../include/Utils.hpp"
+
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+
+ResourceManager::ResourceManager(ResidencyManager* residency) :
+ m_textures("texture"), m_shaders("shader"), m_residency(residency) {
+  m_textures.setReleaseCallback([this](Texture& texture) {
+    auto it = m_residencyIds.find(&texture);
+    if (it != m_residencyIds.end()) {
+      m_residency->remove(it->second);
+      m_residencyIds.erase(it);
+    }
+  });
+}
+
+std::string ResourceManager::canonicalPath(const std::string& path) {
+  std::error_code error;
+  std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+  return error ? std::filesystem::path(path).lexically_normal().string() : canonical.string();
+}
+
+ResourceManager::TextureRef ResourceManager::loadTexture(const std::string& path) {
+  return loadTexture(path, usageFromPath(path));
+}
+
+ResourceManager::TextureRef ResourceManager::loadTexture(const std::string& path, TextureUsage usage) {
+  std::string canonical = canonicalPath(path);
+  std::string key = canonical + "|usage=" + std::to_string(static_cast<int>(usage));
+  return m_textures.acquire(key, [&]() -> std::unique_ptr<Texture> {
+    auto texture = std::make_unique<Texture>(0, canonical.c_str(), usage);
+    if (!texture->isLoaded()) {
+      return nullptr;
+    }
+    if (m_residency) {
+      m_residencyIds[texture.get()] = m_residency->add(ResidencyKind::Texture, canonical, texture->getMemoryUsage());
+    }
+    return texture;
+  });
+}
+
+ResourceManager::ShaderRef ResourceManager::loadShader(const std::string& vertexPath, const std::string& fragmentPath) {
+  return loadShader(vertexPath, fragmentPath, {}, true);
+}
+
+ResourceManager::ShaderRef ResourceManager::loadShader(const std::string& vertexPath,
+                                                       const std::string& fragmentPath,
+                                                       const ShaderDefines& defines,
+                                                       bool wait) {
+  std::string vertex = canonicalPath(vertexPath);
+  std::string fragment = canonicalPath(fragmentPath);
+  std::string variant = ShaderPreprocessor::definesKey(defines);
+  std::string key = vertex + "|" + fragment + (variant.empty() ? "" : "|" + variant);
+  bool started = false;
+  ShaderRef shader = m_shaders.acquire(key, [&]() -> std::unique_ptr<Shader> {
+    try {
+      auto shader = std::make_unique<Shader>(vertex, fragment, defines, m_shaderCache, wait);
+      started = true;
+      return !wait || shader->isLinked() ? std::move(shader) : nullptr;
+    } catch (const std::exception& e) {
+      LOG_ERROR_F("[ResourceManager] {}", e.what());
+      return nullptr;
+    }
+  });
+
+  if (!shader) {
+    return shader;
+  }
+  if (wait) {
+    // Also finishes a variant that was started in the background and is wanted right away now
+    if (!shader->finish()) {
+      return ShaderRef();
+    }
+  } else if (started) {
+    if (shader->isReady()) {
+      shader->finish();
+    } else {
+      m_compilingShaders.push_back(shader);
+    }
+  }
+  return shader;
+}
+
+int ResourceManager::updateShaders() {
+  int finished = 0;
+  for (size_t i = 0; i < m_compilingShaders.size();) {
+    Shader* shader = m_compilingShaders[i].get();
+    if (shader->isReady()) {
+      shader->finish();
+      m_compilingShaders[i] = std::move(m_compilingShaders.back());
+      m_compilingShaders.pop_back();
+      finished++;
+    } else {
+      i++;
+    }
+  }
+  return finished;
+}
+
+int ResourceManager::warmUpShaders(const std::string& listPath) {
+  std::string list;
+  try {
+    list = Utils::loadFile(listPath, false);
+  } catch (const std::exception&) {
+    LOG_WARNING_F("[ResourceManager] No shader warm-up list at {}", listPath);
+    return 0;
+  }
+
+  const std::filesystem::path directory = std::filesystem::path(listPath).parent_path();
+  std::istringstream lines(list);
+  std::string line;
+  int started = 0;
+  while (std::getline(lines, line)) {
+    std::istringstream words(line);
+    std::string vertex;
+    std::string fragment;
+    if (!(words >> vertex) || vertex[0] == '#') {
+      continue;
+    }
+    if (!(words >> fragment)) {
+      LOG_WARNING_F("[ResourceManager] Ignoring '{}' in {}, it needs a vertex and a fragment shader", line, listPath);
+      continue;
+    }
+    ShaderDefines defines;
+    std::string define;
+    while (words >> define) {
+      size_t equals = define.find('=');
+      defines.emplace_back(define.substr(0, equals), equals == std::string::npos ? "" : define.substr(equals + 1));
+    }
+    ShaderRef shader = loadShader((directory / vertex).string(), (directory / fragment).string(), defines, false);
+    if (shader) {
+      m_warmShaders.push_back(shader);
+      started++;
+    }
+  }
+  LOG_INFO_F("[ResourceManager] Warming up {} shader variant(s), {} compiling in the background",
+             started,
+             m_compilingShaders.size());
+  return started;
+}
+
+void ResourceManager::logStats() const {
+  auto log = [](const char* type, const ResourceStats& stats) {
+    LOG_INFO_F("{}: {} live, {} bytes, {} hits / {} misses ({}% hit rate), {} failed",
+               type,
+               stats.live,
+               stats.bytes,
+               stats.hits,
+               stats.misses,
+               stats.hitRate(),
+               stats.failures);
+  };
+  log("Textures", m_textures.getStats());
+  log("Shaders", m_shaders.getStats());
+  if (!m_compilingShaders.empty()) {
+    LOG_INFO_F("  {} shader variant(s) still compiling", m_compilingShaders.size());
+  }
+}
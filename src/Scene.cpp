@@ -0,0 +1,149 @@
+#include "../include/Scene.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Mesh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+Scene::Scene() : m_needsRebuild(false), m_needsRefit(false), m_staticVersion(0) {}
+
+int Scene::addObject(const glm::mat4& transform, const AABB& localBounds, bool isStatic) {
+  SceneObject object;
+  object.transform = transform;
+  object.localBounds = localBounds;
+  object.worldBounds = localBounds.transformed(transform);
+  object.isStatic = isStatic;
+
+  int objectId = static_cast<int>(m_objects.size());
+
+  if (isStatic) {
+    m_needsRebuild = true;
+    m_staticVersion++;
+  } else {
+    object.proxy = m_bvh.insert(object.worldBounds, objectId);
+  }
+
+  m_objects.push_back(object);
+  return objectId;
+}
+
+int Scene::addEntities() {
+  int added = 0;
+  m_world.query<const Transform, const MeshRenderer, SceneLink>().forEach(
+      [&](Entity, const Transform& transform, const MeshRenderer& renderer, SceneLink& link) {
+        if (link.objectId >= 0 || !renderer.mesh) {
+          return;
+        }
+        link.objectId = addObject(transform.matrix, renderer.mesh->getBounds(), renderer.isStatic);
+        setMesh(link.objectId, renderer.mesh);
+        setMaterial(link.objectId, renderer.material);
+        added++;
+      });
+  return added;
+}
+
+void Scene::setTransform(int objectId, const glm::mat4& transform) {
+  SceneObject& object = m_objects[objectId];
+  object.transform = transform;
+  object.worldBounds = object.localBounds.transformed(transform);
+  if (object.isStatic) {
+    m_staticVersion++;
+  }
+
+  if (object.proxy == BVH::NullNode) {
+    return;
+  }
+
+  if (object.isStatic) {
+    m_bvh.setBounds(object.proxy, object.worldBounds);
+    m_needsRefit = true;
+  } else {
+    m_bvh.move(object.proxy, object.worldBounds);
+  }
+}
+
+void Scene::setOccluder(int objectId, std::shared_ptr<const OccluderMesh> occluder) {
+  m_objects[objectId].occluder = std::move(occluder);
+}
+
+void Scene::update() {
+  if (m_needsRebuild) {
+    buildHierarchy();
+  } else if (m_needsRefit) {
+    m_bvh.refit();
+    m_needsRefit = false;
+  }
+}
+
+void Scene::buildHierarchy() {
+  auto start = std::chrono::high_resolution_clock::now();
+
+  std::vector<BVHBuildItem> items;
+  std::vector<int> ids;
+  for (size_t i = 0; i < m_objects.size(); i++) {
+    if (m_objects[i].isStatic) {
+      items.push_back({m_objects[i].worldBounds, static_cast<int>(i)});
+      ids.push_back(static_cast<int>(i));
+    }
+  }
+
+  std::vector<int> proxies = m_bvh.build(items);
+  for (size_t i = 0; i < ids.size(); i++) {
+    m_objects[ids[i]].proxy = proxies[i];
+  }
+
+  // The build wipes the tree, so dynamic objects are inserted again on top of the static hierarchy
+  for (size_t i = 0; i < m_objects.size(); i++) {
+    if (!m_objects[i].isStatic) {
+      m_objects[i].proxy = m_bvh.insert(m_objects[i].worldBounds, static_cast<int>(i));
+    }
+  }
+
+  m_needsRebuild = false;
+  m_needsRefit = false;
+
+  float elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  BVHStats stats = m_bvh.computeStats();
+  LOG_INFO_F("[Scene] BVH built: {} objects, {} nodes, height {}, SAH cost {} in {} ms",
+             stats.leafCount,
+             stats.nodeCount,
+             stats.height,
+             stats.sahCost,
+             elapsed);
+}
+
+void Scene::cull(const Frustum& frustum, std::vector<int>& visible) const {
+  visible.clear();
+  m_bvh.queryFrustum(frustum, visible);
+}
+
+void Scene::queryOverlap(const AABB& bounds, std::vector<int>& results) const {
+  results.clear();
+  m_bvh.queryOverlap(bounds, results);
+}
+
+bool Scene::pick(const Ray& ray, float maxDistance, RaycastHit& hit) const {
+  // Dynamic proxies are fattened, so confirm candidates against the tight world bounds
+  return m_bvh.raycast(ray, maxDistance, hit, [this](int objectId, const Ray& r, float& distance) {
+    return r.intersects(m_objects[objectId].worldBounds, std::numeric_limits<float>::max(), distance);
+  });
+}
+
+void Scene::cullOccluded(OcclusionCuller& culler, const glm::mat4& viewProjection, std::vector<int>& visible) const {
+  culler.beginFrame(viewProjection);
+
+  // Only occluders that survived frustum culling can hide anything on screen
+  for (int objectId : visible) {
+    const SceneObject& object = m_objects[objectId];
+    if (object.occluder) {
+      culler.renderOccluder(*object.occluder, object.transform);
+    }
+  }
+  culler.finalize();
+
+  visible.erase(std::remove_if(visible.begin(),
+                               visible.end(),
+                               [&](int objectId) { return !culler.isVisible(m_objects[objectId].worldBounds); }),
+                visible.end());
+}
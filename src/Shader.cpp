@@ -1,51 +1,211 @@
 #include "../include/Shader.hpp"
-#include "../include/Utils.hpp"
+#include <GLFW/glfw3.h>
 #include "../include/Logger.hpp"
+#include "../include/ShaderCache.hpp"
+#include "../include/Texture.hpp"
 
-Shader::Shader(const char* vPath, const char* fPath) {
-  std::string vertexCode = Utils::loadFile(vPath);
-  std::string fragmentCode = Utils::loadFile(fPath);
+#include <algorithm>
 
-  const char* vShaderCode = vertexCode.c_str();
-  const char* fShaderCode = fragmentCode.c_str();
+namespace {
+// KHR_parallel_shader_compile and its ARB twin aren't part of the generated GLAD loader
+constexpr GLenum CompletionStatus = 0x91B1;  // GL_COMPLETION_STATUS_KHR
+typedef void(APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
 
-  unsigned vShader, fShader;
-  int success;
-  char infoLog[512];
+bool g_parallelCompile = false;
 
-  // Vertex Shader
-  vShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vShader, 1, &vShaderCode, nullptr);
-  glCompileShader(vShader);
-  glGetShaderiv(vShader, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    glGetShaderInfoLog(vShader, 512, nullptr, infoLog);
-    LOG_ERROR_F("[Shader] there was an error with the vShader: {}", infoLog);
-  };
-
-  // Frag Shader
-  fShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fShader, 1, &fShaderCode, nullptr);
-  glCompileShader(fShader);
-  glGetShaderiv(fShader, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    glGetShaderInfoLog(fShader, 512, nullptr, infoLog);
-    LOG_ERROR_F("[Shader] there was an error with the fShader: {}", infoLog);
-  };
+std::string infoLog(GLuint object, bool program) {
+  GLint length = 0;
+  if (program) {
+    glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+  } else {
+    glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+  }
+  std::string log(static_cast<size_t>(std::max(length, 1)), '\0');
+  if (program) {
+    glGetProgramInfoLog(object, length, nullptr, log.data());
+  } else {
+    glGetShaderInfoLog(object, length, nullptr, log.data());
+  }
+  log.resize(log.find('\0') == std::string::npos ? log.size() : log.find('\0'));
+  return log;
+}
+
+// The log refers to files by their #line source string number
+void logFiles(const std::vector<std::string>& files) {
+  for (size_t i = 0; i < files.size(); i++) {
+    LOG_ERROR_F("[Shader]   source {} = {}", i, files[i]);
+  }
+}
+
+unsigned int compile(GLenum type, const std::string& source) {
+  // The length is passed along, the text may hold anything
+  const char* code = source.data();
+  const GLint length = static_cast<GLint>(source.size());
+  unsigned int shader = glCreateShader(type);
+  glShaderSource(shader, 1, &code, &length);
+  glCompileShader(shader);
+  return shader;
+}
+}  // namespace
+
+bool Shader::enableParallelCompile() {
+  if (!hasExtension("GL_KHR_parallel_shader_compile") && !hasExtension("GL_ARB_parallel_shader_compile")) {
+    g_parallelCompile = false;
+    return false;
+  }
+  auto maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+  if (!maxThreads) {
+    maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+  }
+  // 0xFFFFFFFF leaves the thread count to the driver
+  if (maxThreads) {
+    maxThreads(0xFFFFFFFFu);
+  }
+  g_parallelCompile = true;
+  return true;
+}
+
+bool Shader::hasParallelCompile() {
+  return g_parallelCompile;
+}
+
+Shader::Shader(const char* vPath, const char* fPath, ShaderCache* cache) : Shader(vPath, fPath, {}, cache, true) {}
+
+Shader::Shader(
+  const std::string& vPath, const std::string& fPath, const ShaderDefines& defines, ShaderCache* cache, bool wait) :
+ m_id(0) {
+  ShaderSource vertex = ShaderPreprocessor::load(vPath, defines);
+  ShaderSource fragment = ShaderPreprocessor::load(fPath, defines);
+  build(vertex, fragment, cache);
+  if (m_pending) {
+    std::string variant = ShaderPreprocessor::definesKey(defines);
+    m_pending->name = vPath + " + " + fPath + (variant.empty() ? "" : " [" + variant + "]");
+    if (wait) {
+      finish();
+    }
+  }
+}
+
+void Shader::build(const ShaderSource& vertex, const ShaderSource& fragment, ShaderCache* cache) {
+  // A cached binary skips compiling and linking altogether, anything else falls through to the source
+  const bool useCache = cache && cache->isSupported();
+  uint64_t cacheKey = 0;
+  if (useCache) {
+    cacheKey = cache->key(vertex.text, fragment.text);
+    m_id = cache->load(cacheKey);
+    if (m_id) {
+      m_linked = true;
+      readBinaryLength();
+      return;
+    }
+  }
+
+  // Nothing is checked until finish(), querying a status here would wait for the compiler
+  m_pending = std::make_unique<Pending>();
+  m_pending->vertex = compile(GL_VERTEX_SHADER, vertex.text);
+  m_pending->fragment = compile(GL_FRAGMENT_SHADER, fragment.text);
+  m_pending->cache = useCache ? cache : nullptr;
+  m_pending->cacheKey = cacheKey;
+  m_pending->vertexFiles = vertex.files;
+  m_pending->fragmentFiles = fragment.files;
 
-  // Shader Program
   m_id = glCreateProgram();
-  glAttachShader(m_id, vShader);
-  glAttachShader(m_id, fShader);
+  glAttachShader(m_id, m_pending->vertex);
+  glAttachShader(m_id, m_pending->fragment);
+  if (useCache) {
+    cache->prepare(m_id);
+  }
   glLinkProgram(m_id);
+}
+
+bool Shader::isReady() const {
+  if (!m_pending || !g_parallelCompile) {
+    return true;
+  }
+  GLint done = GL_FALSE;
+  glGetProgramiv(m_id, CompletionStatus, &done);
+  return done != GL_FALSE;
+}
+
+bool Shader::finish() {
+  if (!m_pending) {
+    return m_linked;
+  }
+  std::unique_ptr<Pending> pending = std::move(m_pending);
+
+  int success;
+  glGetShaderiv(pending->vertex, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    LOG_ERROR_F(
+      "[Shader] there was an error with the vShader of {}: {}", pending->name, infoLog(pending->vertex, false));
+    logFiles(pending->vertexFiles);
+  }
+  glGetShaderiv(pending->fragment, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    LOG_ERROR_F(
+      "[Shader] there was an error with the fShader of {}: {}", pending->name, infoLog(pending->fragment, false));
+    logFiles(pending->fragmentFiles);
+  }
+
   glGetProgramiv(m_id, GL_LINK_STATUS, &success);
   if (!success) {
-    glGetProgramInfoLog(m_id, 512, nullptr, infoLog);
-  };
+    LOG_ERROR_F("[Shader] {} failed to link: {}", pending->name, infoLog(m_id, true));
+  }
+  m_linked = success != 0;
+
+  if (m_linked) {
+    readBinaryLength();
+    if (pending->cache) {
+      pending->cache->store(pending->cacheKey, m_id);
+    }
+  }
 
   // Delete now that they've been binded to the shader program
-  glDeleteShader(vShader);
-  glDeleteShader(fShader);
+  glDeleteShader(pending->vertex);
+  glDeleteShader(pending->fragment);
+  return m_linked;
+}
+
+void Shader::readBinaryLength() {
+  // The driver's binary is the closest thing to a program's memory footprint that GL exposes
+  if (GLAD_GL_VERSION_4_1) {
+    GLint binaryLength = 0;
+    glGetProgramiv(m_id, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    m_bytes = static_cast<size_t>(binaryLength);
+  }
+}
+
+Shader::~Shader() {
+  if (m_pending) {
+    glDeleteShader(m_pending->vertex);
+    glDeleteShader(m_pending->fragment);
+  }
+  if (m_id) {
+    glDeleteProgram(m_id);
+  }
+}
+
+Shader::Shader(Shader&& other) noexcept :
+ m_linked(other.m_linked), m_bytes(other.m_bytes), m_pending(std::move(other.m_pending)), m_id(other.m_id) {
+  other.m_id = 0;
+}
+
+Shader& Shader::operator=(Shader&& other) noexcept {
+  if (this != &other) {
+    if (m_pending) {
+      glDeleteShader(m_pending->vertex);
+      glDeleteShader(m_pending->fragment);
+    }
+    if (m_id) {
+      glDeleteProgram(m_id);
+    }
+    m_id = other.m_id;
+    m_linked = other.m_linked;
+    m_bytes = other.m_bytes;
+    m_pending = std::move(other.m_pending);
+    other.m_id = 0;
+  }
+  return *this;
 }
 
 void Shader::use() {
@@ -61,7 +221,11 @@ void Shader::setInt(const std::string& name, int value) const {
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
-  glUniform1i(glGetUniformLocation(m_id, name.c_str()), value);
+  glUniform1f(glGetUniformLocation(m_id, name.c_str()), value);
+}
+
+void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
+  glUniform3fv(glGetUniformLocation(m_id, name.c_str()), 1, glm::value_ptr(value));
 }
 
 void Shader::setMat4(const std::string& name, glm::mat4& mat) const {
@@ -0,0 +1,185 @@
+#include "../include/ShaderCache.hpp"
+#include <GLFW/glfw3.h>
+#include "../include/Logger.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/PackFile.hpp"
+#include "../include/Texture.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+constexpr char EntryMagic[4] = {'M', 'S', 'H', 'B'};
+constexpr uint32_t EntryVersion = 1;
+
+// Precedes the driver's binary in every cache file
+struct EntryHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t binaryFormat;
+  uint32_t length;
+};
+
+static_assert(sizeof(EntryHeader) == 24, "shader cache entry layout changed");
+
+const char* glString(GLenum name) {
+  const char* value = reinterpret_cast<const char*>(glGetString(name));
+  return value ? value : "";
+}
+}  // namespace
+
+ShaderCache::ShaderCache(const std::string& directory) :
+ m_directory(directory),
+ m_driverHash(0),
+ m_supported(false),
+ m_getProgramBinary(nullptr),
+ m_programBinary(nullptr),
+ m_programParameteri(nullptr) {
+  // Core since 4.1, the extension carries the same entry points on older contexts
+  if (m_directory.empty() || !(GLAD_GL_VERSION_4_1 || hasExtension("GL_ARB_get_program_binary"))) {
+    LOG_INFO("[ShaderCache] Program binaries not available, shaders are compiled from source");
+    return;
+  }
+  m_getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(glfwGetProcAddress("glGetProgramBinary"));
+  m_programBinary = reinterpret_cast<ProgramBinaryProc>(glfwGetProcAddress("glProgramBinary"));
+  m_programParameteri = reinterpret_cast<ProgramParameteriProc>(glfwGetProcAddress("glProgramParameteri"));
+
+  // Some drivers expose the API but no format to save in
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (!m_getProgramBinary || !m_programBinary || !m_programParameteri || formats <= 0) {
+    LOG_INFO("[ShaderCache] The driver has no program binary format, shaders are compiled from source");
+    return;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+  if (error) {
+    LOG_WARNING_F("[ShaderCache] Can't create '{}': {}", m_directory, error.message());
+    return;
+  }
+
+  const char* strings[] = {glString(GL_VENDOR), glString(GL_RENDERER), glString(GL_VERSION)};
+  m_driverHash = PackFormat::hash(&EntryVersion, sizeof(EntryVersion));
+  for (const char* value : strings) {
+    // The terminator keeps "ab"+"c" and "a"+"bc" apart
+    m_driverHash = PackFormat::hash(value, std::strlen(value) + 1, m_driverHash);
+  }
+  m_supported = true;
+  LOG_INFO_F("[ShaderCache] Caching program binaries in '{}' ({} format(s))", m_directory, formats);
+}
+
+std::string ShaderCache::entryPath(uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+  return (std::filesystem::path(m_directory) / name).string();
+}
+
+uint64_t ShaderCache::key(std::string_view vertexSource, std::string_view fragmentSource) const {
+  const uint64_t vertexSize = vertexSource.size();
+  uint64_t result = PackFormat::hash(&vertexSize, sizeof(vertexSize), m_driverHash);
+  result = PackFormat::hash(vertexSource.data(), vertexSource.size(), result);
+  return PackFormat::hash(fragmentSource.data(), fragmentSource.size(), result);
+}
+
+GLuint ShaderCache::load(uint64_t key) {
+  if (!m_supported) {
+    return 0;
+  }
+  const std::string path = entryPath(key);
+  std::error_code error;
+  if (!std::filesystem::exists(path, error)) {
+    m_stats.misses++;
+    return 0;
+  }
+
+  MappedFile file;
+  EntryHeader header;
+  bool valid = file.open(path) && file.size() >= sizeof(header);
+  if (valid) {
+    std::memcpy(&header, file.data(), sizeof(header));
+    valid = std::memcmp(header.magic, EntryMagic, sizeof(EntryMagic)) == 0 && header.version == EntryVersion &&
+            header.key == key && file.size() - sizeof(header) == header.length;
+  }
+
+  GLuint program = 0;
+  if (valid) {
+    program = glCreateProgram();
+    m_programBinary(program, header.binaryFormat, file.data() + sizeof(header), static_cast<GLsizei>(header.length));
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+      glDeleteProgram(program);
+      program = 0;
+    }
+  }
+
+  if (!program) {
+    LOG_WARNING_F("[ShaderCache] Discarding rejected binary {}", path);
+    file.close();
+    std::filesystem::remove(path, error);
+    m_stats.rejected++;
+    m_stats.misses++;
+    return 0;
+  }
+  m_stats.hits++;
+  return program;
+}
+
+void ShaderCache::prepare(GLuint program) const {
+  if (m_supported) {
+    m_programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+}
+
+bool ShaderCache::store(uint64_t key, GLuint program) {
+  if (!m_supported) {
+    return false;
+  }
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return false;
+  }
+
+  std::vector<uint8_t> binary(static_cast<size_t>(length));
+  GLsizei written = 0;
+  GLenum format = 0;
+  m_getProgramBinary(program, length, &written, &format, binary.data());
+  if (written <= 0) {
+    return false;
+  }
+
+  EntryHeader header;
+  std::memcpy(header.magic, EntryMagic, sizeof(EntryMagic));
+  header.version = EntryVersion;
+  header.key = key;
+  header.binaryFormat = format;
+  header.length = static_cast<uint32_t>(written);
+
+  // Written aside and renamed so a crash never leaves a truncated entry behind
+  const std::string path = entryPath(key);
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(binary.data()), written);
+    if (!file.good()) {
+      LOG_WARNING_F("[ShaderCache] Failed to write {}", temporary);
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    LOG_WARNING_F("[ShaderCache] Failed to write {}: {}", path, error.message());
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  m_stats.stored++;
+  return true;
+}
@@ -0,0 +1,164 @@
+#include "../include/ShaderPreprocessor.hpp"
+#include "../include/PackFile.hpp"
+#include "../include/Utils.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+struct Expansion {
+  ShaderSource& source;
+  const ShaderDefines& defines;
+  bool versionSeen = false;
+};
+
+// Source text as a view of the mounted asset pack or of the mapped loose file. The mapping (when
+// there is one) has to outlive the view.
+std::string_view loadText(const std::string& filepath, MappedFile& file) {
+  if (const PackFile* pack = PackFile::mounted()) {
+    if (AssetView view = pack->find(filepath, AssetType::Shader)) {
+      return view.text();
+    }
+  }
+  file = Utils::mapFile(filepath);
+  return file.text();
+}
+
+std::string_view trimmed(std::string_view line) {
+  size_t begin = line.find_first_not_of(" \t");
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  size_t end = line.find_last_not_of(" \t\r");
+  return line.substr(begin, end - begin + 1);
+}
+
+// "#  include" is as valid as "#include"
+bool isDirective(std::string_view line, std::string_view name, std::string_view& rest) {
+  if (line.empty() || line[0] != '#') {
+    return false;
+  }
+  line = trimmed(line.substr(1));
+  if (line.compare(0, name.size(), name) != 0 ||
+      (line.size() > name.size() && line[name.size()] != ' ' && line[name.size()] != '\t')) {
+    return false;
+  }
+  rest = trimmed(line.substr(name.size()));
+  return true;
+}
+
+std::string defineLines(const ShaderDefines& defines) {
+  std::string lines;
+  for (const auto& [name, value] : defines) {
+    lines += "#define " + name + " " + (value.empty() ? std::string("1") : value) + "\n";
+  }
+  return lines;
+}
+
+void appendLine(std::string& text, int line, size_t file) {
+  text += "#line " + std::to_string(line) + " " + std::to_string(file) + "\n";
+}
+
+void expand(Expansion& expansion, const std::string& filepath, const std::string& includedFrom) {
+  std::vector<std::string>& files = expansion.source.files;
+  const std::string normalized = std::filesystem::path(filepath).lexically_normal().generic_string();
+  if (std::find(files.begin(), files.end(), normalized) != files.end()) {
+    return;
+  }
+
+  MappedFile file;
+  std::string_view text;
+  try {
+    text = loadText(normalized, file);
+  } catch (const std::exception&) {
+    throw std::runtime_error(includedFrom.empty() ? "Can't load shader " + normalized
+                                                  : "Can't find " + normalized + " included from " + includedFrom);
+  }
+
+  const size_t index = files.size();
+  files.push_back(normalized);
+  std::string& out = expansion.source.text;
+  if (index > 0) {
+    appendLine(out, 1, index);
+  }
+
+  const std::filesystem::path directory = std::filesystem::path(normalized).parent_path();
+  int lineNumber = 0;
+  size_t position = 0;
+  while (position < text.size()) {
+    size_t end = text.find('\n', position);
+    if (end == std::string_view::npos) {
+      end = text.size();
+    }
+    std::string_view line = text.substr(position, end - position);
+    position = end + 1;
+    lineNumber++;
+
+    std::string_view directive = trimmed(line);
+    std::string_view rest;
+    if (isDirective(directive, "include", rest)) {
+      const bool quoted = rest.size() >= 2 && ((rest.front() == '"' && rest.back() == '"') ||
+                                               (rest.front() == '<' && rest.back() == '>'));
+      if (!quoted) {
+        throw std::runtime_error(normalized + ":" + std::to_string(lineNumber) + ": malformed #include");
+      }
+      std::string name(rest.substr(1, rest.size() - 2));
+      expand(expansion, (directory / name).string(), normalized + ":" + std::to_string(lineNumber));
+      appendLine(out, lineNumber + 1, index);
+      continue;
+    }
+    if (isDirective(directive, "pragma", rest) && rest == "once") {
+      out += "\n";
+      continue;
+    }
+    if (isDirective(directive, "version", rest)) {
+      // Only the loaded file's #version counts, it has to stay the first statement
+      if (index > 0 || expansion.versionSeen) {
+        out += "\n";
+        continue;
+      }
+      expansion.versionSeen = true;
+      out.append(line.data(), line.size());
+      out += "\n";
+      out += defineLines(expansion.defines);
+      if (!expansion.defines.empty()) {
+        appendLine(out, lineNumber + 1, index);
+      }
+      continue;
+    }
+    out.append(line.data(), line.size());
+    out += "\n";
+  }
+}
+}  // namespace
+
+namespace ShaderPreprocessor {
+ShaderSource load(const std::string& filepath, const ShaderDefines& defines) {
+  ShaderSource source;
+  Expansion expansion{source, defines};
+  expand(expansion, filepath, "");
+
+  // Without a #version line there is nowhere safe to put the defines but the very top
+  if (!expansion.versionSeen && !defines.empty()) {
+    std::string header = defineLines(defines);
+    appendLine(header, 1, 0);
+    source.text.insert(0, header);
+  }
+  return source;
+}
+
+std::string definesKey(const ShaderDefines& defines) {
+  ShaderDefines sorted = defines;
+  std::sort(sorted.begin(), sorted.end());
+  std::string key;
+  for (const auto& [name, value] : sorted) {
+    if (!key.empty()) {
+      key += ";";
+    }
+    key += name + "=" + (value.empty() ? std::string("1") : value);
+  }
+  return key;
+}
+}  // namespace ShaderPreprocessor
@@ -0,0 +1,279 @@
+#include "../include/ShadowMaps.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+// Blend between uniform and logarithmic splits, more of the resolution goes close to the camera
+constexpr float SplitLambda = 0.75f;
+// Cached cascades cover this much more than they need to, the camera can move a while before they
+// have to be re-centered
+constexpr float CacheMargin = 0.25f;
+
+const char* const CascadeScopes[ShadowMaps::MaxCascades] = {
+  "Shadow cascade 0", "Shadow cascade 1", "Shadow cascade 2", "Shadow cascade 3"};
+}  // namespace
+
+ShadowMaps::ShadowMaps(int size, int cascades, int firstCached, float distance, ResidencyManager* residency) :
+ m_size(size),
+ m_cascadeCount(std::clamp(cascades, 1, MaxCascades)),
+ m_firstCached(std::clamp(firstCached, 0, m_cascadeCount)),
+ m_distance(distance),
+ m_refreshInterval(0),
+ m_lightDirection(glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f))),
+ m_frame(0),
+ m_depth(0),
+ m_static(0),
+ m_framebuffers{0, 0},
+ m_residencyId(-1),
+ m_residency(residency) {
+  m_matrices.fill(glm::mat4(1.0f));
+
+  glGenTextures(1, &m_depth);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_depth);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, m_size, m_size, m_cascadeCount, 0, GL_DEPTH_COMPONENT,
+               GL_FLOAT, nullptr);
+  // Compared in the sampler, linear filtering gives 2x2 PCF for free
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  const float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+  const int cachedCount = m_cascadeCount - m_firstCached;
+  if (cachedCount > 0) {
+    glGenTextures(1, &m_static);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_static);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, m_size, m_size, cachedCount, 0, GL_DEPTH_COMPONENT,
+                 GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  // Depth only, a layer is attached before each pass
+  glGenFramebuffers(2, m_framebuffers);
+  for (GLuint framebuffer : m_framebuffers) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    LOG_ERROR("[ShadowMaps] Shadow framebuffer is incomplete");
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (m_residency) {
+    const size_t bytes = static_cast<size_t>(m_size) * m_size * 4 * (m_cascadeCount + cachedCount);
+    m_residencyId = m_residency->add(ResidencyKind::Texture, "shadow maps", bytes);
+  }
+  LOG_INFO_F("[ShadowMaps] {} cascade(s) of {}x{}, {} cached", m_cascadeCount, m_size, m_size, cachedCount);
+}
+
+ShadowMaps::~ShadowMaps() {
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->remove(m_residencyId);
+  }
+  glDeleteFramebuffers(2, m_framebuffers);
+  glDeleteTextures(1, &m_depth);
+  if (m_static) {
+    glDeleteTextures(1, &m_static);
+  }
+}
+
+void ShadowMaps::setLightDirection(const glm::vec3& direction) {
+  m_lightDirection = glm::normalize(direction);
+}
+
+void ShadowMaps::invalidate() {
+  for (Cascade& cascade : m_cascades) {
+    cascade.valid = false;
+  }
+}
+
+void ShadowMaps::fitCascade(
+  int index, const glm::mat4& inverseView, float splitNear, float splitFar, float tanX, float tanY) {
+  Cascade& cascade = m_cascades[index];
+  cascade.splitFar = splitFar;
+
+  // The sphere around the slice is centered on the view axis, so turning the camera doesn't change
+  // its size. Rounded up to keep float noise from changing the texel size.
+  const float center = std::min(splitFar, 0.5f * (splitNear + splitFar) * (1.0f + tanX * tanX + tanY * tanY));
+  const float farExtent2 = (tanX * tanX + tanY * tanY) * splitFar * splitFar;
+  const float nearExtent2 = (tanX * tanX + tanY * tanY) * splitNear * splitNear;
+  float radius = std::sqrt(std::max((splitFar - center) * (splitFar - center) + farExtent2,
+                                    (center - splitNear) * (center - splitNear) + nearExtent2));
+  radius = std::ceil(radius * 16.0f) / 16.0f;
+  glm::vec3 worldCenter = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -center, 1.0f));
+
+  if (index >= m_firstCached) {
+    // Kept where it is while the slice's sphere is still inside the padded one and the light hasn't
+    // turned, otherwise render() would redraw the static casters with the old light's matrix
+    const float sliceRadius = radius;
+    radius = std::ceil(radius * (1.0f + CacheMargin));
+    if (cascade.valid && cascade.radius == radius && cascade.lightDirection == m_lightDirection &&
+        glm::length(worldCenter - cascade.center) + sliceRadius <= radius) {
+      return;
+    }
+    cascade.valid = false;
+  }
+
+  // Snapped to whole texels in light space, the rasterization of static casters stays the same
+  const glm::vec3 up = std::abs(m_lightDirection.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+  const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), m_lightDirection, up);
+  glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(worldCenter, 1.0f));
+  const float texel = 2.0f * radius / m_size;
+  lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+  lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+
+  // Casters up to the shadow distance in front of the sphere still throw shadows into it
+  const glm::mat4 projection = glm::ortho(lightCenter.x - radius,
+                                          lightCenter.x + radius,
+                                          lightCenter.y - radius,
+                                          lightCenter.y + radius,
+                                          -lightCenter.z - radius - m_distance,
+                                          -lightCenter.z + radius);
+  cascade.viewProjection = projection * lightRotation;
+  cascade.center = worldCenter;
+  cascade.radius = radius;
+  m_matrices[index] = cascade.viewProjection;
+}
+
+void ShadowMaps::drawCasters(const Scene& scene, const Shader& depthShader, bool staticCasters) {
+  const GLint modelLocation = glGetUniformLocation(depthShader.m_id, "model");
+  const Mesh* boundMesh = nullptr;
+  for (int objectId : m_casters) {
+    const SceneObject& object = scene.getObject(objectId);
+    if (!object.mesh || object.isStatic != staticCasters) {
+      continue;
+    }
+    if (object.mesh != boundMesh) {
+      object.mesh->bind();
+      depthShader.setVec3("positionScale", object.mesh->getPositionScale());
+      depthShader.setVec3("positionOffset", object.mesh->getPositionOffset());
+      boundMesh = object.mesh;
+    }
+    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(object.transform));
+    object.mesh->draw(object.lod);
+    m_stats.casters++;
+  }
+}
+
+void ShadowMaps::render(const Scene& scene,
+                        Shader& depthShader,
+                        const glm::mat4& view,
+                        float fovY,
+                        float aspect,
+                        float nearPlane,
+                        Profiler* profiler) {
+  Profiler::Scope scope(profiler, "Shadows");
+  m_stats = ShadowStats();
+  m_frame++;
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->touch(m_residencyId);
+  }
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[0]);
+  glViewport(0, 0, m_size, m_size);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(1.5f, 3.0f);
+  depthShader.use();
+  const GLint matrixLocation = glGetUniformLocation(depthShader.m_id, "lightViewProjection");
+
+  const glm::mat4 inverseView = glm::inverse(view);
+  const float tanY = std::tan(fovY * 0.5f);
+  const float tanX = tanY * aspect;
+  float splitNear = nearPlane;
+  for (int i = 0; i < m_cascadeCount; i++) {
+    const float t = static_cast<float>(i + 1) / m_cascadeCount;
+    const float logSplit = nearPlane * std::pow(m_distance / nearPlane, t);
+    const float uniformSplit = nearPlane + (m_distance - nearPlane) * t;
+    const float splitFar = SplitLambda * logSplit + (1.0f - SplitLambda) * uniformSplit;
+    fitCascade(i, inverseView, splitNear, splitFar, tanX, tanY);
+    splitNear = splitFar;
+
+    Cascade& cascade = m_cascades[i];
+    scene.cull(Frustum::fromMatrix(cascade.viewProjection), m_casters);
+    glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, glm::value_ptr(cascade.viewProjection));
+
+    if (i < m_firstCached) {
+      Profiler::Scope cascadeScope(profiler, CascadeScopes[i]);
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth, 0, i);
+      glClear(GL_DEPTH_BUFFER_BIT);
+      drawCasters(scene, depthShader, true);
+      drawCasters(scene, depthShader, false);
+      m_stats.rendered++;
+      continue;
+    }
+
+    const int staticLayer = i - m_firstCached;
+    // Scheduled refreshes are offset by a frame per cascade so they don't pile up in one frame
+    const bool scheduled = m_refreshInterval > 0 && (m_frame + staticLayer) % m_refreshInterval == 0;
+    const bool refresh = !cascade.valid || cascade.staticVersion != scene.getStaticVersion() ||
+                         cascade.lightDirection != m_lightDirection || scheduled;
+    if (refresh) {
+      Profiler::Scope cascadeScope(profiler, CascadeScopes[i]);
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_static, 0, staticLayer);
+      glClear(GL_DEPTH_BUFFER_BIT);
+      drawCasters(scene, depthShader, true);
+      cascade.valid = true;
+      cascade.staticVersion = scene.getStaticVersion();
+      cascade.lightDirection = m_lightDirection;
+      m_stats.rendered++;
+    } else {
+      const ProfileTiming* timing = profiler ? profiler->find(CascadeScopes[i]) : nullptr;
+      m_stats.savedMs += timing ? timing->gpuMs : 0.0f;
+      m_stats.cached++;
+    }
+
+    // The live layer is the static one plus whatever moves, restored when either changed
+    const bool movingCasters = std::any_of(
+      m_casters.begin(), m_casters.end(), [&scene](int id) { return !scene.getObject(id).isStatic; });
+    if (refresh || movingCasters || cascade.hasMovingCasters) {
+      Profiler::Scope copyScope(profiler, "Shadow cache restore");
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffers[1]);
+      glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_static, 0, staticLayer);
+      glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth, 0, i);
+      glBlitFramebuffer(0, 0, m_size, m_size, 0, 0, m_size, m_size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffers[0]);
+      drawCasters(scene, depthShader, false);
+      cascade.hasMovingCasters = movingCasters;
+      m_stats.copied += refresh ? 0 : 1;
+    }
+  }
+
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void ShadowMaps::bind(const Shader& shader) const {
+  glActiveTexture(GL_TEXTURE0 + Unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_depth);
+  glActiveTexture(GL_TEXTURE0);
+  shader.setInt("shadowMap", Unit);
+  shader.setInt("cascadeCount", m_cascadeCount);
+
+  glm::vec4 splits(0.0f);
+  glm::vec4 texelSizes(0.0f);
+  for (int i = 0; i < m_cascadeCount; i++) {
+    splits[i] = m_cascades[i].splitFar;
+    texelSizes[i] = 2.0f * m_cascades[i].radius / m_size;
+  }
+  glUniformMatrix4fv(
+    glGetUniformLocation(shader.m_id, "shadowMatrices"), m_cascadeCount, GL_FALSE, glm::value_ptr(m_matrices[0]));
+  glUniform4fv(glGetUniformLocation(shader.m_id, "cascadeSplits"), 1, glm::value_ptr(splits));
+  glUniform4fv(glGetUniformLocation(shader.m_id, "cascadeTexelSizes"), 1, glm::value_ptr(texelSizes));
+  shader.setFloat("shadowTexelSize", 1.0f / m_size);
+}
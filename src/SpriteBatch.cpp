@@ -0,0 +1,227 @@
+#include "../include/SpriteBatch.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr size_t InitialQuads = 1024;
+
+uint32_t packColor(glm::vec4 color) {
+  uint32_t packed = 0;
+  for (int c = 0; c < 4; c++) {
+    const auto channel = static_cast<uint32_t>(std::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    packed |= channel << (c * 8);
+  }
+  return packed;
+}
+}  // namespace
+
+SpriteBatch::SpriteBatch(ResidencyManager* residency) :
+ m_screenSize(1.0f),
+ m_vao(0),
+ m_vertexBuffer(0),
+ m_indexBuffer(0),
+ m_whiteTexture(0),
+ m_capacity(0),
+ m_residency(residency),
+ m_residencyId(-1) {
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_vertexBuffer);
+  glGenBuffers(1, &m_indexBuffer);
+
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, VertexBytes, reinterpret_cast<void*>(0));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, VertexBytes, reinterpret_cast<void*>(16));
+  // The element buffer binding is part of the vertex array
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  if (m_residency) {
+    m_residencyId = m_residency->add(ResidencyKind::Buffer, "sprite batch", 0);
+  }
+  reserve(InitialQuads);
+
+  const uint32_t white = 0xFFFFFFFF;
+  glGenTextures(1, &m_whiteTexture);
+  glBindTexture(GL_TEXTURE_2D, m_whiteTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+SpriteBatch::~SpriteBatch() {
+  glDeleteTextures(1, &m_whiteTexture);
+  glDeleteBuffers(1, &m_indexBuffer);
+  glDeleteBuffers(1, &m_vertexBuffer);
+  glDeleteVertexArrays(1, &m_vao);
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->remove(m_residencyId);
+  }
+}
+
+void SpriteBatch::reserve(size_t quads) {
+  if (quads <= m_capacity) {
+    return;
+  }
+  size_t capacity = std::max(m_capacity, InitialQuads);
+  while (capacity < quads) {
+    capacity *= 2;
+  }
+
+  // The indices never change, two triangles over the four corners of every quad
+  std::vector<uint32_t> indices(capacity * 6);
+  for (size_t quad = 0; quad < capacity; quad++) {
+    const auto corner = static_cast<uint32_t>(quad * 4);
+    uint32_t* index = &indices[quad * 6];
+    index[0] = corner;
+    index[1] = corner + 1;
+    index[2] = corner + 2;
+    index[3] = corner + 2;
+    index[4] = corner + 1;
+    index[5] = corner + 3;
+  }
+  glBindVertexArray(m_vao);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)),
+               indices.data(),
+               GL_STATIC_DRAW);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity * 4 * VertexBytes), nullptr, GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  m_capacity = capacity;
+  if (m_residency && m_residencyId >= 0) {
+    m_residency->resize(m_residencyId, capacity * (4 * VertexBytes + 6 * sizeof(uint32_t)));
+  }
+}
+
+void SpriteBatch::begin(int width, int height) {
+  m_screenSize = glm::vec2(static_cast<float>(std::max(width, 1)), static_cast<float>(std::max(height, 1)));
+  m_vertices.clear();
+  m_batches.clear();
+}
+
+void SpriteBatch::addQuad(GLuint texture,
+                          bool distanceField,
+                          glm::vec2 position,
+                          glm::vec2 size,
+                          glm::vec4 uv,
+                          uint32_t color) {
+  const size_t quad = m_vertices.size() / 4;
+  if (m_batches.empty() || m_batches.back().texture != texture || m_batches.back().distanceField != distanceField) {
+    m_batches.push_back({texture, distanceField, quad, 0});
+  }
+  m_batches.back().count++;
+
+  const float right = position.x + size.x;
+  const float bottom = position.y + size.y;
+  m_vertices.push_back({position.x, position.y, uv.x, uv.y, color});
+  m_vertices.push_back({right, position.y, uv.z, uv.y, color});
+  m_vertices.push_back({position.x, bottom, uv.x, uv.w, color});
+  m_vertices.push_back({right, bottom, uv.z, uv.w, color});
+}
+
+void SpriteBatch::draw(GLuint texture, glm::vec2 position, glm::vec2 size, glm::vec4 uv, glm::vec4 color) {
+  addQuad(texture, false, position, size, uv, packColor(color));
+}
+
+void SpriteBatch::drawRect(glm::vec2 position, glm::vec2 size, glm::vec4 color) {
+  addQuad(m_whiteTexture, false, position, size, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), packColor(color));
+}
+
+float SpriteBatch::drawText(const FontAtlas& font,
+                            std::string_view text,
+                            glm::vec2 position,
+                            float pixelSize,
+                            glm::vec4 color) {
+  if (!font.isLoaded()) {
+    return 0.0f;
+  }
+  const float scale = pixelSize / FontAtlas::GlyphSize;
+  const uint32_t packed = packColor(color);
+  glm::vec2 pen(position.x, position.y + font.getAscent() * scale);
+  float width = 0.0f;
+  for (char c : text) {
+    if (c == '\n') {
+      pen = glm::vec2(position.x, pen.y + font.getLineHeight() * scale);
+      continue;
+    }
+    const FontAtlas::Glyph& glyph = font.getGlyph(static_cast<unsigned char>(c));
+    if (glyph.size.x > 0.0f) {
+      addQuad(font.getTexture(), true, pen + glyph.offset * scale, glyph.size * scale, glyph.uv, packed);
+    }
+    pen.x += glyph.advance * scale;
+    width = std::max(width, pen.x - position.x);
+  }
+  return width;
+}
+
+void SpriteBatch::end(const Shader& shader) {
+  const size_t quads = m_vertices.size() / 4;
+  m_stats.quads = quads;
+  m_stats.drawCalls = 0;
+  m_stats.streamBytes = m_vertices.size() * VertexBytes;
+  if (quads == 0) {
+    return;
+  }
+
+  // All quads go up in one write, into fresh storage so the GPU can still be reading last frame's
+  reserve(quads);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+  void* mapped = glMapBufferRange(GL_ARRAY_BUFFER,
+                                  0,
+                                  static_cast<GLsizeiptr>(m_stats.streamBytes),
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!mapped) {
+    LOG_ERROR("[SpriteBatch] Failed to map the vertex buffer");
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_vertices.clear();
+    m_batches.clear();
+    return;
+  }
+  std::memcpy(mapped, m_vertices.data(), m_stats.streamBytes);
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  const GLboolean blending = glIsEnabled(GL_BLEND);
+  const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDisable(GL_DEPTH_TEST);
+
+  glUniform2f(glGetUniformLocation(shader.m_id, "screenSize"), m_screenSize.x, m_screenSize.y);
+  shader.setInt("spriteTexture", 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindVertexArray(m_vao);
+  int distanceField = -1;
+  for (const Batch& batch : m_batches) {
+    if (static_cast<int>(batch.distanceField) != distanceField) {
+      distanceField = batch.distanceField;
+      shader.setBool("distanceField", batch.distanceField);
+    }
+    glBindTexture(GL_TEXTURE_2D, batch.texture);
+    glDrawElements(GL_TRIANGLES,
+                   static_cast<GLsizei>(batch.count * 6),
+                   GL_UNSIGNED_INT,
+                   reinterpret_cast<void*>(batch.first * 6 * sizeof(uint32_t)));
+    m_stats.drawCalls++;
+  }
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  if (depthTest) {
+    glEnable(GL_DEPTH_TEST);
+  }
+  if (!blending) {
+    glDisable(GL_BLEND);
+  }
+  m_vertices.clear();
+  m_batches.clear();
+}
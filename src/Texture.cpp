@@ -1,5 +1,80 @@
 #include "../include/Texture.hpp"
 #include "../include/Logger.hpp"
+#include "../include/PackFile.hpp"
+
+#include <filesystem>
+#include <vector>
+
+// S3TC is an extension, GLAD only has the core formats
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+bool hasExtension(const char* name) {
+  static const std::vector<std::string> extensions = [] {
+    std::vector<std::string> result;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+      result.emplace_back(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
+    }
+    return result;
+  }();
+
+  for (const auto& extension : extensions) {
+    if (extension == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool isBlockFormatSupported(BlockFormat format, bool srgb) {
+  switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC3:
+      return hasExtension("GL_EXT_texture_compression_s3tc") &&
+             (!srgb || hasExtension("GL_EXT_texture_sRGB") || hasExtension("GL_EXT_texture_compression_s3tc_srgb"));
+    case BlockFormat::BC4:
+    case BlockFormat::BC5:
+      return true;  // RGTC is core since 3.0
+    case BlockFormat::BC7:
+      return GLAD_GL_VERSION_4_2 || hasExtension("GL_ARB_texture_compression_bptc");
+  }
+  return false;
+}
+
+GLenum compressedInternalFormat(BlockFormat format, bool srgb) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case BlockFormat::BC3:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4:
+      return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5:
+      return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+  return 0;
+}
+
+std::string findCompressedSibling(const std::string& filepath) {
+  for (const char* extension : {".ktx2", ".dds"}) {
+    std::filesystem::path candidate(filepath);
+    candidate.replace_extension(extension);
+    if (std::filesystem::exists(candidate)) {
+      return candidate.string();
+    }
+  }
+  return "";
+}
 
 void Texture::setParams() const {
   // Set the texture parameters
@@ -10,7 +85,85 @@ void Texture::setParams() const {
   glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
+bool loadPackedTexture(const std::string& filepath, CompressedImage& image) {
+  const PackFile* pack = PackFile::mounted();
+  if (!pack) {
+    return false;
+  }
+  AssetView view = pack->find(filepath, AssetType::Texture);
+  if (!view) {
+    return false;
+  }
+  if (!CompressedImage::loadKTX2(view.data, view.size, image)) {
+    LOG_ERROR_F("[Texture] The packed version of {} is corrupt", filepath);
+    return false;
+  }
+  return true;
+}
+
+bool Texture::loadCompressed(const std::string& filepath) {
+  CompressedImage image;
+  if (!CompressedImage::load(filepath, image)) {
+    return false;
+  }
+  return uploadCompressed(filepath, image);
+}
+
+bool Texture::uploadCompressed(const std::string& filepath, const CompressedImage& image) {
+  // Color formats exist in both variants, the map type decides which one the data is sampled as
+  bool srgb = isColorFormat(image.format) && m_usage == TextureUsage::Color;
+  if (srgb != image.srgb) {
+    LOG_WARNING_F("[Texture] {} is stored as {} but used as a {} map",
+                  filepath,
+                  image.srgb ? "sRGB" : "linear",
+                  srgb ? "sRGB" : "linear");
+  }
+
+  if (!isBlockFormatSupported(image.format, srgb)) {
+    LOG_ERROR_F("[Texture] {} is not supported by this driver", blockFormatName(image.format));
+    return false;
+  }
+
+  GLenum internalFormat = compressedInternalFormat(image.format, srgb);
+  for (size_t level = 0; level < image.mips.size(); level++) {
+    const CompressedMip& mip = image.mips[level];
+    glCompressedTexImage2D(GL_TEXTURE_2D,
+                           static_cast<GLint>(level),
+                           internalFormat,
+                           mip.width,
+                           mip.height,
+                           0,
+                           static_cast<GLsizei>(mip.data.size()),
+                           mip.data.data());
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mips.size()) - 1);
+
+  for (const auto& mip : image.mips) {
+    m_bytes += mip.data.size();
+  }
+  m_loaded = true;
+  return true;
+}
+
 void Texture::loadTexture(const char* filepath) {
+  // The mounted asset pack holds the cooked version of loose files
+  CompressedImage packed;
+  if (loadPackedTexture(filepath, packed) && uploadCompressed(filepath, packed)) {
+    return;
+  }
+
+  // Pre-compressed data (with its own mip chain) is preferred over decoding the source image
+  std::string compressedPath = isCompressedTexturePath(filepath) ? filepath : findCompressedSibling(filepath);
+  if (!compressedPath.empty()) {
+    if (loadCompressed(compressedPath)) {
+      return;
+    }
+    if (compressedPath == filepath) {
+      return;
+    }
+    LOG_WARNING_F("[Texture] Falling back to the uncompressed source {}", filepath);
+  }
+
   m_texture_img = Utils::loadImage(filepath);
 
   if (m_texture_img.data) {
@@ -19,43 +172,62 @@ void Texture::loadTexture(const char* filepath) {
     const int channels = m_texture_img.channels;
     LOG_INFO_F("Image has {} Channels", channels);
 
+    // The internal format has to keep every channel of the source, and color maps are sRGB
+    const bool srgb = m_usage == TextureUsage::Color;
     GLenum format;
+    GLenum internalFormat;
     switch (channels) {
       case 1:
         format = GL_RED;
+        internalFormat = GL_R8;
         break;
       case 2:
         format = GL_RG;
+        internalFormat = GL_RG8;
         break;
       case 3:
         format = GL_RGB;
+        internalFormat = srgb ? GL_SRGB8 : GL_RGB8;
         break;
       case 4:
         format = GL_RGBA;
+        internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
         break;
       default:
         LOG_ERROR_F("Issue with channel count: {}", channels);
         format = GL_RGB;  // fallback
+        internalFormat = GL_RGB8;
         break;
     };
 
+    // Rows of 1-3 channel images are not necessarily 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glTexImage2D(GL_TEXTURE_2D,
                  0,
-                 GL_RGB,
+                 internalFormat,
                  m_texture_img.width,
                  m_texture_img.height,
                  0,
                  format,
                  GL_UNSIGNED_BYTE,
                  m_texture_img.data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     glGenerateMipmap(GL_TEXTURE_2D);
+
+    // Drivers pad RGB8 to four bytes, the mip chain adds another third
+    const size_t texelBytes = channels == 3 ? 4 : channels;
+    m_bytes = static_cast<size_t>(m_texture_img.width) * m_texture_img.height * texelBytes * 4 / 3;
+    m_loaded = true;
   } else {
     LOG_INFO("Possible error with TEXTURE IMAGE DATA ...");
   }
   Utils::freeImage(m_texture_img);
 }
 
-Texture::Texture(int texture_slot, const char* filepath) : m_texture_num(texture_slot) {
+Texture::Texture(int texture_slot, const char* filepath) : Texture(texture_slot, filepath, usageFromPath(filepath)) {}
+
+Texture::Texture(int texture_slot, const char* filepath, TextureUsage usage) :
+ m_texture_num(texture_slot), m_usage(usage) {
   glGenTextures(1, &m_texture);
   glBindTexture(GL_TEXTURE_2D, m_texture);
 
@@ -63,8 +235,42 @@ Texture::Texture(int texture_slot, const char* filepath) : m_texture_num(texture
   loadTexture(filepath);
 }
 
+Texture::~Texture() {
+  if (m_texture) {
+    glDeleteTextures(1, &m_texture);
+  }
+}
+
+Texture::Texture(Texture&& other) noexcept :
+ m_texture(other.m_texture),
+ m_texture_num(other.m_texture_num),
+ m_usage(other.m_usage),
+ m_loaded(other.m_loaded),
+ m_bytes(other.m_bytes) {
+  other.m_texture = 0;
+}
+
+Texture& Texture::operator=(Texture&& other) noexcept {
+  if (this != &other) {
+    if (m_texture) {
+      glDeleteTextures(1, &m_texture);
+    }
+    m_texture = other.m_texture;
+    m_texture_num = other.m_texture_num;
+    m_usage = other.m_usage;
+    m_loaded = other.m_loaded;
+    m_bytes = other.m_bytes;
+    other.m_texture = 0;
+  }
+  return *this;
+}
+
 void Texture::bindTexture() {
-  glActiveTexture(GL_TEXTURE0 + m_texture_num);
+  bindTexture(m_texture_num);
+}
+
+void Texture::bindTexture(int unit) {
+  glActiveTexture(GL_TEXTURE0 + unit);
   glBindTexture(GL_TEXTURE_2D, m_texture);
 }
 
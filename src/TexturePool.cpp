@@ -0,0 +1,461 @@
+#include "../include/TexturePool.hpp"
+#include <GLFW/glfw3.h>
+#include "../include/BCEncoder.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Texture.hpp"
+#include "../include/Utils.hpp"
+
+#include <algorithm>
+
+namespace {
+// ARB_bindless_texture is not part of the generated GLAD loader, so it is fetched by hand
+typedef GLuint64(APIENTRYP GetTextureHandleProc)(GLuint texture);
+typedef void(APIENTRYP MakeTextureHandleResidentProc)(GLuint64 handle);
+typedef void(APIENTRYP MakeTextureHandleNonResidentProc)(GLuint64 handle);
+typedef void(APIENTRYP UniformHandleProc)(GLint location, GLuint64 value);
+
+GetTextureHandleProc getTextureHandle = nullptr;
+MakeTextureHandleResidentProc makeTextureHandleResident = nullptr;
+MakeTextureHandleNonResidentProc makeTextureHandleNonResident = nullptr;
+UniformHandleProc uniformHandle = nullptr;
+
+bool loadBindless() {
+  if (!hasExtension("GL_ARB_bindless_texture")) {
+    return false;
+  }
+  getTextureHandle = reinterpret_cast<GetTextureHandleProc>(glfwGetProcAddress("glGetTextureHandleARB"));
+  makeTextureHandleResident =
+    reinterpret_cast<MakeTextureHandleResidentProc>(glfwGetProcAddress("glMakeTextureHandleResidentARB"));
+  makeTextureHandleNonResident =
+    reinterpret_cast<MakeTextureHandleNonResidentProc>(glfwGetProcAddress("glMakeTextureHandleNonResidentARB"));
+  uniformHandle = reinterpret_cast<UniformHandleProc>(glfwGetProcAddress("glUniformHandleui64ARB"));
+  return getTextureHandle && makeTextureHandleResident && makeTextureHandleNonResident && uniformHandle;
+}
+
+// Texels of edge replicated around every atlas entry, enough for this many mips not to bleed
+constexpr int AtlasPadding = 4;
+constexpr int AtlasLevels = 3;
+}  // namespace
+
+TexturePool::TexturePool(int layersPerArray,
+                         int atlasSize,
+                         int maxAtlasTexture,
+                         bool allowBindless,
+                         ResidencyManager* residency) :
+ m_layersPerArray(std::max(layersPerArray, 1)),
+ m_atlasSize(atlasSize),
+ m_maxAtlasTexture(std::min(maxAtlasTexture, atlasSize - 2 * AtlasPadding)),
+ m_bindless(allowBindless && loadBindless()),
+ m_canGrow(GLAD_GL_VERSION_4_3 && glCopyImageSubData),
+ m_residency(residency) {
+  LOG_INFO_F("[TexturePool] {} layers per array, bindless textures {}",
+             m_layersPerArray,
+             m_bindless ? "enabled" : "unavailable");
+}
+
+TexturePool::~TexturePool() {
+  for (auto& array : m_arrays) {
+    if (array.handle) {
+      makeTextureHandleNonResident(array.handle);
+    }
+    glDeleteTextures(1, &array.texture);
+    if (m_residency) {
+      m_residency->remove(array.residencyId);
+    }
+  }
+}
+
+int TexturePool::acquireLayer(int width,
+                              int height,
+                              GLenum internalFormat,
+                              bool compressed,
+                              bool atlas,
+                              const std::vector<size_t>& levelBytes,
+                              int& layer) {
+  const int levels = static_cast<int>(levelBytes.size());
+  for (size_t i = 0; i < m_arrays.size(); i++) {
+    TextureArray& array = m_arrays[i];
+    if (array.width == width && array.height == height && array.levels == levels &&
+        array.internalFormat == internalFormat && array.atlas == atlas && array.layers < array.maxCapacity) {
+      if (array.layers == array.capacity) {
+        allocate(array, std::min(array.capacity * 2, array.maxCapacity));
+      }
+      layer = array.layers++;
+      m_stats.layers++;
+      return static_cast<int>(i);
+    }
+  }
+
+  TextureArray array;
+  array.width = width;
+  array.height = height;
+  array.levels = levels;
+  array.levelBytes = levelBytes;
+  array.internalFormat = internalFormat;
+  array.compressed = compressed;
+  array.atlas = atlas;
+
+  // However many layers the pool allows, as long as they stay within the byte cap. One layer
+  // always fits, a single texture bigger than the cap still gets an array of its own.
+  size_t layerBytes = 0;
+  for (size_t bytes : levelBytes) {
+    layerBytes += bytes;
+  }
+  array.maxCapacity =
+    std::clamp(static_cast<int>(ArrayBytes / std::max<size_t>(layerBytes, 1)), 1, m_layersPerArray);
+  if (m_residency) {
+    array.residencyId = m_residency->add(
+      ResidencyKind::Texture, "texture array " + std::to_string(width) + "x" + std::to_string(height), 0);
+  }
+  // Without copies between textures an array can't grow, it gets all its layers up front
+  allocate(array, m_canGrow ? 1 : array.maxCapacity);
+
+  LOG_INFO_F("[TexturePool] New {}{}x{} array: up to {} layers, {} mip(s)",
+             atlas ? "atlas " : "",
+             width,
+             height,
+             array.maxCapacity,
+             levels);
+
+  layer = array.layers++;
+  m_arrays.push_back(array);
+  m_stats.arrays++;
+  m_stats.layers++;
+  return static_cast<int>(m_arrays.size()) - 1;
+}
+
+void TexturePool::allocate(TextureArray& array, int capacity) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  size_t bytes = 0;
+  for (int level = 0; level < array.levels; level++) {
+    const int levelWidth = std::max(array.width >> level, 1);
+    const int levelHeight = std::max(array.height >> level, 1);
+    if (array.compressed) {
+      glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY,
+                             level,
+                             array.internalFormat,
+                             levelWidth,
+                             levelHeight,
+                             capacity,
+                             0,
+                             static_cast<GLsizei>(array.levelBytes[level] * capacity),
+                             nullptr);
+    } else {
+      glTexImage3D(GL_TEXTURE_2D_ARRAY,
+                   level,
+                   array.internalFormat,
+                   levelWidth,
+                   levelHeight,
+                   capacity,
+                   0,
+                   GL_RGBA,
+                   GL_UNSIGNED_BYTE,
+                   nullptr);
+    }
+    bytes += array.levelBytes[level] * capacity;
+  }
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.levels - 1);
+
+  if (array.texture) {
+    // The layers in use move over on the GPU, every level at once per layer range
+    for (int level = 0; level < array.levels; level++) {
+      glCopyImageSubData(array.texture,
+                         GL_TEXTURE_2D_ARRAY,
+                         level,
+                         0,
+                         0,
+                         0,
+                         texture,
+                         GL_TEXTURE_2D_ARRAY,
+                         level,
+                         0,
+                         0,
+                         0,
+                         std::max(array.width >> level, 1),
+                         std::max(array.height >> level, 1),
+                         array.layers);
+    }
+    // The handle belongs to the old texture, finalize() takes a new one
+    if (array.handle) {
+      makeTextureHandleNonResident(array.handle);
+      array.handle = 0;
+    }
+    glDeleteTextures(1, &array.texture);
+    m_stats.bytes -= bytes / capacity * array.capacity;
+    m_stats.grows++;
+    LOG_INFO_F("[TexturePool] Grew {}x{} array to {} layers", array.width, array.height, capacity);
+  }
+
+  array.texture = texture;
+  array.capacity = capacity;
+  m_stats.bytes += bytes;
+  if (m_residency && array.residencyId >= 0) {
+    m_residency->resize(array.residencyId, bytes);
+  }
+}
+
+bool TexturePool::placeInAtlas(GLenum internalFormat, int width, int height, int& page, int& x, int& y) {
+  for (size_t i = 0; i < m_atlasPages.size(); i++) {
+    AtlasPage& candidate = m_atlasPages[i];
+    if (m_arrays[candidate.array].internalFormat != internalFormat) {
+      continue;
+    }
+
+    // The shelf that wastes the least height, or a new one below the last
+    Shelf* best = nullptr;
+    for (auto& shelf : candidate.shelves) {
+      if (height <= shelf.height && shelf.x + width <= m_atlasSize && (!best || shelf.height < best->height)) {
+        best = &shelf;
+      }
+    }
+    if (!best) {
+      int top = candidate.shelves.empty() ? 0 : candidate.shelves.back().y + candidate.shelves.back().height;
+      if (top + height > m_atlasSize) {
+        continue;
+      }
+      candidate.shelves.push_back({top, height, 0});
+      best = &candidate.shelves.back();
+    }
+
+    page = static_cast<int>(i);
+    x = best->x;
+    y = best->y;
+    best->x += width;
+    return true;
+  }
+  return false;
+}
+
+TextureRegion TexturePool::addToAtlas(const uint8_t* rgba, int width, int height, GLenum internalFormat) {
+  const int paddedWidth = width + 2 * AtlasPadding;
+  const int paddedHeight = height + 2 * AtlasPadding;
+
+  int page, x, y;
+  if (!placeInAtlas(internalFormat, paddedWidth, paddedHeight, page, x, y)) {
+    std::vector<size_t> levelBytes;
+    for (int level = 0; level < AtlasLevels; level++) {
+      levelBytes.push_back(static_cast<size_t>(m_atlasSize >> level) * (m_atlasSize >> level) * 4);
+    }
+    AtlasPage newPage;
+    newPage.array = acquireLayer(m_atlasSize, m_atlasSize, internalFormat, false, true, levelBytes, newPage.layer);
+    m_atlasPages.push_back(newPage);
+    m_stats.atlasPages++;
+    placeInAtlas(internalFormat, paddedWidth, paddedHeight, page, x, y);
+  }
+
+  // Clamp-to-edge by hand, the sampler wraps the whole page
+  std::vector<uint8_t> padded(static_cast<size_t>(paddedWidth) * paddedHeight * 4);
+  for (int row = 0; row < paddedHeight; row++) {
+    int sourceRow = std::clamp(row - AtlasPadding, 0, height - 1);
+    for (int column = 0; column < paddedWidth; column++) {
+      int sourceColumn = std::clamp(column - AtlasPadding, 0, width - 1);
+      std::copy_n(rgba + (static_cast<size_t>(sourceRow) * width + sourceColumn) * 4,
+                  4,
+                  padded.data() + (static_cast<size_t>(row) * paddedWidth + column) * 4);
+    }
+  }
+
+  const AtlasPage& atlasPage = m_atlasPages[page];
+  TextureArray& array = m_arrays[atlasPage.array];
+  glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                  0,
+                  x,
+                  y,
+                  atlasPage.layer,
+                  paddedWidth,
+                  paddedHeight,
+                  1,
+                  GL_RGBA,
+                  GL_UNSIGNED_BYTE,
+                  padded.data());
+  array.mipsDirty = true;
+  m_stats.atlasRegions++;
+
+  TextureRegion region;
+  region.array = atlasPage.array;
+  region.layer = atlasPage.layer;
+  const float size = static_cast<float>(m_atlasSize);
+  region.uvRect = glm::vec4((x + AtlasPadding) / size, (y + AtlasPadding) / size, width / size, height / size);
+  return region;
+}
+
+TextureRegion TexturePool::add(const std::string& name,
+                               const uint8_t* rgba,
+                               int width,
+                               int height,
+                               TextureUsage usage) {
+  if (const TextureRegion* existing = find(name)) {
+    return *existing;
+  }
+
+  const GLenum internalFormat = usage == TextureUsage::Color ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  TextureRegion region;
+  if (width <= m_maxAtlasTexture && height <= m_maxAtlasTexture) {
+    region = addToAtlas(rgba, width, height, internalFormat);
+  } else {
+    // Mips are built here since glGenerateMipmap would redo every layer of the array
+    std::vector<std::vector<uint8_t>> mips;
+    std::vector<size_t> levelBytes;
+    mips.emplace_back(rgba, rgba + static_cast<size_t>(width) * height * 4);
+    int levelWidth = width;
+    int levelHeight = height;
+    while (levelWidth > 1 || levelHeight > 1) {
+      mips.push_back(BCEncoder::downsample(mips.back().data(), levelWidth, levelHeight, usage));
+      levelWidth = std::max(levelWidth / 2, 1);
+      levelHeight = std::max(levelHeight / 2, 1);
+    }
+    for (const auto& mip : mips) {
+      levelBytes.push_back(mip.size());
+    }
+
+    int layer;
+    int array = acquireLayer(width, height, internalFormat, false, false, levelBytes, layer);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[array].texture);
+    for (size_t level = 0; level < mips.size(); level++) {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                      static_cast<GLint>(level),
+                      0,
+                      0,
+                      layer,
+                      std::max(width >> level, 1),
+                      std::max(height >> level, 1),
+                      1,
+                      GL_RGBA,
+                      GL_UNSIGNED_BYTE,
+                      mips[level].data());
+    }
+    region.array = array;
+    region.layer = layer;
+  }
+
+  m_regions[name] = region;
+  return region;
+}
+
+TextureRegion TexturePool::add(const std::string& name, const CompressedImage& image, TextureUsage usage) {
+  if (const TextureRegion* existing = find(name)) {
+    return *existing;
+  }
+
+  // Block compressed textures always get whole layers, atlasing them would have to respect blocks
+  bool srgb = isColorFormat(image.format) && usage == TextureUsage::Color;
+  if (!isBlockFormatSupported(image.format, srgb)) {
+    LOG_ERROR_F("[TexturePool] {} is not supported by this driver", blockFormatName(image.format));
+    return {};
+  }
+  GLenum internalFormat = compressedInternalFormat(image.format, srgb);
+
+  std::vector<size_t> levelBytes;
+  for (const auto& mip : image.mips) {
+    levelBytes.push_back(mip.data.size());
+  }
+
+  TextureRegion region;
+  region.array = acquireLayer(image.width, image.height, internalFormat, true, false, levelBytes, region.layer);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[region.array].texture);
+  for (size_t level = 0; level < image.mips.size(); level++) {
+    const CompressedMip& mip = image.mips[level];
+    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                              static_cast<GLint>(level),
+                              0,
+                              0,
+                              region.layer,
+                              mip.width,
+                              mip.height,
+                              1,
+                              internalFormat,
+                              static_cast<GLsizei>(mip.data.size()),
+                              mip.data.data());
+  }
+
+  m_regions[name] = region;
+  return region;
+}
+
+TextureRegion TexturePool::load(const std::string& path) {
+  return load(path, usageFromPath(path));
+}
+
+TextureRegion TexturePool::load(const std::string& path, TextureUsage usage) {
+  if (const TextureRegion* existing = find(path)) {
+    return *existing;
+  }
+
+  CompressedImage packed;
+  if (loadPackedTexture(path, packed)) {
+    TextureRegion region = add(path, packed, usage);
+    if (region.isValid()) {
+      return region;
+    }
+  }
+
+  std::string compressedPath = isCompressedTexturePath(path) ? path : findCompressedSibling(path);
+  if (!compressedPath.empty()) {
+    CompressedImage image;
+    if (CompressedImage::load(compressedPath, image)) {
+      TextureRegion region = add(path, image, usage);
+      if (region.isValid()) {
+        return region;
+      }
+    }
+    if (compressedPath == path) {
+      return {};
+    }
+    LOG_WARNING_F("[TexturePool] Falling back to the uncompressed source {}", path);
+  }
+
+  Utils::Image image = Utils::loadImage(path, false, 4);
+  if (!image.data) {
+    LOG_ERROR_F("[TexturePool] Failed to load {}", path);
+    return {};
+  }
+  TextureRegion region = add(path, image.data, image.width, image.height, usage);
+  Utils::freeImage(image);
+  return region;
+}
+
+const TextureRegion* TexturePool::find(const std::string& name) const {
+  auto it = m_regions.find(name);
+  return it != m_regions.end() ? &it->second : nullptr;
+}
+
+void TexturePool::finalize() {
+  for (auto& array : m_arrays) {
+    if (array.mipsDirty) {
+      glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+      glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+      array.mipsDirty = false;
+    }
+    // A handle freezes the texture's parameters, so it is only taken once the array is set up
+    if (m_bindless && !array.handle) {
+      array.handle = getTextureHandle(array.texture);
+      makeTextureHandleResident(array.handle);
+    }
+  }
+}
+
+void TexturePool::bind(int array, int unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[array].texture);
+}
+
+void TexturePool::setSampler(const Shader& shader, const std::string& name, int array, int unit) const {
+  GLint location = glGetUniformLocation(shader.m_id, name.c_str());
+  if (location < 0) {
+    return;
+  }
+
+  if (m_arrays[array].handle) {
+    uniformHandle(location, m_arrays[array].handle);
+  } else {
+    bind(array, unit);
+    glUniform1i(location, unit);
+  }
+}
@@ -0,0 +1,695 @@
+#include "../include/TextureStreamer.hpp"
+#include "../include/BCEncoder.hpp"
+#include "../include/Logger.hpp"
+#include "../include/PackFile.hpp"
+#include "../include/Texture.hpp"
+#include "../include/Utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+TextureStreamer::TextureStreamer(JobSystem& jobs,
+                                 AsyncIO* io,
+                                 ResidencyManager* residency,
+                                 size_t uploadBudget,
+                                 int uploadBuffers) :
+ m_jobs(jobs),
+ m_io(io),
+ m_residency(residency),
+ m_decoded(std::make_shared<DecodeQueue>()),
+ m_uploadBuffers(std::max(uploadBuffers, 1)),
+ m_nextUploadBuffer(0),
+ m_uploadBudget(uploadBudget),
+ m_maxDecodesInFlight(static_cast<int>(std::max<size_t>(jobs.getWorkerCount(), 1))),
+ m_decodesInFlight(0),
+ m_frame(0) {
+  for (auto& buffer : m_uploadBuffers) {
+    glGenBuffers(1, &buffer.pbo);
+    if (m_residency) {
+      buffer.residencyId = m_residency->add(ResidencyKind::Buffer, "texture upload buffer", 0);
+    }
+  }
+
+  const uint8_t grey[4] = {128, 128, 128, 255};
+  const uint8_t flatNormal[4] = {128, 128, 255, 255};
+  m_placeholderColor = createPlaceholder(grey, true);
+  m_placeholderLinear = createPlaceholder(grey, false);
+  m_placeholderNormal = createPlaceholder(flatNormal, false);
+}
+
+TextureStreamer::~TextureStreamer() {
+  // Jobs still decoding only hold on to m_decoded, which they share. Reads that haven't finished
+  // are not needed anymore.
+  for (auto& texture : m_textures) {
+    if (m_io && texture.readRequest) {
+      m_io->cancel(texture.readRequest);
+    }
+    if (texture.texture) {
+      glDeleteTextures(1, &texture.texture);
+    }
+    if (texture.fallback) {
+      glDeleteTextures(1, &texture.fallback);
+    }
+    if (m_residency && texture.residencyId >= 0) {
+      m_residency->remove(texture.residencyId);
+    }
+  }
+  for (auto& buffer : m_uploadBuffers) {
+    if (buffer.fence) {
+      glDeleteSync(buffer.fence);
+    }
+    glDeleteBuffers(1, &buffer.pbo);
+    if (m_residency) {
+      m_residency->remove(buffer.residencyId);
+    }
+  }
+  glDeleteTextures(1, &m_placeholderColor);
+  glDeleteTextures(1, &m_placeholderLinear);
+  glDeleteTextures(1, &m_placeholderNormal);
+}
+
+GLuint TextureStreamer::createPlaceholder(const uint8_t* rgba, bool srgb) {
+  uint8_t pixels[16];
+  for (int i = 0; i < 4; i++) {
+    std::memcpy(pixels + i * 4, rgba, 4);
+  }
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  return texture;
+}
+
+int TextureStreamer::request(const std::string& path, float priority) {
+  return request(path, usageFromPath(path), priority);
+}
+
+int TextureStreamer::request(const std::string& path, TextureUsage usage, float priority) {
+  for (size_t i = 0; i < m_textures.size(); i++) {
+    if (m_textures[i].path == path && m_textures[i].usage == usage) {
+      m_textures[i].priority = std::max(m_textures[i].priority, priority);
+      return static_cast<int>(i);
+    }
+  }
+
+  StreamedTexture texture;
+  texture.path = path;
+  texture.usage = usage;
+  texture.priority = priority;
+  m_textures.push_back(std::move(texture));
+  return static_cast<int>(m_textures.size()) - 1;
+}
+
+void TextureStreamer::setPriority(int id, float priority) {
+  m_textures[id].priority = priority;
+  if (m_io && m_textures[id].readRequest) {
+    m_io->setPriority(m_textures[id].readRequest, priority);
+  }
+}
+
+std::string TextureStreamer::sourcePath(const std::string& path, bool allowCompressed) {
+  if (allowCompressed && !isCompressedTexturePath(path)) {
+    std::string sibling = findCompressedSibling(path);
+    if (!sibling.empty()) {
+      return sibling;
+    }
+  }
+  return path;
+}
+
+TextureStreamer::DecodedImage TextureStreamer::decode(int id,
+                                                      const std::string& path,
+                                                      TextureUsage usage,
+                                                      bool allowCompressed) {
+  // Cooked data comes with its mip chain and skips decoding entirely, from the pack if one is mounted
+  CompressedImage packed;
+  if (allowCompressed && loadPackedTexture(path, packed)) {
+    DecodedImage result;
+    result.id = id;
+    result.fromSibling = !isCompressedTexturePath(path);
+    takeCompressed(result, packed);
+    return result;
+  }
+
+  const std::string source = sourcePath(path, allowCompressed);
+  MappedFile file;
+  if (!file.open(source, FileAccess::Sequential)) {
+    DecodedImage result;
+    result.id = id;
+    result.fromSibling = source != path;
+    return result;
+  }
+  return decodeData(id, source, file.data(), file.size(), usage, source != path);
+}
+
+TextureStreamer::DecodedImage TextureStreamer::decodeData(int id,
+                                                          const std::string& source,
+                                                          const uint8_t* data,
+                                                          size_t size,
+                                                          TextureUsage usage,
+                                                          bool fromSibling) {
+  DecodedImage result;
+  result.id = id;
+  result.fromSibling = fromSibling;
+
+  if (isCompressedTexturePath(source)) {
+    CompressedImage image;
+    if (CompressedImage::load(data, size, image)) {
+      takeCompressed(result, image);
+    }
+    return result;
+  }
+
+  Utils::Image image = Utils::loadImage(data, size, 4);
+  if (!image.data) {
+    return result;
+  }
+
+  // Uploads go smallest mip first, so the chain is built here instead of with glGenerateMipmap
+  MipLevel level;
+  level.width = image.width;
+  level.height = image.height;
+  level.data.assign(image.data, image.data + static_cast<size_t>(image.width) * image.height * 4);
+  Utils::freeImage(image);
+  result.mips.push_back(std::move(level));
+
+  while (result.mips.back().width > 1 || result.mips.back().height > 1) {
+    const MipLevel& previous = result.mips.back();
+    MipLevel next;
+    next.width = std::max(previous.width / 2, 1);
+    next.height = std::max(previous.height / 2, 1);
+    next.data = BCEncoder::downsample(previous.data.data(), previous.width, previous.height, usage);
+    result.mips.push_back(std::move(next));
+  }
+
+  result.success = true;
+  return result;
+}
+
+void TextureStreamer::takeCompressed(DecodedImage& result, CompressedImage& image) {
+  result.success = true;
+  result.compressed = true;
+  result.format = image.format;
+  for (auto& mip : image.mips) {
+    result.mips.push_back({mip.width, mip.height, std::move(mip.data)});
+  }
+}
+
+void TextureStreamer::startDecodes() {
+  while (m_decodesInFlight < m_maxDecodesInFlight) {
+    // Highest priority first, the job queue itself is plain FIFO
+    int best = -1;
+    for (size_t i = 0; i < m_textures.size(); i++) {
+      if (m_textures[i].state == StreamState::Queued &&
+          (best < 0 || m_textures[i].priority > m_textures[best].priority)) {
+        best = static_cast<int>(i);
+      }
+    }
+    if (best < 0) {
+      return;
+    }
+
+    StreamedTexture& texture = m_textures[best];
+    texture.state = StreamState::Decoding;
+    m_decodesInFlight++;
+
+    std::shared_ptr<DecodeQueue> queue = m_decoded;
+    std::string path = texture.path;
+    TextureUsage usage = texture.usage;
+    bool allowCompressed = texture.allowCompressed;
+
+    // Packed textures are already in memory, everything else is read without tying up a worker
+    const PackFile* pack = PackFile::mounted();
+    const bool packed = allowCompressed && pack && pack->find(path, AssetType::Texture);
+    if (m_io && !packed) {
+      const std::string source = sourcePath(path, allowCompressed);
+      const bool fromSibling = source != path;
+      JobSystem* jobs = &m_jobs;
+      auto onRead = [jobs, queue, best, source, usage, fromSibling](IOResult& read) {
+        if (read.status != IOStatus::Completed) {
+          DecodedImage failed;
+          failed.id = best;
+          failed.fromSibling = fromSibling;
+          std::lock_guard<std::mutex> lock(queue->mutex);
+          queue->done.push_back(std::move(failed));
+          return;
+        }
+        jobs->submit([queue, best, source, usage, fromSibling, data = std::move(read.data)]() {
+          DecodedImage image = decodeData(best, source, data.data(), data.size(), usage, fromSibling);
+          std::lock_guard<std::mutex> lock(queue->mutex);
+          queue->done.push_back(std::move(image));
+        });
+      };
+      texture.readRequest = m_io->read(source, onRead, texture.priority);
+      continue;
+    }
+
+    m_jobs.submit([queue, best, path, usage, allowCompressed]() {
+      DecodedImage image = decode(best, path, usage, allowCompressed);
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->done.push_back(std::move(image));
+    });
+  }
+}
+
+void TextureStreamer::receiveDecoded() {
+  std::vector<DecodedImage> done;
+  {
+    std::lock_guard<std::mutex> lock(m_decoded->mutex);
+    done.swap(m_decoded->done);
+  }
+
+  for (auto& image : done) {
+    m_decodesInFlight--;
+    StreamedTexture& texture = m_textures[image.id];
+    texture.readRequest = 0;
+
+    if (!image.success && image.fromSibling) {
+      LOG_WARNING_F("[TextureStreamer] Unable to load the cooked version of {}, decoding it instead", texture.path);
+      texture.allowCompressed = false;
+      texture.state = StreamState::Queued;
+      continue;
+    }
+    if (!image.success) {
+      LOG_ERROR_F("[TextureStreamer] Failed to load {}", texture.path);
+      if (texture.fallback) {
+        // Keep the reduced copy rather than nothing, and stop trying to restore it
+        texture.texture = std::exchange(texture.fallback, 0);
+        texture.bytes = std::exchange(texture.fallbackBytes, 0);
+        texture.residentLevel = texture.firstLevel;
+        texture.canRestore = false;
+        texture.state = StreamState::Resident;
+      } else {
+        texture.state = StreamState::Failed;
+      }
+      continue;
+    }
+
+    if (image.compressed) {
+      bool srgb = isColorFormat(image.format) && texture.usage == TextureUsage::Color;
+      if (!isBlockFormatSupported(image.format, srgb)) {
+        if (image.fromSibling) {
+          LOG_WARNING_F("[TextureStreamer] {} is not supported, decoding the source of {} instead",
+                        blockFormatName(image.format),
+                        texture.path);
+          texture.allowCompressed = false;
+          texture.state = StreamState::Queued;
+        } else {
+          LOG_ERROR_F("[TextureStreamer] {} is not supported by this driver", blockFormatName(image.format));
+          texture.state = StreamState::Failed;
+        }
+        continue;
+      }
+    }
+
+    allocateStorage(image.id, image);
+  }
+}
+
+GLuint TextureStreamer::createStorage(const StreamedTexture& texture, int firstLevel) const {
+  GLuint handle;
+  glGenTextures(1, &handle);
+  glBindTexture(GL_TEXTURE_2D, handle);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // Storage for every level up front (no glTexStorage in 3.3), the data follows through buffers
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  const int levels = static_cast<int>(texture.levelBytes.size());
+  for (int level = firstLevel; level < levels; level++) {
+    const int width = std::max(texture.width >> level, 1);
+    const int height = std::max(texture.height >> level, 1);
+    if (texture.compressed) {
+      glCompressedTexImage2D(GL_TEXTURE_2D,
+                             level - firstLevel,
+                             texture.internalFormat,
+                             width,
+                             height,
+                             0,
+                             static_cast<GLsizei>(texture.levelBytes[level]),
+                             nullptr);
+    } else {
+      glTexImage2D(
+        GL_TEXTURE_2D, level - firstLevel, texture.internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1 - firstLevel);
+  return handle;
+}
+
+void TextureStreamer::allocateStorage(int id, DecodedImage& image) {
+  StreamedTexture& texture = m_textures[id];
+  const bool srgb = texture.usage == TextureUsage::Color;
+  texture.compressed = image.compressed;
+  texture.internalFormat = image.compressed ? compressedInternalFormat(image.format, srgb && isColorFormat(image.format))
+                                            : (srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8);
+  texture.mips = std::move(image.mips);
+  texture.width = texture.mips[0].width;
+  texture.height = texture.mips[0].height;
+  texture.levelBytes.clear();
+  texture.bytes = 0;
+  for (const auto& mip : texture.mips) {
+    texture.levelBytes.push_back(mip.data.size());
+    texture.bytes += mip.data.size();
+  }
+  texture.firstLevel = 0;
+  texture.texture = createStorage(texture, 0);
+
+  // Only the levels that have landed are sampled, starting with the coarsest
+  const GLint coarsest = static_cast<GLint>(texture.mips.size()) - 1;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, coarsest);
+
+  texture.nextLevel = coarsest;
+  texture.residentLevel = -1;
+  texture.state = StreamState::Uploading;
+
+  if (m_residency && texture.residencyId < 0) {
+    texture.residencyId = m_residency->add(
+      ResidencyKind::Texture,
+      texture.path,
+      0,
+      [this, id]() { return dropTopMip(id); },
+      [this, id]() { evict(id); });
+  }
+  reportResidency(texture);
+}
+
+void TextureStreamer::reportResidency(StreamedTexture& texture) {
+  if (m_residency && texture.residencyId >= 0) {
+    m_residency->resize(texture.residencyId, texture.bytes + texture.fallbackBytes);
+  }
+}
+
+TextureStreamer::UploadBuffer* TextureStreamer::acquireUploadBuffer(size_t size) {
+  for (size_t i = 0; i < m_uploadBuffers.size(); i++) {
+    UploadBuffer& buffer = m_uploadBuffers[(m_nextUploadBuffer + i) % m_uploadBuffers.size()];
+
+    // Still being read by an earlier upload
+    if (buffer.fence) {
+      GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        continue;
+      }
+      glDeleteSync(buffer.fence);
+      buffer.fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+    if (buffer.capacity < size) {
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+      buffer.capacity = size;
+      if (m_residency) {
+        m_residency->resize(buffer.residencyId, size);
+      }
+    }
+
+    m_nextUploadBuffer = (m_nextUploadBuffer + i + 1) % m_uploadBuffers.size();
+    return &buffer;
+  }
+  return nullptr;
+}
+
+bool TextureStreamer::uploadLevel(StreamedTexture& texture) {
+  MipLevel& mip = texture.mips[texture.nextLevel];
+  const size_t size = mip.data.size();
+
+  UploadBuffer* buffer = acquireUploadBuffer(size);
+  if (!buffer) {
+    return false;
+  }
+
+  // The fence guarantees the GPU is done with this buffer, no need to let the driver sync again
+  void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                  0,
+                                  static_cast<GLsizeiptr>(size),
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+  if (!mapped) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    LOG_ERROR_F("[TextureStreamer] Failed to map an upload buffer for {}", texture.path);
+    return false;
+  }
+  std::memcpy(mapped, mip.data.data(), size);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  // With a buffer bound the data pointer is an offset into it
+  glBindTexture(GL_TEXTURE_2D, texture.texture);
+  if (texture.compressed) {
+    glCompressedTexSubImage2D(GL_TEXTURE_2D,
+                              texture.nextLevel,
+                              0,
+                              0,
+                              mip.width,
+                              mip.height,
+                              texture.internalFormat,
+                              static_cast<GLsizei>(size),
+                              nullptr);
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, texture.nextLevel, 0, 0, mip.width, mip.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.nextLevel);
+  buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  texture.residentLevel = texture.nextLevel;
+  texture.nextLevel--;
+  std::vector<uint8_t>().swap(mip.data);
+
+  // The restored texture is now at least as sharp as the reduced copy it replaces
+  if (texture.fallback && texture.residentLevel <= texture.fallbackLevel) {
+    glDeleteTextures(1, &texture.fallback);
+    texture.fallback = 0;
+    texture.fallbackBytes = 0;
+    reportResidency(texture);
+  }
+
+  m_stats.bytesThisFrame += size;
+  m_stats.uploadsThisFrame++;
+
+  if (texture.nextLevel < 0) {
+    texture.state = StreamState::Resident;
+    texture.mips.clear();
+    LOG_INFO_F("[TextureStreamer] {} resident ({} bytes)", texture.path, texture.bytes);
+  }
+  return true;
+}
+
+size_t TextureStreamer::dropTopMip(int id) {
+  StreamedTexture& texture = m_textures[id];
+  const int levels = static_cast<int>(texture.levelBytes.size());
+  if (texture.state != StreamState::Resident || texture.fallback || levels - texture.firstLevel <= 1) {
+    return texture.bytes;
+  }
+
+  // The remaining levels are copied GPU side, packed into a buffer and unpacked into a texture one
+  // level shorter. Nothing waits for the GPU, the old texture is only really freed once it is done.
+  const int firstLevel = texture.firstLevel + 1;
+  size_t keptBytes = 0;
+  for (int level = firstLevel; level < levels; level++) {
+    keptBytes += texture.levelBytes[level];
+  }
+
+  GLuint copyBuffer;
+  glGenBuffers(1, &copyBuffer);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, copyBuffer);
+  glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(keptBytes), nullptr, GL_STREAM_COPY);
+  glBindTexture(GL_TEXTURE_2D, texture.texture);
+  size_t offset = 0;
+  for (int level = firstLevel; level < levels; level++) {
+    void* destination = reinterpret_cast<void*>(offset);
+    if (texture.compressed) {
+      glGetCompressedTexImage(GL_TEXTURE_2D, level - texture.firstLevel, destination);
+    } else {
+      glGetTexImage(GL_TEXTURE_2D, level - texture.firstLevel, GL_RGBA, GL_UNSIGNED_BYTE, destination);
+    }
+    offset += texture.levelBytes[level];
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  GLuint reduced = createStorage(texture, firstLevel);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, copyBuffer);
+  offset = 0;
+  for (int level = firstLevel; level < levels; level++) {
+    const void* source = reinterpret_cast<const void*>(offset);
+    const int width = std::max(texture.width >> level, 1);
+    const int height = std::max(texture.height >> level, 1);
+    if (texture.compressed) {
+      glCompressedTexSubImage2D(GL_TEXTURE_2D,
+                                level - firstLevel,
+                                0,
+                                0,
+                                width,
+                                height,
+                                texture.internalFormat,
+                                static_cast<GLsizei>(texture.levelBytes[level]),
+                                source);
+    } else {
+      glTexSubImage2D(GL_TEXTURE_2D, level - firstLevel, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, source);
+    }
+    offset += texture.levelBytes[level];
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glDeleteBuffers(1, &copyBuffer);
+  glDeleteTextures(1, &texture.texture);
+
+  texture.texture = reduced;
+  texture.firstLevel = firstLevel;
+  texture.residentLevel = firstLevel;
+  texture.bytes = keptBytes;
+  return texture.bytes;
+}
+
+void TextureStreamer::evict(int id) {
+  StreamedTexture& texture = m_textures[id];
+  if (texture.texture) {
+    glDeleteTextures(1, &texture.texture);
+    texture.texture = 0;
+  }
+  if (texture.fallback) {
+    glDeleteTextures(1, &texture.fallback);
+    texture.fallback = 0;
+  }
+  texture.fallbackBytes = 0;
+
+  // A restore that is still decoding just loses its fallback, the new data arrives as usual
+  if (texture.state == StreamState::Resident || texture.state == StreamState::Uploading) {
+    texture.mips.clear();
+    texture.bytes = 0;
+    texture.firstLevel = 0;
+    texture.residentLevel = -1;
+    texture.state = StreamState::Evicted;
+  }
+}
+
+void TextureStreamer::restoreUsedTextures() {
+  for (auto& texture : m_textures) {
+    const bool reduced = texture.state == StreamState::Resident && texture.firstLevel > 0 && texture.canRestore;
+    if ((!reduced && texture.state != StreamState::Evicted) || texture.lastBoundFrame + 1 < m_frame) {
+      continue;
+    }
+
+    // Only when the full chain fits, otherwise it would just be evicted again
+    size_t fullBytes = 0;
+    for (size_t bytes : texture.levelBytes) {
+      fullBytes += bytes;
+    }
+    if (m_residency && m_residency->getHeadroom() < fullBytes) {
+      continue;
+    }
+
+    if (reduced) {
+      texture.fallback = std::exchange(texture.texture, 0);
+      texture.fallbackLevel = texture.firstLevel;
+      texture.fallbackBytes = std::exchange(texture.bytes, 0);
+    }
+    texture.state = StreamState::Queued;
+  }
+}
+
+void TextureStreamer::update() {
+  m_frame++;
+  m_stats.bytesThisFrame = 0;
+  m_stats.uploadsThisFrame = 0;
+
+  receiveDecoded();
+  restoreUsedTextures();
+  startDecodes();
+
+  // RGBA8 rows are always 4-byte aligned, but the default state is not guaranteed
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  while (true) {
+    // Cheapest high-priority level first: every texture gets its small mips before any gets its
+    // full resolution
+    StreamedTexture* best = nullptr;
+    float bestScore = 0.0f;
+    for (auto& texture : m_textures) {
+      if (texture.state != StreamState::Uploading) {
+        continue;
+      }
+      size_t bytes = std::max<size_t>(texture.mips[texture.nextLevel].data.size(), 1);
+      float score = texture.priority / static_cast<float>(bytes);
+      if (!best || score > bestScore) {
+        best = &texture;
+        bestScore = score;
+      }
+    }
+    if (!best) {
+      break;
+    }
+
+    // At least one upload per frame, so a level bigger than the budget still gets through
+    size_t bytes = best->mips[best->nextLevel].data.size();
+    if (m_stats.uploadsThisFrame > 0 && m_stats.bytesThisFrame + bytes > m_uploadBudget) {
+      break;
+    }
+    if (!uploadLevel(*best)) {
+      break;
+    }
+  }
+
+  m_stats.queued = m_stats.decoding = m_stats.uploading = m_stats.resident = m_stats.failed = 0;
+  m_stats.reduced = m_stats.evicted = 0;
+  m_stats.totalBytes = 0;
+  for (const auto& texture : m_textures) {
+    switch (texture.state) {
+      case StreamState::Queued:
+        m_stats.queued++;
+        break;
+      case StreamState::Decoding:
+        m_stats.decoding++;
+        break;
+      case StreamState::Uploading:
+        m_stats.uploading++;
+        break;
+      case StreamState::Resident:
+        m_stats.resident++;
+        m_stats.reduced += texture.firstLevel > 0 ? 1 : 0;
+        break;
+      case StreamState::Evicted:
+        m_stats.evicted++;
+        break;
+      case StreamState::Failed:
+        m_stats.failed++;
+        break;
+    }
+    m_stats.totalBytes += texture.bytes + texture.fallbackBytes;
+  }
+}
+
+GLuint TextureStreamer::getTexture(int id) const {
+  const StreamedTexture& texture = m_textures[id];
+  if (texture.fallback) {
+    return texture.fallback;
+  }
+  if (texture.residentLevel >= 0) {
+    return texture.texture;
+  }
+
+  switch (texture.usage) {
+    case TextureUsage::Color:
+      return m_placeholderColor;
+    case TextureUsage::Normal:
+      return m_placeholderNormal;
+    default:
+      return m_placeholderLinear;
+  }
+}
+
+void TextureStreamer::bind(int id, int unit) {
+  StreamedTexture& texture = m_textures[id];
+  texture.lastBoundFrame = m_frame;
+  if (m_residency && texture.residencyId >= 0) {
+    m_residency->touch(texture.residencyId);
+  }
+
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D, getTexture(id));
+}
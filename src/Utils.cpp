@@ -2,39 +2,39 @@
 #include "stb_image.h"
 #include "../include/Logger.hpp"
 
-#include <fstream>
 #include <stdexcept>
-#include <iostream>
-#include <sstream>
 
 namespace Utils {
-std::string loadFile(const std::string& filepath, bool debug) {
-  std::ifstream file(filepath);
-
-  if (!file.is_open()) {
+MappedFile mapFile(const std::string& filepath, FileAccess access, bool debug) {
+  MappedFile file;
+  if (!file.open(filepath, access)) {
     LOG_ERROR_F("\nProblem opening file: {}", filepath);
     throw std::runtime_error("There was an error loading the file");
   }
 
   if (debug)
-    LOG_INFO_F("Reading File: {}", filepath);
+    LOG_INFO_F("Mapped File: {} ({} bytes{})", filepath, file.size(), file.isMapped() ? "" : ", read");
 
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  file.close();
+  return file;
+}
 
-  if (debug)
-    LOG_INFO_F("Done Reading File: {}", filepath);
+std::string loadFile(const std::string& filepath, bool debug) {
+  MappedFile file = mapFile(filepath, FileAccess::Sequential, debug);
+  return std::string(file.text());
+}
 
-  return buffer.str();
+std::vector<uint8_t> loadBinaryFile(const std::string& filepath, bool debug) {
+  MappedFile file = mapFile(filepath, FileAccess::Sequential, debug);
+  return std::vector<uint8_t>(file.data(), file.data() + file.size());
 }
 
-Image loadImage(const std::string& filepath, bool debug) {
-  // Image obj
+Image loadImage(const std::string& filepath, bool debug, int desiredChannels) {
+  // Decoded straight from the mapping, the compressed file is never copied
+  MappedFile file;
   Image img;
-  stbi_set_flip_vertically_on_load(true);
-
-  img.data = stbi_load(filepath.c_str(), &img.width, &img.height, &img.channels, 0);
+  if (file.open(filepath, FileAccess::Sequential)) {
+    img = loadImage(file.data(), file.size(), desiredChannels);
+  }
   LOG_INFO_F("Loading image data: {}", filepath);
 
   if (img.data) {
@@ -47,6 +47,22 @@ Image loadImage(const std::string& filepath, bool debug) {
   return img;
 }
 
+Image loadImage(const uint8_t* data, size_t size, int desiredChannels) {
+  // Image obj
+  Image img;
+  // Per thread, images are also decoded on worker threads
+  stbi_set_flip_vertically_on_load_thread(true);
+
+  if (size > 0) {
+    img.data = stbi_load_from_memory(
+      data, static_cast<int>(size), &img.width, &img.height, &img.channels, desiredChannels);
+  }
+  if (desiredChannels != 0) {
+    img.channels = desiredChannels;
+  }
+  return img;
+}
+
 void freeImage(Image& img) {
   if (img.data) {
     stbi_image_free(img.data);
@@ -0,0 +1,300 @@
+#include "../include/VertexLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+struct FormatInfo {
+  GLint components;
+  GLenum type;
+  GLboolean normalized;
+  unsigned int size;
+};
+
+FormatInfo formatInfo(VertexFormat format) {
+  switch (format) {
+    case VertexFormat::Float2:
+      return {2, GL_FLOAT, GL_FALSE, 8};
+    case VertexFormat::Float3:
+      return {3, GL_FLOAT, GL_FALSE, 12};
+    case VertexFormat::Half2:
+      return {2, GL_HALF_FLOAT, GL_FALSE, 4};
+    case VertexFormat::Half4:
+      return {4, GL_HALF_FLOAT, GL_FALSE, 8};
+    case VertexFormat::UNorm16x2:
+      return {2, GL_UNSIGNED_SHORT, GL_TRUE, 4};
+    case VertexFormat::UNorm16x4:
+      return {4, GL_UNSIGNED_SHORT, GL_TRUE, 8};
+    case VertexFormat::SNorm16x2:
+      return {2, GL_SHORT, GL_TRUE, 4};
+  }
+  return {0, GL_FLOAT, GL_FALSE, 0};
+}
+
+uint16_t quantizeUNorm16(float value) {
+  return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+int16_t quantizeSNorm16(float value) {
+  return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+template <typename T, size_t N>
+void write(uint8_t* dst, const T (&values)[N]) {
+  std::memcpy(dst, values, sizeof(values));
+}
+}  // namespace
+
+VertexLayout& VertexLayout::add(VertexAttribute attribute, VertexFormat format) {
+  m_elements.push_back({attribute, format, m_stride});
+  m_stride += (formatSize(format) + 3) & ~3u;
+  return *this;
+}
+
+void VertexLayout::apply() const {
+  for (const auto& element : m_elements) {
+    FormatInfo info = formatInfo(element.format);
+    GLuint location = static_cast<GLuint>(element.attribute);
+    glVertexAttribPointer(location,
+                          info.components,
+                          info.type,
+                          info.normalized,
+                          m_stride,
+                          reinterpret_cast<void*>(static_cast<size_t>(element.offset)));
+    glEnableVertexAttribArray(location);
+  }
+}
+
+const VertexElement* VertexLayout::find(VertexAttribute attribute) const {
+  for (const auto& element : m_elements) {
+    if (element.attribute == attribute) {
+      return &element;
+    }
+  }
+  return nullptr;
+}
+
+unsigned int VertexLayout::formatSize(VertexFormat format) {
+  return formatInfo(format).size;
+}
+
+VertexLayout VertexEncoding::layout() const {
+  VertexLayout result;
+
+  switch (position) {
+    case PositionEncoding::Float:
+      result.add(VertexAttribute::Position, VertexFormat::Float3);
+      break;
+    case PositionEncoding::UNorm16:
+      result.add(VertexAttribute::Position, VertexFormat::UNorm16x4);
+      break;
+  }
+
+  switch (normal) {
+    case NormalEncoding::Float:
+      result.add(VertexAttribute::Normal, VertexFormat::Float3);
+      break;
+    case NormalEncoding::Octahedral16:
+      result.add(VertexAttribute::Normal, VertexFormat::SNorm16x2);
+      break;
+  }
+
+  switch (texCoord) {
+    case TexCoordEncoding::Float:
+      result.add(VertexAttribute::TexCoord, VertexFormat::Float2);
+      break;
+    case TexCoordEncoding::Half:
+      result.add(VertexAttribute::TexCoord, VertexFormat::Half2);
+      break;
+    case TexCoordEncoding::UNorm16:
+      result.add(VertexAttribute::TexCoord, VertexFormat::UNorm16x2);
+      break;
+  }
+
+  return result;
+}
+
+VertexEncoding VertexEncoding::uncompressed() {
+  return {PositionEncoding::Float, NormalEncoding::Float, TexCoordEncoding::Float};
+}
+
+VertexEncoding VertexEncoding::select(const MeshData& mesh, float maxPositionError) {
+  VertexEncoding encoding;
+
+  // unorm16 over the bounds is uniformly precise to 1/131070 of the extent. Half over the same
+  // bounds is at best 1/4096 near the edges, so it never fits where unorm16 doesn't.
+  glm::vec3 extent = mesh.bounds.isValid() ? mesh.bounds.extent() : glm::vec3(0.0f);
+  float maxExtent = std::max({extent.x, extent.y, extent.z});
+  if (maxExtent / 65535.0f * 0.5f > maxPositionError) {
+    encoding.position = PositionEncoding::Float;
+  }
+
+  glm::vec2 uvMin(0.0f), uvMax(0.0f);
+  if (!mesh.vertices.empty()) {
+    uvMin = uvMax = mesh.vertices[0].texCoord;
+  }
+  for (const auto& vertex : mesh.vertices) {
+    uvMin = glm::min(uvMin, vertex.texCoord);
+    uvMax = glm::max(uvMax, vertex.texCoord);
+  }
+
+  if (uvMin.x < 0.0f || uvMin.y < 0.0f || uvMax.x > 1.0f || uvMax.y > 1.0f) {
+    // Tiling uvs: half keeps about 1/32 texel precision on a 1k texture up to 64 repeats
+    float range = std::max({-uvMin.x, -uvMin.y, uvMax.x, uvMax.y});
+    encoding.texCoord = range <= 64.0f ? TexCoordEncoding::Half : TexCoordEncoding::Float;
+  }
+
+  return encoding;
+}
+
+EncodedVertices encodeVertices(const std::vector<Vertex>& vertices, const AABB& bounds, const VertexEncoding& encoding) {
+  EncodedVertices result;
+  result.layout = encoding.layout();
+  result.octahedralNormals = encoding.normal == NormalEncoding::Octahedral16;
+
+  const unsigned int stride = result.layout.getStride();
+  result.data.resize(vertices.size() * stride);
+
+  glm::vec3 boundsMin = bounds.isValid() ? bounds.min : glm::vec3(0.0f);
+  glm::vec3 extent = bounds.isValid() ? bounds.extent() : glm::vec3(0.0f);
+  glm::vec3 safeExtent = glm::max(extent, glm::vec3(1e-20f));
+
+  switch (encoding.position) {
+    case PositionEncoding::Float:
+      break;
+    case PositionEncoding::UNorm16:
+      result.positionScale = safeExtent;
+      result.positionOffset = boundsMin;
+      break;
+  }
+
+  for (size_t i = 0; i < vertices.size(); i++) {
+    const Vertex& vertex = vertices[i];
+    uint8_t* dst = result.data.data() + i * stride;
+
+    for (const auto& element : result.layout.getElements()) {
+      uint8_t* out = dst + element.offset;
+
+      switch (element.attribute) {
+        case VertexAttribute::Position: {
+          glm::vec3 p = (vertex.position - result.positionOffset) / result.positionScale;
+          if (encoding.position == PositionEncoding::Float) {
+            write(out, {vertex.position.x, vertex.position.y, vertex.position.z});
+          } else {
+            write(out, {quantizeUNorm16(p.x), quantizeUNorm16(p.y), quantizeUNorm16(p.z), uint16_t(65535)});
+          }
+          break;
+        }
+        case VertexAttribute::Normal: {
+          if (encoding.normal == NormalEncoding::Float) {
+            write(out, {vertex.normal.x, vertex.normal.y, vertex.normal.z});
+          } else {
+            glm::vec2 oct = encodeOctahedral(vertex.normal);
+            write(out, {quantizeSNorm16(oct.x), quantizeSNorm16(oct.y)});
+          }
+          break;
+        }
+        case VertexAttribute::TexCoord: {
+          const glm::vec2& uv = vertex.texCoord;
+          if (encoding.texCoord == TexCoordEncoding::Float) {
+            write(out, {uv.x, uv.y});
+          } else if (encoding.texCoord == TexCoordEncoding::Half) {
+            write(out, {floatToHalf(uv.x), floatToHalf(uv.y)});
+          } else {
+            write(out, {quantizeUNorm16(uv.x), quantizeUNorm16(uv.y)});
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+uint16_t floatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  uint32_t magnitude = bits & 0x7fffffffu;
+
+  if (magnitude >= 0x7f800000u) {
+    // Inf stays inf, NaN stays NaN
+    return static_cast<uint16_t>(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u));
+  }
+  if (magnitude >= 0x477ff000u) {
+    // Rounds past the largest half
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  }
+  if (magnitude < 0x38800000u) {
+    // Denormal half: shift the implicit-one mantissa into place with round to nearest even
+    if (magnitude < 0x33000000u) {
+      return static_cast<uint16_t>(sign);
+    }
+    uint32_t exponent = magnitude >> 23;
+    uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+    uint32_t shift = 126 - exponent;
+    uint32_t result = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (result & 1u))) {
+      result++;
+    }
+    return static_cast<uint16_t>(sign | result);
+  }
+
+  // Normal range: rebias the exponent and round the mantissa to nearest even
+  uint32_t result = (magnitude - 0x38000000u) >> 13;
+  uint32_t remainder = magnitude & 0x1fffu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (result & 1u))) {
+    result++;
+  }
+  return static_cast<uint16_t>(sign | result);
+}
+
+float halfToFloat(uint16_t value) {
+  uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+  uint32_t exponent = (value >> 10) & 0x1fu;
+  uint32_t mantissa = value & 0x3ffu;
+  uint32_t bits;
+
+  if (exponent == 0) {
+    // Zero or denormal
+    float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+    return sign ? -magnitude : magnitude;
+  } else if (exponent == 31) {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+glm::vec2 encodeOctahedral(const glm::vec3& normal) {
+  float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (l1 <= 0.0f) {
+    return glm::vec2(0.0f);
+  }
+
+  glm::vec3 n = normal / l1;
+  glm::vec2 result(n.x, n.y);
+  if (n.z < 0.0f) {
+    // Fold the lower hemisphere over the diagonals
+    result.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+    result.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+  }
+  return result;
+}
+
+glm::vec3 decodeOctahedral(const glm::vec2& encoded) {
+  glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+  float t = std::max(-n.z, 0.0f);
+  n.x += n.x >= 0.0f ? -t : t;
+  n.y += n.y >= 0.0f ? -t : t;
+  return glm::normalize(n);
+}
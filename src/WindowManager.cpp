@@ -129,12 +129,16 @@ void WindowManager::setupWindowHints() {
   // glfwWindowHint(GLFW_FLOATING, GLFW_TRUE);
   glfwWindowHint(GLFW_RESIZABLE, m_config.resizable ? GLFW_TRUE : GLFW_FALSE);
   glfwWindowHint(GLFW_DECORATED, m_config.decorated ? GLFW_TRUE : GLFW_FALSE);
+  glfwWindowHint(GLFW_VISIBLE, m_config.visible ? GLFW_TRUE : GLFW_FALSE);
 
   // Multisampling (MSAA)
   if (m_config.samples > 0) {
     glfwWindowHint(GLFW_SAMPLES, m_config.samples);
   }
 
+  // Lets GL_FRAMEBUFFER_SRGB encode the linear shader output
+  glfwWindowHint(GLFW_SRGB_CAPABLE, m_config.srgb ? GLFW_TRUE : GLFW_FALSE);
+
   // Double buffering (always enabled for games)
   glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
 }
@@ -2,10 +2,40 @@
 
 #include <exception>
 #include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+  EngineConfig config;
+  config.windowTitle = "MACHI-NGEN - OPENGL TEST";
+  config.windowWidth = 800;
+  config.windowHeight = 600;
+
+  // --golden <image> [--golden-frame N] [--tolerance T] renders without showing the window and
+  // compares a frame to the image, the exit code says whether it matched
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << argument << std::endl;
+      return -1;
+    }
+    if (argument == "--golden") {
+      config.goldenImage = argv[++i];
+    } else if (argument == "--golden-frame") {
+      config.goldenFrame = std::atoi(argv[++i]);
+    } else if (argument == "--tolerance") {
+      config.goldenTolerance = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "Unknown argument " << argument << std::endl;
+      return -1;
+    }
+  }
+  if (!config.goldenImage.empty()) {
+    config.hiddenWindow = true;
+    config.vsync = false;
+  }
 
-int main() {
   try {
-    Engine engine("MACHI-NGEN - OPENGL TEST", 800, 600);
+    Engine engine(config);
 
     if (!engine.initialize()) {
       std::cerr << "Failed to initialize engine!" << std::endl;
@@ -13,7 +43,7 @@ int main() {
     }
     engine.run();
 
-    return 0;
+    return engine.getExitCode();
   } catch (std::exception& e) {
     std::cerr << "Engine error: " << e.what() << std::endl;
     return -1;
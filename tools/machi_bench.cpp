@@ -0,0 +1,377 @@
+// machi_bench - times the engine's CPU hot paths, for comparing changes to them
+//
+//   machi_bench [suite ...] [--scale <factor>] [--repeat <count>]
+//
+// Suites: bvh, particles, ecs. Without a suite every one runs. --scale multiplies the problem sizes (1 = the sizes
+// the numbers in the commit history were taken at), each case runs --repeat times and prints its
+// best and median time. Exits with 1 when a suite's result check fails.
+
+#include "../include/BVH.hpp"
+#include "../include/ECS.hpp"
+#include "../include/Logger.hpp"
+#include "../include/JobSystem.hpp"
+#include "../include/ParticleSimulation.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+struct Options {
+  float scale = 1.0f;
+  int repeat = 5;
+
+  size_t scaled(size_t count) const {
+    return std::max<size_t>(static_cast<size_t>(count * scale), 1);
+  }
+};
+
+// Results go here so the optimizer can't drop the work that produced them
+volatile size_t sink = 0;
+
+// Runs setup untimed and then body, repeat times. items is what one run processes, for a per-item
+// time.
+void measure(const std::string& name,
+             const Options& options,
+             size_t items,
+             const std::function<void()>& setup,
+             const std::function<void()>& body) {
+  std::vector<double> times;
+  for (int i = 0; i < options.repeat; i++) {
+    if (setup) {
+      setup();
+    }
+    const auto start = std::chrono::high_resolution_clock::now();
+    body();
+    const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    times.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+  }
+  std::sort(times.begin(), times.end());
+  const double median = times[times.size() / 2];
+  std::cout << "  " << std::left << std::setw(34) << name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << times.front() << " ms best" << std::setw(10) << median << " ms median";
+  if (items > 0) {
+    std::cout << std::setprecision(1) << std::setw(10) << times.front() * 1e6 / items << " ns/item (" << items
+              << ")";
+  }
+  std::cout << std::endl;
+}
+
+glm::vec3 randomPoint(std::mt19937& rng, float extent) {
+  std::uniform_real_distribution<float> coordinate(-extent, extent);
+  return glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+}
+
+// A world of boxes the size of props, scattered through a kilometre cube
+bool benchBVH(const Options& options) {
+  const size_t count = options.scaled(100000);
+  std::mt19937 rng(26);
+  std::uniform_real_distribution<float> size(0.5f, 4.0f);
+  std::vector<BVHBuildItem> items(count);
+  for (size_t i = 0; i < count; i++) {
+    const glm::vec3 center = randomPoint(rng, 500.0f);
+    const glm::vec3 half(size(rng) * 0.5f, size(rng) * 0.5f, size(rng) * 0.5f);
+    items[i] = {AABB(center - half, center + half), static_cast<int>(i)};
+  }
+  auto jittered = [&rng](const AABB& box, float distance) {
+    const glm::vec3 offset = randomPoint(rng, distance);
+    return AABB(box.min + offset, box.max + offset);
+  };
+
+  BVH bvh;
+  std::vector<int> proxies;
+  measure("SAH build", options, count, nullptr, [&] { proxies = bvh.build(items); });
+  const BVHStats stats = bvh.computeStats();
+  std::cout << "    " << stats.nodeCount << " nodes, height " << stats.height << ", SAH cost " << stats.sahCost
+            << std::endl;
+
+  measure("Incremental insert", options, count, [&] { bvh.clear(); }, [&] {
+    for (size_t i = 0; i < count; i++) {
+      proxies[i] = bvh.insert(items[i].bounds, items[i].userData);
+    }
+  });
+
+  // Half the moves stay inside the fattened bounds, half leave them and reinsert
+  std::vector<AABB> moved(count);
+  measure("Move (dynamic)",
+          options,
+          count,
+          [&] {
+            for (size_t i = 0; i < count; i++) {
+              moved[i] = jittered(items[i].bounds, i % 2 ? 0.05f : 2.0f);
+            }
+          },
+          [&] {
+            for (size_t i = 0; i < count; i++) {
+              sink = sink + bvh.move(proxies[i], moved[i]);
+            }
+          });
+
+  measure("Refit (static)",
+          options,
+          count,
+          [&] {
+            proxies = bvh.build(items);
+            for (size_t i = 0; i < count; i++) {
+              bvh.setBounds(proxies[i], jittered(items[i].bounds, 0.5f));
+            }
+          },
+          [&] { bvh.refit(); });
+
+  proxies = bvh.build(items);
+  std::vector<int> results;
+  const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+  const int frustums = 16;
+  measure("Frustum query (16 views)", options, frustums, nullptr, [&] {
+    for (int i = 0; i < frustums; i++) {
+      const float angle = i * 6.28318f / frustums;
+      const glm::mat4 view =
+        glm::lookAt(glm::vec3(0.0f), glm::vec3(std::cos(angle), 0.0f, std::sin(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+      bvh.queryFrustum(Frustum::fromMatrix(projection * view), results);
+      sink = sink + results.size();
+    }
+  });
+
+  const size_t queries = options.scaled(10000);
+  std::vector<AABB> regions(queries);
+  std::vector<Ray> rays;
+  for (size_t i = 0; i < queries; i++) {
+    const glm::vec3 center = randomPoint(rng, 500.0f);
+    regions[i] = AABB(center - glm::vec3(10.0f), center + glm::vec3(10.0f));
+    rays.emplace_back(randomPoint(rng, 500.0f), glm::normalize(randomPoint(rng, 1.0f) + glm::vec3(1e-3f)));
+  }
+  measure("Overlap query (20 m boxes)", options, queries, nullptr, [&] {
+    for (const AABB& region : regions) {
+      bvh.queryOverlap(region, results);
+      sink = sink + results.size();
+    }
+  });
+  measure("Raycast (closest hit)", options, queries, nullptr, [&] {
+    for (const Ray& ray : rays) {
+      RaycastHit hit;
+      sink = sink + bvh.raycast(ray, 1000.0f, hit);
+    }
+  });
+  return true;
+}
+
+// The engine's demo fountains at a million live particles, on one thread so the numbers compare
+// across machines with different core counts. Each case starts from the same warmed up state.
+bool benchParticles(const Options& options) {
+  const float step = 1.0f / 60.0f;
+  const int fountains = 16;
+  ParticleSimulation warm;
+  for (int i = 0; i < fountains; i++) {
+    const float angle = i * 6.28318f / fountains;
+    ParticleEmitter emitter;
+    emitter.position = glm::vec3(std::cos(angle) * 6.0f, -4.0f, -6.0f + std::sin(angle) * 6.0f);
+    emitter.velocity = glm::vec3(0.0f, 7.0f, 0.0f);
+    emitter.velocitySpread = 1.5f;
+    emitter.minLifetime = 1.0f;
+    emitter.maxLifetime = 2.0f;
+    emitter.rate = options.scaled(1000000) / (fountains * 1.5f);  // Live = rate * mean lifetime
+    emitter.capacity = static_cast<int>(emitter.rate * emitter.maxLifetime) + 1;
+    warm.addEmitter(emitter);
+  }
+  // Past the longest lifetime, births and deaths balance from here on
+  for (int frame = 0; frame < 150; frame++) {
+    warm.simulate(step);
+  }
+  std::cout << "    " << warm.getAliveCount() << " alive, " << warm.getDiedCount() << " dying per frame" << std::endl;
+
+  ParticleSimulation simulation;
+  std::vector<uint8_t> instances;
+  for (bool simd : {true, false}) {
+    if (simd && !ParticleSimulation::hasSimd()) {
+      std::cout << "  SSE cases skipped, this build has no SSE2" << std::endl;
+      continue;
+    }
+    const std::string path = simd ? " (SSE)" : " (scalar)";
+    measure("Simulate" + path,
+            options,
+            warm.getAliveCount(),
+            [&] {
+              simulation = warm;
+              simulation.setSimd(simd);
+            },
+            [&] { simulation.simulate(step); });
+    instances.resize(simulation.getAliveCount() * ParticleSimulation::InstanceBytes);
+    measure("Pack" + path, options, simulation.getAliveCount(), nullptr, [&] {
+      simulation.pack(instances.data());
+    });
+  }
+  return true;
+}
+
+struct Position {
+  float x, y, z;
+};
+
+struct Velocity {
+  float x, y, z;
+};
+
+// A million moving entities, iterated by queries and by the same loop over plain arrays, which is
+// what the queries should stay close to. Then most of them are destroyed in random order and the
+// survivors iterated again, checking that the query visits exactly them.
+bool benchECS(const Options& options) {
+  const size_t count = options.scaled(1000000);
+  const float step = 1.0f / 60.0f;
+  std::unique_ptr<World> world;
+  std::vector<Entity> entities(count);
+  auto populate = [&] {
+    world = std::make_unique<World>();
+    for (size_t i = 0; i < count; i++) {
+      entities[i] = world->create(Position{static_cast<float>(i), 0.0f, 0.0f}, Velocity{1.0f, 2.0f, 3.0f});
+    }
+  };
+  measure("Create", options, count, nullptr, populate);
+  std::cout << "    " << world->getStats().chunks << " chunks" << std::endl;
+
+  auto query = world->query<Position, const Velocity>();
+  measure("Query forEach", options, count, nullptr, [&] {
+    query.forEach([step](Entity, Position& position, const Velocity& velocity) {
+      position.x += velocity.x * step;
+      position.y += velocity.y * step;
+      position.z += velocity.z * step;
+    });
+  });
+  measure("Query forEachChunk", options, count, nullptr, [&] {
+    query.forEachChunk([step](size_t n, const Entity*, Position* positions, const Velocity* velocities) {
+      for (size_t i = 0; i < n; i++) {
+        positions[i].x += velocities[i].x * step;
+        positions[i].y += velocities[i].y * step;
+        positions[i].z += velocities[i].z * step;
+      }
+    });
+  });
+  JobSystem jobs;
+  measure("Query parallel chunks (" + std::to_string(jobs.getWorkerCount() + 1) + " threads)",
+          options,
+          count,
+          nullptr,
+          [&] {
+            query.parallelForEachChunk(
+              &jobs, [step](size_t n, const Entity*, Position* positions, const Velocity* velocities) {
+                for (size_t i = 0; i < n; i++) {
+                  positions[i].x += velocities[i].x * step;
+                  positions[i].y += velocities[i].y * step;
+                  positions[i].z += velocities[i].z * step;
+                }
+              });
+          });
+
+  std::vector<Position> positions(count, Position{0.0f, 0.0f, 0.0f});
+  std::vector<Velocity> velocities(count, Velocity{1.0f, 2.0f, 3.0f});
+  measure("Plain arrays", options, count, nullptr, [&] {
+    for (size_t i = 0; i < count; i++) {
+      positions[i].x += velocities[i].x * step;
+      positions[i].y += velocities[i].y * step;
+      positions[i].z += velocities[i].z * step;
+    }
+  });
+
+  // Destroying moves the last entity of the archetype into the hole and frees the chunks left
+  // empty, all but one spare
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(50));
+  const size_t destroyed = count - count / 10;
+  measure("Destroy 90% (random order)", options, destroyed, populate, [&] {
+    for (size_t i = 0; i < destroyed; i++) {
+      world->destroy(entities[order[i]]);
+    }
+  });
+  std::cout << "    " << world->getStats().chunks << " chunks left" << std::endl;
+
+  size_t visited = 0;
+  double sum = 0.0;
+  auto survivors = world->query<const Position>();
+  measure("Query forEach after destroy", options, count - destroyed, nullptr, [&] {
+    visited = 0;
+    sum = 0.0;
+    survivors.forEach([&](Entity, const Position& position) {
+      visited++;
+      sum += position.x;
+    });
+  });
+  double expected = 0.0;
+  for (size_t i = destroyed; i < count; i++) {
+    expected += static_cast<double>(order[i]);
+  }
+  if (visited != count - destroyed || sum != expected) {
+    std::cerr << "ECS check failed: visited " << visited << " of " << count - destroyed << " survivors" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+struct Suite {
+  const char* name;
+  bool (*run)(const Options& options);  // false when a result check failed
+};
+
+const Suite suites[] = {
+  {"bvh", benchBVH},
+  {"particles", benchParticles},
+  {"ecs", benchECS},
+};
+
+void printUsage() {
+  std::cerr << "Usage: machi_bench [suite ...] [--scale <factor>] [--repeat <count>]\n"
+               "Suites:";
+  for (const Suite& suite : suites) {
+    std::cerr << " " << suite.name;
+  }
+  std::cerr << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  std::vector<const Suite*> selected;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--scale" && i + 1 < argc) {
+      options.scale = std::stof(argv[++i]);
+    } else if (arg == "--repeat" && i + 1 < argc) {
+      options.repeat = std::max(std::stoi(argv[++i]), 1);
+    } else if (arg == "-h" || arg == "--help") {
+      printUsage();
+      return 0;
+    } else {
+      auto suite = std::find_if(std::begin(suites), std::end(suites), [&](const Suite& s) { return arg == s.name; });
+      if (suite == std::end(suites)) {
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        printUsage();
+        return 1;
+      }
+      selected.push_back(suite);
+    }
+  }
+  if (selected.empty()) {
+    for (const Suite& suite : suites) {
+      selected.push_back(&suite);
+    }
+  }
+
+  Logger::getInstance().setLogLevel(LogLevel::ERROR);
+  bool passed = true;
+  for (const Suite* suite : selected) {
+    std::cout << suite->name << std::endl;
+    passed = suite->run(options) && passed;
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,368 @@
+// machi_cook - cooks a resource directory into one memory-mappable pack the engine loads from
+//
+//   machi_cook <resource dir> [-o output.mpak] [--force]
+//
+// Images become BCn KTX2 with their whole mip chain, meshes (.obj) go through the mesh optimizer
+// and are stored ready to upload, shaders and .mtlx files are stored as they are. Without -o the
+// pack is written to <resource dir>/assets.mpak, where the engine looks for it. Assets whose
+// source and cook settings hash the same as in the existing pack are copied over without being
+// cooked again; --force cooks everything.
+
+#include "../include/BCEncoder.hpp"
+#include "../include/Logger.hpp"
+#include "../include/MeshData.hpp"
+#include "../include/MeshOptimizer.hpp"
+#include "../include/PackFile.hpp"
+#include "../include/Utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+// Bump when a cooker changes its output, so every asset is cooked again
+const uint32_t CookVersion = 1;
+
+struct CookedAsset {
+  std::string name;
+  AssetType type = AssetType::Raw;
+  uint64_t contentHash = 0;
+  std::vector<uint8_t> data;
+};
+
+void printUsage() {
+  std::cerr << "Usage: machi_cook <resource dir> [-o output.mpak] [--force]" << std::endl;
+}
+
+std::string lowercaseExtension(const std::filesystem::path& path) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return extension;
+}
+
+// Which cooker handles a file, false for files that don't go in the pack
+bool classify(const std::string& extension, AssetType& type) {
+  if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" ||
+      extension == ".bmp" || extension == ".ktx2" || extension == ".dds") {
+    type = AssetType::Texture;
+  } else if (extension == ".glsl" || extension == ".vert" || extension == ".frag" || extension == ".geom" ||
+             extension == ".comp") {
+    type = AssetType::Shader;
+  } else if (extension == ".obj") {
+    type = AssetType::Mesh;
+  } else if (extension == ".mtlx" || extension == ".ttf") {
+    type = AssetType::Raw;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool cookTexture(const std::string& path, const std::vector<uint8_t>& source, std::vector<uint8_t>& out) {
+  const std::string extension = lowercaseExtension(path);
+  CompressedImage compressed;
+  if (extension == ".ktx2" || extension == ".dds") {
+    // Already compressed, only the container is normalized to KTX2
+    bool loaded = extension == ".dds" ? CompressedImage::loadDDS(source.data(), source.size(), compressed)
+                                      : CompressedImage::loadKTX2(source.data(), source.size(), compressed);
+    if (!loaded) {
+      return false;
+    }
+  } else {
+    const TextureUsage usage = usageFromPath(path);
+    Utils::Image image = Utils::loadImage(path, false, 4);
+    if (!image.data) {
+      return false;
+    }
+    compressed = BCEncoder::compress(image.data, image.width, image.height, BCEncoder::chooseFormat(usage), usage);
+    Utils::freeImage(image);
+  }
+  out = compressed.encodeKTX2();
+  return true;
+}
+
+// Positions, uvs and normals of triangles and polygons (fanned), everything else is ignored
+bool parseOBJ(const std::string& text, MeshData& mesh) {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texCoords;
+  std::vector<glm::vec3> normals;
+  bool hasNormals = true;
+
+  auto resolve = [](int index, size_t count) -> int {
+    return index < 0 ? static_cast<int>(count) + index : index - 1;
+  };
+
+  std::istringstream stream(text);
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::istringstream tokens(line);
+    std::string keyword;
+    tokens >> keyword;
+    if (keyword == "v") {
+      glm::vec3 p(0.0f);
+      tokens >> p.x >> p.y >> p.z;
+      positions.push_back(p);
+    } else if (keyword == "vt") {
+      glm::vec2 t(0.0f);
+      tokens >> t.x >> t.y;
+      texCoords.push_back(t);
+    } else if (keyword == "vn") {
+      glm::vec3 n(0.0f);
+      tokens >> n.x >> n.y >> n.z;
+      normals.push_back(n);
+    } else if (keyword == "f") {
+      std::vector<Vertex> face;
+      std::string corner;
+      while (tokens >> corner) {
+        int indices[3] = {0, 0, 0};
+        if (std::sscanf(corner.c_str(), "%d/%d/%d", &indices[0], &indices[1], &indices[2]) != 3 &&
+            std::sscanf(corner.c_str(), "%d//%d", &indices[0], &indices[2]) != 2 &&
+            std::sscanf(corner.c_str(), "%d/%d", &indices[0], &indices[1]) != 2 &&
+            std::sscanf(corner.c_str(), "%d", &indices[0]) != 1) {
+          return false;
+        }
+
+        Vertex vertex;
+        int position = resolve(indices[0], positions.size());
+        if (position < 0 || position >= static_cast<int>(positions.size())) {
+          return false;
+        }
+        vertex.position = positions[position];
+        int texCoord = resolve(indices[1], texCoords.size());
+        vertex.texCoord = indices[1] != 0 && texCoord >= 0 && texCoord < static_cast<int>(texCoords.size())
+                            ? texCoords[texCoord]
+                            : glm::vec2(0.0f);
+        int normal = resolve(indices[2], normals.size());
+        if (indices[2] != 0 && normal >= 0 && normal < static_cast<int>(normals.size())) {
+          vertex.normal = normals[normal];
+        } else {
+          hasNormals = false;
+        }
+        face.push_back(vertex);
+      }
+
+      for (size_t i = 2; i < face.size(); i++) {
+        for (const Vertex& vertex : {face[0], face[i - 1], face[i]}) {
+          mesh.indices.push_back(static_cast<unsigned int>(mesh.vertices.size()));
+          mesh.vertices.push_back(vertex);
+        }
+      }
+    }
+  }
+
+  if (mesh.indices.empty()) {
+    return false;
+  }
+  mesh.lods.push_back({0, static_cast<unsigned int>(mesh.indices.size()), 0.0f});
+  mesh.computeBounds();
+  if (!hasNormals) {
+    mesh.computeNormals();
+  }
+  return true;
+}
+
+bool cookMesh(const std::vector<uint8_t>& source, std::vector<uint8_t>& out) {
+  MeshData mesh;
+  if (!parseOBJ(std::string(source.begin(), source.end()), mesh)) {
+    return false;
+  }
+  MeshOptimizer::optimize(mesh);
+  out = mesh.serialize();
+  return true;
+}
+
+void writePadding(std::ofstream& file, uint64_t& offset) {
+  static const char zeros[PackFormat::Alignment] = {};
+  uint64_t padding = (PackFormat::Alignment - offset % PackFormat::Alignment) % PackFormat::Alignment;
+  file.write(zeros, static_cast<std::streamsize>(padding));
+  offset += padding;
+}
+
+bool writePack(const std::string& filepath, const std::vector<CookedAsset>& assets) {
+  std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  PackFormat::Header header = {};
+  std::memcpy(header.magic, PackFormat::Magic, sizeof(header.magic));
+  header.version = PackFormat::Version;
+  header.entryCount = static_cast<uint32_t>(assets.size());
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  uint64_t offset = sizeof(header);
+
+  std::vector<PackFormat::Entry> entries;
+  std::string strings;
+  for (const CookedAsset& asset : assets) {
+    writePadding(file, offset);
+    PackFormat::Entry entry = {};
+    entry.nameHash = PackFormat::hash(asset.name.data(), asset.name.size());
+    entry.contentHash = asset.contentHash;
+    entry.offset = offset;
+    entry.size = asset.data.size();
+    entry.nameOffset = static_cast<uint32_t>(strings.size());
+    entry.nameLength = static_cast<uint32_t>(asset.name.size());
+    entry.type = static_cast<uint32_t>(asset.type);
+    entries.push_back(entry);
+    strings += asset.name;
+
+    file.write(reinterpret_cast<const char*>(asset.data.data()), static_cast<std::streamsize>(asset.data.size()));
+    offset += asset.data.size();
+  }
+
+  // Sorted by hash for the runtime's binary search, ties keep their name order
+  std::stable_sort(entries.begin(), entries.end(), [](const PackFormat::Entry& a, const PackFormat::Entry& b) {
+    return a.nameHash < b.nameHash;
+  });
+
+  writePadding(file, offset);
+  header.tocOffset = offset;
+  file.write(reinterpret_cast<const char*>(entries.data()),
+             static_cast<std::streamsize>(entries.size() * sizeof(PackFormat::Entry)));
+  offset += entries.size() * sizeof(PackFormat::Entry);
+  header.stringTableOffset = offset;
+  header.stringTableSize = static_cast<uint32_t>(strings.size());
+  file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  return file.good();
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string input;
+  std::string output;
+  bool force = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc) {
+      output = argv[++i];
+    } else if (arg == "--force") {
+      force = true;
+    } else if (arg == "-h" || arg == "--help") {
+      printUsage();
+      return 0;
+    } else if (input.empty() && arg[0] != '-') {
+      input = arg;
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      printUsage();
+      return 1;
+    }
+  }
+
+  if (input.empty() || !std::filesystem::is_directory(input)) {
+    printUsage();
+    return 1;
+  }
+  if (output.empty()) {
+    output = (std::filesystem::path(input) / "assets.mpak").string();
+  }
+
+  Logger::getInstance().setLogLevel(LogLevel::ERROR);
+  auto start = std::chrono::high_resolution_clock::now();
+
+  // Blobs of the previous pack are reused when nothing that went into them changed
+  PackFile previous;
+  if (!force && std::filesystem::exists(output)) {
+    previous.open(output);
+  }
+
+  std::vector<std::filesystem::path> files;
+  for (const auto& item : std::filesystem::recursive_directory_iterator(input)) {
+    if (item.is_regular_file()) {
+      files.push_back(item.path());
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  std::vector<CookedAsset> assets;
+  int cooked = 0;
+  int reused = 0;
+  int failed = 0;
+  for (const auto& file : files) {
+    AssetType type;
+    if (!classify(lowercaseExtension(file), type)) {
+      continue;
+    }
+
+    CookedAsset asset;
+    asset.name = file.lexically_relative(input).generic_string();
+    asset.type = type;
+
+    std::vector<uint8_t> source;
+    try {
+      source = Utils::loadBinaryFile(file.string(), false);
+    } catch (const std::exception&) {
+      std::cerr << "Unable to read " << file.string() << std::endl;
+      failed++;
+      continue;
+    }
+    const std::string settings = std::to_string(CookVersion) + "|" + std::to_string(static_cast<uint32_t>(type)) +
+                                 "|" + std::to_string(static_cast<int>(usageFromPath(file.string())));
+    asset.contentHash = PackFormat::hash(source.data(), source.size());
+    asset.contentHash = PackFormat::hash(settings.data(), settings.size(), asset.contentHash);
+
+    AssetView existing = previous.isOpen() ? previous.find(asset.name) : AssetView();
+    if (existing && existing.contentHash == asset.contentHash && existing.type == type) {
+      asset.data.assign(existing.data, existing.data + existing.size);
+      assets.push_back(std::move(asset));
+      reused++;
+      continue;
+    }
+
+    bool success = true;
+    switch (type) {
+      case AssetType::Texture:
+        success = cookTexture(file.string(), source, asset.data);
+        break;
+      case AssetType::Mesh:
+        success = cookMesh(source, asset.data);
+        break;
+      case AssetType::Shader:
+      case AssetType::Raw:
+        asset.data = std::move(source);
+        break;
+    }
+
+    if (!success) {
+      std::cerr << "Unable to cook " << file.string() << std::endl;
+      failed++;
+      continue;
+    }
+    std::cout << "  " << asset.name << " (" << asset.data.size() / 1024 << " KB)" << std::endl;
+    assets.push_back(std::move(asset));
+    cooked++;
+  }
+
+  // Written next to the old pack first, which stays mapped until everything is copied out of it
+  const std::string temporary = output + ".tmp";
+  if (!writePack(temporary, assets)) {
+    std::cerr << "Unable to write " << temporary << std::endl;
+    return 1;
+  }
+  previous.close();
+  std::error_code error;
+  std::filesystem::rename(temporary, output, error);
+  if (error) {
+    std::cerr << "Unable to replace " << output << ": " << error.message() << std::endl;
+    return 1;
+  }
+
+  float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+  std::cout << output << ": " << assets.size() << " asset(s), " << cooked << " cooked, " << reused << " up to date, "
+            << failed << " failed, " << std::filesystem::file_size(output) / 1024 << " KB, " << seconds << "s"
+            << std::endl;
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+// machi_texc - compresses source images into BCn KTX2/DDS files the engine loads directly
+//
+//   machi_texc <image> [-o output.ktx2|.dds] [--format bc1|bc3|bc4|bc5|bc7]
+//              [--usage color|normal|mask|data] [--no-mips]
+//
+// Without -o the result is written next to the image as .ktx2, which Texture picks up in place of
+// the source. The usage is guessed from the file name (_Normal, _Roughness ...) when not given.
+
+#include "../include/BCEncoder.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Utils.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace {
+void printUsage() {
+  std::cerr << "Usage: machi_texc <image> [-o output.ktx2|.dds] [--format bc1|bc3|bc4|bc5|bc7]\n"
+               "                  [--usage color|normal|mask|data] [--no-mips]"
+            << std::endl;
+}
+
+bool parseFormat(const std::string& name, BlockFormat& format) {
+  const std::pair<const char*, BlockFormat> formats[] = {
+    {"bc1", BlockFormat::BC1},
+    {"bc3", BlockFormat::BC3},
+    {"bc4", BlockFormat::BC4},
+    {"bc5", BlockFormat::BC5},
+    {"bc7", BlockFormat::BC7},
+  };
+  for (const auto& [key, value] : formats) {
+    if (name == key) {
+      format = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parseUsage(const std::string& name, TextureUsage& usage) {
+  const std::pair<const char*, TextureUsage> usages[] = {
+    {"color", TextureUsage::Color},
+    {"normal", TextureUsage::Normal},
+    {"mask", TextureUsage::Mask},
+    {"data", TextureUsage::Data},
+  };
+  for (const auto& [key, value] : usages) {
+    if (name == key) {
+      usage = value;
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string input;
+  std::string output;
+  std::string formatName;
+  std::string usageName;
+  bool generateMips = true;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc) {
+      output = argv[++i];
+    } else if (arg == "--format" && i + 1 < argc) {
+      formatName = argv[++i];
+    } else if (arg == "--usage" && i + 1 < argc) {
+      usageName = argv[++i];
+    } else if (arg == "--no-mips") {
+      generateMips = false;
+    } else if (arg == "-h" || arg == "--help") {
+      printUsage();
+      return 0;
+    } else if (input.empty() && arg[0] != '-') {
+      input = arg;
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      printUsage();
+      return 1;
+    }
+  }
+
+  if (input.empty()) {
+    printUsage();
+    return 1;
+  }
+  if (output.empty()) {
+    output = std::filesystem::path(input).replace_extension(".ktx2").string();
+  }
+
+  TextureUsage usage = usageFromPath(input);
+  if (!usageName.empty() && !parseUsage(usageName, usage)) {
+    std::cerr << "Unknown usage: " << usageName << std::endl;
+    return 1;
+  }
+  BlockFormat format = BCEncoder::chooseFormat(usage);
+  if (!formatName.empty() && !parseFormat(formatName, format)) {
+    std::cerr << "Unknown format: " << formatName << std::endl;
+    return 1;
+  }
+
+  Logger::getInstance().setLogLevel(LogLevel::ERROR);
+  Utils::Image image = Utils::loadImage(input, false, 4);
+  if (!image.data) {
+    std::cerr << "Unable to load " << input << std::endl;
+    return 1;
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  CompressedImage compressed =
+    BCEncoder::compress(image.data, image.width, image.height, format, usage, generateMips);
+  float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+  Utils::freeImage(image);
+
+  if (!compressed.save(output)) {
+    std::cerr << "Unable to write " << output << std::endl;
+    return 1;
+  }
+
+  size_t compressedBytes = 0;
+  for (const auto& mip : compressed.mips) {
+    compressedBytes += mip.data.size();
+  }
+  size_t sourceBytes = static_cast<size_t>(compressed.width) * compressed.height * 4 * 4 / 3;
+
+  std::cout << input << " -> " << output << ": " << compressed.width << "x" << compressed.height << " "
+            << blockFormatName(format) << (compressed.srgb ? " sRGB" : "") << ", " << compressed.mips.size()
+            << " mip(s), " << compressedBytes / 1024 << " KB (RGBA8 " << sourceBytes / 1024 << " KB), " << seconds
+            << "s" << std::endl;
+  return 0;
+}